@@ -30,11 +30,14 @@ namespace SOS.Hosting
     [Command(Name = "eeversion",         DefaultOptions = "EEVersion",           Help = "Displays information about the runtime version.")]
     [Command(Name = "ehinfo",            DefaultOptions = "EHInfo",              Help = "Displays the exception handling blocks in a JIT-ed method.")]
     [Command(Name = "enummem",           DefaultOptions = "enummem",             Help = "ICLRDataEnumMemoryRegions.EnumMemoryRegions test command.")]
+    [Command(Name = "exportilmap",       DefaultOptions = "ExportILMap",         Help = "Writes the IL to native maps, with source lines, of the jitted methods in a module to a file.")]
     [Command(Name = "findappdomain",     DefaultOptions = "FindAppDomain",       Help = "Attempts to resolve the AppDomain of a GC object.")]
     [Command(Name = "gchandles",         DefaultOptions = "GCHandles",           Help = "Provides statistics about GCHandles in the process.")]
     [Command(Name = "gcinfo",            DefaultOptions = "GCInfo",              Help = "Displays JIT GC encoding for a method.")]
     [Command(Name = "ip2md",             DefaultOptions = "IP2MD",               Help = "Displays the MethodDesc structure at the specified address in code that has been JIT-compiled.")]
     [Command(Name = "printexception",    DefaultOptions = "PrintException",      Aliases = new string[] { "pe" }, Help = "Displays and formats fields of any object derived from the Exception class at the specified address.")]
+    [Command(Name = "saveallmodules",    DefaultOptions = "SaveAllModules",      Help = "Saves every managed assembly in the target to a folder.")]
+    [Command(Name = "savemodule",        DefaultOptions = "SaveModule",          Help = "Saves a managed assembly loaded in the target to a file.")]
     [Command(Name = "syncblk",           DefaultOptions = "SyncBlk",             Help = "Displays the SyncBlock holder info.")]
     [Command(Name = "threadstate",       DefaultOptions = "ThreadState",         Help = "Pretty prints the meaning of a threads state.")]
     public class SOSCommand : SOSCommandBase
@@ -64,6 +67,21 @@ public class WindowsSOSCommand : SOSCommandBase
                 target != null && target.OperatingSystem == OSPlatform.Windows && SOSCommandBase.Filter(managedOnly, runtime);
     }
 
+    [Command(Name = "vmmap",             DefaultOptions = "VMMap",               Help = "Lists the memory mappings of the target with their protection, type and runtime owner.")]
+    [Command(Name = "vmstat",            DefaultOptions = "VMStat",              Help = "Displays a summary of the target's address space by type and runtime owner.")]
+    public class UnixSOSCommand : SOSCommandBase
+    {
+        /// <summary>
+        /// These commands need the host to enumerate the target's memory regions (ILLDBServices3)
+        /// and are only hosted through LLDBServices on Linux and MacOS.
+        /// </summary>
+        [FilterInvoke]
+        public static bool FilterInvoke(
+            [ServiceImport(Optional = true)] ManagedOnlyCommandFilter managedOnly,
+            [ServiceImport(Optional = true)] IRuntime runtime) =>
+                !RuntimeInformation.IsOSPlatform(OSPlatform.Windows) && SOSCommandBase.Filter(managedOnly, runtime);
+    }
+
     public class SOSCommandBase : CommandBase
     {
         /// <summary>
@@ -5,6 +5,7 @@
 using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
+using System.Linq;
 using System.Runtime.InteropServices;
 using System.Text;
 using Microsoft.Diagnostics.DebugServices;
@@ -17,10 +18,12 @@ public sealed unsafe class LLDBServices : COMCallableIUnknown
     {
         public static readonly Guid IID_ILLDBServices = new("2E6C569A-9E14-4DA4-9DFC-CDB73A532566");
         public static readonly Guid IID_ILLDBServices2 = new("012F32F0-33BA-4E8E-BC01-037D382D8A5E");
+        public static readonly Guid IID_ILLDBServices3 = new("5A3B6E1C-8F2D-4C47-9B1E-6D0C2A7F4E93");
 
         public IntPtr ILLDBServices { get; }
 
         private readonly SOSHost _soshost;
+        private readonly IMemoryRegionService _memoryRegionService;
 
         /// <summary>
         /// Create an instance of the service wrapper SOS uses.
@@ -81,8 +84,20 @@ internal LLDBServices(SOSHost soshost)
             builder.AddMethod(new AddModuleSymbolDelegate(AddModuleSymbol));
             builder.AddMethod(new GetModuleInfoDelegate(GetModuleInfo));
             builder.AddMethod(new GetModuleVersionInformationDelegate(soshost.GetModuleVersionInformation));
+            // Fills the last native ILLDBServices2 slot; bpmd calls it when the runtime isn't loaded yet
+            builder.AddMethod(new SetRuntimeLoadedCallbackDelegate((self, callback) => HResult.E_NOTIMPL));
             builder.Complete();
 
+            // Only expose ILLDBServices3 when the target can enumerate its memory
+            // regions; without it vmmap/vmstat report that the host doesn't support them.
+            _memoryRegionService = soshost.Target.Services.GetService<IMemoryRegionService>();
+            if (_memoryRegionService is not null)
+            {
+                builder = AddInterface(IID_ILLDBServices3, validate: false);
+                builder.AddMethod(new EnumerateMemoryRegionsDelegate(EnumerateMemoryRegions));
+                builder.Complete();
+            }
+
             AddRef();
         }
 
@@ -210,6 +225,37 @@ protected override void Destroy()
 
         #endregion
 
+        #region ILLDBServices3
+
+        private int EnumerateMemoryRegions(
+            IntPtr self,
+            MemoryRegionCallback callback,
+            IntPtr parameter)
+        {
+            if (callback is null)
+            {
+                return HResult.E_INVALIDARG;
+            }
+            try
+            {
+                foreach (IMemoryRegion region in _memoryRegionService.EnumerateRegions().OrderBy((region) => region.Start))
+                {
+                    if (region.State == MemoryRegionState.MEM_FREE)
+                    {
+                        continue;
+                    }
+                    callback(parameter, region.Start, region.End, (uint)region.Protection, region.Image);
+                }
+            }
+            catch (DiagnosticsException)
+            {
+                return HResult.E_FAIL;
+            }
+            return HResult.S_OK;
+        }
+
+        #endregion
+
         #region ILLDBServices delegates
 
         [UnmanagedFunctionPointer(CallingConvention.Winapi)]
@@ -511,6 +557,31 @@ protected override void Destroy()
             [In] uint bufferSize,
             [Out] uint* verInfoSize);
 
+        [UnmanagedFunctionPointer(CallingConvention.Winapi)]
+        private delegate int SetRuntimeLoadedCallbackDelegate(
+            IntPtr self,
+            [In] IntPtr callback);
+
+        #endregion
+
+        #region ILLDBServices3 delegates
+
+        /// <summary>
+        /// The EnumerateMemoryRegionsDelegate callback
+        /// </summary>
+        private delegate void MemoryRegionCallback(
+            IntPtr parameter,
+            [In] ulong start,
+            [In] ulong end,
+            [In] uint protect,
+            [In, MarshalAs(UnmanagedType.LPStr)] string name);
+
+        [UnmanagedFunctionPointer(CallingConvention.Winapi)]
+        private delegate int EnumerateMemoryRegionsDelegate(
+            IntPtr self,
+            [In] MemoryRegionCallback callback,
+            [In] IntPtr parameter);
+
         #endregion
     }
 }
@@ -115,6 +115,7 @@ ClrmaManagedAnalysis::QueryDebugClient(IUnknown* pUnknown)
 void
 ClrmaManagedAnalysis::ReleaseDebugClient()
 {
+    m_methodDescCache.clear();
     if (m_clrData != nullptr)
     {
         m_clrData->Release();
@@ -533,18 +534,20 @@ ClrmaManagedAnalysis::get_ObjectInspection(
     return E_NOTIMPL;
 }
 
-HRESULT
-ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame& frame, bool stripFunctionParameters)
+//
+// Resolves the module and method names for the MethodDesc. Returns false if the
+// result depends on the IP and can't be cached for the MethodDesc.
+//
+bool
+ClrmaManagedAnalysis::ResolveMethodDesc(CLRDATA_ADDRESS methodDesc, ULONG64 ip, MethodDescInfo& info)
 {
+    bool cacheable = true;
     HRESULT hr;
     DacpMethodDescData methodDescData;
     if (SUCCEEDED(hr = methodDescData.Request(SosDacInterface(), methodDesc)))
     {
-        // Don't compute the method displacement if IP is 0
-        if (frame.IP > 0)
-        {
-            frame.Displacement = (frame.IP - methodDescData.NativeCodeAddr);
-        }
+        info.Resolved = true;
+        info.NativeCodeAddr = methodDescData.NativeCodeAddr;
 
         DacpModuleData moduleData;
         if (SUCCEEDED(hr = moduleData.Request(SosDacInterface(), methodDescData.ModulePtr)))
@@ -554,13 +557,17 @@ ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame&
             if (FAILED(hr = SosDacInterface()->GetPEFileBase(moduleData.PEAssembly, &baseAddress)) || baseAddress == 0)
             {
                 TraceInformation("GetMethodDescInfo(%016llx) GetPEFileBase %016llx FAILED %08x\n", methodDesc, moduleData.PEAssembly, hr);
-                if (FAILED(hr = m_debugSymbols->GetModuleByOffset(frame.IP, 0, &index, &baseAddress)))
+
+                // The module found from the IP is only valid for this frame
+                cacheable = false;
+                if (FAILED(hr = m_debugSymbols->GetModuleByOffset(ip, 0, &index, &baseAddress)))
                 {
                     TraceError("GetMethodDescInfo GetModuleByOffset FAILED %08x\n", hr);
                     baseAddress = 0;
                     index = DEBUG_ANY_ID;
                 }
             }
+            info.ModuleBase = baseAddress;
 
             // Attempt to get the module name from the debugger
             ArrayHolder<WCHAR> wszModuleName = new WCHAR[MAX_LONGPATH + 1];
@@ -569,7 +576,7 @@ ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame&
 #ifndef FEATURE_PAL
                 if (SUCCEEDED(hr = m_debugSymbols->GetModuleNameStringWide(DEBUG_MODNAME_MODULE, index, baseAddress, wszModuleName, MAX_LONGPATH, nullptr)))
                 {
-                    frame.Module = wszModuleName;
+                    info.Module = wszModuleName;
                 }
                 else
                 {
@@ -587,7 +594,7 @@ ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame&
                     {
                         moduleName.push_back((WCHAR)(unsigned char)*p);
                     }
-                    frame.Module = moduleName;
+                    info.Module = moduleName;
                 }
                 else
                 {
@@ -597,7 +604,7 @@ ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame&
             }
 
             // Fallback if we can't get it from the debugger
-            if (frame.Module.empty())
+            if (info.Module.empty())
             {
                 wszModuleName[0] = L'\0';
                 if (FAILED(hr = SosDacInterface()->GetPEFileName(moduleData.PEAssembly, MAX_LONGPATH, wszModuleName, nullptr)))
@@ -619,12 +626,12 @@ ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame&
                 }
                 if (wszModuleName[0] != L'\0')
                 {
-                    frame.Module = wszModuleName;
+                    info.Module = wszModuleName;
                     _ASSERTE(m_fileSeparator != 0);
-                    size_t nameStart = frame.Module.find_last_of(m_fileSeparator);
+                    size_t nameStart = info.Module.find_last_of(m_fileSeparator);
                     if (nameStart != -1)
                     {
-                        frame.Module = frame.Module.substr(nameStart + 1);
+                        info.Module = info.Module.substr(nameStart + 1);
                     }
                 }
             }
@@ -637,29 +644,19 @@ ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame&
         ArrayHolder<WCHAR> wszNameBuffer = new WCHAR[MAX_LONGPATH + 1];
         if (SUCCEEDED(hr = SosDacInterface()->GetMethodDescName(methodDesc, MAX_LONGPATH, wszNameBuffer, NULL)))
         {
-            frame.Function = wszNameBuffer;
+            info.Function = wszNameBuffer;
 
             // Under certain circumstances DacpMethodDescData::GetMethodDescName() returns a module qualified method name
-            size_t nameStart = frame.Function.find_first_of(L'!');
+            size_t nameStart = info.Function.find_first_of(L'!');
             if (nameStart != -1)
             {
                 // Fallback to using the module name from the function name
-                if (frame.Module.empty())
+                if (info.Module.empty())
                 {
-                    frame.Module = frame.Function.substr(0, nameStart);
+                    info.Module = info.Function.substr(0, nameStart);
                 }
                 // Now strip the module name from the function name. Need to do this after the module name fallback
-                frame.Function = frame.Function.substr(nameStart + 1);
-            }
-
-            // Strip off the function parameters
-            if (stripFunctionParameters)
-            {
-                size_t parameterStart = frame.Function.find_first_of(L'(');
-                if (parameterStart != -1)
-                {
-                    frame.Function = frame.Function.substr(0, parameterStart);
-                }
+                info.Function = info.Function.substr(nameStart + 1);
             }
         }
         else
@@ -671,13 +668,54 @@ ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame&
     {
         TraceError("GetMethodDescInfo(%016llx) ISOSDacInterface::GetMethodDescData FAILED %08x\n", methodDesc, hr);
     }
-    if (frame.Module.empty())
+    if (info.Module.empty())
+    {
+        info.Module = W("UNKNOWN");
+    }
+    if (info.Function.empty())
+    {
+        info.Function = W("UNKNOWN");
+    }
+    return cacheable;
+}
+
+HRESULT
+ClrmaManagedAnalysis::GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame& frame, bool stripFunctionParameters)
+{
+    // Threads and exceptions share the same hot frames so the names are
+    // only resolved once for each MethodDesc.
+    MethodDescInfo uncachedInfo;
+    const MethodDescInfo* info;
+    auto found = m_methodDescCache.find(methodDesc);
+    if (found != m_methodDescCache.end())
+    {
+        info = &found->second;
+    }
+    else if (ResolveMethodDesc(methodDesc, frame.IP, uncachedInfo))
+    {
+        info = &m_methodDescCache.emplace(methodDesc, std::move(uncachedInfo)).first->second;
+    }
+    else
+    {
+        info = &uncachedInfo;
+    }
+
+    // Don't compute the method displacement if IP is 0
+    if (info->Resolved && frame.IP > 0)
     {
-        frame.Module = W("UNKNOWN");
+        frame.Displacement = (frame.IP - info->NativeCodeAddr);
     }
-    if (frame.Function.empty())
+    frame.Module = info->Module;
+    frame.Function = info->Function;
+
+    // Strip off the function parameters
+    if (stripFunctionParameters)
     {
-        frame.Function = W("UNKNOWN");
+        size_t parameterStart = frame.Function.find_first_of(L'(');
+        if (parameterStart != -1)
+        {
+            frame.Function = frame.Function.substr(0, parameterStart);
+        }
     }
     return S_OK;
 }
@@ -20,6 +20,7 @@
 #include <extensions.h>
 #include <target.h>
 #include <runtime.h>
+#include <unordered_map>
 #include <vector>
 
 #ifdef FEATURE_PAL
@@ -63,6 +64,16 @@ typedef struct StackFrame
     std::basic_string<WCHAR> Function;
 } StackFrame;
 
+// The module and method names resolved for a MethodDesc
+struct MethodDescInfo
+{
+    bool Resolved = false;                  // the MethodDesc data request succeeded
+    CLRDATA_ADDRESS NativeCodeAddr = 0;
+    CLRDATA_ADDRESS ModuleBase = 0;
+    std::basic_string<WCHAR> Module;
+    std::basic_string<WCHAR> Function;      // includes the parameters
+};
+
 extern int g_clrmaGlobalFlags;
 
 extern void TraceInformation(PCSTR format, ...);
@@ -99,7 +110,7 @@ public:
     inline CLRDATA_ADDRESS ObjectMethodTable() { return m_usefulGlobals.ObjectMethodTable; }
 
     /// <summary>
-    /// Fills in the frame.Module and frame.Function from the MethodDesc.
+    /// Fills in the frame.Module, frame.Function and frame.Displacement from the MethodDesc.
     /// </summary>
     HRESULT GetMethodDescInfo(CLRDATA_ADDRESS methodDesc, StackFrame& frame, bool stripFunctionParameters);
 
@@ -126,6 +137,7 @@ public:
 private:
     HRESULT QueryDebugClient(IUnknown* pUnknown);
     void ReleaseDebugClient();
+    bool ResolveMethodDesc(CLRDATA_ADDRESS methodDesc, ULONG64 ip, MethodDescInfo& info);
 
     LONG m_lRefs;
     int m_pointerSize;
@@ -145,6 +157,9 @@ private:
     ISOSDacInterface* m_sosDac;
 
     DacpUsefulGlobalsData m_usefulGlobals;
+
+    // The resolved MethodDescs shared by all the thread and exception objects
+    std::unordered_map<CLRDATA_ADDRESS, MethodDescInfo> m_methodDescCache;
 };
 
 #include "thread.h"
@@ -12,6 +12,7 @@
 #include "util.h"
 #include <dbghelp.h>
 #include <limits.h>
+#include <algorithm>
 
 #include "sos_md.h"
 
@@ -1162,8 +1163,8 @@ bool GCEncodingInfo::Initialize()
     buf = nullptr;
     cchBufAllocation = 0;
     cchBuf = 0;
-    curPtr = nullptr;
-    done = false;
+    lines.clear();
+    nextLine = 0;
     hotSizeToAdd = 0;
 
     return ReallocBuf();
@@ -1175,8 +1176,9 @@ void GCEncodingInfo::Deinitialize()
     buf = nullptr;
     cchBufAllocation = 0;
     cchBuf = 0;
-    curPtr = nullptr;
-    done = false;
+    lines.clear();
+    lines.shrink_to_fit();
+    nextLine = 0;
     hotSizeToAdd = 0;
 }
 
@@ -1222,79 +1224,61 @@ bool GCEncodingInfo::EnsureAdequateBufferSpace(SIZE_T count)
     return true;
 }
 
-void GCEncodingInfo::DumpGCInfoThrough(SIZE_T curOffset)
+void GCEncodingInfo::BuildLineTable()
 {
-    if (done)
+    lines.clear();
+    nextLine = 0;
+    if (buf == nullptr)
     {
-        // We've already output all the GC info
         return;
     }
-
-    if (curPtr == nullptr)
-    {
-        // We're just starting iteration.
-        curPtr = buf;
-    }
-
-    for (;;)
+    lines.reserve(std::count(buf, buf + cchBuf, '\n') + 1);
+
+    // There are two kinds of lines: those that start with an offset, and
+    // those that don't. It should be the case that all lines without
+    // offset come first, but that's certainly not guaranteed; a line
+    // without offset stays with the line that precedes it.
+    //
+    // For the lines with offset, it will be a 16-bit (x86) or 32-bit (non-x86) hex
+    // offset.  strtoul returns ULONG_MAX or 0 on failure.  0 is a valid
+    // offset for the first encoding.
+    SIZE_T lastOffset = 0;
+    bool sorted = true;
+    char* curPtr = buf;
+    while (*curPtr != '\0')
     {
         char *pNewLine = strchr(curPtr, '\n');
         if (pNewLine != nullptr)
             *pNewLine = '\0';
-        SIZE_T cchLine = strlen(curPtr);
-
-        // There are two kinds of lines: those that start with an offset, and
-        // those that don't. It should be the case that all lines without
-        // offset come first, but that's certainly not guaranteed.
-        //
-        // For the lines with offset, it will be a 16-bit (x86) or 32-bit (non-x86) hex
-        // offset.  strtoul returns ULONG_MAX or 0 on failure.  0 is a valid
-        // offset for the first encoding.
 
         char *pEnd;
         ULONG ofs = strtoul(curPtr, &pEnd, /* base */ 16);
-
         if ((pEnd != curPtr) && isspace(*pEnd) && (ULONG_MAX != ofs))
         {
-            // We got a number. Assume it's an offset.
-            if (ofs <= curOffset)
-            {
-                ExtOut(curPtr);
-                ExtOut("\n");
-                curPtr += cchLine + 1; // +1 to pass the terminating null
-            }
-            else
-            {
-                // We'll come back and output this one later. Restore the newline, if any.
-                // Leave curPtr alone.
-                if (pNewLine != nullptr)
-                    *pNewLine = '\n';
-                break;
-            }
-        }
-        else
-        {
-            // This is something else. Output it.
-            ExtOut(curPtr);
-            ExtOut("\n");
-            curPtr += cchLine + 1; // +1 to pass the terminating null
+            sorted = sorted && (ofs >= lastOffset);
+            lastOffset = ofs;
         }
+        lines.push_back({ lastOffset, (SIZE_T)(curPtr - buf) });
 
         if (pNewLine == nullptr)
-        {
-            // There was no trailing newline, and we output some text; we must be done
-            // (if we didn't output any text, we wouldn't get here).
-            done = true;
             break;
-        }
-        else if (*curPtr == '\0')
-        {
-            // We must have output a line with a newline, and now we're pointing at the
-            // trailing null.
-            done = true;
-            break;
-        }
+        curPtr = pNewLine + 1;
+    }
 
-        // Otherwise, we have text left to output.
+    // The decoders emit the transitions in offset order, so this is normally a no-op
+    if (!sorted)
+    {
+        std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.offset < b.offset; });
+    }
+}
+
+void GCEncodingInfo::DumpGCInfoThrough(SIZE_T curOffset)
+{
+    // Both the lines and the instructions are in offset order, so this is a single
+    // linear merge over the whole disassembly.
+    while (nextLine < lines.size() && lines[nextLine].offset <= curOffset)
+    {
+        ExtOut("%s\n", buf + lines[nextLine].start);
+        nextLine++;
     }
 }
@@ -10,6 +10,7 @@
 #define __disasm_h__
 
 #include "sos_stacktrace.h"
+#include <vector>
 
 struct InfoHdr;
 class GCDump;
@@ -25,7 +26,7 @@ struct DumpStackFlag
 
 struct GCEncodingInfo
 {
-    GCEncodingInfo() : buf(nullptr), cchBufAllocation(0), cchBuf(0), curPtr(nullptr), done(false), hotSizeToAdd(0)
+    GCEncodingInfo() : buf(nullptr), cchBufAllocation(0), cchBuf(0), nextLine(0), hotSizeToAdd(0)
     {
         // We don't call Initialize() here because we want to call it somewhere
         // we can handle memory allocation or other failures.
@@ -47,15 +48,26 @@ struct GCEncodingInfo
     // if necessary. Returns 'true' on success, 'false' on failure (e.g., failure to allocate memory).
     bool EnsureAdequateBufferSpace(SIZE_T count);
 
+    // Split the GC info text into lines and sort them by code offset. Called once after
+    // all the GC info has been decoded into 'buf'.
+    void BuildLineTable();
+
     // Output all GC info from the current position up to and including 'curOffset'.
     void DumpGCInfoThrough(SIZE_T curOffset);
 
+    struct Line
+    {
+        SIZE_T offset;          // Code offset of the line. Lines without an offset prefix
+                                // (header, untracked slots) take the offset of the line before.
+        SIZE_T start;           // Index of the null terminated line text in 'buf'.
+    };
+
     char* buf;                 // GC info textual output memory.
     SIZE_T cchBufAllocation;   // Number of characters allocated to buf.
     SIZE_T cchBuf;             // Number of characters stored in 'buf' (not including terminating null).
 
-    char* curPtr;              // Current pointer in 'buf', when iterating through the GC info.
-    bool done;                 // Have we output all the GC info?
+    std::vector<Line> lines;   // Lines of 'buf' in code offset order, built by BuildLineTable.
+    SIZE_T nextLine;           // Next entry of 'lines' to output, when merging with the disassembly.
     
     // When decoding a cold region, set this to the size of the hot region to keep offset
     // calculations working.
@@ -8,6 +8,7 @@
 // ==--==
 #include <assert.h>
 #include <sstream>
+#include <algorithm>
 #include "sos.h"
 #include "safemath.h"
 #include "releaseholder.h"
@@ -24,6 +25,11 @@ const int nSegLookupStgIncrement = 100;
 *                                                                      *
 \**********************************************************************/
 void HeapStat::Add(DWORD_PTR aData, DWORD aSize)
+{
+    Add(aData, (size_t)aSize, 1);
+}
+
+void HeapStat::Add(DWORD_PTR aData, size_t aTotalSize, DWORD aCount)
 {
     if (head == 0)
     {
@@ -80,8 +86,8 @@ void HeapStat::Add(DWORD_PTR aData, DWORD aSize)
 
     if (cmp == 0)
     {
-        walk->count ++;
-        walk->totalSize += aSize;
+        walk->count += aCount;
+        walk->totalSize += aTotalSize;
     }
     else
     {
@@ -108,8 +114,8 @@ void HeapStat::Add(DWORD_PTR aData, DWORD aSize)
         }
 
         node->data = aData;
-        node->totalSize = aSize;
-        node->count ++;
+        node->totalSize = aTotalSize;
+        node->count += aCount;
 
         if (cmp < 0)
         {
@@ -516,6 +522,83 @@ BOOL GetSizeEfficient(DWORD_PTR dwAddrCurrObj,
     return TRUE;
 }
 
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Resolves the MethodTable and size of a set of objects. The        *
+*    entries are sorted by address and the object headers that fall    *
+*    within one cache page of each other are fetched with a single     *
+*    read, so the cost scales with the pages touched instead of the    *
+*    number of objects.                                                *
+*                                                                      *
+\**********************************************************************/
+void GetObjectsMTAndSize(ObjectMTAndSize *objects, size_t count)
+{
+    // The MethodTable pointer and the component count
+    const TADDR headerSize = sizeof(TADDR) + sizeof(DWORD);
+    const ULONG cacheSize = 0x10000;
+
+    std::sort(objects, objects + count, [](const ObjectMTAndSize& a, const ObjectMTAndSize& b) { return a.Object < b.Object; });
+
+    LinearReadCache cache(cacheSize);
+    TADDR cachedStart = 0;
+    TADDR cachedEnd = 0;
+    TADDR stringMT = TO_TADDR(g_special_usefulGlobals.StringMethodTable);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ObjectMTAndSize& entry = objects[i];
+        entry.MT = 0;
+        entry.Size = 0;
+
+        if (entry.Object == 0 || IsInterrupt())
+            continue;
+
+        if (entry.Object < cachedStart || entry.Object + headerSize > cachedEnd)
+        {
+            size_t last = i;
+            while (last + 1 < count && objects[last + 1].Object - entry.Object + headerSize <= cacheSize)
+                last++;
+
+            cachedStart = entry.Object;
+            cachedEnd = objects[last].Object + headerSize;
+            cache.EnsureRangeInCache(cachedStart, (unsigned int)(cachedEnd - cachedStart));
+        }
+
+        // Falls back to a direct read if the range read above failed
+        TADDR mt = 0;
+        if (!cache.Read(entry.Object, &mt, false))
+            continue;
+
+        mt &= ~sos::Object::METHODTABLE_PTR_LOW_BITMASK;
+        MethodTableInfo* info = GetMethodTableInfo(mt);
+        if (info == NULL)
+            continue;
+
+        size_t size = info->BaseSize;
+        if (info->ComponentSize)
+        {
+            DWORD components = 0;
+            if (cache.Read(entry.Object + sizeof(TADDR), &components, false))
+            {
+                // The component count of a String does not include the trailing NULL
+                if (mt == stringMT)
+                    components++;
+                size += (size_t)info->ComponentSize * components;
+            }
+        }
+
+#ifdef _WIN64
+        // Pad to min object size if necessary
+        if (size < min_obj_size)
+            size = min_obj_size;
+#endif // _WIN64
+
+        entry.MT = mt;
+        entry.Size = size;
+    }
+}
+
 BOOL GetCollectibleDataEfficient(DWORD_PTR dwAddrMethTable, BOOL& bCollectible, TADDR& loaderAllocatorObjectHandle)
 {
     MethodTableInfo* info = GetMethodTableInfo(dwAddrMethTable);
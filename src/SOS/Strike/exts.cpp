@@ -109,6 +109,9 @@ ExtInit(PDEBUG_CLIENT client)
         g_sos = NULL;
         g_sos15 = NULL;
         g_sos16 = NULL;
+        g_sos5 = NULL;
+        g_sos7 = NULL;
+        g_sos14 = NULL;
 
         // Flush here only on Windows under dbgeng. The lldb sos plugin handles it for Linux/MacOS.
 #ifndef FEATURE_PAL
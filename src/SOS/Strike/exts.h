@@ -243,6 +243,10 @@ public:
     ToRelease<ISOSDacInterface> spISD(g_sos);                   \
     ToRelease<ISOSDacInterface15> spISD15(g_sos15);             \
     ToRelease<ISOSDacInterface16> spISD16(g_sos16);             \
+    ToRelease<ISOSDacInterface5> spISD5(g_sos5);                \
+    ToRelease<ISOSDacInterface7> spISD7(g_sos7);                \
+    ToRelease<ISOSDacInterface14> spISD14(g_sos14);             \
+    DacRequestCacheScope __dacRequestCacheScope;                \
     ResetGlobals();
 
 #define INIT_API_PROBE_MANAGED(name)                            \
@@ -280,7 +284,11 @@ public:
     ToRelease<IXCLRDataProcess> spIDP(g_clrData);               \
     ToRelease<ISOSDacInterface> spISD(g_sos);                   \
     ToRelease<ISOSDacInterface15> spISD15(g_sos15);             \
-    ToRelease<ISOSDacInterface16> spISD16(g_sos16);
+    ToRelease<ISOSDacInterface16> spISD16(g_sos16);             \
+    ToRelease<ISOSDacInterface5> spISD5(g_sos5);                \
+    ToRelease<ISOSDacInterface7> spISD7(g_sos7);                \
+    ToRelease<ISOSDacInterface14> spISD14(g_sos14);             \
+    DacRequestCacheScope __dacRequestCacheScope;
     
 #ifdef FEATURE_PAL
 
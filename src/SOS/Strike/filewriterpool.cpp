@@ -0,0 +1,161 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+// The standard threading headers have to come before the PAL's headers
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "filewriterpool.h"
+
+struct FileWriterTask
+{
+    uint32_t fileId;
+    bool close;
+    std::vector<uint8_t> data;
+};
+
+struct FileWriterEntry
+{
+    FILE* file;
+    bool failed;
+};
+
+struct FileWriterPool::State
+{
+    std::mutex lock;
+    std::condition_variable workAvailable;
+    std::condition_variable spaceAvailable;
+    std::vector<std::deque<FileWriterTask>> queues;     // one per worker
+    std::vector<std::thread> threads;
+    std::vector<FileWriterEntry> files;
+    size_t queuedBytes;
+    size_t maxQueuedBytes;
+    bool stopping;
+
+    void Queue(FileWriterTask&& task)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        size_t size = task.data.size();
+
+        // Always let a chunk in when nothing is queued so a chunk larger than
+        // the limit can't block forever
+        spaceAvailable.wait(guard, [&] { return queuedBytes == 0 || queuedBytes + size <= maxQueuedBytes; });
+        queuedBytes += size;
+        queues[task.fileId % queues.size()].push_back(std::move(task));
+        workAvailable.notify_all();
+    }
+
+    void Worker(size_t index)
+    {
+        std::deque<FileWriterTask>& queue = queues[index];
+        std::unique_lock<std::mutex> guard(lock);
+        while (true)
+        {
+            workAvailable.wait(guard, [&] { return !queue.empty() || stopping; });
+            if (queue.empty())
+            {
+                break;
+            }
+            FileWriterTask task = std::move(queue.front());
+            queue.pop_front();
+            FILE* file = files[task.fileId].file;
+            bool failed = files[task.fileId].failed;
+            guard.unlock();
+
+            if (!failed && !task.data.empty())
+            {
+                failed = fwrite(task.data.data(), 1, task.data.size(), file) != task.data.size();
+            }
+            if (task.close && fclose(file) != 0)
+            {
+                failed = true;
+            }
+
+            guard.lock();
+            queuedBytes -= task.data.size();
+            files[task.fileId].failed = failed;
+            if (task.close)
+            {
+                files[task.fileId].file = nullptr;
+            }
+            spaceAvailable.notify_all();
+        }
+    }
+};
+
+FileWriterPool::FileWriterPool(uint32_t threadCount, size_t maxQueuedBytes) :
+    m_state(new State())
+{
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+    m_state->queuedBytes = 0;
+    m_state->maxQueuedBytes = maxQueuedBytes;
+    m_state->stopping = false;
+    m_state->queues.resize(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        m_state->threads.emplace_back(&State::Worker, m_state, (size_t)i);
+    }
+}
+
+FileWriterPool::~FileWriterPool()
+{
+    Finish();
+    delete m_state;
+}
+
+uint32_t
+FileWriterPool::AddFile(FILE* file)
+{
+    std::lock_guard<std::mutex> guard(m_state->lock);
+    m_state->files.push_back({ file, false });
+    return (uint32_t)(m_state->files.size() - 1);
+}
+
+void
+FileWriterPool::Write(uint32_t fileId, std::vector<uint8_t>&& data)
+{
+    m_state->Queue({ fileId, false, std::move(data) });
+}
+
+void
+FileWriterPool::Close(uint32_t fileId)
+{
+    m_state->Queue({ fileId, true, std::vector<uint8_t>() });
+}
+
+uint32_t
+FileWriterPool::Finish()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_state->lock);
+        m_state->stopping = true;
+        m_state->workAvailable.notify_all();
+    }
+    for (std::thread& thread : m_state->threads)
+    {
+        thread.join();
+    }
+    m_state->threads.clear();
+
+    uint32_t failures = 0;
+    for (FileWriterEntry& entry : m_state->files)
+    {
+        if (entry.file != nullptr)
+        {
+            if (fclose(entry.file) != 0)
+            {
+                entry.failed = true;
+            }
+            entry.file = nullptr;
+        }
+        if (entry.failed)
+        {
+            failures++;
+        }
+    }
+    return failures;
+}
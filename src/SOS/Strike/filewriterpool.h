@@ -0,0 +1,42 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+//
+// Writes files on a pool of worker threads so a command can keep reading the
+// target while the data it already read is written out. The debugger services
+// can only be called on the command thread, so only the writes are parallel.
+// Each file is written by one worker in the order its chunks were queued.
+//
+class FileWriterPool
+{
+public:
+    // The queued chunks are limited to maxQueuedBytes; Write blocks until the
+    // workers catch up.
+    FileWriterPool(uint32_t threadCount, size_t maxQueuedBytes);
+
+    // Waits for the queued writes
+    ~FileWriterPool();
+
+    // Takes ownership of the file, which is closed by Close or Finish. Returns
+    // the id to queue its chunks with.
+    uint32_t AddFile(FILE* file);
+
+    void Write(uint32_t fileId, std::vector<uint8_t>&& data);
+
+    // Queues the close of the file after its chunks
+    void Close(uint32_t fileId);
+
+    // Waits for everything queued and stops the workers. Returns the number
+    // of files with a failed write.
+    uint32_t Finish();
+
+private:
+    struct State;
+    State* m_state;
+};
@@ -6,6 +6,8 @@
 #include "gcinfoprovider.h"
 #include "disasm.h"
 #include <algorithm>
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 // ============================================================================
@@ -68,14 +70,290 @@ HRESULT GCInfoData::Create(CLRDATA_ADDRESS methodIP, GCInfoData& out)
             out.SafePoints.clear();
     }
 
+    out.BuildIndex();
     out.IsValid = true;
     return S_OK;
 }
 
+// ============================================================================
+// Liveness index
+// ============================================================================
+
+void GCInfoData::BuildIndex()
+{
+    std::sort(SafePoints.begin(), SafePoints.end());
+    std::sort(InterruptibleRanges.begin(), InterruptibleRanges.end(),
+        [](const SOSCodeRange& a, const SOSCodeRange& b) { return a.BeginOffset < b.BeginOffset; });
+
+    m_slotsByBegin.resize(SlotLifetimes.size());
+    for (size_t i = 0; i < m_slotsByBegin.size(); i++)
+    {
+        m_slotsByBegin[i] = i;
+    }
+    std::stable_sort(m_slotsByBegin.begin(), m_slotsByBegin.end(),
+        [this](size_t a, size_t b) { return SlotLifetimes[a].BeginOffset < SlotLifetimes[b].BeginOffset; });
+
+    m_subtreeMaxEnd.resize(SlotLifetimes.size());
+    BuildIndex(0, m_slotsByBegin.size());
+}
+
+unsigned int GCInfoData::BuildIndex(size_t lo, size_t hi)
+{
+    if (lo >= hi)
+    {
+        return 0;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    unsigned int maxEnd = SlotLifetimes[m_slotsByBegin[mid]].EndOffset;
+    maxEnd = std::max(maxEnd, BuildIndex(lo, mid));
+    maxEnd = std::max(maxEnd, BuildIndex(mid + 1, hi));
+    m_subtreeMaxEnd[mid] = maxEnd;
+    return maxEnd;
+}
+
+bool GCInfoData::IsSafePoint(unsigned int codeOffset) const
+{
+    return std::binary_search(SafePoints.begin(), SafePoints.end(), codeOffset);
+}
+
+bool GCInfoData::IsInterruptible(unsigned int codeOffset) const
+{
+    // Last range that begins at or before the offset
+    auto range = std::upper_bound(InterruptibleRanges.begin(), InterruptibleRanges.end(), codeOffset,
+        [](unsigned int offset, const SOSCodeRange& r) { return offset < r.BeginOffset; });
+    if (range == InterruptibleRanges.begin())
+    {
+        return false;
+    }
+    --range;
+    return codeOffset < range->EndOffset;
+}
+
+void GCInfoData::GetLiveSlots(unsigned int codeOffset, std::vector<size_t>& liveSlots) const
+{
+    GetLiveSlots(0, m_slotsByBegin.size(), codeOffset, liveSlots);
+}
+
+void GCInfoData::GetLiveSlots(size_t lo, size_t hi, unsigned int codeOffset, std::vector<size_t>& liveSlots) const
+{
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        // Nothing in this subtree lives past the offset
+        if (m_subtreeMaxEnd[mid] <= codeOffset)
+        {
+            return;
+        }
+
+        GetLiveSlots(lo, mid, codeOffset, liveSlots);
+
+        // Everything from mid on begins after the offset
+        const SOSGCSlotLifetime& slot = SlotLifetimes[m_slotsByBegin[mid]];
+        if (slot.BeginOffset > codeOffset)
+        {
+            return;
+        }
+        if (codeOffset < slot.EndOffset)
+        {
+            liveSlots.push_back(m_slotsByBegin[mid]);
+        }
+
+        // Continue with the right subtree
+        lo = mid + 1;
+    }
+}
+
+// ============================================================================
+// Per method body cache
+// ============================================================================
+
+#define METHOD_CODE_INFO_CACHE_SIZE 64
+
+struct MethodCodeKey
+{
+    CLRDATA_ADDRESS MethodDesc;
+    CLRDATA_ADDRESS MethodStart;
+
+    bool operator==(const MethodCodeKey& other) const
+    {
+        return MethodDesc == other.MethodDesc && MethodStart == other.MethodStart;
+    }
+};
+
+struct MethodCodeKeyHash
+{
+    size_t operator()(const MethodCodeKey& key) const
+    {
+        return std::hash<CLRDATA_ADDRESS>()(key.MethodDesc) ^ (std::hash<CLRDATA_ADDRESS>()(key.MethodStart) * 31);
+    }
+};
+
+struct MethodCodeInfo
+{
+    MethodCodeKey Key;
+
+    HRESULT GCInfoStatus;           // S_FALSE until the GC info is decoded
+    GCInfoData GCInfo;
+
+    HRESULT EHStatus;               // S_FALSE until the EH clauses are gathered
+    std::vector<DACEHInfo> EHClauses;
+};
+
+// Most recently used entry first
+static std::list<MethodCodeInfo> g_methodCodeInfoList;
+static std::unordered_map<MethodCodeKey, std::list<MethodCodeInfo>::iterator, MethodCodeKeyHash> g_methodCodeInfoMap;
+
+static MethodCodeInfo& LookupMethodCodeInfo(CLRDATA_ADDRESS methodDesc, CLRDATA_ADDRESS methodStart)
+{
+    MethodCodeKey key = { methodDesc, methodStart };
+    auto found = g_methodCodeInfoMap.find(key);
+    if (found != g_methodCodeInfoMap.end())
+    {
+        g_methodCodeInfoList.splice(g_methodCodeInfoList.begin(), g_methodCodeInfoList, found->second);
+        return *found->second;
+    }
+
+    if (g_methodCodeInfoList.size() >= METHOD_CODE_INFO_CACHE_SIZE)
+    {
+        g_methodCodeInfoMap.erase(g_methodCodeInfoList.back().Key);
+        g_methodCodeInfoList.pop_back();
+    }
+
+    g_methodCodeInfoList.emplace_front();
+    MethodCodeInfo& info = g_methodCodeInfoList.front();
+    info.Key = key;
+    info.GCInfoStatus = S_FALSE;
+    info.EHStatus = S_FALSE;
+    g_methodCodeInfoMap[key] = g_methodCodeInfoList.begin();
+    return info;
+}
+
+static BOOL GatherEHClause(UINT clauseIndex, UINT totalClauses, DACEHInfo *pEHInfo, LPVOID token)
+{
+    std::vector<DACEHInfo>* pClauses = (std::vector<DACEHInfo>*)token;
+    if (IsInterrupt())
+    {
+        return FALSE;
+    }
+    if (pClauses->empty())
+    {
+        pClauses->reserve(totalClauses);
+    }
+    pClauses->push_back(*pEHInfo);
+    return TRUE;
+}
+
+HRESULT GetCachedGCInfo(CLRDATA_ADDRESS methodDesc, CLRDATA_ADDRESS methodStart, const GCInfoData** ppGCInfo)
+{
+    MethodCodeInfo& info = LookupMethodCodeInfo(methodDesc, methodStart);
+    if (info.GCInfoStatus == S_FALSE)
+    {
+        info.GCInfoStatus = GCInfoData::Create(methodStart, info.GCInfo);
+    }
+    *ppGCInfo = &info.GCInfo;
+    return info.GCInfoStatus;
+}
+
+HRESULT GetCachedEHClauses(CLRDATA_ADDRESS methodDesc, CLRDATA_ADDRESS methodStart, const std::vector<DACEHInfo>** ppClauses)
+{
+    MethodCodeInfo& info = LookupMethodCodeInfo(methodDesc, methodStart);
+    if (info.EHStatus == S_FALSE)
+    {
+        info.EHClauses.clear();
+        HRESULT hr = g_sos->TraverseEHInfo(methodStart, GatherEHClause, (LPVOID)&info.EHClauses);
+        if (hr != S_OK)
+        {
+            // Don't keep a partial list (e.g. the user aborted the traversal)
+            info.EHClauses.clear();
+            *ppClauses = &info.EHClauses;
+            return hr;
+        }
+        info.EHStatus = S_OK;
+    }
+    *ppClauses = &info.EHClauses;
+    return info.EHStatus;
+}
+
+HRESULT GetGCInfoForIP(CLRDATA_ADDRESS ip, const GCInfoData** ppGCInfo, unsigned int* pCodeOffset)
+{
+    DacpCodeHeaderData codeHeaderData;
+    if (codeHeaderData.Request(g_sos, ip) != S_OK || codeHeaderData.MethodStart == 0)
+    {
+        return S_FALSE;
+    }
+
+    // Offsets into a cold region continue from the end of the hot region
+    CLRDATA_ADDRESS offset;
+    if (codeHeaderData.ColdRegionStart != 0 &&
+        ip >= codeHeaderData.ColdRegionStart &&
+        ip < codeHeaderData.ColdRegionStart + codeHeaderData.ColdRegionSize)
+    {
+        offset = (ip - codeHeaderData.ColdRegionStart) + codeHeaderData.HotRegionSize;
+    }
+    else
+    {
+        offset = ip - codeHeaderData.MethodStart;
+    }
+
+    HRESULT hr = GetCachedGCInfo(codeHeaderData.MethodDescPtr, codeHeaderData.MethodStart, ppGCInfo);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    *pCodeOffset = (unsigned int)offset;
+    return S_OK;
+}
+
+void FlushMethodCodeInfoCache()
+{
+    g_methodCodeInfoMap.clear();
+    g_methodCodeInfoList.clear();
+}
+
 // ============================================================================
 // Formatting
 // ============================================================================
 
+// Map ICorDebugInfo::RegNum to register names.
+// The cDAC returns register numbers using ICorDebugInfo::RegNum ordering,
+// NOT SOS's s_GCRegs ordering. Use the same mapping as GetRegName() in gcdumpnonx86.cpp.
+static const char* GetRegName(unsigned int regNum)
+{
+#if defined(SOS_TARGET_AMD64)
+    static const char* s_regNames[] = {
+        "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+        "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+    };
+    if (regNum < ARRAY_SIZE(s_regNames))
+        return s_regNames[regNum];
+#elif defined(SOS_TARGET_X86)
+    static const char* s_regNames[] = {
+        "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"
+    };
+    if (regNum < ARRAY_SIZE(s_regNames))
+        return s_regNames[regNum];
+#elif defined(SOS_TARGET_ARM64)
+    if (regNum <= 28)
+    {
+        static char buf[8];
+        sprintf_s(buf, ARRAY_SIZE(buf), "x%u", regNum);
+        return buf;
+    }
+    if (regNum == 29) return "fp";
+    if (regNum == 30) return "lr";
+    if (regNum == 31) return "sp";
+#elif defined(SOS_TARGET_ARM)
+    static const char* s_regNames[] = {
+        "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7",
+        "r8", "r9", "r10", "r11", "r12", "sp", "lr", "pc"
+    };
+    if (regNum < ARRAY_SIZE(s_regNames))
+        return s_regNames[regNum];
+#endif
+    return "???";
+}
+
 void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
 {
     if (pfnPrintf == NULL)
@@ -87,44 +365,6 @@ void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
         return;
     }
 
-    // Map ICorDebugInfo::RegNum to register names.
-    // The cDAC returns register numbers using ICorDebugInfo::RegNum ordering,
-    // NOT SOS's s_GCRegs ordering. Use the same mapping as GetRegName() in gcdumpnonx86.cpp.
-    auto getRegName = [](unsigned int regNum) -> const char* {
-#if defined(SOS_TARGET_AMD64)
-        static const char* s_regNames[] = {
-            "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
-            "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
-        };
-        if (regNum < ARRAY_SIZE(s_regNames))
-            return s_regNames[regNum];
-#elif defined(SOS_TARGET_X86)
-        static const char* s_regNames[] = {
-            "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"
-        };
-        if (regNum < ARRAY_SIZE(s_regNames))
-            return s_regNames[regNum];
-#elif defined(SOS_TARGET_ARM64)
-        if (regNum <= 28)
-        {
-            static char buf[8];
-            sprintf_s(buf, ARRAY_SIZE(buf), "x%u", regNum);
-            return buf;
-        }
-        if (regNum == 29) return "fp";
-        if (regNum == 30) return "lr";
-        if (regNum == 31) return "sp";
-#elif defined(SOS_TARGET_ARM)
-        static const char* s_regNames[] = {
-            "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7",
-            "r8", "r9", "r10", "r11", "r12", "sp", "lr", "pc"
-        };
-        if (regNum < ARRAY_SIZE(s_regNames))
-            return s_regNames[regNum];
-#endif
-        return "???";
-    };
-
     // Print header fields matching legacy DumpGCTable format
     pfnPrintf("Prolog size: %d\n", Header.PrologSize);
 
@@ -167,14 +407,14 @@ void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
 
     pfnPrintf("Varargs: %d\n", Header.IsVarArg ? 1 : 0);
     if (Header.StackBaseRegister != 0xFFFFFFFF)
-        pfnPrintf("Frame pointer: %s\n", getRegName(Header.StackBaseRegister));
+        pfnPrintf("Frame pointer: %s\n", GetRegName(Header.StackBaseRegister));
     else
         pfnPrintf("Frame pointer: <none>\n");
     pfnPrintf("Wants Report Only Leaf: %d\n", Header.WantsReportOnlyLeaf ? 1 : 0);
     pfnPrintf("Size of parameter area: %x\n", Header.SizeOfStackParameterArea);
     pfnPrintf("Code size: %x\n", Header.CodeSize);
 
-    const char* frameRegName = (Header.StackBaseRegister != 0xFFFFFFFF) ? getRegName(Header.StackBaseRegister) : "sp";
+    const char* frameRegName = (Header.StackBaseRegister != 0xFFFFFFFF) ? GetRegName(Header.StackBaseRegister) : "sp";
 
     // Helper to format a stack slot offset as hex with sign, matching legacy format
     auto fmtStackSlot = [&](const SOSGCSlotLifetime& s) -> const char* {
@@ -197,7 +437,7 @@ void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
         if (s.BeginOffset == 0 && s.EndOffset == Header.CodeSize)
         {
             if (s.IsRegister)
-                pfnPrintf("Untracked: %s+%s\n", s.GcFlags & 0x2 ? "pinned " : "", getRegName(s.RegisterNumber));
+                pfnPrintf("Untracked: %s+%s\n", s.GcFlags & 0x2 ? "pinned " : "", GetRegName(s.RegisterNumber));
             else
                 pfnPrintf("Untracked: %s+%s\n", s.GcFlags & 0x2 ? "pinned " : "", fmtStackSlot(s));
         }
@@ -211,22 +451,25 @@ void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
     {
         // Non-interruptible: only show safe points with live slots listed on the same line.
         // No +/- transitions shown separately.
+        std::vector<size_t> liveSlots;
         for (size_t sp = 0; sp < SafePoints.size(); sp++)
         {
             unsigned int spOffset = SafePoints[sp];
             pfnPrintf("%08x is a safepoint: ", spOffset);
-            for (size_t i = 0; i < SlotLifetimes.size(); i++)
+
+            // Print in SlotLifetimes order like the legacy dumper
+            liveSlots.clear();
+            GetLiveSlots(spOffset, liveSlots);
+            std::sort(liveSlots.begin(), liveSlots.end());
+            for (size_t i : liveSlots)
             {
                 const SOSGCSlotLifetime& s = SlotLifetimes[i];
                 if (s.BeginOffset == 0 && s.EndOffset == Header.CodeSize)
                     continue; // skip untracked
-                if (spOffset >= s.BeginOffset && spOffset < s.EndOffset)
-                {
-                    if (s.IsRegister)
-                        pfnPrintf(" +%s", getRegName(s.RegisterNumber));
-                    else
-                        pfnPrintf(" +%s", fmtStackSlot(s));
-                }
+                if (s.IsRegister)
+                    pfnPrintf(" +%s", GetRegName(s.RegisterNumber));
+                else
+                    pfnPrintf(" +%s", fmtStackSlot(s));
             }
             pfnPrintf("\n");
         }
@@ -287,7 +530,7 @@ void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
                     lastOffset = ev.offset;
                 }
                 if (s.IsRegister)
-                    pfnPrintf(" +%s", getRegName(s.RegisterNumber));
+                    pfnPrintf(" +%s", GetRegName(s.RegisterNumber));
                 else
                     pfnPrintf(" +%s", fmtStackSlot(s));
                 break;
@@ -303,7 +546,7 @@ void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
                     lastOffset = ev.offset;
                 }
                 if (s.IsRegister)
-                    pfnPrintf(" -%s", getRegName(s.RegisterNumber));
+                    pfnPrintf(" -%s", GetRegName(s.RegisterNumber));
                 else
                     pfnPrintf(" -%s", fmtStackSlot(s));
                 break;
@@ -314,3 +557,79 @@ void GCInfoData::DumpToOutput(GCInfoData::printfFtn pfnPrintf) const
             pfnPrintf("\n");
     }
 }
+
+// Print the decoded GC info as a JSON object, one slot lifetime per line, for
+// consumption by scripts and other tools. Register names use the same mapping
+// as DumpToOutput.
+void GCInfoData::DumpToJson(GCInfoData::printfFtn pfnPrintf) const
+{
+    if (pfnPrintf == NULL)
+        pfnPrintf = ExtOut;
+
+    if (!IsValid)
+    {
+        pfnPrintf("{ \"valid\": false }\n");
+        return;
+    }
+
+    pfnPrintf("{\n");
+    pfnPrintf("  \"valid\": true,\n");
+    pfnPrintf("  \"codeSize\": %u,\n", Header.CodeSize);
+    pfnPrintf("  \"prologSize\": %u,\n", Header.PrologSize);
+    if (Header.StackBaseRegister != 0xFFFFFFFF)
+        pfnPrintf("  \"framePointer\": \"%s\",\n", GetRegName(Header.StackBaseRegister));
+    else
+        pfnPrintf("  \"framePointer\": null,\n");
+    pfnPrintf("  \"sizeOfParameterArea\": %u,\n", Header.SizeOfStackParameterArea);
+    pfnPrintf("  \"isVarArg\": %s,\n", Header.IsVarArg ? "true" : "false");
+    pfnPrintf("  \"wantsReportOnlyLeaf\": %s,\n", Header.WantsReportOnlyLeaf ? "true" : "false");
+
+    pfnPrintf("  \"interruptibleRanges\": [");
+    for (size_t i = 0; i < InterruptibleRanges.size(); i++)
+    {
+        pfnPrintf("%s\n    { \"begin\": %u, \"end\": %u }", i == 0 ? "" : ",",
+            InterruptibleRanges[i].BeginOffset, InterruptibleRanges[i].EndOffset);
+    }
+    pfnPrintf("%s],\n", InterruptibleRanges.empty() ? "" : "\n  ");
+
+    pfnPrintf("  \"safePoints\": [");
+    for (size_t i = 0; i < SafePoints.size(); i++)
+    {
+        pfnPrintf("%s%u", i == 0 ? "" : ", ", SafePoints[i]);
+    }
+    pfnPrintf("],\n");
+
+    // Slots sorted by the offset where they become live, so a consumer can sweep them
+    // alongside the instruction stream.
+    std::vector<size_t> order(SlotLifetimes.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return SlotLifetimes[a].BeginOffset < SlotLifetimes[b].BeginOffset;
+    });
+
+    pfnPrintf("  \"slotLifetimes\": [");
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const SOSGCSlotLifetime& s = SlotLifetimes[order[i]];
+        bool untracked = s.BeginOffset == 0 && s.EndOffset == Header.CodeSize;
+        pfnPrintf("%s\n    { \"begin\": %u, \"end\": %u, \"untracked\": %s, \"pinned\": %s, \"interior\": %s, ",
+            i == 0 ? "" : ",", s.BeginOffset, s.EndOffset,
+            untracked ? "true" : "false",
+            s.GcFlags & 0x2 ? "true" : "false",
+            s.GcFlags & 0x1 ? "true" : "false");
+        if (s.IsRegister)
+        {
+            pfnPrintf("\"register\": \"%s\" }", GetRegName(s.RegisterNumber));
+        }
+        else
+        {
+            const char* baseReg = "sp";
+            if (s.BaseRegister != 0 && Header.StackBaseRegister != 0xFFFFFFFF)
+                baseReg = GetRegName(Header.StackBaseRegister);
+            pfnPrintf("\"stackBase\": \"%s\", \"stackOffset\": %d }", baseReg, s.SpOffset);
+        }
+    }
+    pfnPrintf("%s]\n", order.empty() ? "" : "\n  ");
+    pfnPrintf("}\n");
+}
@@ -5,6 +5,7 @@
 
 #include <vector>
 #include "sospriv.h"
+#include "dacprivate.h"
 
 // GCInfoData holds decoded GC info for a method, populated from either
 // ISOSDacInterface18 or the legacy GcInfoDecoder/GcInfoDumper.
@@ -26,4 +27,55 @@ struct GCInfoData
     // If pfnPrintf is NULL, uses ExtOut.
     typedef void (*printfFtn)(const char* fmt, ...);
     void DumpToOutput(printfFtn pfnPrintf) const;
+
+    // Print the header, ranges, safe points and slot lifetimes as JSON.
+    // If pfnPrintf is NULL, uses ExtOut.
+    void DumpToJson(printfFtn pfnPrintf) const;
+
+    // Liveness queries. Create sorts SafePoints and InterruptibleRanges and builds
+    // an interval index over SlotLifetimes, so these are O(log n) plus the number
+    // of live slots returned.
+
+    // Is the code offset a safe point of a partially interruptible method?
+    bool IsSafePoint(unsigned int codeOffset) const;
+
+    // Is the code offset inside one of the interruptible ranges?
+    bool IsInterruptible(unsigned int codeOffset) const;
+
+    // Append the indexes (into SlotLifetimes) of the slots live at the code offset,
+    // including the untracked ones, in order of their BeginOffset.
+    void GetLiveSlots(unsigned int codeOffset, std::vector<size_t>& liveSlots) const;
+
+private:
+    // Interval index over SlotLifetimes: slot indexes sorted by BeginOffset, viewed as an
+    // implicit balanced binary tree (the root of [lo, hi) is (lo + hi) / 2), and the
+    // largest EndOffset of each subtree stored at its root.
+    std::vector<size_t> m_slotsByBegin;
+    std::vector<unsigned int> m_subtreeMaxEnd;
+
+    void BuildIndex();
+    unsigned int BuildIndex(size_t lo, size_t hi);
+    void GetLiveSlots(size_t lo, size_t hi, unsigned int codeOffset, std::vector<size_t>& liveSlots) const;
 };
+
+// Code offset of ip within its method body and the body's GC info (from the cache
+// below). The offset accounts for hot/cold splitting. Returns S_FALSE if ip isn't
+// managed code. This is the per-frame entry point for stack root scans.
+HRESULT GetGCInfoForIP(CLRDATA_ADDRESS ip, const GCInfoData** ppGCInfo, unsigned int* pCodeOffset);
+
+// Decoded GC info and EH clauses of recently inspected methods, keyed by
+// (MethodDesc, code start) so every rejitted or re-tiered body gets its own
+// entry. The least recently used entries are evicted once the cache is full,
+// and the whole cache is discarded when the target moves (Target::Flush).
+
+// Returns the GC info of the method body starting at methodStart, decoding it
+// through GCInfoData::Create on the first request. The pointer stays valid
+// until the next call into the cache.
+HRESULT GetCachedGCInfo(CLRDATA_ADDRESS methodDesc, CLRDATA_ADDRESS methodStart, const GCInfoData** ppGCInfo);
+
+// Returns the EH clauses of the method body starting at methodStart, gathering
+// them through TraverseEHInfo on the first request. The pointer stays valid
+// until the next call into the cache.
+HRESULT GetCachedEHClauses(CLRDATA_ADDRESS methodDesc, CLRDATA_ADDRESS methodStart, const std::vector<DACEHInfo>** ppClauses);
+
+void FlushMethodCodeInfoCache();
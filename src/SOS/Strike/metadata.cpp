@@ -86,7 +86,7 @@ IMetaDataImport* MDImportForModule(DacpModuleData* pModule)
 IMetaDataImport* MDImportForModule(DWORD_PTR pModule)
 {
     DacpModuleData moduleData;
-    if(moduleData.Request(g_sos, TO_CDADDR(pModule))==S_OK)
+    if(CachedRequest(moduleData, TO_CDADDR(pModule))==S_OK)
         return MDImportForModule(&moduleData);
     else
         return NULL;
@@ -182,14 +182,14 @@ void NameForToken_s(DWORD_PTR ModuleAddr, mdTypeDef mb, __out_ecount (capacity_m
 {
     DacpModuleData ModuleData;
     mdName[0] = L'\0';
-    if(ModuleData.Request(g_sos, TO_CDADDR(ModuleAddr))==S_OK)
+    if(CachedRequest(ModuleData, TO_CDADDR(ModuleAddr))==S_OK)
         NameForToken_s(&ModuleData,mb,mdName,capacity_mdName,bClassName);
 }
 
 BOOL IsValidToken(DWORD_PTR ModuleAddr, mdTypeDef mb)
 {
     DacpModuleData ModuleData;
-    if(ModuleData.Request(g_sos, TO_CDADDR(ModuleAddr))==S_OK)
+    if(CachedRequest(ModuleData, TO_CDADDR(ModuleAddr))==S_OK)
     {
         ToRelease<IMetaDataImport> pImport = MDImportForModule(&ModuleData);
         if (pImport)
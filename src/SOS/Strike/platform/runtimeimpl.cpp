@@ -23,6 +23,7 @@
 #include <sys/stat.h>
 #include <dlfcn.h>
 #include <unistd.h>
+#include "libraryindex.h"
 #endif // !FEATURE_PAL
 
 #define CORDBG_E_NO_IMAGE_AVAILABLE EMAKEHR(0x1c64)
@@ -74,6 +75,52 @@ bool ReaderReadMemory(void* address, void* buffer, size_t size)
     return SUCCEEDED(debuggerServices->ReadVirtual((ULONG64)address, buffer, (ULONG)size, &read));
 }
 
+#if defined(FEATURE_PAL) && !defined(__APPLE__)
+
+extern "C" bool TryGetBuildIdWithCallback(
+    bool (*readMemory)(void* address, void* buffer, size_t size),
+    ULONG64 baseAddress,
+    BYTE* buffer,
+    ULONG bufferSize,
+    PULONG pBuildSize);
+
+#define MAX_RUNTIME_BUILDID_SIZE 24
+
+/**********************************************************************\
+ * Looks up the DAC or DBI resolved for this runtime build by an earlier
+ * session in the library index (DOTNET_DEBUGGER_LIBRARY_INDEX). These
+ * entries are keyed on the runtime module's build id, so they use their
+ * own kinds ("dac-runtime", "dbi-runtime") instead of the "dac" and "dbi"
+ * dbgshim keys on the DAC and DBI build ids.
+\**********************************************************************/
+static bool LookupIndexedRuntimeLibrary(ITarget* target, ULONG64 runtimeAddress, const char* name, std::string& path)
+{
+    BYTE buildId[MAX_RUNTIME_BUILDID_SIZE];
+    ULONG buildIdSize = 0;
+    if (target->GetOperatingSystem() != ITarget::OperatingSystem::Linux ||
+        !::TryGetBuildIdWithCallback(ReaderReadMemory, runtimeAddress, buildId, sizeof(buildId), &buildIdSize))
+    {
+        return false;
+    }
+    return LibraryIndexLookup(name, buildId, buildIdSize, path);
+}
+
+/**********************************************************************\
+ * Adds the DAC or DBI found for this runtime build to the library index
+\**********************************************************************/
+static void AddIndexedRuntimeLibrary(ITarget* target, ULONG64 runtimeAddress, const char* name, const char* path)
+{
+    BYTE buildId[MAX_RUNTIME_BUILDID_SIZE];
+    ULONG buildIdSize = 0;
+    if (target->GetOperatingSystem() == ITarget::OperatingSystem::Linux &&
+        ::TryGetBuildIdWithCallback(ReaderReadMemory, runtimeAddress, buildId, sizeof(buildId), &buildIdSize))
+    {
+        LibraryIndexAdd(name, buildId, buildIdSize, path);
+    }
+}
+
+#endif // defined(FEATURE_PAL) && !defined(__APPLE__)
+
 /**********************************************************************\
  * Search all the modules in the process for the single-file host
 \**********************************************************************/
@@ -210,9 +257,12 @@ Runtime::Runtime(ITarget* target, RuntimeConfiguration configuration, ULONG inde
     m_name(nullptr),
     m_runtimeInfo(runtimeInfo),
     m_runtimeDirectory(nullptr),
+    m_runtimeDirectorySet(false),
     m_dacFilePath(nullptr),
     m_cdacFilePath(nullptr),
     m_dbiFilePath(nullptr),
+    m_indexDacFilePath(false),
+    m_indexDbiFilePath(false),
     m_clrDataProcess(nullptr),
     m_cdacDataProcess(nullptr),
     m_pCorDebugProcess(nullptr)
@@ -303,6 +353,16 @@ LPCSTR Runtime::GetDacFilePath()
             ExtDbgOut("GetDacFilePath: GetDacSignatureVerificationSettings FAILED %08x or returned TRUE\n", hr);
             return nullptr;
         }
+#if defined(FEATURE_PAL) && !defined(__APPLE__)
+        // Use the DAC found for this runtime build by an earlier session unless
+        // the runtime directory was set explicitly (setclrpath).
+        std::string indexedPath;
+        if (!m_runtimeDirectorySet && LookupIndexedRuntimeLibrary(m_target, m_address, "dac-runtime", indexedPath))
+        {
+            m_dacFilePath = _strdup(indexedPath.c_str());
+            return m_dacFilePath;
+        }
+#endif
         LPCSTR directory = GetRuntimeDirectory();
         if (directory != nullptr)
         {
@@ -315,6 +375,9 @@ LPCSTR Runtime::GetDacFilePath()
 #endif
             {
                 m_dacFilePath = _strdup(dacModulePath.c_str());
+
+                // Indexed once the DAC has loaded successfully
+                m_indexDacFilePath = true;
             }
         }
     }
@@ -387,6 +450,16 @@ LPCSTR Runtime::GetDbiFilePath()
 {
     if (m_dbiFilePath == nullptr)
     {
+#if defined(FEATURE_PAL) && !defined(__APPLE__)
+        // Use the DBI found for this runtime build by an earlier session unless
+        // the runtime directory was set explicitly (setclrpath).
+        std::string indexedPath;
+        if (!m_runtimeDirectorySet && LookupIndexedRuntimeLibrary(m_target, m_address, "dbi-runtime", indexedPath))
+        {
+            m_dbiFilePath = _strdup(indexedPath.c_str());
+            return m_dbiFilePath;
+        }
+#endif
         LPCSTR directory = GetRuntimeDirectory();
         if (directory != nullptr)
         {
@@ -399,6 +472,9 @@ LPCSTR Runtime::GetDbiFilePath()
 #endif
             {
                 m_dbiFilePath = _strdup(dbiModulePath.c_str());
+
+                // Indexed once the DBI has opened the process successfully
+                m_indexDbiFilePath = true;
             }
         }
     }
@@ -477,6 +553,7 @@ void Runtime::SetRuntimeDirectory(LPCSTR runtimeModuleDirectory)
     {
         m_runtimeDirectory = _strdup(runtimeModuleDirectory);
     }
+    m_runtimeDirectorySet = runtimeModuleDirectory != nullptr;
 }
 
 /**********************************************************************\
@@ -557,6 +634,7 @@ HRESULT Runtime::GetClrDataProcess(ClrDataProcessFlags flags, IXCLRDataProcess**
         {
             return CORDBG_E_MISSING_DEBUGGER_EXPORTS;
         }
+        UpdateLibraryIndex();
     }
     *ppClrDataProcess = m_clrDataProcess;
     return S_OK;
@@ -834,10 +912,32 @@ HRESULT Runtime::GetCorDebugInterface(ICorDebugProcess** ppCorDebugProcess)
     if (FAILED(hr)) {
         return hr;
     }
+    UpdateLibraryIndex();
     *ppCorDebugProcess = m_pCorDebugProcess;
     return hr;
 }
 
+/**********************************************************************\
+ * Adds the DAC and DBI found in the runtime directory to the library
+ * index once they have loaded. Opening the process with the DBI also
+ * checks that the DBI and DAC match the runtime.
+\**********************************************************************/
+void Runtime::UpdateLibraryIndex()
+{
+#if defined(FEATURE_PAL) && !defined(__APPLE__)
+    if (m_indexDacFilePath && (m_clrDataProcess != nullptr || m_pCorDebugProcess != nullptr))
+    {
+        AddIndexedRuntimeLibrary(m_target, m_address, "dac-runtime", m_dacFilePath);
+        m_indexDacFilePath = false;
+    }
+    if (m_indexDbiFilePath && m_pCorDebugProcess != nullptr)
+    {
+        AddIndexedRuntimeLibrary(m_target, m_address, "dbi-runtime", m_dbiFilePath);
+        m_indexDbiFilePath = false;
+    }
+#endif
+}
+
 /**********************************************************************\
  * Gets the runtime version
 \**********************************************************************/
@@ -131,9 +131,12 @@ private:
     const char* m_name;
     RuntimeInfo* m_runtimeInfo;
     LPCSTR m_runtimeDirectory;
+    bool m_runtimeDirectorySet;
     LPCSTR m_dacFilePath;
     LPCSTR m_cdacFilePath;
     LPCSTR m_dbiFilePath;
+    bool m_indexDacFilePath;
+    bool m_indexDbiFilePath;
     IXCLRDataProcess* m_clrDataProcess;
     IXCLRDataProcess* m_cdacDataProcess;
     ICorDebugProcess* m_pCorDebugProcess;
@@ -169,6 +172,9 @@ private:
     // DOTNET_ENABLE_CDAC requests that the in-box DAC drive the cDAC contract reader itself.
     bool ShouldUseCDac();
 
+    // Adds the DAC and DBI found in the runtime directory to the library index once they have loaded.
+    void UpdateLibraryIndex();
+
 public:
     static HRESULT CreateInstance(ITarget* target, RuntimeConfiguration configuration, Runtime** ppRuntime);
 
@@ -4,6 +4,7 @@
 #include "strike.h"
 #include "util.h"
 #include "targetimpl.h"
+#include "gcinfoprovider.h"
 #include "host.h"
 #include <string>
 
@@ -61,6 +62,10 @@ Target::~Target()
         m_netcore->Release();
         m_netcore = nullptr;
     }
+    FlushMethodTableNameCache();
+    FlushDacRequestCache();
+    FlushMethodCodeInfoCache();
+    FlushILTokenNameCache();
 #ifdef FEATURE_PAL
     FlushMetadataRegions();
 #else
@@ -299,6 +304,10 @@ void Target::Flush()
     if (m_netcore != nullptr) {
         m_netcore->Flush();
     }
+    FlushMethodTableNameCache();
+    FlushDacRequestCache();
+    FlushMethodCodeInfoCache();
+    FlushILTokenNameCache();
 #ifdef FEATURE_PAL
     FlushMetadataRegions();
 #else
@@ -37,10 +37,70 @@
 #include "sildasm.h"
 
 #include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// When set, IL output is appended to this string instead of being written out. Used to
+// capture token names for the per-module token name cache.
+static std::string* g_ilCapture = nullptr;
+
+// When set (dumpil -file), IL output is streamed to this file instead of the debugger.
+static FILE* g_ilOutputFile = nullptr;
+
+static void ILWrite(const char* text)
+{
+    if (g_ilCapture != nullptr)
+    {
+        g_ilCapture->append(text);
+    }
+    else if (g_ilOutputFile != nullptr)
+    {
+        fputs(text, g_ilOutputFile);
+    }
+    else
+    {
+        ExtOut("%s", text);
+    }
+}
+
+static void ILOut(PCSTR format, ...)
+{
+    // Most lines fit the stack buffer. A longer one (a large string literal or
+    // blob) is formatted again into a heap buffer that doubles until it fits.
+    char stackBuffer[1024];
+    std::vector<char> heapBuffer;
+    char* buffer = stackBuffer;
+    size_t size = sizeof(stackBuffer);
+    va_list args;
+    va_start(args, format);
+    while (true)
+    {
+        va_list argsCopy;
+        va_copy(argsCopy, args);
+        int length = _vsnprintf_s(buffer, size, _TRUNCATE, format, argsCopy);
+        va_end(argsCopy);
+
+        // A truncated line fills the buffer; anything else is a format error
+        if (length >= 0 || strlen(buffer) != size - 1)
+        {
+            break;
+        }
+        size *= 2;
+        heapBuffer.resize(size);
+        buffer = heapBuffer.data();
+    }
+    va_end(args);
+    if (buffer[0] != '\0')
+    {
+        ILWrite(buffer);
+    }
+}
+
 #undef printf
-#define printf ExtOut
+#define printf ILOut
 
 // typedef unsigned char BYTE;
 struct OpCode
@@ -349,53 +409,160 @@ void DisassembleToken(IMetaDataImport *i,
     }
 }
 
-ULONG GetILSize(DWORD_PTR ilAddr)
+// Per-module cache of formatted metadata tokens. Flushed when the target state changes.
+static std::unordered_map<CLRDATA_ADDRESS, std::unordered_map<DWORD, std::string>> g_ilTokenNames;
+
+void FlushILTokenNameCache()
 {
-    ULONG uRet = 0;
-
-    // workaround: read enough bytes at ilAddr to presumably get the entire header.
-    // Could be error prone.
-
-    alignas(COR_ILMETHOD) static BYTE headerArray[1024];
-    HRESULT Status = g_ExtData->ReadVirtual(TO_CDADDR(ilAddr), headerArray, sizeof(headerArray), NULL);    
-    if (SUCCEEDED(Status))
-    {            
-        COR_ILMETHOD_DECODER header((COR_ILMETHOD *)headerArray);
-        // uRet = header.GetHeaderSize();
-        uRet = header.GetOnDiskSize((COR_ILMETHOD *)headerArray);
+    g_ilTokenNames.clear();
+}
+
+static void DisassembleTokenCached(IMetaDataImport *pImport, CLRDATA_ADDRESS moduleAddr, DWORD token)
+{
+    if (moduleAddr == 0)
+    {
+        DisassembleToken(pImport, token);
+        return;
+    }
+    std::unordered_map<DWORD, std::string>& names = g_ilTokenNames[moduleAddr];
+    auto found = names.find(token);
+    if (found == names.end())
+    {
+        std::string name;
+        std::string* previous = g_ilCapture;
+        g_ilCapture = &name;
+        DisassembleToken(pImport, token);
+        g_ilCapture = previous;
+        found = names.emplace(token, std::move(name)).first;
     }
+    ILWrite(found->second.c_str());
+}
 
-    return uRet;
+// Largest IL method body (header, code and EH sections) we are willing to read.
+#define MAX_IL_METHOD_SIZE (64 * 1024 * 1024)
+
+static bool GrowILMethod(TADDR ilAddr, ArrayHolder<BYTE>& body, ULONG* pRead, ULONG needed)
+{
+    if (needed <= *pRead)
+    {
+        return true;
+    }
+    if (needed > MAX_IL_METHOD_SIZE)
+    {
+        return false;
+    }
+    BYTE* pNew = new NOTHROW BYTE[needed];
+    if (pNew == NULL)
+    {
+        return false;
+    }
+    memcpy(pNew, body, *pRead);
+    ULONG cbRead = 0;
+    if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(ilAddr + *pRead), pNew + *pRead, needed - *pRead, &cbRead)) || cbRead != needed - *pRead)
+    {
+        delete [] pNew;
+        return false;
+    }
+    body = pNew;
+    *pRead = needed;
+    return true;
 }
-  
-HRESULT DecodeILFromAddress(IMetaDataImport *pImport, TADDR ilAddr)
+
+HRESULT ReadILMethod(TADDR ilAddr, ArrayHolder<BYTE>& body, ULONG* pSize)
 {
-    HRESULT Status = S_OK;
+    // Read a block that covers the header and the code of most methods in one request and
+    // only go back to the target when the code or the EH sections extend past it.
+    const ULONG initialRead = 1024;
 
-    ULONG Size = GetILSize(ilAddr);
-    if (Size == 0)
+    *pSize = 0;
+    body = new NOTHROW BYTE[initialRead];
+    if (body.GetPtr() == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    ULONG cbRead = 0;
+    if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(ilAddr), body, initialRead, &cbRead)) || cbRead == 0)
     {
-        ExtOut("error decoding IL\n");
-        return Status;
+        return E_FAIL;
     }
 
-    ExtOut("ilAddr = %p\n", SOS_PTR(ilAddr));
+    if (!GrowILMethod(ilAddr, body, &cbRead, sizeof(IMAGE_COR_ILMETHOD_TINY)))
+    {
+        return E_FAIL;
+    }
+    COR_ILMETHOD_TINY* pTiny = (COR_ILMETHOD_TINY*)(BYTE*)body;
+    if (pTiny->IsTiny())
+    {
+        ULONG size = sizeof(IMAGE_COR_ILMETHOD_TINY) + pTiny->GetCodeSize();
+        if (!GrowILMethod(ilAddr, body, &cbRead, size))
+        {
+            return E_FAIL;
+        }
+        *pSize = size;
+        return S_OK;
+    }
+
+    if (!GrowILMethod(ilAddr, body, &cbRead, sizeof(IMAGE_COR_ILMETHOD_FAT)))
+    {
+        return E_FAIL;
+    }
+    COR_ILMETHOD_FAT* pFat = (COR_ILMETHOD_FAT*)(BYTE*)body;
+    if (!pFat->IsFat())
+    {
+        return E_FAIL;
+    }
+    bool more = pFat->More();
+    ULONG size = pFat->GetSize() * 4 + pFat->GetCodeSize();
+    if (size < sizeof(IMAGE_COR_ILMETHOD_FAT) || !GrowILMethod(ilAddr, body, &cbRead, size))
+    {
+        return E_FAIL;
+    }
 
-    // Read the memory into a local buffer
-    ArrayHolder<BYTE> pArray = new BYTE[Size];
-    Status = g_ExtData->ReadVirtual(TO_CDADDR(ilAddr), pArray, Size, NULL);
-    if (Status != S_OK)
+    // Walk the extra data sections (EH tables) that follow the code
+    while (more)
     {
-        ExtOut("Failed to read memory\n");
-        return Status;
+        size = (size + 3) & ~3;
+        if (!GrowILMethod(ilAddr, body, &cbRead, size + 4))
+        {
+            return E_FAIL;
+        }
+        COR_ILMETHOD_SECT* pSect = (COR_ILMETHOD_SECT*)((BYTE*)body + size);
+        more = pSect->More();
+        ULONG dataSize = pSect->DataSize();
+        if (dataSize < 4 || dataSize > MAX_IL_METHOD_SIZE)
+        {
+            return E_FAIL;
+        }
+        size += dataSize;
+        if (!GrowILMethod(ilAddr, body, &cbRead, size))
+        {
+            return E_FAIL;
+        }
     }
 
-    DecodeIL(pImport, pArray, Size);
+    *pSize = size;
+    return S_OK;
+}
 
-    return Status;
+HRESULT DecodeILFromAddress(IMetaDataImport *pImport, TADDR ilAddr, CLRDATA_ADDRESS moduleAddr)
+{
+    ArrayHolder<BYTE> pArray(nullptr);
+    ULONG Size = 0;
+    HRESULT Status = ReadILMethod(ilAddr, pArray, &Size);
+    if (FAILED(Status))
+    {
+        printf("error decoding IL\n");
+        return S_OK;
+    }
+
+    printf("ilAddr = %p\n", SOS_PTR(ilAddr));
+
+    DecodeIL(pImport, pArray, Size, moduleAddr);
+
+    return S_OK;
 }
 
-void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize)
+void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize, CLRDATA_ADDRESS moduleAddr)
 {
     // First decode the header
     COR_ILMETHOD *pHeader = (COR_ILMETHOD *) buffer;    
@@ -411,7 +578,7 @@ void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize)
     {
         std::tuple<ULONG, UINT> r = DecodeILAtPosition(
                 pImport, pBuffer, bufSize,
-                position, indentCount, header);
+                position, indentCount, header, moduleAddr);
         position = std::get<0>(r);
         indentCount = std::get<1>(r);
         printf("\n");
@@ -420,7 +587,8 @@ void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize)
 
 std::tuple<ULONG, UINT> DecodeILAtPosition(
         IMetaDataImport *pImport, BYTE *pBuffer, ULONG bufSize,
-        ULONG position, UINT indentCount, COR_ILMETHOD_DECODER& header)
+        ULONG position, UINT indentCount, COR_ILMETHOD_DECODER& header,
+        CLRDATA_ADDRESS moduleAddr)
 {
     for (unsigned e=0;e<header.EHCount();e++)
     {
@@ -458,10 +626,10 @@ std::tuple<ULONG, UINT> DecodeILAtPosition(
                 printf("%*s} // end .catch\n", indentCount, "");
         }
     }
-    std::function<void(DWORD)> func = [&pImport](DWORD l) {
+    std::function<void(DWORD)> func = [&pImport, moduleAddr](DWORD l) {
         if (pImport != NULL)
         {
-            DisassembleToken(pImport, l);
+            DisassembleTokenCached(pImport, moduleAddr, l);
         }
         else
         {
@@ -541,9 +709,46 @@ ULONG DisplayILOperation(const UINT indentCount, BYTE *pBuffer, ULONG position,
     return position;
 }
 
-DWORD_PTR GetObj(DacpObjectData& tokenArray, UINT item)
+// Objects referenced by the token array of a dynamic method. The array is read from the
+// target once per DecodeDynamicIL call instead of once per token operand.
+struct DynamicTokens
+{
+    DacpObjectData& tokenArray;
+    ArrayHolder<TADDR> objects;
+    ULONG count;
+
+    DynamicTokens(DacpObjectData& array) : tokenArray(array), objects(nullptr), count(0)
+    {
+        if (tokenArray.dwComponentSize != sizeof(TADDR) || tokenArray.dwNumComponents > ULONG_MAX / sizeof(TADDR))
+        {
+            return;
+        }
+        ULONG n = (ULONG)tokenArray.dwNumComponents;
+        objects = new NOTHROW TADDR[n == 0 ? 1 : n];
+        if (objects.GetPtr() != NULL)
+        {
+            ULONG cbRead = 0;
+            if (SUCCEEDED(g_ExtData->ReadVirtual(tokenArray.ArrayDataPtr, objects, n * sizeof(TADDR), &cbRead)) &&
+                cbRead == n * sizeof(TADDR))
+            {
+                count = n;
+            }
+            else
+            {
+                objects = nullptr;
+            }
+        }
+    }
+};
+
+DWORD_PTR GetObj(DynamicTokens& tokens, UINT item)
 {
-    if (item < tokenArray.dwNumComponents)
+    if (item < tokens.count)
+    {
+        return tokens.objects[item];
+    }
+    DacpObjectData& tokenArray = tokens.tokenArray;
+    if (tokens.objects.GetPtr() == NULL && item < tokenArray.dwNumComponents)
     {
         DWORD_PTR dwAddr = (DWORD_PTR) (tokenArray.ArrayDataPtr + tokenArray.dwComponentSize*item);
         DWORD_PTR objPtr;
@@ -556,7 +761,7 @@ DWORD_PTR GetObj(DacpObjectData& tokenArray, UINT item)
 }
 
 
-void DisassembleToken(DacpObjectData& tokenArray,
+void DisassembleToken(DynamicTokens& tokens,
                       DWORD token)
 {    
     switch (TypeFromToken(token))
@@ -567,7 +772,7 @@ void DisassembleToken(DacpObjectData& tokenArray,
 
     case mdtTypeDef:
         {
-            DWORD_PTR runtimeTypeHandle = GetObj(tokenArray, RidFromToken(token));
+            DWORD_PTR runtimeTypeHandle = GetObj(tokens, RidFromToken(token));
 
             DWORD_PTR runtimeType = (TADDR)0;
             MOVE(runtimeType, runtimeTypeHandle + sizeof(DWORD_PTR));
@@ -591,19 +796,19 @@ void DisassembleToken(DacpObjectData& tokenArray,
     case mdtSignature:
     case mdtTypeRef:
         {
-            printf ("%x (%p)", token, SOS_PTR(GetObj(tokenArray, RidFromToken(token))));
+            printf ("%x (%p)", token, SOS_PTR(GetObj(tokens, RidFromToken(token))));
         }
         break;
 
     case mdtFieldDef:
         {
-            printf ("%x (%p)", token, SOS_PTR(GetObj(tokenArray, RidFromToken(token))));
+            printf ("%x (%p)", token, SOS_PTR(GetObj(tokens, RidFromToken(token))));
         }
         break;
 
     case mdtMethodDef:
         {
-            CLRDATA_ADDRESS runtimeMethodHandle = GetObj(tokenArray, RidFromToken(token));            
+            CLRDATA_ADDRESS runtimeMethodHandle = GetObj(tokens, RidFromToken(token));            
             int offset = GetObjFieldOffset(runtimeMethodHandle, W("m_value"));
 
             TADDR runtimeMethodInfo = (TADDR)0;
@@ -621,12 +826,12 @@ void DisassembleToken(DacpObjectData& tokenArray,
 
     case mdtMemberRef:
         {
-            printf ("%x (%p)", token, SOS_PTR(GetObj(tokenArray, RidFromToken(token))));
+            printf ("%x (%p)", token, SOS_PTR(GetObj(tokens, RidFromToken(token))));
         }
         break;
     case mdtString:
         {
-            DWORD_PTR strObj = GetObj(tokenArray, RidFromToken(token));
+            DWORD_PTR strObj = GetObj(tokens, RidFromToken(token));
             printf ("%x \"", token);
             StringObjectContent (strObj, FALSE, 40);
             printf ("\"");
@@ -645,11 +850,12 @@ void DecodeDynamicIL(BYTE *data, ULONG Size, DacpObjectData& tokenArray)
     // At this time no exception information will be displayed (fix soon)
     UINT indentCount = 0;
     ULONG endCodePosition = Size;
+    DynamicTokens tokens(tokenArray);
+    std::function<void(DWORD)> func = [&tokens](DWORD l) {
+        DisassembleToken(tokens, l);
+    };
     while(position < endCodePosition)
     {
-        std::function<void(DWORD)> func = [&tokenArray](DWORD l) {
-            DisassembleToken(tokenArray, l);
-        };
         position = DisplayILOperation(indentCount, pBuffer, position, func);
         printf("\n");
     }
@@ -657,6 +863,109 @@ void DecodeDynamicIL(BYTE *data, ULONG Size, DacpObjectData& tokenArray)
 
 
 
+// Writes the IL of every method with a body in the module to a file (dumpil -file). The
+// output is streamed method by method so large modules are not buffered in memory, and the
+// token names are shared through the per-module token name cache.
+HRESULT DumpModuleILToFile(TADDR moduleAddr, LPCSTR filePath, ULONG* pMethodCount)
+{
+    *pMethodCount = 0;
+
+    DacpModuleData moduleData;
+    if (moduleData.Request(g_sos, TO_CDADDR(moduleAddr)) != S_OK)
+    {
+        ExtOut("%p is not a Module\n", SOS_PTR(moduleAddr));
+        return E_INVALIDARG;
+    }
+
+    ToRelease<IMetaDataImport> pImport(MDImportForModule(&moduleData));
+    if (pImport == NULL)
+    {
+        ExtOut("Unable to get the metadata for module %p\n", SOS_PTR(moduleAddr));
+        return E_FAIL;
+    }
+
+    // The <Module> type holds the global methods and is not returned by EnumTypeDefs
+    std::vector<mdTypeDef> typeDefs;
+    typeDefs.push_back(TokenFromRid(1, mdtTypeDef));
+
+    HCORENUM typeEnum = NULL;
+    mdTypeDef typeBuffer[64];
+    ULONG count = 0;
+    while (SUCCEEDED(pImport->EnumTypeDefs(&typeEnum, typeBuffer, ARRAY_SIZE(typeBuffer), &count)) && count > 0)
+    {
+        typeDefs.insert(typeDefs.end(), typeBuffer, typeBuffer + count);
+    }
+    pImport->CloseEnum(typeEnum);
+
+    FILE *file = NULL;
+    if (fopen_s(&file, filePath, "w") != 0 || file == NULL)
+    {
+        ExtOut("Failed to open file %s\n", filePath);
+        return E_FAIL;
+    }
+
+    HRESULT Status = S_OK;
+    g_ilOutputFile = file;
+
+    for (mdTypeDef typeDef : typeDefs)
+    {
+        if (IsInterrupt())
+        {
+            Status = E_ABORT;
+            break;
+        }
+
+        WCHAR typeName[mdNameLen];
+        ULONG cchName;
+        if (FAILED(pImport->GetTypeDefProps(typeDef, typeName, mdNameLen, &cchName, NULL, NULL)))
+        {
+            continue;
+        }
+
+        HCORENUM methodEnum = NULL;
+        mdMethodDef methodBuffer[64];
+        while (SUCCEEDED(pImport->EnumMethods(&methodEnum, typeDef, methodBuffer, ARRAY_SIZE(methodBuffer), &count)) && count > 0)
+        {
+            for (ULONG i = 0; i < count; i++)
+            {
+                WCHAR methodName[mdNameLen];
+                ULONG rva = 0;
+                DWORD implFlags;
+                if (FAILED(pImport->GetMethodProps(methodBuffer[i], NULL, methodName, mdNameLen, &cchName, NULL, NULL, NULL, &rva, &implFlags)) || rva == 0)
+                {
+                    continue;
+                }
+
+                printf("// %S::%S (%08x)\n", typeName, methodName, methodBuffer[i]);
+
+                CLRDATA_ADDRESS ilAddr = 0;
+                ArrayHolder<BYTE> body(nullptr);
+                ULONG size = 0;
+                if (g_sos->GetILForModule(TO_CDADDR(moduleAddr), rva, &ilAddr) != S_OK || ilAddr == 0 ||
+                    FAILED(ReadILMethod(TO_TADDR(ilAddr), body, &size)))
+                {
+                    printf("// unable to read IL\n\n");
+                    continue;
+                }
+
+                DecodeIL(pImport, body, size, TO_CDADDR(moduleAddr));
+                printf("\n");
+                (*pMethodCount)++;
+            }
+        }
+        pImport->CloseEnum(methodEnum);
+    }
+
+    g_ilOutputFile = nullptr;
+    if (ferror(file))
+    {
+        ExtOut("Failed to write file %s\n", filePath);
+        Status = E_FAIL;
+    }
+    fclose(file);
+    return Status;
+}
+
 /******************************************************************************/
 // CQuickBytes utilities
 static char* asString(CQuickBytes *out) {
@@ -16,6 +16,7 @@
 
 std::tuple<ULONG, UINT> DecodeILAtPosition(
         IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize,
-        ULONG position, UINT indentCount, COR_ILMETHOD_DECODER& header);
+        ULONG position, UINT indentCount, COR_ILMETHOD_DECODER& header,
+        CLRDATA_ADDRESS moduleAddr = 0);
 
 #endif // __sildasm_h__
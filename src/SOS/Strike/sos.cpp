@@ -53,9 +53,6 @@ namespace sos
         if (mMTData)
             delete mMTData;
 
-        if (mTypeName)
-            delete mTypeName;
-
         mAddress = addr;
         mMT = 0;
         mSize = ~0;
@@ -131,7 +128,7 @@ namespace sos
     const WCHAR *Object::GetTypeName() const
     {
         if (mTypeName == NULL)
-            mTypeName = CreateMethodTableName(GetMT(), GetComponentMT());
+            mTypeName = GetCachedMethodTableName(GetMT(), GetComponentMT());
 
 
         if (mTypeName == NULL)
@@ -145,7 +142,7 @@ namespace sos
         if (mMTData == NULL)
         {
             mMTData = new DacpMethodTableData;
-            if (FAILED(mMTData->Request(g_sos, GetMT())))
+            if (FAILED(CachedRequest(*mMTData, GetMT())))
             {
                 delete mMTData;
                 mMTData = NULL;
@@ -232,7 +229,7 @@ namespace sos
     bool Object::VerifyMemberFields(TADDR pMT, TADDR obj, WORD &numInstanceFields)
     {
         DacpMethodTableData vMethTable;
-        if (FAILED(vMethTable.Request(g_sos, pMT)))
+        if (FAILED(CachedRequest(vMethTable, pMT)))
             return false;
 
         // Recursively verify the parent (this updates numInstanceFields)
@@ -292,17 +289,13 @@ namespace sos
 
     void MethodTable::Clear()
     {
-        if (mName)
-        {
-            delete [] mName;
-            mName = NULL;
-        }
+        mName = NULL;
     }
 
     const WCHAR *MethodTable::GetName() const
     {
         if (mName == NULL)
-            mName = CreateMethodTableName(mMT);
+            mName = GetCachedMethodTableName(mMT);
 
         if (mName == NULL)
             return W("<error>");
@@ -223,7 +223,7 @@ namespace sos
 
     private:
         TADDR mMT;
-        mutable WCHAR *mName;
+        mutable const WCHAR *mName;
     };
 
     /* This represents an object on the GC heap in the target process.  This class
@@ -290,9 +290,6 @@ namespace sos
         {
             if (mMTData)
                 delete mMTData;
-
-            if (mTypeName)
-                delete mTypeName;
         }
 
         const Object &operator=(TADDR addr);
@@ -445,7 +442,7 @@ namespace sos
         mutable size_t mSize;
         mutable bool mPointers;
         mutable DacpMethodTableData *mMTData;
-        mutable WCHAR *mTypeName;
+        mutable const WCHAR *mTypeName;
     };
 
     /* Reprensents an entry in the sync block table.
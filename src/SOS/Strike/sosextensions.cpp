@@ -49,9 +49,40 @@ SOSExtensions::Initialize(IHost* host, IDebuggerServices* debuggerServices)
     {
         s_extensions = new SOSExtensions(debuggerServices, host);
     }
+    else if (host != nullptr)
+    {
+        // The lldb plug-in initializes SOS without a host while its background hosting is
+        // still loading and again with the host once it is ready
+        ((SOSExtensions*)s_extensions)->SetHost(host);
+    }
     return S_OK;
 }
 
+/// <summary>
+/// Switches from the local host instance to the host's. The target and the services
+/// from the local host are released so the next command gets them from the new host.
+/// </summary>
+void
+SOSExtensions::SetHost(IHost* host)
+{
+    if (m_pHost == host)
+    {
+        host->Release();
+        return;
+    }
+    ReleaseTarget();
+    if (m_pSymbolService != nullptr)
+    {
+        m_pSymbolService->Release();
+        m_pSymbolService = nullptr;
+    }
+    if (m_pHost != nullptr)
+    {
+        m_pHost->Release();
+    }
+    m_pHost = host;
+}
+
 void
 SOSExtensions::Uninitialize()
 {
@@ -67,6 +98,7 @@ SOSExtensions::Uninitialize()
 /// 
 /// * dotnet-dump - m_pHost has already been set by SOSInitializeByHost by SOS.Hosting
 /// * lldb - m_pHost has already been set by SOSInitializeByHost by libsosplugin which gets it via the InitializeHostServices callback
+///   unless the plug-in's background hosting was still loading. The local host is used until SetHost is called.
 /// * dbgeng - SOS.Extensions provides the instance via the InitializeHostServices callback
 /// </summary>
 IHost*
@@ -22,6 +22,7 @@ public:
     static HRESULT Initialize(IHost* host, IDebuggerServices* debuggerServices);
     static void Uninitialize();
     IHost* GetHost();
+    void SetHost(IHost* host);
 };
 
 extern HRESULT GetRuntime(IRuntime** ppRuntime);
@@ -88,6 +88,7 @@
 #include <set>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <tuple>
 #include <memory>
 #include <functional>
@@ -122,6 +123,7 @@
 #include "hillclimbing.h"
 #include "sos_md.h"
 #include "gcinfoprovider.h"
+#include "filewriterpool.h"
 
 #ifndef FEATURE_PAL
 
@@ -729,12 +731,14 @@ DECLARE_API(DumpIL)
     DWORD_PTR dwDynamicMethodObj = (TADDR)0;
     BOOL dml = FALSE;
     BOOL fILPointerDirectlySpecified = FALSE;
+    StringHolder filePath;
 
     CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"-i", &fILPointerDirectlySpecified, COBOOL, FALSE},
         {"/i", &fILPointerDirectlySpecified, COBOOL, FALSE},
         {"/d", &dml, COBOOL, FALSE},
+        {"-file", &filePath.data, COSTRING, TRUE},
     };
     CMDValue arg[] =
     {   // vptr, type
@@ -759,6 +763,22 @@ DECLARE_API(DumpIL)
         return DecodeILFromAddress(NULL, dwStartAddr);
     }
 
+    if (filePath.data != NULL)
+    {
+        // The address is a Module; write the IL of all of its methods to the file
+        ULONG methodCount = 0;
+        Status = DumpModuleILToFile(dwStartAddr, filePath.data, &methodCount);
+        if (Status == E_ABORT)
+        {
+            ExtOut("Interrupted after writing %d methods to %s\n", methodCount, filePath.data);
+        }
+        else if (SUCCEEDED(Status))
+        {
+            ExtOut("Wrote the IL of %d methods to %s\n", methodCount, filePath.data);
+        }
+        return Status;
+    }
+
     if (sos::IsObject(dwStartAddr))
     {
         dwDynamicMethodObj = dwStartAddr;
@@ -800,7 +820,7 @@ DECLARE_API(DumpIL)
             ExtOut("ilAddr is %p pImport is %p\n", SOS_PTR(std::get<0>(result)), SOS_PTR(std::get<1>(result)));
             TADDR ilAddr = std::get<0>(result);
             ToRelease<IMetaDataImport> pImport(std::get<1>(result));
-            IfFailRet(DecodeILFromAddress(pImport, ilAddr));
+            IfFailRet(DecodeILFromAddress(pImport, ilAddr, MethodDescData.ModulePtr));
         }
     }
 
@@ -1988,9 +2008,9 @@ HRESULT PrintArray(DacpObjectData& objData, DumpArrayFlags& flags, BOOL isPermSe
     if (!isPermSetPrint)
     {
         // TODO: don't depend on this being a MethodTable
-        NameForMT_s(TO_TADDR(objData.ElementTypeHandle), g_mdName, mdNameLen);
+        const WCHAR *elementName = GetCachedMethodTableName(TO_TADDR(objData.ElementTypeHandle));
 
-        ExtOut("Name:        %S[", g_mdName);
+        ExtOut("Name:        %S[", elementName != NULL ? elementName : W("<error>"));
         for (i = 1; i < objData.dwRank; i++)
             ExtOut(",");
         ExtOut("]\n");
@@ -2133,11 +2153,15 @@ DECLARE_API(DumpObj)
     BOOL dml = FALSE;
     BOOL bNoFields = FALSE;
     BOOL bRefs = FALSE;
+    BOOL bUtf8 = FALSE;
     StringHolder str_Object;
+    StringHolder str_File;
     CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"-nofields", &bNoFields, COBOOL, FALSE},
         {"-refs", &bRefs, COBOOL, FALSE},
+        {"-file", &str_File.data, COSTRING, TRUE},
+        {"-utf8", &bUtf8, COBOOL, FALSE},
         {"/d", &dml, COBOOL, FALSE},
     };
     CMDValue arg[] =
@@ -2158,6 +2182,17 @@ DECLARE_API(DumpObj)
         return E_INVALIDARG;
     }
 
+    if (str_File.data != NULL)
+    {
+        ULONG64 written = 0;
+        Status = ExportObjectContent(p_Object, str_File.data, bUtf8 != FALSE, &written);
+        if (SUCCEEDED(Status))
+        {
+            ExtOut("Wrote %I64u bytes to %s\n", written, str_File.data);
+        }
+        return Status;
+    }
+
     try {
         Status = PrintObj(p_Object, !bNoFields);
 
@@ -2436,11 +2471,13 @@ struct StackTraceElement
 
 #include "sildasm.h"
 
+// Append only string buffer. The length is tracked so appending doesn't
+// rescan what was already added and the buffer grows by doubling.
 class StringOutput
 {
 public:
     CQuickString cs;
-    StringOutput()
+    StringOutput() : m_length(0)
     {
         cs.Alloc(1024);
         cs.String()[0] = L'\0';
@@ -2449,31 +2486,45 @@ public:
     BOOL Append(__in_z LPCWSTR pszStr)
     {
         size_t iInputLen = _wcslen (pszStr);
-        size_t iCurLen = _wcslen (cs.String());
-        if ((iCurLen + iInputLen + 1) > cs.Size())
+        size_t iNeeded = m_length + iInputLen + 1;
+        if (iNeeded > cs.Size())
         {
-            if (cs.ReSize(iCurLen + iInputLen + 1) != S_OK)
+            if (cs.ReSize(std::max(iNeeded, (size_t)cs.Size() * 2)) != S_OK)
             {
                 return FALSE;
             }
         }
 
-        wcsncat_s (cs.String(), cs.Size(), pszStr, _TRUNCATE);
+        memcpy(cs.String() + m_length, pszStr, (iInputLen + 1) * sizeof(WCHAR));
+        m_length += iInputLen;
         return TRUE;
     }
 
     size_t Length()
     {
-        return _wcslen(cs.String());
+        return m_length;
     }
 
     WCHAR *String()
     {
         return cs.String();
     }
+
+private:
+    size_t m_length;
+};
+
+// The "module!method" part of a frame, which is the same for every frame of
+// the MethodDesc, and the method's code address for the frame's offset
+struct MethodDescFrameName
+{
+    WString Name;
+    CLRDATA_ADDRESS NativeCodeAddr;
 };
 
-static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp, ULONG64 IPAddr, StringOutput& so);
+typedef std::unordered_map<TADDR, MethodDescFrameName> MethodDescNameCache;
+
+static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp, ULONG64 IPAddr, StringOutput& so, MethodDescNameCache* pNameCache = NULL);
 
 // Using heuristics to determine if an exception object represented an async (hardware) or a
 // managed exception
@@ -2565,7 +2616,8 @@ size_t FormatGeneratedException (DWORD_PTR dataPtr,
     size_t bufferLength,
     BOOL bAsync,                // hardware exception if true
     BOOL bNestedCase = FALSE,
-    BOOL bLineNumbers = FALSE)
+    BOOL bLineNumbers = FALSE,
+    MethodDescNameCache* pNameCache = NULL)
 {
     UINT count = bytes / sizeof(StackTraceElement);
     size_t Length = 0;
@@ -2593,10 +2645,37 @@ size_t FormatGeneratedException (DWORD_PTR dataPtr,
         count--;
     }
 
+    // Read the whole stack trace at once. If that fails (i.e. part of the array
+    // isn't in the dump) read the elements one by one like before.
+    ArrayHolder<StackTraceElement> elements = new NOTHROW StackTraceElement[count];
+    if (elements == NULL)
+    {
+        ReportOOM();
+        return 0;
+    }
+    ULONG cbRead = 0;
+    bool bBulkRead = count > 0 &&
+        g_ExtData->ReadVirtual(TO_CDADDR(dataPtr), elements, count * sizeof(StackTraceElement), &cbRead) == S_OK &&
+        cbRead == count * sizeof(StackTraceElement);
+
+    // The same methods usually show up in many frames (recursion, async state machines)
+    MethodDescNameCache nameCache;
+    if (pNameCache == NULL)
+    {
+        pNameCache = &nameCache;
+    }
+
     for (UINT i = 0; i < count; i++)
     {
         StackTraceElement ste;
-        MOVE (ste, dataPtr + i*sizeof(StackTraceElement));
+        if (bBulkRead)
+        {
+            ste = elements[i];
+        }
+        else if (FAILED(MOVE(ste, dataPtr + i*sizeof(StackTraceElement))))
+        {
+            continue;
+        }
 
         // ste.ip must be adjusted because of an ancient workaround in the exception
         // infrastructure. The workaround is that the exception needs to have
@@ -2636,7 +2715,7 @@ size_t FormatGeneratedException (DWORD_PTR dataPtr,
 #endif // defined(_TARGET_AMD64_) || defined(_TARGET__X86_)
 
         StringOutput so;
-        HRESULT Status = DumpMDInfoBuffer(ste.pFunc, SOS_STACKTRACE_SHOWADDRESSES|SOS_STACKTRACE_SHOWEXPLICITFRAMES, ste.sp, ste.ip, so);
+        HRESULT Status = DumpMDInfoBuffer(ste.pFunc, SOS_STACKTRACE_SHOWADDRESSES|SOS_STACKTRACE_SHOWEXPLICITFRAMES, ste.sp, ste.ip, so, pNameCache);
 
         // If DumpMDInfoBuffer failed (due to out of memory or missing metadata),
         // or did not update so (when ste is an explicit frames), do not update wszBuffer
@@ -2675,12 +2754,13 @@ size_t FormatGeneratedException (DWORD_PTR dataPtr,
                 swprintf_s(wszLineBuffer, ARRAY_SIZE(wszLineBuffer), W("    %s\n"), so.String());
             }
 
-            Length += _wcslen(wszLineBuffer);
-
-            if (wszBuffer)
+            // Copy to the end of what was already written instead of rescanning the buffer
+            size_t lineLength = _wcslen(wszLineBuffer);
+            if (wszBuffer && Length < bufferLength)
             {
-                wcsncat_s(wszBuffer, bufferLength, wszLineBuffer, _TRUNCATE);
+                wcsncpy_s(wszBuffer + Length, bufferLength - Length, wszLineBuffer, _TRUNCATE);
             }
+            Length += lineLength;
         }
     }
 
@@ -2898,12 +2978,13 @@ HRESULT FormatException(CLRDATA_ADDRESS taObj, BOOL bLineNumbers = FALSE)
                 else
                 {
                     size_t iHeaderLength = AddExceptionHeader (NULL, 0);
-                    size_t iLength = FormatGeneratedException (dataPtr, cbStackSize, NULL, 0, bAsync, FALSE, bLineNumbers);
+                    MethodDescNameCache nameCache;
+                    size_t iLength = FormatGeneratedException (dataPtr, cbStackSize, NULL, 0, bAsync, FALSE, bLineNumbers, &nameCache);
                     WCHAR *pwszBuffer = new NOTHROW WCHAR[iHeaderLength + iLength + 1];
                     if (pwszBuffer)
                     {
                         AddExceptionHeader(pwszBuffer, iHeaderLength + 1);
-                        FormatGeneratedException(dataPtr, cbStackSize, pwszBuffer + iHeaderLength, iLength + 1, bAsync, FALSE, bLineNumbers);
+                        FormatGeneratedException(dataPtr, cbStackSize, pwszBuffer + iHeaderLength, iLength + 1, bAsync, FALSE, bLineNumbers, &nameCache);
                         SosExtOutLargeString(pwszBuffer, iHeaderLength + iLength + 1);
                         delete[] pwszBuffer;
                     }
@@ -4072,9 +4153,8 @@ DECLARE_API(DumpModule)
         CLRDATA_ADDRESS methodDescs[kcMaxMethodDescsForProfiler];
         int cMethodDescs;
 
-        ReleaseHolder<ISOSDacInterface7> sos7;
-        if (SUCCEEDED(g_sos->QueryInterface(__uuidof(ISOSDacInterface7), &sos7)) &&
-            SUCCEEDED(sos7->GetMethodsWithProfilerModifiedIL(TO_CDADDR(p_ModuleAddr),
+        if (g_sos7 != nullptr &&
+            SUCCEEDED(g_sos7->GetMethodsWithProfilerModifiedIL(TO_CDADDR(p_ModuleAddr),
                                                              methodDescs,
                                                              kcMaxMethodDescsForProfiler,
                                                              &cMethodDescs)))
@@ -4095,7 +4175,7 @@ DECLARE_API(DumpModule)
                     }
 
                     struct DacpProfilerILData ilData;
-                    if (SUCCEEDED(sos7->GetProfilerModifiedILInformation(md, &ilData)))
+                    if (SUCCEEDED(g_sos7->GetProfilerModifiedILInformation(md, &ilData)))
                     {
                         if (ilData.type == DacpProfilerILData::ILModified)
                         {
@@ -5046,11 +5126,56 @@ void IssueDebuggerBPCommand ( CLRDATA_ADDRESS addr )
 
 class Breakpoints
 {
+    // All the pending breakpoints in the order ListBreakpoints and ClearBreakpoint number them
     PendingBreakpoint* m_breakpoints;
+
+    // Breakpoints not yet bound to a module that name a method, grouped by module name (as
+    // passed to ModuleFromName) so a module load only checks each distinct name once
+    std::unordered_map<std::string, std::vector<PendingBreakpoint*>> m_unboundByModuleName;
+
+    // Breakpoints not yet bound to a module that name a source line. These need the symbols
+    // of every loaded module; when there are none, module loads skip loading symbols.
+    size_t m_unboundSourceCount;
+
+    // Breakpoints bound to a module, by module
+    std::unordered_map<TADDR, std::vector<PendingBreakpoint*>> m_boundByModule;
+
+    struct TokenKey
+    {
+        TADDR mod;
+        mdMethodDef token;
+        DWORD ilOffset;
+
+        bool operator==(const TokenKey& other) const
+        {
+            return mod == other.mod && token == other.token && ilOffset == other.ilOffset;
+        }
+    };
+
+    struct TokenKeyHash
+    {
+        size_t operator()(const TokenKey& key) const
+        {
+            return std::hash<TADDR>()(key.mod) ^ ((size_t)key.token * 31) ^ ((size_t)key.ilOffset << 7);
+        }
+    };
+
+    // Module bound breakpoints by (module, method token, IL offset) for IsIn
+    std::unordered_map<TokenKey, PendingBreakpoint*, TokenKeyHash> m_byToken;
+
+    static std::string ModuleNameKey(const WCHAR* szModule)
+    {
+        char szName[mdNameLen];
+        WideCharToMultiByte(CP_ACP, 0, szModule, -1, szName, mdNameLen, NULL, NULL);
+        szName[mdNameLen - 1] = '\0';
+        return std::string(szName);
+    }
+
 public:
     Breakpoints()
     {
         m_breakpoints = NULL;
+        m_unboundSourceCount = 0;
     }
     ~Breakpoints()
     {
@@ -5073,8 +5198,7 @@ public:
             wcscpy_s(pNew->szFunctionName, mdNameLen, szName);
             pNew->SetModule(mod);
             pNew->ilOffset = ilOffset;
-            pNew->pNext = m_breakpoints;
-            m_breakpoints = pNew;
+            Insert(pNew);
         }
     }
 
@@ -5088,8 +5212,7 @@ public:
             pNew->methodToken = methodToken;
             pNew->SetModule(mod);
             pNew->ilOffset = ilOffset;
-            pNew->pNext = m_breakpoints;
-            m_breakpoints = pNew;
+            Insert(pNew);
         }
     }
 
@@ -5101,8 +5224,7 @@ public:
             wcscpy_s(pNew->szFilename, MAX_LONGPATH, szFilename);
             pNew->lineNumber = lineNumber;
             pNew->SetModule(mod);
-            pNew->pNext = m_breakpoints;
-            m_breakpoints = pNew;
+            Insert(pNew);
         }
     }
 
@@ -5116,82 +5238,70 @@ public:
             pNew->methodToken = methodToken;
             pNew->SetModule(mod);
             pNew->ilOffset = ilOffset;
-            pNew->pNext = m_breakpoints;
-            m_breakpoints = pNew;
+            Insert(pNew);
         }
     }
 
     //returns true if updates are still needed for this module, FALSE if all BPs are now bound
     BOOL Update(TADDR mod, BOOL isNewModule)
     {
-        BOOL bNeedUpdates = FALSE;
-        PendingBreakpoint *pCur = NULL;
-
         if(isNewModule)
         {
-            SymbolReader symbolReader;
-            SymbolReader* pSymReader = &symbolReader;
-            if(LoadSymbolsForModule(mod, &symbolReader) != S_OK)
-                pSymReader = NULL;
+            ResolveForNewModule(mod);
+        }
 
-            // Get tokens for any modules that match. If there was a change,
-            // update notifications.
-            pCur = m_breakpoints;
-            while(pCur)
-            {
-                PendingBreakpoint *pNext = pCur->pNext;
-                ResolvePendingNonModuleBoundBreakpoint(mod, pCur, pSymReader);
-                pCur = pNext;
-            }
+        auto found = m_boundByModule.find(mod);
+        if (found == m_boundByModule.end())
+        {
+            return FALSE;
         }
 
-        pCur = m_breakpoints;
-        while(pCur)
+        ToRelease<IXCLRDataModule> pModule;
+        if (FAILED(g_sos->GetModule(mod, &pModule)))
         {
-            PendingBreakpoint *pNext = pCur->pNext;
-            if (ResolvePendingBreakpoint(mod, pCur))
+            return FALSE;
+        }
+
+        // Collect the methods that still need a code notification and set them all
+        // with one request instead of one per breakpoint.
+        BOOL bNeedUpdates = FALSE;
+        std::vector<mdMethodDef> deferred;
+        std::vector<PendingBreakpoint*> bound(found->second);
+        for (PendingBreakpoint* pCur : bound)
+        {
+            if (ResolvePendingBreakpoint(pModule, pCur, &deferred))
             {
                 bNeedUpdates = TRUE;
             }
-            pCur = pNext;
+        }
+        if (!deferred.empty() && !SetCodeNotifications(pModule, deferred))
+        {
+            bNeedUpdates = FALSE;
         }
         return bNeedUpdates;
     }
 
     BOOL UpdateKnownCodeAddress(TADDR mod, CLRDATA_ADDRESS bpLocation)
     {
-        PendingBreakpoint *pCur = m_breakpoints;
-        BOOL bpSet = FALSE;
-
-        while(pCur)
+        if (m_boundByModule.find(mod) == m_boundByModule.end())
         {
-            PendingBreakpoint *pNext = pCur->pNext;
-            if (pCur->ModuleMatches(mod))
-            {
-                IssueDebuggerBPCommand(bpLocation);
-                bpSet = TRUE;
-                break;
-            }
-
-            pCur = pNext;
+            return FALSE;
         }
-
-        return bpSet;
+        IssueDebuggerBPCommand(bpLocation);
+        return TRUE;
     }
 
     void RemovePendingForModule(TADDR mod)
     {
-        PendingBreakpoint *pCur = m_breakpoints;
-        while(pCur)
+        auto found = m_boundByModule.find(mod);
+        if (found == m_boundByModule.end())
         {
-            PendingBreakpoint *pNext = pCur->pNext;
-            if (pCur->ModuleMatches(mod))
-            {
-                // Delete the current node, and keep going
-                Delete(pCur);
-            }
-
-            pCur = pNext;
+            return;
+        }
+        std::vector<PendingBreakpoint*> bound(found->second);
+        for (PendingBreakpoint* pCur : bound)
+        {
+            Delete(pCur);
         }
     }
 
@@ -5311,13 +5421,9 @@ public:
 
     HRESULT ResolvePendingNonModuleBoundBreakpoint(__in_z WCHAR* pModuleName, __in_z WCHAR* pMethodName, TADDR mod, DWORD ilOffset)
     {
-        HRESULT Status = S_OK;
         char szName[mdNameLen];
         int numModule;
 
-        ToRelease<IXCLRDataModule> module;
-        IfFailRet(g_sos->GetModule(mod, &module));
-
         WideCharToMultiByte(CP_ACP, 0, pModuleName, (int)(_wcslen(pModuleName) + 1), szName, mdNameLen, NULL, NULL);
 
         ArrayHolder<DWORD_PTR> moduleList = ModuleFromName(szName, &numModule);
@@ -5331,30 +5437,17 @@ public:
         {
             // If any one entry in moduleList matches, then the current PendingBreakpoint
             // is the right one.
-            if(moduleList[i] != TO_TADDR(mod))
-                continue;
-
-            CLRDATA_ENUM h;
-            if (module->StartEnumMethodDefinitionsByName(pMethodName, 0, &h) == S_OK)
+            if(moduleList[i] == TO_TADDR(mod))
             {
-                IXCLRDataMethodDefinition *pMeth = NULL;
-                while (module->EnumMethodDefinitionByName(&h, &pMeth) == S_OK)
-                {
-                    mdMethodDef methodToken;
-                    ToRelease<IXCLRDataModule> pUnusedModule;
-                    IfFailRet(pMeth->GetTokenAndScope(&methodToken, &pUnusedModule));
-
-                    Add(pModuleName, pMethodName, methodToken, mod, ilOffset);
-                    pMeth->Release();
-                }
-                module->EndEnumMethodDefinitionsByName(h);
+                return AddMethodDefinitionsByName(pModuleName, pMethodName, mod, ilOffset);
             }
         }
         return S_OK;
     }
 
-    // Return TRUE if there might be more instances that will be JITTED later
-    static BOOL ResolveMethodInstances(IXCLRDataMethodDefinition *pMeth, DWORD ilOffset)
+    // Return TRUE if there might be more instances that will be JITTED later. When pDeferred
+    // is not NULL the method token is added to it instead of setting the code notification.
+    static BOOL ResolveMethodInstances(IXCLRDataMethodDefinition *pMeth, DWORD ilOffset, std::vector<mdMethodDef>* pDeferred = NULL)
     {
         BOOL bFoundCode = FALSE;
         BOOL bNeedDefer = FALSE;
@@ -5403,6 +5496,16 @@ public:
 
         bNeedDefer = !bFoundCode || bGeneric;
         // This is down here because we only need to call SetCodeNofiication once.
+        if (bNeedDefer && pDeferred != NULL)
+        {
+            mdMethodDef methodToken;
+            ToRelease<IXCLRDataModule> pUnusedModule;
+            if (SUCCEEDED(pMeth->GetTokenAndScope(&methodToken, &pUnusedModule)))
+            {
+                pDeferred->push_back(methodToken);
+                return bNeedDefer;
+            }
+        }
         if (bNeedDefer)
         {
             if (pMeth->SetCodeNotification (CLRDATA_METHNOTIFY_GENERATED) != S_OK)
@@ -5415,6 +5518,182 @@ public:
     }
 
 private:
+    void Insert(PendingBreakpoint *pNew)
+    {
+        pNew->pNext = m_breakpoints;
+        m_breakpoints = pNew;
+
+        if (pNew->pModule != (TADDR)0)
+        {
+            m_boundByModule[pNew->pModule].push_back(pNew);
+            if (pNew->methodToken != 0)
+            {
+                m_byToken.emplace(TokenKey { pNew->pModule, pNew->methodToken, pNew->ilOffset }, pNew);
+            }
+        }
+        else if (pNew->szModuleName[0] != L'\0')
+        {
+            m_unboundByModuleName[ModuleNameKey(pNew->szModuleName)].push_back(pNew);
+        }
+        else
+        {
+            m_unboundSourceCount++;
+        }
+    }
+
+    static void RemoveFromList(std::vector<PendingBreakpoint*>& list, PendingBreakpoint *pDelete)
+    {
+        auto it = std::find(list.begin(), list.end(), pDelete);
+        if (it != list.end())
+        {
+            list.erase(it);
+        }
+    }
+
+    void Unindex(PendingBreakpoint *pDelete)
+    {
+        if (pDelete->pModule != (TADDR)0)
+        {
+            auto found = m_boundByModule.find(pDelete->pModule);
+            if (found != m_boundByModule.end())
+            {
+                RemoveFromList(found->second, pDelete);
+                if (found->second.empty())
+                {
+                    m_boundByModule.erase(found);
+                }
+            }
+            if (pDelete->methodToken != 0)
+            {
+                auto token = m_byToken.find(TokenKey { pDelete->pModule, pDelete->methodToken, pDelete->ilOffset });
+                if (token != m_byToken.end() && token->second == pDelete)
+                {
+                    m_byToken.erase(token);
+                }
+            }
+        }
+        else if (pDelete->szModuleName[0] != L'\0')
+        {
+            auto found = m_unboundByModuleName.find(ModuleNameKey(pDelete->szModuleName));
+            if (found != m_unboundByModuleName.end())
+            {
+                RemoveFromList(found->second, pDelete);
+                if (found->second.empty())
+                {
+                    m_unboundByModuleName.erase(found);
+                }
+            }
+        }
+        else
+        {
+            m_unboundSourceCount--;
+        }
+    }
+
+    // Binds the breakpoints that are not bound to a module yet to a newly loaded module. Each
+    // distinct module name is matched once and the symbols are only loaded when there are
+    // source line breakpoints.
+    void ResolveForNewModule(TADDR mod)
+    {
+        if (!m_unboundByModuleName.empty())
+        {
+            DacpModuleData moduleData;
+            if (moduleData.Request(g_sos, TO_CDADDR(mod)) == S_OK)
+            {
+                ArrayHolder<WCHAR> moduleName = new NOTHROW WCHAR[MAX_LONGPATH];
+                ArrayHolder<char> fileName = new NOTHROW char[MAX_LONGPATH];
+                if (moduleName != NULL && fileName != NULL)
+                {
+                    FileNameForModule(&moduleData, moduleName);
+                    WideCharToMultiByte(CP_ACP, 0, moduleName, -1, fileName, MAX_LONGPATH, NULL, NULL);
+
+                    // Adding the bound breakpoints doesn't change the unbound groups
+                    for (auto& entry : m_unboundByModuleName)
+                    {
+                        std::vector<char> name(entry.first.begin(), entry.first.end());
+                        name.push_back('\0');
+                        if (!ModuleNameMatches(moduleData, fileName, name.data()))
+                        {
+                            continue;
+                        }
+                        for (PendingBreakpoint* pCur : entry.second)
+                        {
+                            AddMethodDefinitionsByName(pCur->szModuleName, pCur->szFunctionName, mod, pCur->ilOffset);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (m_unboundSourceCount > 0)
+        {
+            SymbolReader symbolReader;
+            if (LoadSymbolsForModule(mod, &symbolReader) == S_OK)
+            {
+                PendingBreakpoint *pCur = m_breakpoints;
+                while(pCur)
+                {
+                    PendingBreakpoint *pNext = pCur->pNext;
+                    if (pCur->pModule == (TADDR)0 && pCur->szModuleName[0] == L'\0')
+                    {
+                        ResolvePendingNonModuleBoundBreakpoint(pCur->szFilename, pCur->lineNumber, mod, &symbolReader);
+                    }
+                    pCur = pNext;
+                }
+            }
+        }
+    }
+
+    HRESULT AddMethodDefinitionsByName(__in_z WCHAR* pModuleName, __in_z WCHAR* pMethodName, TADDR mod, DWORD ilOffset)
+    {
+        HRESULT Status = S_OK;
+        ToRelease<IXCLRDataModule> module;
+        IfFailRet(g_sos->GetModule(mod, &module));
+
+        CLRDATA_ENUM h;
+        if (module->StartEnumMethodDefinitionsByName(pMethodName, 0, &h) == S_OK)
+        {
+            IXCLRDataMethodDefinition *pMeth = NULL;
+            while (module->EnumMethodDefinitionByName(&h, &pMeth) == S_OK)
+            {
+                mdMethodDef methodToken;
+                ToRelease<IXCLRDataModule> pUnusedModule;
+                IfFailRet(pMeth->GetTokenAndScope(&methodToken, &pUnusedModule));
+
+                Add(pModuleName, pMethodName, methodToken, mod, ilOffset);
+                pMeth->Release();
+            }
+            module->EndEnumMethodDefinitionsByName(h);
+        }
+        return S_OK;
+    }
+
+    // Sets the code notifications for the methods of a module in one request. Falls back
+    // to one request per method if the batch isn't supported.
+    static BOOL SetCodeNotifications(IXCLRDataModule* pModule, std::vector<mdMethodDef>& tokens)
+    {
+        if (g_clrData != nullptr &&
+            g_clrData->SetCodeNotifications((ULONG32)tokens.size(), NULL, pModule, tokens.data(), NULL, CLRDATA_METHNOTIFY_GENERATED) == S_OK)
+        {
+            return TRUE;
+        }
+        BOOL bSet = FALSE;
+        for (mdMethodDef token : tokens)
+        {
+            ToRelease<IXCLRDataMethodDefinition> pMeth;
+            if (pModule->GetMethodDefinitionByToken(token, &pMeth) == S_OK &&
+                pMeth->SetCodeNotification(CLRDATA_METHNOTIFY_GENERATED) == S_OK)
+            {
+                bSet = TRUE;
+            }
+        }
+        if (!bSet)
+        {
+            ExtOut("Failed to set code notification\n");
+        }
+        return bSet;
+    }
+
     BOOL IsIn(__in_z LPWSTR szModule, __in_z LPWSTR szName, TADDR mod)
     {
         PendingBreakpoint *pCur = m_breakpoints;
@@ -5449,18 +5728,7 @@ private:
 
     BOOL IsIn(mdMethodDef token, TADDR mod, DWORD ilOffset)
     {
-        PendingBreakpoint *pCur = m_breakpoints;
-        while(pCur)
-        {
-            if (pCur->ModuleMatches(mod) &&
-                pCur->methodToken == token &&
-                pCur->ilOffset == ilOffset)
-            {
-                return TRUE;
-            }
-            pCur = pCur->pNext;
-        }
-        return FALSE;
+        return m_byToken.find(TokenKey { mod, token, ilOffset }) != m_byToken.end();
     }
 
     void Delete(PendingBreakpoint *pDelete)
@@ -5479,6 +5747,7 @@ private:
                 {
                     pPrev->pNext = pCur->pNext;
                 }
+                Unindex(pCur);
                 delete pCur;
                 return;
             }
@@ -5487,55 +5756,24 @@ private:
         }
     }
 
-
-
-    HRESULT ResolvePendingNonModuleBoundBreakpoint(TADDR mod, PendingBreakpoint *pCur, SymbolReader* pSymbolReader)
-    {
-        // This function only works with pending breakpoints that are not module bound.
-        if (pCur->pModule == (TADDR)0)
-        {
-            if (pCur->szModuleName[0] != L'\0')
-            {
-                return ResolvePendingNonModuleBoundBreakpoint(pCur->szModuleName, pCur->szFunctionName, mod, pCur->ilOffset);
-            }
-            else
-            {
-                return ResolvePendingNonModuleBoundBreakpoint(pCur->szFilename, pCur->lineNumber, mod, pSymbolReader);
-            }
-        }
-        else
-        {
-            return S_OK;
-        }
-    }
-
     // Returns TRUE if further instances may be jitted, FALSE if all instances are now resolved
-    BOOL ResolvePendingBreakpoint(TADDR addr, PendingBreakpoint *pCur)
+    BOOL ResolvePendingBreakpoint(IXCLRDataModule* mod, PendingBreakpoint *pCur, std::vector<mdMethodDef>* pDeferred)
     {
-        // Only go forward if the module matches the current PendingBreakpoint
-        if (!pCur->ModuleMatches(addr))
-        {
-            return FALSE;
-        }
-
-        ToRelease<IXCLRDataModule> mod;
-        if (FAILED(g_sos->GetModule(addr, &mod)))
+        if(pCur->methodToken == 0)
         {
             return FALSE;
         }
 
-        if(pCur->methodToken == 0)
+        ToRelease<IXCLRDataMethodDefinition> pMeth = NULL;
+        if (mod->GetMethodDefinitionByToken(pCur->methodToken, &pMeth) != S_OK)
         {
             return FALSE;
         }
 
-        ToRelease<IXCLRDataMethodDefinition> pMeth = NULL;
-        mod->GetMethodDefinitionByToken(pCur->methodToken, &pMeth);
-
         // We may not need the code notification. Maybe it was ngen'd and we
         // already have the method?
         // We can delete the current entry if ResolveMethodInstances() set all BPs
-        return ResolveMethodInstances(pMeth, pCur->ilOffset);
+        return ResolveMethodInstances(pMeth, pCur->ilOffset, pDeferred);
     }
 };
 
@@ -6163,6 +6401,9 @@ DECLARE_API(bpmd)
         // If LoadClrDebugDll() succeeded make sure we release g_clrData
         ToRelease<IXCLRDataProcess> spIDP(g_clrData);
         ToRelease<ISOSDacInterface> spISD(g_sos);
+        ToRelease<ISOSDacInterface5> spISD5(g_sos5);
+        ToRelease<ISOSDacInterface7> spISD7(g_sos7);
+        ToRelease<ISOSDacInterface14> spISD14(g_sos14);
         if (g_sos != nullptr)
         {
             ResetGlobals();
@@ -6676,7 +6917,21 @@ DECLARE_API(EHInfo)
     DumpMDInfo(TO_TADDR(MD.MethodDescPtr));
 
     ExtOut("\n");
-    Status = g_sos->TraverseEHInfo(TO_CDADDR(MD.NativeCodeAddr), traverseEh, (LPVOID)MD.NativeCodeAddr);
+    const std::vector<DACEHInfo>* pClauses = NULL;
+    Status = GetCachedEHClauses(MD.MethodDescPtr, TO_CDADDR(MD.NativeCodeAddr), &pClauses);
+    if (Status == S_OK)
+    {
+        UINT totalClauses = (UINT)pClauses->size();
+        for (UINT i = 0; i < totalClauses; i++)
+        {
+            DACEHInfo clause = (*pClauses)[i];
+            if (!traverseEh(i, totalClauses, &clause, (LPVOID)MD.NativeCodeAddr))
+            {
+                Status = E_ABORT;
+                break;
+            }
+        }
+    }
 
     if (Status == E_ABORT)
     {
@@ -6706,11 +6961,13 @@ DECLARE_API(GCInfo)
     TADDR taGCInfoAddr;
     BOOL dml = FALSE;
     BOOL useLegacy = FALSE;
+    BOOL json = FALSE;
 
     CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"/d", &dml, COBOOL, FALSE},
         {"-legacy", &useLegacy, COBOOL, FALSE},
+        {"-json", &json, COBOOL, FALSE},
     };
     CMDValue arg[] =
     {   // vptr, type
@@ -6790,16 +7047,28 @@ DECLARE_API(GCInfo)
     // Use GCInfoData abstraction (tries ISOSDacInterface18 first, then legacy)
     if (!useLegacy)
     {
-        GCInfoData gcInfo;
-        CLRDATA_ADDRESS methodIP = TO_CDADDR(codeHeaderData.MethodStart);
-        HRESULT hr = GCInfoData::Create(methodIP, gcInfo);
-        if (SUCCEEDED(hr) && gcInfo.IsValid)
+        const GCInfoData* pGCInfo = NULL;
+        HRESULT hr = GetCachedGCInfo(codeHeaderData.MethodDescPtr, TO_CDADDR(codeHeaderData.MethodStart), &pGCInfo);
+        if (SUCCEEDED(hr) && pGCInfo->IsValid)
         {
-            gcInfo.DumpToOutput(ExtOut);
+            if (json)
+            {
+                pGCInfo->DumpToJson(ExtOut);
+            }
+            else
+            {
+                pGCInfo->DumpToOutput(ExtOut);
+            }
             return Status;
         }
     }
 
+    if (json)
+    {
+        ExtOut("JSON output requires a runtime that provides decoded GC info\n");
+        return Status;
+    }
+
     // Final fallback: raw GC info blob + DumpGCInfo (for older runtimes without Interface18)
     taGCInfoAddr = TO_TADDR(codeHeaderData.GCInfo);
 
@@ -6942,9 +7211,8 @@ GetILAddressResult GetILAddress(const DacpMethodDescData& MethodDescData)
     GetILAddressResult error = std::make_tuple((TADDR)0, nullptr);
     TADDR ilAddr = (TADDR)0;
     struct DacpProfilerILData ilData;
-    ReleaseHolder<ISOSDacInterface7> sos7;
-    if (SUCCEEDED(g_sos->QueryInterface(__uuidof(ISOSDacInterface7), &sos7)) &&
-        SUCCEEDED(sos7->GetProfilerModifiedILInformation(MethodDescData.MethodDescPtr, &ilData)))
+    if (g_sos7 != nullptr &&
+        SUCCEEDED(g_sos7->GetProfilerModifiedILInformation(MethodDescData.MethodDescPtr, &ilData)))
     {
         if (ilData.type == DacpProfilerILData::ILModified)
         {
@@ -7135,15 +7403,9 @@ DECLARE_API(u)
         {
             pImport = pResultImport;
 
-            ilSize = GetILSize(ilAddr);
-            if (ilSize != 0)
+            if (SUCCEEDED(ReadILMethod(ilAddr, pArray, &ilSize)))
             {
-                pArray = new BYTE[ilSize];
-                Status = g_ExtData->ReadVirtual(TO_CDADDR(ilAddr), pArray, ilSize, NULL);
-                if (Status == S_OK)
-                {
-                    hasIL = TRUE;
-                }
+                hasIL = TRUE;
             }
         }
         else
@@ -7204,7 +7466,7 @@ DECLARE_API(u)
                 } while (mapIndex < mapCount);
                 std::tuple<ULONG, UINT> r = DecodeILAtPosition(
                     pImport, pBuffer, bufSize,
-                    position, indentCount, header);
+                    position, indentCount, header, MethodDescData.ModulePtr);
                 ExtOut("\n");
                 if (mapIndex < mapCount)
                 {
@@ -7230,7 +7492,7 @@ DECLARE_API(u)
         }
 
         displayILFun =
-            [&pImport, &pBuffer, bufSize, &header, &ilCodePositions](ULONG *pPosition, UINT *pIndentCount,
+            [&pImport, &pBuffer, bufSize, &header, &ilCodePositions, &MethodDescData](ULONG *pPosition, UINT *pIndentCount,
                                                     BYTE *pIp) -> void {
                     for (auto iter = ilCodePositions.begin(); iter != ilCodePositions.end(); ++iter)
                     {
@@ -7242,7 +7504,7 @@ DECLARE_API(u)
                             {
                                 std::tuple<ULONG, UINT> r = DecodeILAtPosition(
                                     pImport, pBuffer, bufSize,
-                                    position, *pIndentCount, header);
+                                    position, *pIndentCount, header, MethodDescData.ModulePtr);
                                 ExtOut("\n");
                                 position = std::get<0>(r);
                                 *pIndentCount = std::get<1>(r);
@@ -7284,11 +7546,29 @@ DECLARE_API(u)
         {
             ReportOOM();
         }
-        else if (g_sos->TraverseEHInfo(codeHeaderData.MethodStart, gatherEh, (LPVOID)pInfo) != S_OK)
+        else
         {
-            ExtOut("Failed to gather EHInfo data\n");
-            delete pInfo;
-            pInfo = NULL;
+            const std::vector<DACEHInfo>* pClauses = NULL;
+            if (GetCachedEHClauses(codeHeaderData.MethodDescPtr, codeHeaderData.MethodStart, &pClauses) != S_OK)
+            {
+                ExtOut("Failed to gather EHInfo data\n");
+                delete pInfo;
+                pInfo = NULL;
+            }
+            else
+            {
+                UINT totalClauses = (UINT)pClauses->size();
+                for (UINT i = 0; i < totalClauses; i++)
+                {
+                    DACEHInfo clause = (*pClauses)[i];
+                    if (!gatherEh(i, totalClauses, &clause, (LPVOID)pInfo))
+                    {
+                        delete pInfo;
+                        pInfo = NULL;
+                        break;
+                    }
+                }
+            }
         }
     }
 
@@ -7478,7 +7758,8 @@ HRESULT displayGcInfo(BOOL fWithGCInfo, const DacpCodeHeaderData& codeHeaderData
     // For the entries with offset prefixes, we parse the offset, and display all relevant information
     // before the current instruction offset being disassembled, that is, all the lines of GC info
     // with an offset greater than the previous instruction and with an offset less than or equal
-    // to the offset of the current instruction.
+    // to the offset of the current instruction. The text is split into an offset-sorted line table
+    // once (GCEncodingInfo::BuildLineTable) so the disassemblers can merge it in a single pass.
 
     // The actual GC Encoding Table, this is updated during the course of the function.
     // Use a holder to make sure we clean up the memory for the table.
@@ -7493,12 +7774,12 @@ HRESULT displayGcInfo(BOOL fWithGCInfo, const DacpCodeHeaderData& codeHeaderData
 
         // Try the GCInfoData abstraction first (ISOSDacInterface18, then legacy decoder)
         {
-            GCInfoData gcInfo;
-            CLRDATA_ADDRESS methodIP = TO_CDADDR(codeHeaderData.MethodStart);
-            HRESULT hr = GCInfoData::Create(methodIP, gcInfo);
-            if (SUCCEEDED(hr) && gcInfo.IsValid)
+            const GCInfoData* pGCInfo = NULL;
+            HRESULT hr = GetCachedGCInfo(codeHeaderData.MethodDescPtr, TO_CDADDR(codeHeaderData.MethodStart), &pGCInfo);
+            if (SUCCEEDED(hr) && pGCInfo->IsValid)
             {
-                gcInfo.DumpToOutput(DecodeGCTableEntry);
+                pGCInfo->DumpToOutput(DecodeGCTableEntry);
+                g_gcEncodingInfo.BuildLineTable();
                 return S_OK;
             }
         }
@@ -7537,6 +7818,7 @@ HRESULT displayGcInfo(BOOL fWithGCInfo, const DacpCodeHeaderData& codeHeaderData
 
         GCInfoToken gcInfoToken = { table, GCInfoVersion() };
         g_targetMachine->DumpGCInfo(gcInfoToken, methodSize, DecodeGCTableEntry, false /*encBytes*/, false /*bPrintHeader*/);
+        g_gcEncodingInfo.BuildLineTable();
     }
     return S_OK;
 }
@@ -7586,6 +7868,56 @@ HRESULT GetIntermediateLangMap(BOOL bIL, const DacpCodeHeaderData& codeHeaderDat
     return S_OK;
 }
 
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    This function is called to export the IL to native maps, with     *
+*    source lines, of all the jitted methods in a module (or in all    *
+*    modules) to a file for offline symbolization.                     *
+*                                                                      *
+\**********************************************************************/
+DECLARE_API(ExportILMap)
+{
+    INIT_API_PROBE_MANAGED("exportilmap");
+
+    BOOL csv = FALSE;
+    StringHolder filePath;
+    DWORD_PTR moduleAddr = (TADDR)0;
+
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-csv", &csv, COBOOL, FALSE},
+    };
+    CMDValue arg[] =
+    {   // vptr, type
+        {&filePath.data, COSTRING},
+        {&moduleAddr, COHEX},
+    };
+    size_t nArg;
+
+    if (!GetCMDOption(args, option, ARRAY_SIZE(option), arg, ARRAY_SIZE(arg), &nArg))
+    {
+        return E_INVALIDARG;
+    }
+    if (nArg == 0)
+    {
+        ExtOut("Usage: %sExportILMap [-csv] <file path> [<Module address>]\n", SOSPrefix);
+        return E_INVALIDARG;
+    }
+
+    ULONG methodCount = 0;
+    Status = ExportILMap(moduleAddr, filePath.data, csv != FALSE, &methodCount);
+    if (Status == E_ABORT)
+    {
+        ExtOut("Interrupted after writing the maps of %d methods to %s\n", methodCount, filePath.data);
+    }
+    else if (SUCCEEDED(Status))
+    {
+        ExtOut("Wrote the maps of %d methods to %s\n", methodCount, filePath.data);
+    }
+    return Status;
+}
+
 #ifdef TRACE_GC
 
 DECLARE_API (DumpGCLog)
@@ -8729,29 +9061,59 @@ private:
                 sos::Throw<sos::Exception>("Failed to walk the handle table.");
         }
 
-        // GCC can't handle stacks which are too large.
-#ifndef FEATURE_PAL
-        SOSHandleData data[256];
-#else
-        SOSHandleData data[4];
-#endif
+        if (mStat)
+        {
+            WalkHandleStatistics(handles);
+            return;
+        }
+
+        const unsigned int batchSize = 4096;
+        ArrayHolder<SOSHandleData> data = new NOTHROW SOSHandleData[batchSize];
+        if (data == NULL)
+        {
+            ReportOOM();
+            return;
+        }
 
         unsigned int fetched = 0;
         HRESULT hr = S_OK;
         do
         {
-            if (FAILED(hr = handles->Next(ARRAY_SIZE(data), data, &fetched)))
+            if (FAILED(hr = handles->Next(batchSize, data, &fetched)))
             {
                 ExtOut("Error %x while walking the handle table.\n", hr);
                 break;
             }
 
             WalkHandles(data, fetched);
-        } while (ARRAY_SIZE(data) == fetched);
+        } while (batchSize == fetched);
     }
 
+    // Prints a batch of handles. The objects of the whole batch are resolved
+    // in bulk by GetObjectsMTAndSize before the rows are written in handle
+    // table order.
     void WalkHandles(SOSHandleData data[], unsigned int count)
     {
+        std::vector<TADDR> objAddrs(count);
+        std::vector<bool> readFailed(count);
+        std::vector<ObjectMTAndSize> objects;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            if (mType != (unsigned int)~0 && mType != data[i].Type)
+                continue;
+
+            if (FAILED(MOVE(objAddrs[i], data[i].Handle)))
+            {
+                objAddrs[i] = 0;
+                readFailed[i] = true;
+            }
+            else if (objAddrs[i] != 0)
+            {
+                objects.push_back({ objAddrs[i], 0, 0 });
+            }
+        }
+        GetObjectsMTAndSize(objects.data(), objects.size());
+
         for (unsigned int i = 0; i < count; ++i)
         {
             sos::CheckInterrupt();
@@ -8760,89 +9122,44 @@ private:
                 continue;
 
             GCHandleStatistics *pStats = mHandleStat.LookupStatistics(data[i].AppDomain);
-            TADDR objAddr = 0;
+            TADDR objAddr = objAddrs[i];
             TADDR mtAddr = 0;
             size_t size = 0;
             const WCHAR *mtName = 0;
             const char *type = 0;
 
-            if (FAILED(MOVE(objAddr, data[i].Handle)))
+            if (readFailed[i])
             {
-                objAddr = 0;
                 mtName = W("<error>");
             }
             else
             {
-                sos::Object obj(TO_TADDR(objAddr));
-                mtAddr = obj.GetMT();
-                if (sos::MethodTable::IsFreeMT(mtAddr))
+                // The objects are sorted by address
+                auto found = std::lower_bound(objects.begin(), objects.end(), objAddr,
+                    [](const ObjectMTAndSize& object, TADDR addr) { return object.Object < addr; });
+                if (found != objects.end() && found->Object == objAddr)
                 {
-                    mtName = W("<free>");
+                    mtAddr = found->MT;
+                    size = found->Size;
                 }
-                else if (!sos::MethodTable::IsValid(mtAddr))
+
+                if (mtAddr == 0)
                 {
                     mtName = W("<error>");
+                    size = 0;
+                }
+                else if (sos::MethodTable::IsFreeMT(mtAddr))
+                {
+                    mtName = W("<free>");
+                    size = 0;
                 }
                 else
                 {
-                    size = obj.GetSize();
-                    if (mType == (unsigned int)~0 || mType == data[i].Type)
-                        pStats->hs.Add(obj.GetMT(), (DWORD)size);
+                    pStats->hs.Add(mtAddr, (DWORD)size);
                 }
             }
 
-            switch(data[i].Type)
-            {
-                case HNDTYPE_PINNED:
-                    type = "Pinned";
-                    if (pStats) pStats->pinnedHandleCount++;
-                    break;
-                case HNDTYPE_REFCOUNTED:
-                    type = "RefCounted";
-                    if (pStats) pStats->refCntHandleCount++;
-                    break;
-                case HNDTYPE_STRONG:
-                    type = "Strong";
-                    if (pStats) pStats->strongHandleCount++;
-                    break;
-                case HNDTYPE_WEAK_SHORT:
-                    type = "WeakShort";
-                    if (pStats) pStats->weakShortHandleCount++;
-                    break;
-                case HNDTYPE_WEAK_LONG:
-                    type = "WeakLong";
-                    if (pStats) pStats->weakLongHandleCount++;
-                    break;
-                case HNDTYPE_ASYNCPINNED:
-                    type = "AsyncPinned";
-                    if (pStats) pStats->asyncPinnedHandleCount++;
-                    break;
-                case HNDTYPE_VARIABLE:
-                    type = "Variable";
-                    if (pStats) pStats->variableCount++;
-                    break;
-                case HNDTYPE_SIZEDREF:
-                    type = "SizedRef";
-                    if (pStats) pStats->sizedRefCount++;
-                    break;
-                case HNDTYPE_DEPENDENT:
-                    type = "Dependent";
-                    if (pStats) pStats->dependentCount++;
-                    break;
-                case HNDTYPE_WEAK_WINRT:
-                    type = "WeakWinRT";
-                    if (pStats) pStats->weakWinRTHandleCount++;
-                    break;
-                case HNDTYPE_WEAK_INTERIOR_POINTER:
-                    type = "WeakInteriorPointer";
-                    if (pStats) pStats->weakInteriorPointerHandleCount++;
-                    break;
-                default:
-                    DebugBreak();
-                    type = "Unknown";
-                    pStats->unknownHandleCount++;
-                    break;
-            }
+            type = CountHandle(pStats, data[i].Type);
 
             if (type && !mStat)
             {
@@ -8864,6 +9181,171 @@ private:
         }
     }
 
+    // Counts the handle in the per type statistics and returns its type name.
+    const char *CountHandle(GCHandleStatistics *pStats, unsigned int handleType)
+    {
+        const char *type = 0;
+        switch(handleType)
+        {
+            case HNDTYPE_PINNED:
+                type = "Pinned";
+                if (pStats) pStats->pinnedHandleCount++;
+                break;
+            case HNDTYPE_REFCOUNTED:
+                type = "RefCounted";
+                if (pStats) pStats->refCntHandleCount++;
+                break;
+            case HNDTYPE_STRONG:
+                type = "Strong";
+                if (pStats) pStats->strongHandleCount++;
+                break;
+            case HNDTYPE_WEAK_SHORT:
+                type = "WeakShort";
+                if (pStats) pStats->weakShortHandleCount++;
+                break;
+            case HNDTYPE_WEAK_LONG:
+                type = "WeakLong";
+                if (pStats) pStats->weakLongHandleCount++;
+                break;
+            case HNDTYPE_ASYNCPINNED:
+                type = "AsyncPinned";
+                if (pStats) pStats->asyncPinnedHandleCount++;
+                break;
+            case HNDTYPE_VARIABLE:
+                type = "Variable";
+                if (pStats) pStats->variableCount++;
+                break;
+            case HNDTYPE_SIZEDREF:
+                type = "SizedRef";
+                if (pStats) pStats->sizedRefCount++;
+                break;
+            case HNDTYPE_DEPENDENT:
+                type = "Dependent";
+                if (pStats) pStats->dependentCount++;
+                break;
+            case HNDTYPE_WEAK_WINRT:
+                type = "WeakWinRT";
+                if (pStats) pStats->weakWinRTHandleCount++;
+                break;
+            case HNDTYPE_WEAK_INTERIOR_POINTER:
+                type = "WeakInteriorPointer";
+                if (pStats) pStats->weakInteriorPointerHandleCount++;
+                break;
+            default:
+                DebugBreak();
+                type = "Unknown";
+                pStats->unknownHandleCount++;
+                break;
+        }
+
+        return type;
+    }
+
+    // The -stat fast path. Only the per-type counts and the per-MethodTable
+    // totals are needed, so the handles are fetched in large batches, the
+    // handle slots are read in address order once the walk is done and the
+    // objects are resolved in bulk by GetObjectsMTAndSize. The totals are kept
+    // in one hash table per domain instead of being added to the HeapStat tree
+    // one handle at a time.
+    void WalkHandleStatistics(ISOSHandleEnum *handles)
+    {
+        struct PendingHandle
+        {
+            TADDR Handle;
+            TADDR Object;
+            GCHandleStatistics *Stats;
+        };
+
+        struct MTTotal
+        {
+            DWORD Count;
+            size_t Size;
+        };
+
+        const unsigned int batchSize = 4096;
+        ArrayHolder<SOSHandleData> data = new NOTHROW SOSHandleData[batchSize];
+        if (data == NULL)
+        {
+            ReportOOM();
+            return;
+        }
+
+        std::vector<PendingHandle> pending;
+        unsigned int fetched = 0;
+        HRESULT hr = S_OK;
+        do
+        {
+            if (FAILED(hr = handles->Next(batchSize, data, &fetched)))
+            {
+                ExtOut("Error %x while walking the handle table.\n", hr);
+                break;
+            }
+
+            for (unsigned int i = 0; i < fetched; ++i)
+            {
+                if (mType != (unsigned int)~0 && mType != data[i].Type)
+                    continue;
+
+                GCHandleStatistics *pStats = mHandleStat.LookupStatistics(data[i].AppDomain);
+                CountHandle(pStats, data[i].Type);
+                if (pStats != NULL)
+                    pending.push_back({ TO_TADDR(data[i].Handle), 0, pStats });
+            }
+
+            sos::CheckInterrupt();
+        } while (batchSize == fetched);
+
+        std::sort(pending.begin(), pending.end(), [](const PendingHandle& a, const PendingHandle& b) { return a.Handle < b.Handle; });
+        for (PendingHandle& handle : pending)
+        {
+            if (FAILED(MOVE(handle.Object, handle.Handle)))
+                handle.Object = 0;
+        }
+
+        sos::CheckInterrupt();
+
+        // Resolve each distinct object once
+        std::sort(pending.begin(), pending.end(), [](const PendingHandle& a, const PendingHandle& b) { return a.Object < b.Object; });
+
+        std::vector<ObjectMTAndSize> objects;
+        for (const PendingHandle& handle : pending)
+        {
+            if (handle.Object != 0 && (objects.empty() || objects.back().Object != handle.Object))
+                objects.push_back({ handle.Object, 0, 0 });
+        }
+        GetObjectsMTAndSize(objects.data(), objects.size());
+
+        sos::CheckInterrupt();
+
+        std::unordered_map<GCHandleStatistics *, std::unordered_map<TADDR, MTTotal>> totals;
+        size_t next = 0;
+        for (const PendingHandle& handle : pending)
+        {
+            if (handle.Object == 0)
+                continue;
+
+            // Both lists are sorted by object address
+            while (objects[next].Object != handle.Object)
+                next++;
+
+            const ObjectMTAndSize& object = objects[next];
+            if (object.MT == 0 || sos::MethodTable::IsFreeMT(object.MT))
+                continue;
+
+            MTTotal& total = totals[handle.Stats][object.MT];
+            total.Count++;
+            total.Size += object.Size;
+        }
+
+        for (const auto& domain : totals)
+        {
+            for (const auto& entry : domain.second)
+            {
+                domain.first->hs.Add(entry.first, entry.second.Size, entry.second.Count);
+            }
+        }
+    }
+
     inline void PrintHandleRow(const char *text, int count)
     {
         if (count)
@@ -10411,6 +10893,29 @@ void PrintRef(const SOSStackRefData &ref, TableOutput &out)
 }
 
 
+// Prints where the frame's code offset falls in the method's GC info (an
+// interruptible range, a safe point or neither) and how many slots are live there.
+static void PrintFrameGCInfo(CLRDATA_ADDRESS ip, TableOutput &out)
+{
+    const GCInfoData* pGCInfo = NULL;
+    unsigned int codeOffset = 0;
+    if (GetGCInfoForIP(ip, &pGCInfo, &codeOffset) != S_OK || !pGCInfo->IsValid)
+        return;
+
+    const char* state = "not a GC safe point";
+    if (pGCInfo->IsInterruptible(codeOffset))
+        state = "fully interruptible";
+    else if (pGCInfo->IsSafePoint(codeOffset))
+        state = "GC safe point";
+
+    std::vector<size_t> liveSlots;
+    pGCInfo->GetLiveSlots(codeOffset, liveSlots);
+
+    char buffer[128];
+    sprintf_s(buffer, ARRAY_SIZE(buffer), "GC info: offset 0x%x, %s, %d live slots", codeOffset, state, (int)liveSlots.size());
+    out.WriteColumn(2, buffer);
+}
+
 class ClrStackImpl
 {
 public:
@@ -10544,6 +11049,8 @@ public:
 
                     // Print out gc references.  refCount will be zero if bGC is false (or if we
                     // failed to fetch gc reference information).
+                    if (bGC)
+                        PrintFrameGCInfo(ip, out);
                     for (unsigned int i = 0; i < refCount; ++i)
                         if (pRefs[i].Source == ip && pRefs[i].StackPointer == sp)
                             PrintRef(pRefs[i], out);
@@ -11307,10 +11814,12 @@ DECLARE_API(ClrStack)
     return S_OK;
 }
 
-#ifndef FEATURE_PAL
-
 BOOL IsMemoryInfoAvailable()
 {
+#ifdef FEATURE_PAL
+    // The mappings come from the core's program headers or the live process
+    return TRUE;
+#else
     ULONG Class;
     ULONG Qualifier;
     g_ExtControl->GetDebuggeeType(&Class,&Qualifier);
@@ -11326,6 +11835,7 @@ BOOL IsMemoryInfoAvailable()
         }
     }
     return TRUE;
+#endif // FEATURE_PAL
 }
 
 DECLARE_API(VMMap)
@@ -11344,8 +11854,6 @@ DECLARE_API(VMMap)
     return Status;
 }
 
-#endif // FEATURE_PAL
-
 DECLARE_API(SOSFlush)
 {
     INIT_API_NOEE_PROBE_MANAGED("sosflush");
@@ -11359,8 +11867,6 @@ DECLARE_API(SOSFlush)
     return S_OK;
 }
 
-#ifndef FEATURE_PAL
-
 DECLARE_API( VMStat )
 {
     INIT_API();
@@ -11377,25 +11883,60 @@ DECLARE_API( VMStat )
     return Status;
 }   // DECLARE_API( vmmap )
 
+// Modules are read from the target in chunks of this size and handed to the
+// writer threads; at most SAVEMODULE_QUEUE_SIZE bytes are waiting to be written.
+#define SAVEMODULE_CHUNK_SIZE (1024 * 1024)
+#define SAVEMODULE_QUEUE_SIZE (64 * 1024 * 1024)
+#define SAVEMODULE_MAX_THREADS 4
+
+// A module image to save, collected before anything is written
+struct SaveModuleImage
+{
+    TADDR Base;
+    BOOL IsFileLayout;
+    std::string FileName;
+};
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    This function saves a dll to a file.                              *
+*    Returns the base address of the PE image of a Module or of the    *
+*    module at a base address and whether it is mapped flat (as the    *
+*    file) or as a loaded image.                                       *
 *                                                                      *
 \**********************************************************************/
-HRESULT SaveModuleToFile(CLRDATA_ADDRESS moduleAddr, LPSTR file)
-    {
-    DWORD_PTR dllBase = 0;
+static HRESULT GetModuleImage(CLRDATA_ADDRESS moduleAddr, TADDR* pBase, BOOL* pIsFileLayout)
+{
+    TADDR dllBase = 0;
+    BOOL isFileLayout = FALSE;
+    BOOL hasLayout = FALSE;
     ULONG64 base;
     if (g_ExtSymbols->GetModuleByOffset(TO_CDADDR(moduleAddr), 0, NULL, &base) == S_OK)
     {
+        // Mapped by the native loader
         dllBase = TO_TADDR(base);
     }
     else if (IsModule((DWORD_PTR)moduleAddr))
     {
-        DacpModuleData module;
-        module.Request(g_sos, TO_CDADDR(moduleAddr));
-        dllBase = TO_TADDR(module.ilBase);
+        ToRelease<IXCLRDataModule> dataModule;
+        DacpGetModuleData moduleData;
+        if (SUCCEEDED(g_sos->GetModule(moduleAddr, &dataModule)) &&
+            SUCCEEDED(moduleData.Request(dataModule)) &&
+            moduleData.LoadedPEAddress != 0)
+        {
+            dllBase = TO_TADDR(moduleData.LoadedPEAddress);
+            isFileLayout = moduleData.IsFileLayout;
+            hasLayout = TRUE;
+        }
+        else
+        {
+            DacpModuleData module;
+            module.Request(g_sos, TO_CDADDR(moduleAddr));
+            dllBase = TO_TADDR(module.ilBase);
+
+            // Assemblies the runtime maps itself are flat unless the target says otherwise
+            isFileLayout = TRUE;
+        }
         if (dllBase == 0)
         {
             ExtOut("Module does not have base address\n");
@@ -11408,67 +11949,174 @@ HRESULT SaveModuleToFile(CLRDATA_ADDRESS moduleAddr, LPSTR file)
         return E_INVALIDARG;
     }
 
-    MEMORY_BASIC_INFORMATION64 mbi;
-    if (FAILED(g_ExtData2->QueryVirtual(TO_CDADDR(dllBase), &mbi)))
+#ifndef FEATURE_PAL
+    if (!hasLayout)
     {
-        ExtOut("Failed to retrieve information about segment %p", SOS_PTR(dllBase));
+        MEMORY_BASIC_INFORMATION64 mbi;
+        if (SUCCEEDED(g_ExtData2->QueryVirtual(TO_CDADDR(dllBase), &mbi)))
+        {
+            isFileLayout = (mbi.Type != MEM_IMAGE);
+        }
+    }
+#endif
+    *pBase = dllBase;
+    *pIsFileLayout = isFileLayout;
+    return S_OK;
+}
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Reads the PE headers of the image at dllBase.                     *
+*                                                                      *
+\**********************************************************************/
+static HRESULT ReadModuleHeaders(TADDR dllBase, IMAGE_NT_HEADERS* pHeader, std::vector<IMAGE_SECTION_HEADER>& sections)
+{
+    IMAGE_DOS_HEADER DosHeader;
+    if (g_ExtData->ReadVirtual(TO_CDADDR(dllBase), &DosHeader, sizeof(DosHeader), NULL) != S_OK ||
+        DosHeader.e_magic != IMAGE_DOS_SIGNATURE)
+    {
+        ExtOut("%p is not a PE image\n", SOS_PTR(dllBase));
+        return E_FAIL;
+    }
+    if (g_ExtData->ReadVirtual(TO_CDADDR(dllBase + DosHeader.e_lfanew), pHeader, sizeof(*pHeader), NULL) != S_OK ||
+        pHeader->Signature != IMAGE_NT_SIGNATURE)
+    {
+        ExtOut("%p is not a PE image\n", SOS_PTR(dllBase));
         return E_FAIL;
     }
 
-    // module loaded as an image or mapped as a flat file?
-    BOOL bIsImage = (mbi.Type == MEM_IMAGE);
+    TADDR sectionAddr = dllBase + DosHeader.e_lfanew + offsetof(IMAGE_NT_HEADERS, OptionalHeader)
+            + pHeader->FileHeader.SizeOfOptionalHeader;
 
-    IMAGE_DOS_HEADER DosHeader;
-    if (g_ExtData->ReadVirtual(TO_CDADDR(dllBase), &DosHeader, sizeof(DosHeader), NULL) != S_OK)
-        return S_FALSE;
+    sections.resize(pHeader->FileHeader.NumberOfSections);
+    if (!sections.empty() &&
+        g_ExtData->ReadVirtual(TO_CDADDR(sectionAddr), sections.data(), (ULONG)(sections.size() * sizeof(IMAGE_SECTION_HEADER)), NULL) != S_OK)
+    {
+        ExtOut("Fail to read PE section info\n");
+        return E_FAIL;
+    }
 
+    // Written in file order
+    std::sort(sections.begin(), sections.end(), [](const IMAGE_SECTION_HEADER& a, const IMAGE_SECTION_HEADER& b) {
+        return a.PointerToRawData < b.PointerToRawData;
+    });
+    return S_OK;
+}
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    This function reads a module's image from the target and queues   *
+*    it in chunks to the writer pool to rebuild the file.              *
+*                                                                      *
+\**********************************************************************/
+static HRESULT SaveModuleImageToFile(const SaveModuleImage& image, LPCSTR file, FileWriterPool& writer, bool verbose)
+{
     IMAGE_NT_HEADERS Header;
-    if (g_ExtData->ReadVirtual(TO_CDADDR(dllBase + DosHeader.e_lfanew), &Header, sizeof(Header), NULL) != S_OK)
-        return S_FALSE;
+    std::vector<IMAGE_SECTION_HEADER> sections;
+    HRESULT hr = ReadModuleHeaders(image.Base, &Header, sections);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    if (verbose)
+    {
+        ExtOut("%u sections in file\n", (ULONG)sections.size());
+        for (size_t n = 0; n < sections.size(); n++)
+        {
+            ExtOut("section %d - VA=%x, VASize=%x, FileAddr=%x, FileSize=%x\n", (int)n,
+                sections[n].VirtualAddress, sections[n].Misc.VirtualSize,
+                sections[n].PointerToRawData, sections[n].SizeOfRawData);
+        }
+    }
 
-    DWORD_PTR sectionAddr = dllBase + DosHeader.e_lfanew + offsetof(IMAGE_NT_HEADERS, OptionalHeader)
-            + Header.FileHeader.SizeOfOptionalHeader;
+    FILE* pFile = nullptr;
+    if (fopen_s(&pFile, file, "wb") != 0 || pFile == nullptr)
+    {
+        ExtOut("Fail to create file %s\n", file);
+        return E_FAIL;
+    }
+    uint32_t fileId = writer.AddFile(pFile);
 
-    IMAGE_SECTION_HEADER section;
-    struct MemLocation
+    // Copies [address, address + size) of the target to the file, zero filling
+    // the rest of fileSize. The chunks are handed off as they are read.
+    ULONG64 fileOffset = 0;
+    auto copy = [&](TADDR address, ULONG64 size, ULONG64 fileSize) -> bool
     {
-        DWORD_PTR VAAddr;
-        DWORD_PTR VASize;
-        DWORD_PTR FileAddr;
-        DWORD_PTR FileSize;
+        while (fileSize > 0)
+        {
+            if (IsInterrupt())
+            {
+                return false;
+            }
+            ULONG chunkSize = (ULONG)std::min(fileSize, (ULONG64)SAVEMODULE_CHUNK_SIZE);
+            std::vector<uint8_t> chunk(chunkSize);
+            ULONG readSize = (ULONG)std::min(size, (ULONG64)chunkSize);
+            if (readSize > 0)
+            {
+                ULONG read = 0;
+                if (g_ExtData->ReadVirtual(TO_CDADDR(address), chunk.data(), readSize, &read) != S_OK || read != readSize)
+                {
+                    ExtOut("Fail to read memory %p\n", SOS_PTR(address));
+                    return false;
+                }
+            }
+            writer.Write(fileId, std::move(chunk));
+            address += chunkSize;
+            size -= readSize;
+            fileSize -= chunkSize;
+            fileOffset += chunkSize;
+        }
+        return true;
     };
 
-    int nSection = Header.FileHeader.NumberOfSections;
-    ExtOut("%u sections in file\n", nSection);
-    MemLocation* memLoc = (MemLocation*)_alloca(nSection * sizeof(MemLocation));
-    int indxSec = -1;
-    int slot;
-    for (int n = 0; n < nSection; n++)
+    // NT PE Headers
+    bool succeeded = copy(image.Base, Header.OptionalHeader.SizeOfHeaders, Header.OptionalHeader.SizeOfHeaders);
+    for (size_t n = 0; succeeded && n < sections.size(); n++)
     {
-        if (g_ExtData->ReadVirtual(TO_CDADDR(sectionAddr), &section, sizeof(section), NULL) == S_OK)
+        const IMAGE_SECTION_HEADER& section = sections[n];
+        if (section.SizeOfRawData == 0)
         {
-            for (slot = 0; slot <= indxSec; slot++)
-                if (section.PointerToRawData < memLoc[slot].FileAddr)
-                    break;
+            continue;
+        }
+        if (section.PointerToRawData < fileOffset)
+        {
+            ExtOut("Overlapping section %d in %p\n", (int)n, SOS_PTR(image.Base));
+            succeeded = false;
+            break;
+        }
 
-            for (int k = indxSec; k >= slot; k--)
-                memcpy(&memLoc[k + 1], &memLoc[k], sizeof(MemLocation));
+        // Pad any gap between the sections' raw data
+        succeeded = copy(0, 0, section.PointerToRawData - fileOffset);
 
-            memLoc[slot].VAAddr = section.VirtualAddress;
-            memLoc[slot].VASize = section.Misc.VirtualSize;
-            memLoc[slot].FileAddr = section.PointerToRawData;
-            memLoc[slot].FileSize = section.SizeOfRawData;
-            ExtOut("section %d - VA=%x, VASize=%x, FileAddr=%x, FileSize=%x\n",
-                n, memLoc[slot].VAAddr, memLoc[slot].VASize, memLoc[slot].FileAddr,
-                memLoc[slot].FileSize);
-            indxSec++;
-        }
-        else
+        // A loaded image only has the section's virtual size mapped; the rest
+        // of its raw data is file alignment padding.
+        ULONG64 size = section.SizeOfRawData;
+        if (!image.IsFileLayout && section.Misc.VirtualSize != 0)
         {
-            ExtOut("Fail to read PE section info\n");
-            return E_FAIL;
+            size = std::min(size, (ULONG64)section.Misc.VirtualSize);
         }
-        sectionAddr += sizeof(section);
+        TADDR address = image.Base + (image.IsFileLayout ? section.PointerToRawData : section.VirtualAddress);
+        succeeded = succeeded && copy(address, size, section.SizeOfRawData);
+    }
+    writer.Close(fileId);
+    return succeeded ? S_OK : E_FAIL;
+}
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    This function saves a dll to a file.                              *
+*                                                                      *
+\**********************************************************************/
+HRESULT SaveModuleToFile(CLRDATA_ADDRESS moduleAddr, LPSTR file)
+{
+    SaveModuleImage image;
+    HRESULT hr = GetModuleImage(moduleAddr, &image.Base, &image.IsFileLayout);
+    if (FAILED(hr))
+    {
+        return hr;
     }
 
     char* ptr = file;
@@ -11486,68 +12134,28 @@ HRESULT SaveModuleToFile(CLRDATA_ADDRESS moduleAddr, LPSTR file)
         ptr--;
     }
 
-    HANDLE hFile = CreateFileA(file, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
-    if (hFile == INVALID_HANDLE_VALUE)
+    FileWriterPool writer(1, SAVEMODULE_QUEUE_SIZE);
+    hr = SaveModuleImageToFile(image, file, writer, true);
+    if (writer.Finish() != 0)
     {
-        ExtOut("Fail to create file %s\n", file);
-        return E_FAIL;
+        ExtOut("Fail to write file %s\n", file);
+        hr = E_FAIL;
     }
-
-    ULONG pageSize = OSPageSize();
-    char* buffer = (char*)_alloca(pageSize);
-    DWORD nRead;
-    DWORD nWrite;
-
-    // NT PE Headers
-    TADDR dwAddr = dllBase;
-    TADDR dwEnd = dllBase + Header.OptionalHeader.SizeOfHeaders;
-    while (dwAddr < dwEnd)
-    {
-        nRead = pageSize;
-        if (dwEnd - dwAddr < nRead)
-            nRead = (ULONG)(dwEnd - dwAddr);
-
-        if (g_ExtData->ReadVirtual(TO_CDADDR(dwAddr), buffer, nRead, &nRead) == S_OK)
-        {
-            WriteFile(hFile, buffer, nRead, &nWrite, NULL);
-        }
-        else
-        {
-            ExtOut("Fail to read memory\n");
-            goto end;
-        }
-        dwAddr += nRead;
-    }
-
-    for (slot = 0; slot <= indxSec; slot++)
-    {
-        dwAddr = dllBase + (bIsImage ? memLoc[slot].VAAddr : memLoc[slot].FileAddr);
-        dwEnd = memLoc[slot].FileSize + dwAddr - 1;
-
-        while (dwAddr <= dwEnd)
-        {
-            nRead = pageSize;
-            if (dwEnd - dwAddr + 1 < pageSize)
-                nRead = (ULONG)(dwEnd - dwAddr + 1);
-
-            if (g_ExtData->ReadVirtual(TO_CDADDR(dwAddr), buffer, nRead, &nRead) == S_OK)
-            {
-                WriteFile(hFile, buffer, nRead, &nWrite, NULL);
-            }
-            else
-            {
-                ExtOut("Fail to read memory\n");
-                goto end;
-            }
-            dwAddr += pageSize;
-        }
-    }
-end:
-    CloseHandle(hFile);
-    return S_OK;
+    return hr;
 }
 
-HRESULT SaveModulesFromDomain(CLRDATA_ADDRESS domain, LPSTR destinationFolder)
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Adds the modules of a domain to the images to save, skipping the  *
+*    ones with a PE timestamp and size already seen.                   *
+*                                                                      *
+\**********************************************************************/
+static HRESULT CollectModulesFromDomain(
+    CLRDATA_ADDRESS domain,
+    std::vector<SaveModuleImage>& images,
+    std::set<std::pair<DWORD, DWORD>>& imageKeys,
+    std::set<std::string>& fileNames)
 {
     HRESULT Status;
 
@@ -11558,9 +12166,6 @@ HRESULT SaveModulesFromDomain(CLRDATA_ADDRESS domain, LPSTR destinationFolder)
         return Status;
     }
 
-    ExtOut("--------------------------------------\n");
-    DMLOut("Domain %d:%s          %s\n", appDomain.dwId, (appDomain.dwId >= 10) ? "" : " ", DMLDomain(domain));
-
     if (appDomain.AssemblyCount == 0)
     {
         return Status;
@@ -11582,72 +12187,84 @@ HRESULT SaveModulesFromDomain(CLRDATA_ADDRESS domain, LPSTR destinationFolder)
     for (int i = 0; i < appDomain.AssemblyCount; i++)
     {
         DacpAssemblyData assembly;
-        if (assembly.Request(g_sos, assemblies[i], appDomain.AppDomainPtr) == S_OK)
+        if (assembly.Request(g_sos, assemblies[i], appDomain.AppDomainPtr) != S_OK)
         {
-            if (assembly.isDynamic)
+            continue;
+        }
+
+        ArrayHolder<CLRDATA_ADDRESS> modules = new CLRDATA_ADDRESS[assembly.ModuleCount];
+        if (modules == NULL
+            || g_sos->GetAssemblyModuleList(assembly.AssemblyPtr, assembly.ModuleCount, modules, NULL) != S_OK)
+        {
+            ReportOOM();
+            return Status;
+        }
+
+        for (UINT j = 0; j < assembly.ModuleCount; j++)
+        {
+            if (IsInterrupt())
             {
-                continue;
+                return E_ABORT;
             }
 
-            ArrayHolder<CLRDATA_ADDRESS> modules = new CLRDATA_ADDRESS[assembly.ModuleCount];
-            if (modules == NULL
-                || g_sos->GetAssemblyModuleList(assembly.AssemblyPtr, assembly.ModuleCount, modules, NULL) != S_OK)
+            DacpModuleData moduleData;
+            if (moduleData.Request(g_sos, modules[j]) != S_OK)
             {
-                ReportOOM();
-                return Status;
+                continue;
             }
-
-            for (UINT j = 0; j < assembly.ModuleCount; j++)
+            if (assembly.isDynamic || moduleData.bIsReflection)
             {
-                DacpModuleData module;
-                if (module.Request(g_sos, modules[j]) == S_OK)
-                {
-                    ExtOut("Module %s\n", DMLModule(module.Address));
-
-                    DacpModuleData moduleData;
-                    if (moduleData.Request(g_sos, module.Address) == S_OK)
-                    {
-                        WCHAR fullFileName[MAX_LONGPATH];
-                        FileNameForModule(&moduleData, fullFileName);
-
-                        if (fullFileName[0])
-                        {
-                            std::wstring fullFileNameStr(fullFileName);
-                            std::wstring fileName;
-
-                            size_t pos = fullFileNameStr.find_last_of(L"\\/");
-                            if (pos == std::wstring::npos)
-                            {
-                                fileName = fullFileNameStr; // No directory separator found, return the whole path
-                            }
-                            else
-                            {
-                                fileName = fullFileNameStr.substr(pos + 1);
-                            }
-
-                            WCHAR destinationFolderW[MAX_LONGPATH];
+                // Reflection.Emit modules don't have a PE image to save
+                DMLOut("Skipping dynamic module %s\n", DMLModule(moduleData.Address));
+                continue;
+            }
 
-                            // Build the full path
-                            MultiByteToWideChar(CP_ACP, 0, destinationFolder, -1, destinationFolderW, MAX_LONGPATH);
+            SaveModuleImage image;
+            if (FAILED(GetModuleImage(moduleData.Address, &image.Base, &image.IsFileLayout)))
+            {
+                continue;
+            }
+            IMAGE_DOS_HEADER DosHeader;
+            IMAGE_NT_HEADERS Header;
+            if (g_ExtData->ReadVirtual(TO_CDADDR(image.Base), &DosHeader, sizeof(DosHeader), NULL) != S_OK ||
+                g_ExtData->ReadVirtual(TO_CDADDR(image.Base + DosHeader.e_lfanew), &Header, sizeof(Header), NULL) != S_OK)
+            {
+                ExtOut("Fail to read the PE headers of module %p\n", SOS_PTR(moduleData.Address));
+                continue;
+            }
+            if (!imageKeys.insert(std::make_pair(Header.FileHeader.TimeDateStamp, Header.OptionalHeader.SizeOfImage)).second)
+            {
+                continue;
+            }
 
-                            WCHAR destinationPath[MAX_LONGPATH];
-                            swprintf_s(destinationPath, MAX_LONGPATH, W("%s\\%s"), destinationFolderW, fileName.c_str());
+            // Assemblies loaded from memory don't have a path; name them by their address
+            WCHAR fullFileName[MAX_LONGPATH];
+            FileNameForModule(&moduleData, fullFileName);
 
-                            CHAR finalPath[MAX_LONGPATH];
-                            WideCharToMultiByte(CP_ACP, 0, destinationPath, -1, finalPath, MAX_LONGPATH, NULL, NULL);
+            char fileName[MAX_LONGPATH];
+            if (fullFileName[0] == W('\0') ||
+                WideCharToMultiByte(CP_UTF8, 0, fullFileName, -1, fileName, MAX_LONGPATH, NULL, NULL) == 0)
+            {
+                sprintf_s(fileName, MAX_LONGPATH, "module_%p.dll", SOS_PTR(image.Base));
+            }
+            std::string name(fileName);
+            size_t pos = name.find_last_of("\\/");
+            if (pos != std::string::npos)
+            {
+                name = name.substr(pos + 1);
+            }
 
-                            if (SaveModuleToFile(modules[j], finalPath) == S_OK)
-                            {
-                                ExtOut("Saved module to %s\n", finalPath);
-                            }
-                        }
-                        else
-                        {
-                            ExtOut("Skipping module (%s)\n", (moduleData.bIsReflection) ? W("Dynamic Module") : W("Unknown Module"));
-                        }
-                    }
-                }
+            // Different versions of the same assembly
+            if (!fileNames.insert(name).second)
+            {
+                char suffix[32];
+                sprintf_s(suffix, ARRAY_SIZE(suffix), "_%p", SOS_PTR(image.Base));
+                size_t extension = name.rfind('.');
+                name.insert(extension != std::string::npos ? extension : name.size(), suffix);
+                fileNames.insert(name);
             }
+            image.FileName = name;
+            images.push_back(image);
         }
     }
 
@@ -11658,7 +12275,6 @@ DECLARE_API(SaveModule)
 {
     INIT_API();
     MINIDUMP_NOT_SUPPORTED();
-    ONLY_SUPPORTED_ON_WINDOWS_TARGET();
 
     StringHolder Location;
     DWORD_PTR moduleAddr = NULL;
@@ -11691,7 +12307,6 @@ DECLARE_API(SaveAllModules)
 {
     INIT_API();
     MINIDUMP_NOT_SUPPORTED();
-    ONLY_SUPPORTED_ON_WINDOWS_TARGET();
 
     StringHolder Location;
 
@@ -11734,44 +12349,65 @@ DECLARE_API(SaveAllModules)
         return Status;
     }
 
+    // Enumerate every module once before saving any of them
+    std::vector<CLRDATA_ADDRESS> domains;
     if (adsData.systemDomain != (TADDR)0)
     {
-        Status = SaveModulesFromDomain(adsData.systemDomain, Location.data);
-
-        if (Status != S_OK)
-        {
-            return Status;
-        }
+        domains.push_back(adsData.systemDomain);
     }
-
     if (adsData.sharedDomain != (TADDR)0)
     {
-        Status = SaveModulesFromDomain(adsData.sharedDomain, Location.data);
+        domains.push_back(adsData.sharedDomain);
+    }
+    domains.insert(domains.end(), (CLRDATA_ADDRESS*)pArray, (CLRDATA_ADDRESS*)pArray + adsData.DomainCount);
 
+    std::vector<SaveModuleImage> images;
+    std::set<std::pair<DWORD, DWORD>> imageKeys;
+    std::set<std::string> fileNames;
+    for (CLRDATA_ADDRESS domain : domains)
+    {
+        Status = CollectModulesFromDomain(domain, images, imageKeys, fileNames);
         if (Status != S_OK)
         {
             return Status;
         }
     }
 
-    for (int n = 0; n < adsData.DomainCount; n++)
+    // The target is read on this thread while the writer threads write the
+    // chunks already read
+    uint32_t threadCount = std::min((uint32_t)SAVEMODULE_MAX_THREADS, (uint32_t)images.size());
+    FileWriterPool writer(threadCount, SAVEMODULE_QUEUE_SIZE);
+    ULONG saved = 0;
+    for (const SaveModuleImage& image : images)
     {
         if (IsInterrupt())
+        {
+            Status = E_ABORT;
             break;
+        }
+        std::string path(Location.data);
+        if (!path.empty() && path.back() != '\\' && path.back() != '/')
+        {
+            path.append(DIRECTORY_SEPARATOR_STR_A);
+        }
+        path.append(image.FileName);
 
-        Status = SaveModulesFromDomain(pArray[n], Location.data);
-
-        if (Status != S_OK)
+        if (SaveModuleImageToFile(image, path.c_str(), writer, false) == S_OK)
         {
-            break;
+            ExtOut("Saved module %p to %s\n", SOS_PTR(image.Base), path.c_str());
+            saved++;
         }
     }
-
+    ULONG failures = writer.Finish();
+    ExtOut("Saved %d of %d modules\n", saved, (ULONG)images.size());
+    if (failures != 0)
+    {
+        ExtOut("Fail to write %d files\n", failures);
+        Status = E_FAIL;
+    }
     return Status;
 }
 
-#endif // FEATURE_PAL
-
 DECLARE_API(dbgout)
 {
     INIT_API_EXT();
@@ -11794,7 +12430,7 @@ DECLARE_API(dbgout)
 }
 
 static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp,
-        ULONG64 IPAddr, StringOutput& so)
+        ULONG64 IPAddr, StringOutput& so, MethodDescNameCache* pNameCache)
 {
 #define DOAPPEND(str)         \
     do { \
@@ -11809,6 +12445,34 @@ static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp,
         return S_FALSE;
     }
 
+    WCHAR wszAddresses[2 * sizeof(size_t) * 2 + 8];
+    if (Flags & SOS_STACKTRACE_SHOWADDRESSES)
+    {
+        _snwprintf_s(wszAddresses, ARRAY_SIZE(wszAddresses), _TRUNCATE, W("%p %p "), SOS_PTR(Esp), SOS_PTR(IPAddr));
+    }
+
+    if (pNameCache != NULL)
+    {
+        auto cached = pNameCache->find(TO_TADDR(dwStartAddr));
+        if (cached != pNameCache->end())
+        {
+            if (Flags & SOS_STACKTRACE_SHOWADDRESSES)
+            {
+                DOAPPEND(wszAddresses);
+            }
+            DOAPPEND(cached->second.Name.c_str());
+
+            ULONG64 Displacement = (IPAddr - cached->second.NativeCodeAddr);
+            if (Displacement)
+            {
+                WCHAR wszDisplacement[32];
+                _snwprintf_s(wszDisplacement, ARRAY_SIZE(wszDisplacement), _TRUNCATE, W("+%#x"), Displacement);
+                DOAPPEND(wszDisplacement);
+            }
+            return S_OK;
+        }
+    }
+
     DacpMethodDescData MethodDescData;
     if (MethodDescData.Request(g_sos, TO_CDADDR(dwStartAddr)) != S_OK)
     {
@@ -11819,9 +12483,9 @@ static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp,
 
     if (Flags & SOS_STACKTRACE_SHOWADDRESSES)
     {
-        _snwprintf_s(wszNameBuffer, MAX_LONGPATH, MAX_LONGPATH, W("%p %p "), SOS_PTR(Esp), SOS_PTR(IPAddr)); // _TRUNCATE
-        DOAPPEND(wszNameBuffer);
+        DOAPPEND(wszAddresses);
     }
+    size_t nameStart = so.Length();
 
     DacpModuleData dmd;
     BOOL bModuleNameWorked = FALSE;
@@ -11903,6 +12567,15 @@ static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp,
         }
     }
 
+    // The module name is only the same for every frame of the method when it
+    // didn't come from the frame's IP
+    if (pNameCache != NULL && addrInModule != IPAddr)
+    {
+        MethodDescFrameName& entry = (*pNameCache)[TO_TADDR(dwStartAddr)];
+        entry.Name.assign(so.String() + nameStart, so.Length() - nameStart);
+        entry.NativeCodeAddr = MethodDescData.NativeCodeAddr;
+    }
+
     ULONG64 Displacement = (IPAddr - MethodDescData.NativeCodeAddr);
     if (Displacement)
     {
@@ -12435,11 +13108,12 @@ HRESULT AppendExceptionInfo(CLRDATA_ADDRESS cdaObj,
 
             if (stackTraceSize != 0)
             {
-                size_t iLength = FormatGeneratedException (dataPtr, cbStackSize, NULL, 0, bAsync, bNestedCase);
+                MethodDescNameCache nameCache;
+                size_t iLength = FormatGeneratedException (dataPtr, cbStackSize, NULL, 0, bAsync, bNestedCase, FALSE, &nameCache);
                 WCHAR *pwszBuffer = new NOTHROW WCHAR[iLength + 1];
                 if (pwszBuffer)
                 {
-                    FormatGeneratedException(dataPtr, cbStackSize, pwszBuffer, iLength + 1, bAsync, bNestedCase);
+                    FormatGeneratedException(dataPtr, cbStackSize, pwszBuffer, iLength + 1, bAsync, bNestedCase, FALSE, &nameCache);
                     wcsncat_s(wszStackString, cchString, pwszBuffer, _TRUNCATE);
                     delete[] pwszBuffer;
                 }
@@ -31,14 +31,21 @@
 #include <stresslog.h>
 
 #ifdef FEATURE_PAL
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <dlfcn.h>
+#include "libraryindex.h"
 #include <wctype.h>
+#include <pthread.h>
+#include <unistd.h>
 #endif // !FEATURE_PAL
 
 #include <coreclrhost.h>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #if defined(__APPLE__)
 #include <mach-o/dyld.h>
@@ -62,6 +69,9 @@ IXCLRDataProcess *g_clrData = NULL;
 ISOSDacInterface *g_sos = NULL;
 ISOSDacInterface15 *g_sos15 = NULL;
 ISOSDacInterface16 *g_sos16 = NULL;
+ISOSDacInterface5 *g_sos5 = NULL;
+ISOSDacInterface7 *g_sos7 = NULL;
+ISOSDacInterface14 *g_sos14 = NULL;
 
 #undef IfFailRet
 #define IfFailRet(EXPR) do { Status = (EXPR); if(FAILED(Status)) { return (Status); } } while (0)
@@ -847,14 +857,11 @@ void DisplayThreadStatic (DacpModuleData* pModule, CLRDATA_ADDRESS cdaMT, DacpMe
         {
             CLRDATA_ADDRESS appDomainAddr = vThread.domain;
 
-            ISOSDacInterface14 *pSOS14 = nullptr;
-            HRESULT hr = g_sos->QueryInterface(__uuidof(ISOSDacInterface14), reinterpret_cast<LPVOID*>(&pSOS14));
-            if (SUCCEEDED(hr))
+            if (g_sos14 != nullptr)
             {
                 DWORD_PTR dwTmp;
                 BYTE Flags = 0;
-                HRESULT hr = GetThreadStaticFieldPTR(&dwTmp, CurThread, NULL, pSOS14, cdaMT, pMT, pFD, &Flags);
-                pSOS14->Release();
+                HRESULT hr = GetThreadStaticFieldPTR(&dwTmp, CurThread, NULL, g_sos14, cdaMT, pMT, pFD, &Flags);
                 if (SUCCEEDED(hr) && (Flags&4))
                 {
                     ExtOut(INDENT_DATA "%x:", vThread.osThreadId);
@@ -1046,14 +1053,14 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
     if (pMTD->ParentMethodTable)
     {
         DacpMethodTableData vParentMethTable;
-        if (vParentMethTable.Request(g_sos,pMTD->ParentMethodTable) != S_OK)
+        if (CachedRequest(vParentMethTable, pMTD->ParentMethodTable) != S_OK)
         {
             ExtOut("Invalid parent MethodTable\n");
             return;
         }
 
         DacpMethodTableFieldData vParentMethTableFields;
-        if (vParentMethTableFields.Request(g_sos,pMTD->ParentMethodTable) != S_OK)
+        if (CachedRequest(vParentMethTableFields, pMTD->ParentMethodTable) != S_OK)
         {
             ExtOut("Invalid parent EEClass\n");
             return;
@@ -1068,7 +1075,7 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
 
     // Get the module name
     DacpModuleData module;
-    if (module.Request(g_sos, pMTD->Module)!=S_OK)
+    if (CachedRequest(module, pMTD->Module) != S_OK)
         return;
 
     ToRelease<IMetaDataImport> pImport = MDImportForModule(&module);
@@ -1081,7 +1088,7 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
 
         ExtOutIndent ();
 
-        if ((vFieldDesc.Request(g_sos, dwAddr)!=S_OK) ||
+        if ((CachedRequest(vFieldDesc, dwAddr) != S_OK) ||
             (vFieldDesc.Type >= ELEMENT_TYPE_MAX))
         {
             ExtOut("Unable to display fields\n");
@@ -1149,7 +1156,7 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
                 if (vFieldDesc.bIsThreadLocal)
                 {
                     DacpModuleData vModule;
-                    if (vModule.Request(g_sos,pMTD->Module) == S_OK)
+                    if (CachedRequest(vModule, pMTD->Module) == S_OK)
                     {
                         DisplayThreadStatic(&vModule, cdaMT, pMTD, &vFieldDesc, fIsShared);
                     }
@@ -1179,7 +1186,7 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
                 else
                 {
                     DacpModuleData vModule;
-                    if (vModule.Request(g_sos,pMTD->Module) == S_OK)
+                    if (CachedRequest(vModule, pMTD->Module) == S_OK)
                     {
                         DisplaySharedStatic(vModule.dwModuleID, cdaMT, pMTD, &vFieldDesc);
                     }
@@ -1195,12 +1202,9 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
 
                 // If there is support for ISOSDacInterface14 there may be no DomainLocalModule, so attempt to get the statics from ISOSDacInterface14,
                 // which was added to support statics access when DomainLocalModules were removed from the product
-                    ISOSDacInterface14 *pSOS14 = nullptr;
-                    HRESULT hr = g_sos->QueryInterface(__uuidof(ISOSDacInterface14), reinterpret_cast<LPVOID*>(&pSOS14));
-                    if (SUCCEEDED(hr))
+                    if (g_sos14 != nullptr)
                     {
-                        calledGetStaticFieldPTR = SUCCEEDED(GetStaticFieldPTR(&dwTmp, NULL, pSOS14, cdaMT, pMTD, &vFieldDesc));
-                        pSOS14->Release();
+                        calledGetStaticFieldPTR = SUCCEEDED(GetStaticFieldPTR(&dwTmp, NULL, g_sos14, cdaMT, pMTD, &vFieldDesc));
                     }
                 else if (SUCCEEDED(g_sos->GetDomainLocalModuleDataFromModule(pMTD->Module, &vDomainLocalModule)))
                 {
@@ -1786,7 +1790,7 @@ BOOL NameForMD_s (DWORD_PTR pMD, __out_ecount (capacity_mdName) WCHAR *mdName, s
     // don't need to check for minidump file as all commands are seals
     // We also do not have EEJitManager to validate anyway.
     //
-    if (!IsMiniDumpFile() && MethodDescData.Request(g_sos,StartAddr) != S_OK)
+    if (!IsMiniDumpFile() && CachedRequest(MethodDescData, StartAddr) != S_OK)
     {
         ExtOut("%p is not a MethodDesc\n", SOS_PTR(StartAddr));
         return FALSE;
@@ -1800,63 +1804,208 @@ BOOL NameForMD_s (DWORD_PTR pMD, __out_ecount (capacity_mdName) WCHAR *mdName, s
     return TRUE;
 }
 
+// The cached Dacp*Data requests. The result of a failed request is cached
+// without any data.
+struct DacRequestCacheEntry
+{
+    HRESULT hr;
+    std::vector<BYTE> data;
+};
+
+static std::unordered_map<CLRDATA_ADDRESS, DacRequestCacheEntry> g_dacRequestCache[DacRequestTypeCount];
+static IRuntime* g_dacRequestCacheRuntime = nullptr;
+static ULONG g_dacRequestCacheHits[DacRequestTypeCount];
+static ULONG g_dacRequestCacheMisses[DacRequestTypeCount];
+
+bool DacRequestCacheLookup(DacRequestType type, CLRDATA_ADDRESS addr, void* data, size_t size, HRESULT* phr)
+{
+    const auto& cache = g_dacRequestCache[type];
+    auto found = cache.find(addr);
+    if (found == cache.end())
+    {
+        g_dacRequestCacheMisses[type]++;
+        return false;
+    }
+    if (found->second.data.size() == size)
+    {
+        memcpy(data, found->second.data.data(), size);
+    }
+    *phr = found->second.hr;
+    g_dacRequestCacheHits[type]++;
+    return true;
+}
+
+void DacRequestCacheAdd(DacRequestType type, CLRDATA_ADDRESS addr, const void* data, size_t size, HRESULT hr)
+{
+    DacRequestCacheEntry& entry = g_dacRequestCache[type][addr];
+    entry.hr = hr;
+    if (hr == S_OK)
+    {
+        entry.data.assign((const BYTE*)data, (const BYTE*)data + size);
+    }
+}
+
+void FlushDacRequestCache()
+{
+    for (auto& cache : g_dacRequestCache)
+    {
+        cache.clear();
+    }
+    g_dacRequestCacheRuntime = nullptr;
+}
+
+DacRequestCacheScope::DacRequestCacheScope()
+{
+    // The cache is only valid for the runtime it was filled from
+    if (g_dacRequestCacheRuntime != g_pRuntime)
+    {
+        FlushDacRequestCache();
+        g_dacRequestCacheRuntime = g_pRuntime;
+    }
+    memset(g_dacRequestCacheHits, 0, sizeof(g_dacRequestCacheHits));
+    memset(g_dacRequestCacheMisses, 0, sizeof(g_dacRequestCacheMisses));
+}
+
+DacRequestCacheScope::~DacRequestCacheScope()
+{
+    static const char* const requestNames[DacRequestTypeCount] = {
+        "Module",
+        "MethodTable",
+        "MethodTableField",
+        "MethodDesc",
+        "FieldDesc",
+    };
+    ULONG hits = 0;
+    ULONG misses = 0;
+    for (int type = 0; type < DacRequestTypeCount; type++)
+    {
+        hits += g_dacRequestCacheHits[type];
+        misses += g_dacRequestCacheMisses[type];
+    }
+    if (hits + misses == 0)
+    {
+        return;
+    }
+    ExtDbgOut("DAC request cache: %u of %u requests saved\n", hits, hits + misses);
+    for (int type = 0; type < DacRequestTypeCount; type++)
+    {
+        if (g_dacRequestCacheHits[type] + g_dacRequestCacheMisses[type] > 0)
+        {
+            ExtDbgOut("    %-16s %u of %u\n", requestNames[type], g_dacRequestCacheHits[type], g_dacRequestCacheHits[type] + g_dacRequestCacheMisses[type]);
+        }
+    }
+}
+
+// Interned MethodTable names, keyed by MT (and by element MT for the "T[]"
+// names of arrays). The names are allocated once and stay valid until the
+// cache is flushed on the next target flush, so callers can keep the pointers
+// for the duration of a command. Failed lookups are cached as NULL.
+static std::unordered_map<TADDR, WCHAR*> g_methodTableNames;
+static std::unordered_map<TADDR, WCHAR*> g_arrayMethodTableNames;
+
+void FlushMethodTableNameCache()
+{
+    for (const auto& entry : g_methodTableNames)
+    {
+        delete [] entry.second;
+    }
+    for (const auto& entry : g_arrayMethodTableNames)
+    {
+        delete [] entry.second;
+    }
+    g_methodTableNames.clear();
+    g_arrayMethodTableNames.clear();
+}
+
+static WCHAR *FetchMethodTableName(TADDR mt, bool array)
+{
+    // Most names fit in the first buffer so only one DAC request is needed
+    WCHAR buffer[mdNameLen];
+    unsigned int needed = 0;
+    HRESULT hr = g_sos->GetMethodTableName(TO_CDADDR(mt), mdNameLen, buffer, &needed);
+    if (FAILED(hr) || needed == 0)
+    {
+        return NULL;
+    }
+
+    // +2 for [], if we need it.
+    WCHAR *res = new (std::nothrow) WCHAR[needed + 2];
+    if (res == NULL)
+    {
+        return NULL;
+    }
+
+    if (needed <= mdNameLen)
+    {
+        memcpy(res, buffer, needed * sizeof(WCHAR));
+    }
+    else if (FAILED(g_sos->GetMethodTableName(TO_CDADDR(mt), needed, res, NULL)))
+    {
+        delete [] res;
+        return NULL;
+    }
+
+    if (array)
+    {
+        res[needed-1] = '[';
+        res[needed] = ']';
+        res[needed+1] = 0;
+    }
+    return res;
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    This function is called to find the name of a MethodTable using   *
-*    metadata API.                                                     *
+*    Returns the cached name of a MethodTable (or "T[]" when mt is the *
+*    array MT and cmt the component MT). The pointer is owned by the   *
+*    cache. Returns NULL if the name can't be read.                    *
 *                                                                      *
 \**********************************************************************/
-BOOL NameForMT_s(DWORD_PTR MTAddr, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName)
+const WCHAR *GetCachedMethodTableName(TADDR mt, TADDR cmt)
 {
-    HRESULT hr = g_sos->GetMethodTableName(TO_CDADDR(MTAddr), (ULONG32)capacity_mdName, mdName, NULL);
-    return SUCCEEDED(hr);
-}
-
-WCHAR *CreateMethodTableName(TADDR mt, TADDR cmt)
-{
-    bool array = false;
-    WCHAR *res = NULL;
-
     if (mt == sos::MethodTable::GetFreeMT())
     {
-        res = new WCHAR[5];
-        wcscpy_s(res, 5, W("Free"));
-        return res;
+        return W("Free");
     }
 
+    bool array = false;
     if (mt == sos::MethodTable::GetArrayMT() && cmt != (TADDR)0)
     {
         mt = cmt;
         array = true;
     }
 
-    unsigned int needed = 0;
-    HRESULT hr = g_sos->GetMethodTableName(mt, 0, NULL, &needed);
-
-    // If failed, we will return null.
-    if (SUCCEEDED(hr))
+    std::unordered_map<TADDR, WCHAR*>& names = array ? g_arrayMethodTableNames : g_methodTableNames;
+    auto found = names.find(mt);
+    if (found != names.end())
     {
-        // +2 for [], if we need it.
-        res = new WCHAR[needed+2];
-        hr = g_sos->GetMethodTableName(mt, needed, res, NULL);
-
-        if (FAILED(hr))
-        {
-            delete [] res;
-            res = NULL;
-        }
-        else if (array)
-        {
-            res[needed-1] = '[';
-            res[needed] = ']';
-            res[needed+1] = 0;
-        }
+        return found->second;
     }
 
+    WCHAR *res = FetchMethodTableName(mt, array);
+    names.emplace(mt, res);
     return res;
 }
 
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    This function is called to find the name of a MethodTable using   *
+*    metadata API.                                                     *
+*                                                                      *
+\**********************************************************************/
+BOOL NameForMT_s(DWORD_PTR MTAddr, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName)
+{
+    const WCHAR *name = GetCachedMethodTableName(TO_TADDR(MTAddr));
+    if (name == NULL)
+    {
+        return FALSE;
+    }
+    wcsncpy_s(mdName, capacity_mdName, name, _TRUNCATE);
+    return TRUE;
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
@@ -1931,7 +2080,7 @@ BOOL IsMethodDesc (DWORD_PTR value)
 {
     // Just by retrieving one successfully from the DAC, we know we have a MethodDesc.
     DacpMethodDescData MethodDescData;
-    if (MethodDescData.Request(g_sos, TO_CDADDR(value)) != S_OK)
+    if (CachedRequest(MethodDescData, TO_CDADDR(value)) != S_OK)
     {
         return FALSE;
     }
@@ -2152,6 +2301,21 @@ BOOL DebuggerModuleNamesMatch (CLRDATA_ADDRESS PEFileAddr, ___in __in_z LPSTR mN
     return FALSE;
 }
 
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Return TRUE if the module (with the file name from                *
+*    FileNameForModule) matches mName the way ModuleFromName matches   *
+*    modules.                                                          *
+*                                                                      *
+\**********************************************************************/
+BOOL ModuleNameMatches(const DacpModuleData& moduleData, LPCSTR fileName, __in_z LPSTR mName)
+{
+    return IsSameModuleName(fileName, mName) ||
+        DebuggerModuleNamesMatch(moduleData.PEAssembly, mName) ||
+        IsFusionLoadedModule(fileName, mName);
+}
+
 DWORD_PTR *ModuleFromName(__in_opt LPSTR mName, int *numModule)
 {
     if (numModule == NULL)
@@ -2301,7 +2465,7 @@ DWORD_PTR *ModuleFromName(__in_opt LPSTR mName, int *numModule)
 
                     CLRDATA_ADDRESS ModuleAddr = pModules[nModule];
                     DacpModuleData ModuleData;
-                    if (FAILED(hr = ModuleData.Request(g_sos, ModuleAddr)))
+                    if (FAILED(hr = CachedRequest(ModuleData, ModuleAddr)))
                     {
                         ExtDbgOut("Failed to request module data from assembly at %p %08x\n", ModuleAddr, hr);
                         continue;
@@ -2316,10 +2480,7 @@ DWORD_PTR *ModuleFromName(__in_opt LPSTR mName, int *numModule)
                         _ASSERTE(bytesWritten > 0);
                     }
 
-                    if ((mName == NULL) ||
-                        IsSameModuleName(fileName, mName) ||
-                        DebuggerModuleNamesMatch(ModuleData.PEAssembly, mName) ||
-                        IsFusionLoadedModule(fileName, mName))
+                    if ((mName == NULL) || ModuleNameMatches(ModuleData, fileName, mName))
                     {
                         AddToModuleList(moduleList, *numModule, maxList, (DWORD_PTR)ModuleAddr);
                     }
@@ -2650,9 +2811,8 @@ void DumpRejitData(CLRDATA_ADDRESS pMethodDesc, DacpReJitData * pReJitData)
     CLRDATA_ADDRESS ilNodeAddr = 0;
 
     struct DacpReJitData2 rejitData;
-    ReleaseHolder<ISOSDacInterface7> sos7;
-    if (SUCCEEDED(g_sos->QueryInterface(__uuidof(ISOSDacInterface7), &sos7)) &&
-        SUCCEEDED(sos7->GetReJITInformation(pMethodDesc,
+    if (g_sos7 != nullptr &&
+        SUCCEEDED(g_sos7->GetReJITInformation(pMethodDesc,
                                             rejitID,
                                             &rejitData)))
     {
@@ -2663,9 +2823,8 @@ void DumpRejitData(CLRDATA_ADDRESS pMethodDesc, DacpReJitData * pReJitData)
     struct DacpTieredVersionData codeAddrs[kcMaxTieredVersions];
     int cCodeAddrs;
 
-    ReleaseHolder<ISOSDacInterface5> sos5;
-    if (SUCCEEDED(g_sos->QueryInterface(__uuidof(ISOSDacInterface5), &sos5)) &&
-        SUCCEEDED(sos5->GetTieredVersions(pMethodDesc,
+    if (g_sos5 != nullptr &&
+        SUCCEEDED(g_sos5->GetTieredVersions(pMethodDesc,
                                             rejitID,
                                             codeAddrs,
                                             kcMaxTieredVersions,
@@ -2757,10 +2916,9 @@ void DumpMDInfoFromMethodDescData(DacpMethodDescData * pMethodDescData, DacpReJi
         ExtOut("Version History:\n");
 
         struct DacpReJitData2 rejitData;
-        ReleaseHolder<ISOSDacInterface7> sos7;
-        if (SUCCEEDED(g_sos->QueryInterface(__uuidof(ISOSDacInterface7), &sos7)))
+        if (g_sos7 != nullptr)
         {
-            if SUCCEEDED(sos7->GetReJITInformation(pMethodDescData->MethodDescPtr,
+            if SUCCEEDED(g_sos7->GetReJITInformation(pMethodDescData->MethodDescPtr,
                                                    rejitID,
                                                    &rejitData))
             {
@@ -2770,8 +2928,8 @@ void DumpMDInfoFromMethodDescData(DacpMethodDescData * pMethodDescData, DacpReJi
 
             int pendingRejitID;
             struct DacpReJitData2 pendingRejitData;
-            if (sos7->GetPendingReJITID(pMethodDescData->MethodDescPtr, &pendingRejitID) == S_OK &&
-                SUCCEEDED(sos7->GetReJITInformation(pMethodDescData->MethodDescPtr, pendingRejitID, &pendingRejitData)))
+            if (g_sos7->GetPendingReJITID(pMethodDescData->MethodDescPtr, &pendingRejitID) == S_OK &&
+                SUCCEEDED(g_sos7->GetReJITInformation(pMethodDescData->MethodDescPtr, pendingRejitID, &pendingRejitData)))
             {
                 // Special case, there is no jitted code yet but still need to output the IL information
                 ExtOut("  ILCodeVersion:      %p (pending)\n", SOS_PTR(pendingRejitData.ilCodeVersionNodePtr));
@@ -2783,9 +2941,8 @@ void DumpMDInfoFromMethodDescData(DacpMethodDescData * pMethodDescData, DacpReJi
         struct DacpTieredVersionData codeAddrs[kcMaxTieredVersions];
         int cCodeAddrs;
 
-        ReleaseHolder<ISOSDacInterface5> sos5;
-        if (SUCCEEDED(g_sos->QueryInterface(__uuidof(ISOSDacInterface5), &sos5)) &&
-            SUCCEEDED(sos5->GetTieredVersions(pMethodDescData->MethodDescPtr,
+        if (g_sos5 != nullptr &&
+            SUCCEEDED(g_sos5->GetTieredVersions(pMethodDescData->MethodDescPtr,
                                                                 rejitID,
                                                                 codeAddrs,
                                                                 kcMaxTieredVersions,
@@ -2818,13 +2975,31 @@ void DumpMDInfo(DWORD_PTR dwMethodDescAddr, CLRDATA_ADDRESS dwRequestedIP /* = 0
     DacpMethodDescData MethodDescData;
     DacpReJitData revertedRejitData[kcMaxRevertedRejitData];
     ULONG cNeededRevertedRejitData;
-    if (g_sos->GetMethodDescData(
+    HRESULT hr;
+
+    // The reverted rejit versions aren't cached so this always asks the DAC, but
+    // without an IP it fills the same DacpMethodDescData as CachedRequest: a known
+    // bad address is rejected from the cache and the result seeds it for the
+    // NameForMD_s and IsMethodDesc lookups that usually follow.
+    if (dwRequestedIP == 0 &&
+        DacRequestCacheLookup(DacRequestMethodDescData, TO_CDADDR(dwMethodDescAddr), &MethodDescData, sizeof(MethodDescData), &hr) &&
+        hr != S_OK)
+    {
+        ExtOut("%p is not a MethodDesc\n", SOS_PTR(dwMethodDescAddr));
+        return;
+    }
+    hr = g_sos->GetMethodDescData(
         TO_CDADDR(dwMethodDescAddr),
         dwRequestedIP,
         &MethodDescData,
         ARRAY_SIZE(revertedRejitData),
         revertedRejitData,
-        &cNeededRevertedRejitData) != S_OK)
+        &cNeededRevertedRejitData);
+    if (dwRequestedIP == 0)
+    {
+        DacRequestCacheAdd(DacRequestMethodDescData, TO_CDADDR(dwMethodDescAddr), &MethodDescData, sizeof(MethodDescData), hr);
+    }
+    if (hr != S_OK)
     {
         ExtOut("%p is not a MethodDesc\n", SOS_PTR(dwMethodDescAddr));
         return;
@@ -3173,45 +3348,119 @@ void Flatten(__out_ecount(len) char *data, unsigned int len)
     data[len] = 0;
 }
 
+// The number of characters CharArrayContent reads from the target at a time
+#define CHAR_ARRAY_CHUNK 4096
+
 void CharArrayContent(TADDR pos, ULONG num, bool widechar)
 {
     if (!pos || num <= 0)
         return;
 
-    if (widechar)
+    while (num > 0)
     {
-        ArrayHolder<WCHAR> data = new WCHAR[num+1];
-        if (!data)
+        ULONG count = num < CHAR_ARRAY_CHUNK ? num : CHAR_ARRAY_CHUNK;
+        ULONG readLen = 0;
+
+        if (widechar)
         {
-            ReportOOM();
-            return;
+            WCHAR data[CHAR_ARRAY_CHUNK + 1];
+            if (!SafeReadMemory(pos, data, count << 1, &readLen))
+                return;
+
+            Flatten(data, readLen >> 1);
+            ExtOut("%S", data);
+            pos += count << 1;
         }
+        else
+        {
+            char data[CHAR_ARRAY_CHUNK + 1];
+            if (!SafeReadMemory(pos, data, count, &readLen))
+                return;
 
-        ULONG readLen = 0;
-        if (!SafeReadMemory(pos, data, num<<1, &readLen))
-            return;
+            _ASSERTE(readLen <= count);
+            Flatten(data, readLen);
+            ExtOut("%s", data);
+            pos += count;
+        }
 
-        Flatten(data.GetPtr(), readLen >> 1);
-        ExtOut("%S", data.GetPtr());
+        num -= count;
     }
-    else
+}
+
+// Returns the number of characters from the start of chars that are printable
+// ASCII (0x20 - 0x7e), checking four characters at a time.
+static ULONG32 PrintableAsciiLength(const WCHAR *chars, ULONG32 count)
+{
+    ULONG32 i = 0;
+    for (; i + 4 <= count; i += 4)
     {
-        ArrayHolder<char> data = new char[num+1];
-        if (!data)
+        uint64_t v;
+        memcpy(&v, chars + i, sizeof(v));
+
+        // All lanes below 0x80, then bit 7 of (c + 0x60) is set for c >= 0x20 and
+        // bit 7 of (c + 1) is set only for c == 0x7f. Neither sum carries out of a lane.
+        if ((v & 0xff80ff80ff80ff80ull) != 0 ||
+            ((v + 0x0060006000600060ull) & 0x0080008000800080ull) != 0x0080008000800080ull ||
+            ((v + 0x0001000100010001ull) & 0x0080008000800080ull) != 0)
         {
-            ReportOOM();
-            return;
+            break;
         }
+    }
+    for (; i < count; i++)
+    {
+        if (chars[i] < 0x20 || chars[i] > 0x7e)
+            break;
+    }
+    return i;
+}
 
-        ULONG readLen = 0;
-        if (!SafeReadMemory(pos, data, num, &readLen))
-            return;
-
-        _ASSERTE(readLen <= num);
-        Flatten(data, readLen);
+// Writes the literal form of a character that isn't printable ASCII into out
+// and returns the number of characters written (at most 2).
+static ULONG EscapeLiteralChar(WCHAR ch, __out_ecount(2) WCHAR *out)
+{
+    if (iswprint(ch))
+    {
+        out[0] = ch;
+        return 1;
+    }
 
-        ExtOut("%s", data.GetPtr());
+    ULONG k = 0;
+    out[k++] = L'\\';
+    switch (ch) {
+    case L'\n':
+        out[k++] = L'n';
+        break;
+    case L'\0':
+        out[k++] = L'0';
+        break;
+    case L'\t':
+        out[k++] = L't';
+        break;
+    case L'\v':
+        out[k++] = L'v';
+        break;
+    case L'\b':
+        out[k++] = L'b';
+        break;
+    case L'\r':
+        out[k++] = L'r';
+        break;
+    case L'\f':
+        out[k++] = L'f';
+        break;
+    case L'\a':
+        out[k++] = L'a';
+        break;
+    case L'\\':
+        break;
+    case L'\?':
+        out[k++] = L'?';
+        break;
+    default:
+        out[k++] = L'?';
+        break;
     }
+    return k;
 }
 
 void StringObjectContent(size_t obj, BOOL fLiteral, const int length)
@@ -3242,7 +3491,6 @@ void StringObjectContent(size_t obj, BOOL fLiteral, const int length)
         return;
     }
 
-    DWORD_PTR dwAddr = (DWORD_PTR)pwszBuf.GetPtr();
     if (g_sos->GetObjectStringData(TO_CDADDR(obj), stInfo.m_StringLength+1, pwszBuf, NULL)!=S_OK)
     {
         ExtOut("<Invalid Object>");
@@ -3256,75 +3504,164 @@ void StringObjectContent(size_t obj, BOOL fLiteral, const int length)
     }
     else
     {
+        // Copy runs of printable ASCII as is and escape the rest
+        const WCHAR *chars = pwszBuf.GetPtr();
         ULONG32 count = stInfo.m_StringLength;
-        WCHAR buffer[256];
+        ULONG32 i = 0;
         WCHAR out[512];
-        while (count)
+        while (i < count)
         {
-            DWORD toRead = 255;
-            if (count < toRead)
-                toRead = count;
-
-            ULONG bytesRead;
-            wcsncpy_s(buffer,ARRAY_SIZE(buffer),(LPWSTR) dwAddr, toRead);
-            bytesRead = toRead*sizeof(WCHAR);
-            DWORD wcharsRead = bytesRead/2;
-            buffer[wcharsRead] = L'\0';
-
-            ULONG j,k=0;
-            for (j = 0; j < wcharsRead; j ++)
+            ULONG k = 0;
+            while (i < count && k < ARRAY_SIZE(out) - 3)
             {
-                if (iswprint (buffer[j])) {
-                    out[k] = buffer[j];
-                    k ++;
-                }
-                else
+                ULONG32 space = (ULONG32)(ARRAY_SIZE(out) - 3 - k);
+                ULONG32 run = PrintableAsciiLength(chars + i, _min(count - i, space));
+                memcpy(out + k, chars + i, run * sizeof(WCHAR));
+                k += run;
+                i += run;
+
+                if (i < count && k < ARRAY_SIZE(out) - 3)
                 {
-                    out[k++] = L'\\';
-                    switch (buffer[j]) {
-                    case L'\n':
-                        out[k++] = L'n';
-                        break;
-                    case L'\0':
-                        out[k++] = L'0';
-                        break;
-                    case L'\t':
-                        out[k++] = L't';
-                        break;
-                    case L'\v':
-                        out[k++] = L'v';
-                        break;
-                    case L'\b':
-                        out[k++] = L'b';
-                        break;
-                    case L'\r':
-                        out[k++] = L'r';
-                        break;
-                    case L'\f':
-                        out[k++] = L'f';
-                        break;
-                    case L'\a':
-                        out[k++] = L'a';
-                        break;
-                    case L'\\':
-                        break;
-                    case L'\?':
-                        out[k++] = L'?';
-                        break;
-                    default:
-                        out[k++] = L'?';
-                        break;
-                    }
+                    k += EscapeLiteralChar(chars[i++], out + k);
                 }
             }
 
             out[k] = L'\0';
             ExtOut ("%S", out);
+        }
+    }
+}
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Streams the contents of a string, char[] or byte[] object to a    *
+*    local file without loading it all in memory. UTF-16 contents are  *
+*    written as is, or converted to UTF-8 if utf8 is true.             *
+*                                                                      *
+\**********************************************************************/
+HRESULT ExportObjectContent(TADDR obj, LPCSTR filePath, bool utf8, ULONG64 *pBytesWritten)
+{
+    const ULONG chunkSize = 0x10000;
+
+    *pBytesWritten = 0;
+
+    DacpObjectData objData;
+    if (objData.Request(g_sos, TO_CDADDR(obj)) != S_OK)
+    {
+        ExtOut("Invalid object\n");
+        return E_INVALIDARG;
+    }
+
+    TADDR pos;
+    ULONG64 size;
+    bool wide;
+    if (objData.ObjectType == OBJ_STRING)
+    {
+        strobjInfo stInfo { 0, 0 };
+        if (MOVE(stInfo, obj) != S_OK)
+        {
+            ExtOut("Error getting string data\n");
+            return E_FAIL;
+        }
+        pos = obj + sizeof(TADDR) + sizeof(DWORD);
+        size = (ULONG64)stInfo.m_StringLength * sizeof(WCHAR);
+        wide = true;
+    }
+    else if (objData.ObjectType == OBJ_ARRAY &&
+             (objData.ElementType == ELEMENT_TYPE_CHAR ||
+              objData.ElementType == ELEMENT_TYPE_I1 ||
+              objData.ElementType == ELEMENT_TYPE_U1 ||
+              objData.ElementType == ELEMENT_TYPE_BOOLEAN))
+    {
+        wide = objData.ElementType == ELEMENT_TYPE_CHAR;
+        pos = TO_TADDR(objData.ArrayDataPtr);
+        size = objData.dwNumComponents * (wide ? sizeof(WCHAR) : 1);
+    }
+    else
+    {
+        ExtOut("Only String, char[] and byte[] objects can be written to a file\n");
+        return E_INVALIDARG;
+    }
+
+    FILE *file = NULL;
+    if (fopen_s(&file, filePath, "wb") != 0 || file == NULL)
+    {
+        ExtOut("Failed to open file %s\n", filePath);
+        return E_FAIL;
+    }
+
+    ArrayHolder<BYTE> buffer = new NOTHROW BYTE[chunkSize + sizeof(WCHAR)];
+    ArrayHolder<char> converted = (utf8 && wide) ? new NOTHROW char[chunkSize / sizeof(WCHAR) * 3 + 8] : NULL;
+    if (buffer == NULL || (utf8 && wide && converted == NULL))
+    {
+        fclose(file);
+        ReportOOM();
+        return E_OUTOFMEMORY;
+    }
+
+    HRESULT hr = S_OK;
+    ULONG carry = 0;            // a high surrogate held back from the previous chunk
+    while (size > 0)
+    {
+        if (IsInterrupt())
+        {
+            hr = E_ABORT;
+            break;
+        }
+
+        ULONG toRead = (ULONG)(size < chunkSize ? size : chunkSize);
+        ULONG read = 0;
+        if (FAILED(g_ExtData->ReadVirtual(pos, buffer + carry, toRead, &read)) || read != toRead)
+        {
+            ExtOut("Failed to read memory at %p\n", SOS_PTR(pos));
+            hr = E_FAIL;
+            break;
+        }
+        pos += toRead;
+        size -= toRead;
+
+        const void *data = buffer;
+        size_t dataSize = toRead;
+        if (utf8 && wide)
+        {
+            WCHAR *chars = (WCHAR *)buffer.GetPtr();
+            int count = (int)((carry + toRead) / sizeof(WCHAR));
+
+            // Don't split a surrogate pair across two conversions
+            carry = 0;
+            if (size > 0 && count > 0 && chars[count - 1] >= 0xD800 && chars[count - 1] <= 0xDBFF)
+            {
+                count--;
+                carry = sizeof(WCHAR);
+            }
+
+            int length = count > 0 ? WideCharToMultiByte(CP_UTF8, 0, chars, count, converted, chunkSize / sizeof(WCHAR) * 3 + 8, NULL, NULL) : 0;
+            if (count > 0 && length <= 0)
+            {
+                ExtOut("Failed to convert the string to UTF-8\n");
+                hr = E_FAIL;
+                break;
+            }
+            if (carry != 0)
+            {
+                chars[0] = chars[count];
+            }
+            data = converted;
+            dataSize = length;
+        }
 
-            count -= wcharsRead;
-            dwAddr += bytesRead;
+        if (dataSize > 0 && fwrite(data, 1, dataSize, file) != dataSize)
+        {
+            ExtOut("Failed to write to %s\n", filePath);
+            hr = E_FAIL;
+            break;
         }
+        *pBytesWritten += dataSize;
     }
+
+    fclose(file);
+    return hr;
 }
 
 #ifdef _TARGET_WIN64_
@@ -3842,6 +4179,19 @@ HRESULT LoadClrDebugDll(void)
     }
     // Always have an instance of the MethodTable enumerator
     hr = g_clrData->QueryInterface(__uuidof(ISOSDacInterface16), (void**)&g_sos16);
+    // Optional interfaces used for every field, static or MethodDesc
+    if (FAILED(g_sos->QueryInterface(__uuidof(ISOSDacInterface5), (void**)&g_sos5)))
+    {
+        g_sos5 = NULL;
+    }
+    if (FAILED(g_sos->QueryInterface(__uuidof(ISOSDacInterface7), (void**)&g_sos7)))
+    {
+        g_sos7 = NULL;
+    }
+    if (FAILED(g_sos->QueryInterface(__uuidof(ISOSDacInterface14), (void**)&g_sos14)))
+    {
+        g_sos14 = NULL;
+    }
     return S_OK;
 }
 
@@ -4860,22 +5210,357 @@ GetLineByOffset(
     return symbolReader.GetLineByILOffset(methodToken, methodOffs, pLinenum, pwszFileName, cchFileName);
 }
 
-void TableOutput::ReInit(int numColumns, int defaultColumnWidth, Alignment alignmentDefault, int indent, int padding)
+// Streams the IL address maps of jitted methods, with source lines, to a file. Used by
+// ExportILMap. The binary format is little-endian:
+//
+//   header:  "SOSILMAP" uint32 version
+//   module:  uint8 1, uint64 base, uint32 path length, UTF-8 path
+//   file:    uint8 2, uint32 path length, UTF-8 path (file indexes are assigned in order, from 0)
+//   method:  uint8 3, uint32 token, uint64 code start, uint32 count, then count entries of
+//            uint64 start, uint32 size, int32 IL offset, uint32 line, int32 file index (-1 if none)
+//
+// The CSV format has a "# <base> <path>" line before each module's rows and a "file,path"
+// table after all of them. Paths are quoted.
+class ILMapWriter
 {
-    Clear();
+    FILE* m_file;
+    bool m_csv;
+    std::unordered_map<std::string, int> m_fileIndexes;
+    std::vector<CLRDATA_IL_ADDRESS_MAP> m_map;
+    ULONG64 m_moduleBase;
 
-    mColumns = numColumns;
-    mDefaultWidth = defaultColumnWidth;
-    mIndent = indent;
-    mPadding = padding;
-    mCurrCol = 0;
-    mDefaultAlign = alignmentDefault;
-}
+    template <class T> void Write(const T& value)
+    {
+        fwrite(&value, sizeof(T), 1, m_file);
+    }
 
-void TableOutput::SetWidths(int columns, ...)
-{
-    SOS_Assert(columns > 0);
-    SOS_Assert(columns <= mColumns);
+    void WriteString(const std::string& value)
+    {
+        Write<uint32_t>((uint32_t)value.size());
+        fwrite(value.data(), 1, value.size(), m_file);
+    }
+
+    // Quotes a path for the CSV output, doubling any quotes in it
+    static std::string CsvQuote(const std::string& value)
+    {
+        std::string result("\"");
+        for (char c : value)
+        {
+            if (c == '"')
+            {
+                result += '"';
+            }
+            result += c;
+        }
+        result += '"';
+        return result;
+    }
+
+    static std::string ToUtf8(const WCHAR* value)
+    {
+        std::string result;
+        int length = WideCharToMultiByte(CP_UTF8, 0, value, -1, NULL, 0, NULL, NULL);
+        if (length > 1)
+        {
+            result.resize(length);
+            WideCharToMultiByte(CP_UTF8, 0, value, -1, &result[0], length, NULL, NULL);
+            result.resize(length - 1);
+        }
+        return result;
+    }
+
+    int GetFileIndex(const WCHAR* fileName)
+    {
+        std::string name = ToUtf8(fileName);
+        auto found = m_fileIndexes.find(name);
+        if (found != m_fileIndexes.end())
+        {
+            return found->second;
+        }
+        int index = (int)m_fileIndexes.size();
+        m_fileIndexes.emplace(name, index);
+        if (!m_csv)
+        {
+            Write<uint8_t>(2);
+            WriteString(name);
+        }
+        return index;
+    }
+
+    HRESULT WriteMethodInstance(IXCLRDataMethodInstance* pMethodInst, mdMethodDef token, SymbolReader* pSymbolReader)
+    {
+        CLRDATA_ADDRESS codeStart = 0;
+        if (pMethodInst->GetRepresentativeEntryAddress(&codeStart) != S_OK)
+        {
+            return S_FALSE;
+        }
+
+        // The map buffer is reused across methods and only grows
+        ULONG32 mapCount = 0;
+        HRESULT hr = pMethodInst->GetILAddressMap((ULONG32)m_map.size(), &mapCount, m_map.data());
+        if (hr == S_OK && mapCount > m_map.size())
+        {
+            m_map.resize(mapCount);
+            hr = pMethodInst->GetILAddressMap(mapCount, &mapCount, m_map.data());
+        }
+        if (hr != S_OK || mapCount == 0)
+        {
+            return S_FALSE;
+        }
+
+        if (!m_csv)
+        {
+            Write<uint8_t>(3);
+            Write<uint32_t>(token);
+            Write<uint64_t>(codeStart);
+            Write<uint32_t>(mapCount);
+        }
+
+        WCHAR fileName[MAX_LONGPATH];
+        for (ULONG32 i = 0; i < mapCount; i++)
+        {
+            const CLRDATA_IL_ADDRESS_MAP& entry = m_map[i];
+            LONG ilOffset = (LONG)entry.ilOffset;
+            ULONG line = 0;
+            int fileIndex = -1;
+            if (pSymbolReader != nullptr && ilOffset >= 0 &&
+                SUCCEEDED(pSymbolReader->GetLineByILOffset(token, ilOffset, &line, fileName, ARRAY_SIZE(fileName))))
+            {
+                fileIndex = GetFileIndex(fileName);
+            }
+            else
+            {
+                line = 0;
+            }
+            ULONG64 size = entry.endAddress > entry.startAddress ? entry.endAddress - entry.startAddress : 0;
+
+            if (m_csv)
+            {
+                char row[160];
+                sprintf_s(row, ARRAY_SIZE(row), "%I64x,%08x,%I64x,%I64x,%x,%d,%u,%d\n",
+                    m_moduleBase, token, (ULONG64)codeStart, (ULONG64)entry.startAddress, (ULONG)size, ilOffset, line, fileIndex);
+                fputs(row, m_file);
+            }
+            else
+            {
+                Write<uint64_t>(entry.startAddress);
+                Write<uint32_t>((uint32_t)size);
+                Write<int32_t>(ilOffset);
+                Write<uint32_t>(line);
+                Write<int32_t>(fileIndex);
+            }
+        }
+        return S_OK;
+    }
+
+public:
+    ILMapWriter(FILE* file, bool csv) : m_file(file), m_csv(csv), m_moduleBase(0)
+    {
+        if (m_csv)
+        {
+            fputs("module,token,code,start,size,il,line,file\n", m_file);
+        }
+        else
+        {
+            fwrite("SOSILMAP", 1, 8, m_file);
+            Write<uint32_t>(1);
+        }
+    }
+
+    // The binary format emits file records inline; CSV lists the file names after the rows.
+    void WriteFileTable()
+    {
+        if (!m_csv)
+        {
+            return;
+        }
+        std::vector<const std::string*> names(m_fileIndexes.size());
+        for (const auto& entry : m_fileIndexes)
+        {
+            names[entry.second] = &entry.first;
+        }
+        fputs("\nfile,path\n", m_file);
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            fprintf(m_file, "%d,%s\n", (int)i, CsvQuote(*names[i]).c_str());
+        }
+    }
+
+    HRESULT WriteModule(TADDR moduleAddr, ULONG* pMethodCount)
+    {
+        ToRelease<IXCLRDataModule> module;
+        HRESULT hr = g_sos->GetModule(TO_CDADDR(moduleAddr), &module);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        ToRelease<IMetaDataImport> pMDImport;
+        if (FAILED(hr = module->QueryInterface(IID_IMetaDataImport, (LPVOID *)&pMDImport)))
+        {
+            return hr;
+        }
+
+        ULONG64 moduleSize = 0;
+        m_moduleBase = 0;
+        GetClrModuleImages(module, CLRDATA_MODULE_PE_FILE, &m_moduleBase, &moduleSize);
+
+        WCHAR moduleName[MAX_LONGPATH];
+        ULONG32 nameLength = 0;
+        if (module->GetFileName(ARRAY_SIZE(moduleName), &nameLength, moduleName) != S_OK)
+        {
+            moduleName[0] = W('\0');
+        }
+        if (m_csv)
+        {
+            char row[32];
+            sprintf_s(row, ARRAY_SIZE(row), "# %I64x ", m_moduleBase);
+            fputs(row, m_file);
+            fputs(CsvQuote(ToUtf8(moduleName)).c_str(), m_file);
+            fputc('\n', m_file);
+        }
+        else
+        {
+            Write<uint8_t>(1);
+            Write<uint64_t>(m_moduleBase);
+            WriteString(ToUtf8(moduleName));
+        }
+
+        // Load the symbols once for all the methods in the module
+        SymbolReader symbolReader;
+        SymbolReader* pSymbolReader = nullptr;
+        ULONG32 flags = 0;
+        if (module->GetFlags(&flags) == S_OK && (flags & CLRDATA_MODULE_IS_DYNAMIC) == 0 &&
+            SUCCEEDED(symbolReader.LoadSymbols(pMDImport, module)))
+        {
+            pSymbolReader = &symbolReader;
+        }
+
+        // <Module> holds the global methods and is not returned by EnumTypeDefs
+        std::vector<mdTypeDef> typeDefs;
+        typeDefs.push_back(TokenFromRid(1, mdtTypeDef));
+        HCORENUM typeEnum = NULL;
+        mdTypeDef typeBuffer[64];
+        ULONG count = 0;
+        while (SUCCEEDED(pMDImport->EnumTypeDefs(&typeEnum, typeBuffer, ARRAY_SIZE(typeBuffer), &count)) && count > 0)
+        {
+            typeDefs.insert(typeDefs.end(), typeBuffer, typeBuffer + count);
+        }
+        pMDImport->CloseEnum(typeEnum);
+
+        for (mdTypeDef typeDef : typeDefs)
+        {
+            if (IsInterrupt())
+            {
+                return E_ABORT;
+            }
+            HCORENUM methodEnum = NULL;
+            mdMethodDef methodBuffer[64];
+            while (SUCCEEDED(pMDImport->EnumMethods(&methodEnum, typeDef, methodBuffer, ARRAY_SIZE(methodBuffer), &count)) && count > 0)
+            {
+                for (ULONG i = 0; i < count; i++)
+                {
+                    ToRelease<IXCLRDataMethodDefinition> pMethodDef;
+                    if (module->GetMethodDefinitionByToken(methodBuffer[i], &pMethodDef) != S_OK)
+                    {
+                        continue;
+                    }
+                    CLRDATA_ENUM h;
+                    if (pMethodDef->StartEnumInstances(NULL, &h) != S_OK)
+                    {
+                        continue;
+                    }
+                    IXCLRDataMethodInstance* pMethodInst = NULL;
+                    while (pMethodDef->EnumInstance(&h, &pMethodInst) == S_OK)
+                    {
+                        if (WriteMethodInstance(pMethodInst, methodBuffer[i], pSymbolReader) == S_OK)
+                        {
+                            (*pMethodCount)++;
+                        }
+                        pMethodInst->Release();
+                    }
+                    pMethodDef->EndEnumInstances(h);
+                }
+            }
+            pMDImport->CloseEnum(methodEnum);
+        }
+        return S_OK;
+    }
+};
+
+HRESULT ExportILMap(TADDR moduleAddr, LPCSTR filePath, bool csv, ULONG* pMethodCount)
+{
+    *pMethodCount = 0;
+
+    int numModule = 0;
+    ArrayHolder<DWORD_PTR> moduleList(nullptr);
+    if (moduleAddr == (TADDR)0)
+    {
+        moduleList = ModuleFromName(NULL, &numModule);
+        if (moduleList == NULL)
+        {
+            ExtOut("Failed to request module list.\n");
+            return E_FAIL;
+        }
+    }
+
+    FILE *file = NULL;
+    if (fopen_s(&file, filePath, csv ? "w" : "wb") != 0 || file == NULL)
+    {
+        ExtOut("Failed to open file %s\n", filePath);
+        return E_FAIL;
+    }
+
+    HRESULT hr = S_OK;
+    {
+        ILMapWriter writer(file, csv);
+        if (moduleAddr != (TADDR)0)
+        {
+            hr = writer.WriteModule(moduleAddr, pMethodCount);
+            if (FAILED(hr))
+            {
+                ExtOut("%p is not a Module\n", SOS_PTR(moduleAddr));
+            }
+        }
+        else
+        {
+            for (int i = 0; i < numModule && hr != E_ABORT; i++)
+            {
+                hr = writer.WriteModule(moduleList[i], pMethodCount);
+                if (FAILED(hr) && hr != E_ABORT)
+                {
+                    ExtDbgOut("ExportILMap: module %p FAILED %08x\n", SOS_PTR(moduleList[i]), hr);
+                    hr = S_OK;
+                }
+            }
+        }
+        writer.WriteFileTable();
+    }
+
+    if (ferror(file))
+    {
+        ExtOut("Failed to write file %s\n", filePath);
+        hr = E_FAIL;
+    }
+    fclose(file);
+    return hr;
+}
+
+void TableOutput::ReInit(int numColumns, int defaultColumnWidth, Alignment alignmentDefault, int indent, int padding)
+{
+    Clear();
+
+    mColumns = numColumns;
+    mDefaultWidth = defaultColumnWidth;
+    mIndent = indent;
+    mPadding = padding;
+    mCurrCol = 0;
+    mDefaultAlign = alignmentDefault;
+}
+
+void TableOutput::SetWidths(int columns, ...)
+{
+    SOS_Assert(columns > 0);
+    SOS_Assert(columns <= mColumns);
 
     AllocWidths();
 
@@ -5460,6 +6145,115 @@ HRESULT InternalFrameManager::PrintCurrentInternalFrame(size_t &nPrintedFrames)
 
 #ifdef FEATURE_PAL
 
+// The metadata of a region is either loaded lazily by the first DAC read (MetadataNotPrefetched)
+// or, if its assembly file was found locally, queued for the prefetch worker threads after
+// PopulateMetadataRegions (MetadataPending). Whoever moves a pending region to MetadataLoading
+// (a worker or a DAC read) maps the file; any other reader of that region waits until it is
+// MetadataLoaded. A region the workers couldn't map falls back to the lazy load.
+enum MetadataState : LONG
+{
+    MetadataNotPrefetched = 0,
+    MetadataPending = 1,
+    MetadataLoading = 2,
+    MetadataLoaded = 3,
+};
+
+static pthread_mutex_t g_metadataLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_metadataLoaded = PTHREAD_COND_INITIALIZER;
+
+// Returns the file offset of an RVA in a PE file or 0 if no section contains it
+static ULONG32 MetadataRvaToOffset(const IMAGE_SECTION_HEADER* sections, int count, ULONG32 rva)
+{
+    for (int i = 0; i < count; i++)
+    {
+        ULONG32 size = _max(sections[i].Misc.VirtualSize, sections[i].SizeOfRawData);
+        if (rva >= sections[i].VirtualAddress && rva - sections[i].VirtualAddress < size)
+        {
+            return rva - sections[i].VirtualAddress + sections[i].PointerToRawData;
+        }
+    }
+    return 0;
+}
+
+/**********************************************************************\
+ * Maps the assembly file read only and returns a pointer to its metadata
+ * in the mapping. Fails if the file isn't the image with the timestamp
+ * and size or its metadata is smaller than metadataSize.
+\**********************************************************************/
+static HRESULT MapAssemblyMetadata(LPCSTR filePath, ULONG32 timeStamp, ULONG32 imageSize, uint64_t metadataSize, void** pMapping, size_t* pMappingSize, BYTE** pMetadata)
+{
+    int fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return E_FAIL;
+    }
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return E_FAIL;
+    }
+    const BYTE* data = (const BYTE*)mapping;
+    size_t size = st.st_size;
+
+    // The header fields up to DataDirectory are at the same offsets in
+    // PE32 and PE32+ except for the data directories themselves.
+    const IMAGE_DOS_HEADER* dosHeader = (const IMAGE_DOS_HEADER*)data;
+    const IMAGE_NT_HEADERS32* ntHeader32 = nullptr;
+    if (size >= sizeof(IMAGE_DOS_HEADER) && dosHeader->e_magic == IMAGE_DOS_SIGNATURE &&
+        dosHeader->e_lfanew > 0 && (size_t)dosHeader->e_lfanew + sizeof(IMAGE_NT_HEADERS64) <= size)
+    {
+        ntHeader32 = (const IMAGE_NT_HEADERS32*)(data + dosHeader->e_lfanew);
+    }
+    const IMAGE_DATA_DIRECTORY* comDirectory = nullptr;
+    if (ntHeader32 != nullptr && ntHeader32->Signature == IMAGE_NT_SIGNATURE &&
+        ntHeader32->FileHeader.TimeDateStamp == timeStamp && ntHeader32->OptionalHeader.SizeOfImage == imageSize)
+    {
+        if (ntHeader32->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC)
+        {
+            comDirectory = &ntHeader32->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_COMHEADER];
+        }
+        else if (ntHeader32->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+        {
+            comDirectory = &((const IMAGE_NT_HEADERS64*)ntHeader32)->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_COMHEADER];
+        }
+    }
+    BYTE* metadata = nullptr;
+    if (comDirectory != nullptr)
+    {
+        size_t sectionsOffset = dosHeader->e_lfanew + offsetof(IMAGE_NT_HEADERS32, OptionalHeader) + ntHeader32->FileHeader.SizeOfOptionalHeader;
+        int sectionCount = ntHeader32->FileHeader.NumberOfSections;
+        if (sectionsOffset + sectionCount * sizeof(IMAGE_SECTION_HEADER) <= size)
+        {
+            const IMAGE_SECTION_HEADER* sections = (const IMAGE_SECTION_HEADER*)(data + sectionsOffset);
+            ULONG32 corOffset = MetadataRvaToOffset(sections, sectionCount, comDirectory->VirtualAddress);
+            if (corOffset != 0 && (size_t)corOffset + sizeof(IMAGE_COR20_HEADER) <= size)
+            {
+                const IMAGE_COR20_HEADER* corHeader = (const IMAGE_COR20_HEADER*)(data + corOffset);
+                ULONG32 metadataOffset = MetadataRvaToOffset(sections, sectionCount, corHeader->MetaData.VirtualAddress);
+                if (metadataOffset != 0 && corHeader->MetaData.Size >= metadataSize && (size_t)metadataOffset + metadataSize <= size)
+                {
+                    metadata = (BYTE*)data + metadataOffset;
+                }
+            }
+        }
+    }
+    if (metadata == nullptr)
+    {
+        munmap(mapping, size);
+        return E_FAIL;
+    }
+    *pMapping = mapping;
+    *pMappingSize = size;
+    *pMetadata = metadata;
+    return S_OK;
+}
+
 struct MemoryRegion
 {
 private:
@@ -5467,57 +6261,163 @@ private:
     uint64_t m_endAddress;
     CLRDATA_ADDRESS m_peFile;
     BYTE* m_metadataMemory;
+    void* m_mapping;                // the mapped assembly m_metadataMemory points into or nullptr if copied
+    size_t m_mappingSize;
     volatile LONG m_busy;
+    volatile LONG m_state;
+    WCHAR* m_imagePath;
+    ULONG32 m_imageSize;
+    ULONG32 m_timeStamp;
+    std::string m_prefetchPath;     // the local assembly file QueuePrefetch found for the workers
+
+    // Gets the image path, size and timestamp from the target. Uses the DAC so it
+    // must be called on the debugger thread.
+    HRESULT ResolveImage()
+    {
+        if (m_imagePath != nullptr)
+        {
+            return S_OK;
+        }
+        HRESULT hr;
+        CLRDATA_ADDRESS baseAddress;
+        if (FAILED(hr = g_sos->GetPEFileBase(m_peFile, &baseAddress))) {
+            return hr;
+        }
+        ArrayHolder<WCHAR> imagePath = new WCHAR[MAX_LONGPATH];
+        if (FAILED(hr = g_sos->GetPEFileName(m_peFile, MAX_LONGPATH, imagePath.GetPtr(), NULL))) {
+            return hr;
+        }
+        IMAGE_DOS_HEADER DosHeader;
+        if (FAILED(hr = g_ExtData->ReadVirtual(baseAddress, &DosHeader, sizeof(DosHeader), NULL))) {
+            return hr;
+        }
+        IMAGE_NT_HEADERS Header;
+        if (FAILED(hr = g_ExtData->ReadVirtual(baseAddress + DosHeader.e_lfanew, &Header, sizeof(Header), NULL))) {
+            return hr;
+        }
+        // If there is no COMHeader, this can not be managed code.
+        if (Header.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_COMHEADER].VirtualAddress == 0) {
+            return E_ACCESSDENIED;
+        }
+        m_imageSize = Header.OptionalHeader.SizeOfImage;
+        m_timeStamp = Header.FileHeader.TimeDateStamp;
+        m_imagePath = imagePath.Detach();
+        return S_OK;
+    }
+
+    // Maps the local or downloaded assembly so the metadata reads come straight
+    // from the file instead of a private copy. Returns CORDBG_E_MISSING_METADATA
+    // if the symbol service couldn't find or download the assembly.
+    HRESULT MapMetadata()
+    {
+        // The assembly found by an earlier session skips the symbol service
+        ULONG32 indexId[] = { m_timeStamp, m_imageSize };
+        std::string indexedPath;
+        if (LibraryIndexLookup("assembly", (const uint8_t*)indexId, sizeof(indexId), indexedPath) &&
+            SUCCEEDED(MapAssemblyMetadata(indexedPath.c_str(), m_timeStamp, m_imageSize, Size(), &m_mapping, &m_mappingSize, &m_metadataMemory))) {
+            return S_OK;
+        }
+        ArrayHolder<WCHAR> filePath = new NOTHROW WCHAR[MAX_LONGPATH];
+        ArrayHolder<char> filePathA = new NOTHROW char[MAX_LONGPATH];
+        if (filePath == nullptr || filePathA == nullptr) {
+            return E_OUTOFMEMORY;
+        }
+        HRESULT hr;
+        ULONG32 pathSize = 0;
+        if (FAILED(hr = GetICorDebugMetadataLocator(m_imagePath, m_timeStamp, m_imageSize, MAX_LONGPATH, &pathSize, filePath))) {
+            // The path doesn't fit but the assembly was found
+            if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)) {
+                return hr;
+            }
+            ExtDbgOut("MapMetadata: GetICorDebugMetadataLocator FAILED %08x\n", hr);
+            return CORDBG_E_MISSING_METADATA;
+        }
+        if (WideCharToMultiByte(CP_UTF8, 0, filePath, -1, filePathA, MAX_LONGPATH, nullptr, nullptr) == 0) {
+            return E_FAIL;
+        }
+        if (FAILED(hr = MapAssemblyMetadata(filePathA, m_timeStamp, m_imageSize, Size(), &m_mapping, &m_mappingSize, &m_metadataMemory))) {
+            return hr;
+        }
+        LibraryIndexAdd("assembly", (const uint8_t*)indexId, sizeof(indexId), filePathA);
+        return S_OK;
+    }
+
+    // Opens or downloads the assembly and maps or copies its metadata. Uses the
+    // symbol service so it must be called on the debugger thread.
+    HRESULT LoadMetadata()
+    {
+        // Only copy the metadata if the assembly was found but couldn't be mapped;
+        // otherwise the symbol service would probe or download it again.
+        HRESULT hr = MapMetadata();
+        if (SUCCEEDED(hr) || hr == CORDBG_E_MISSING_METADATA) {
+            return hr;
+        }
+        ULONG32 bufferSize = (ULONG32)Size();
+        ArrayHolder<BYTE> buffer = new NOTHROW BYTE[bufferSize];
+        if (buffer == nullptr) {
+            return E_OUTOFMEMORY;
+        }
+        ULONG32 actualSize = 0;
+        if (FAILED(hr = GetMetadataLocator(m_imagePath, m_timeStamp, m_imageSize, nullptr, 0, 0, bufferSize, buffer, &actualSize))) {
+            return hr;
+        }
+        m_metadataMemory = buffer.Detach();
+        return S_OK;
+    }
 
     HRESULT CacheMetadata()
     {
         if (m_metadataMemory == nullptr)
         {
             HRESULT hr;
-            CLRDATA_ADDRESS baseAddress;
-            if (FAILED(hr = g_sos->GetPEFileBase(m_peFile, &baseAddress))) {
-                return hr;
-            }
-            ArrayHolder<WCHAR> imagePath = new WCHAR[MAX_LONGPATH];
-            if (FAILED(hr = g_sos->GetPEFileName(m_peFile, MAX_LONGPATH, imagePath.GetPtr(), NULL))) {
-                return hr;
-            }
-            IMAGE_DOS_HEADER DosHeader;
-            if (FAILED(hr = g_ExtData->ReadVirtual(baseAddress, &DosHeader, sizeof(DosHeader), NULL))) {
+            if (FAILED(hr = ResolveImage())) {
                 return hr;
             }
-            IMAGE_NT_HEADERS Header;
-            if (FAILED(hr = g_ExtData->ReadVirtual(baseAddress + DosHeader.e_lfanew, &Header, sizeof(Header), NULL))) {
+            if (FAILED(hr = LoadMetadata())) {
                 return hr;
             }
-            // If there is no COMHeader, this can not be managed code.
-            if (Header.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_COMHEADER].VirtualAddress == 0) {
-                return E_ACCESSDENIED;
-            }
-            ULONG32 imageSize = Header.OptionalHeader.SizeOfImage;
-            ULONG32 timeStamp = Header.FileHeader.TimeDateStamp;
-            ULONG32 bufferSize = (ULONG32)Size();
-
-            ArrayHolder<BYTE> buffer = new NOTHROW BYTE[bufferSize];
-            if (buffer == nullptr) {
-                return E_OUTOFMEMORY;
-            }
-            ULONG32 actualSize = 0;
-            if (FAILED(hr = GetMetadataLocator(imagePath, timeStamp, imageSize, nullptr, 0, 0, bufferSize, buffer, &actualSize))) {
-                return hr;
-            }
-            m_metadataMemory = buffer.Detach();
         }
         return S_OK;
     }
 
+    // Maps the file QueuePrefetch found. Only touches the local file system so it
+    // can run on a prefetch worker thread.
+    void MapPrefetchedFile()
+    {
+        MapAssemblyMetadata(m_prefetchPath.c_str(), m_timeStamp, m_imageSize, Size(), &m_mapping, &m_mappingSize, &m_metadataMemory);
+    }
+
+    void CompleteLoad()
+    {
+        pthread_mutex_lock(&g_metadataLock);
+        m_state = MetadataLoaded;
+        pthread_cond_broadcast(&g_metadataLoaded);
+        pthread_mutex_unlock(&g_metadataLock);
+    }
+
+    void WaitForLoad()
+    {
+        pthread_mutex_lock(&g_metadataLock);
+        while (m_state != MetadataLoaded)
+        {
+            pthread_cond_wait(&g_metadataLoaded, &g_metadataLock);
+        }
+        pthread_mutex_unlock(&g_metadataLock);
+    }
+
 public:
     MemoryRegion(uint64_t start, uint64_t end, CLRDATA_ADDRESS peFile) :
         m_startAddress(start),
         m_endAddress(end),
         m_peFile(peFile),
         m_metadataMemory(nullptr),
-        m_busy(0)
+        m_mapping(nullptr),
+        m_mappingSize(0),
+        m_busy(0),
+        m_state(MetadataNotPrefetched),
+        m_imagePath(nullptr),
+        m_imageSize(0),
+        m_timeStamp(0)
     {
     }
 
@@ -5538,6 +6438,47 @@ public:
         return (m_startAddress <= rhs.m_startAddress) && (m_endAddress >= rhs.m_endAddress);
     }
 
+    // Resolves the image and its local assembly file on the debugger thread and
+    // queues the region for the prefetch workers. Returns false if there is nothing
+    // to prefetch. Assemblies that would have to be located or downloaded by the
+    // symbol service are left to the DAC read.
+    bool QueuePrefetch()
+    {
+        if (m_peFile == 0 || m_state != MetadataNotPrefetched)
+        {
+            return false;
+        }
+        if (FAILED(ResolveImage()))
+        {
+            m_peFile = 0;
+            return false;
+        }
+        // The assembly found by an earlier session or the one at the path in the target
+        ULONG32 indexId[] = { m_timeStamp, m_imageSize };
+        if (!LibraryIndexLookup("assembly", (const uint8_t*)indexId, sizeof(indexId), m_prefetchPath))
+        {
+            char imagePath[MAX_LONGPATH];
+            if (WideCharToMultiByte(CP_UTF8, 0, m_imagePath, -1, imagePath, MAX_LONGPATH, nullptr, nullptr) == 0 ||
+                access(imagePath, R_OK) != 0)
+            {
+                return false;
+            }
+            m_prefetchPath = imagePath;
+        }
+        m_state = MetadataPending;
+        return true;
+    }
+
+    // Called by a prefetch worker. Skips the region if a DAC read already started loading it.
+    void Prefetch()
+    {
+        if (InterlockedCompareExchange(&m_state, MetadataLoading, MetadataPending) == MetadataPending)
+        {
+            MapPrefetchedFile();
+            CompleteLoad();
+        }
+    }
+
     HRESULT ReadMetadata(CLRDATA_ADDRESS address, ULONG32 bufferSize, BYTE* buffer)
     {
         _ASSERTE((m_startAddress <= address) && (m_endAddress >= (address + bufferSize)));
@@ -5547,16 +6488,36 @@ public:
         // Skip in-memory and dynamic modules or if CacheMetadata failed
         if (m_peFile != 0)
         {
-            if (InterlockedIncrement(&m_busy) == 1)
+            if (m_state != MetadataNotPrefetched)
             {
-                // Attempt to get the assembly metadata from local file or by downloading from a symbol server
-                hr = CacheMetadata();
-                if (FAILED(hr)) {
-                    // If we can get the metadata from the assembly, mark this region to always fail.
-                    m_peFile = 0;
+                // Map it here if no worker has picked it up yet, otherwise wait only for this region
+                if (InterlockedCompareExchange(&m_state, MetadataLoading, MetadataPending) == MetadataPending)
+                {
+                    MapPrefetchedFile();
+                    CompleteLoad();
                 }
+                else
+                {
+                    WaitForLoad();
+                }
+            }
+            if (m_metadataMemory != nullptr)
+            {
+                hr = S_OK;
+            }
+            else
+            {
+                if (InterlockedIncrement(&m_busy) == 1)
+                {
+                    // Attempt to get the assembly metadata from local file or by downloading from a symbol server
+                    hr = CacheMetadata();
+                    if (FAILED(hr)) {
+                        // If we can get the metadata from the assembly, mark this region to always fail.
+                        m_peFile = 0;
+                    }
+                }
+                InterlockedDecrement(&m_busy);
             }
-            InterlockedDecrement(&m_busy);
         }
 
         if (FAILED(hr)) {
@@ -5572,10 +6533,20 @@ public:
 
     void Dispose()
     {
-        if (m_metadataMemory != nullptr)
+        if (m_mapping != nullptr)
+        {
+            munmap(m_mapping, m_mappingSize);
+            m_mapping = nullptr;
+        }
+        else if (m_metadataMemory != nullptr)
         {
             delete[] m_metadataMemory;
-            m_metadataMemory = nullptr;
+        }
+        m_metadataMemory = nullptr;
+        if (m_imagePath != nullptr)
+        {
+            delete[] m_imagePath;
+            m_imagePath = nullptr;
         }
     }
 };
@@ -5583,8 +6554,89 @@ public:
 std::set<MemoryRegion> g_metadataRegions;
 bool g_metadataRegionsPopulated = false;
 
+#define MAX_METADATA_PREFETCH_THREADS 8
+
+// The regions queued for the prefetch workers. The workers take the next
+// region by incrementing g_metadataPrefetchNext.
+static std::vector<MemoryRegion*> g_metadataPrefetchQueue;
+static volatile LONG g_metadataPrefetchNext = 0;
+static pthread_t g_metadataPrefetchThreads[MAX_METADATA_PREFETCH_THREADS];
+static int g_metadataPrefetchThreadCount = 0;
+
+static void* MetadataPrefetchWorker(void*)
+{
+    while (true)
+    {
+        LONG index = InterlockedIncrement(&g_metadataPrefetchNext) - 1;
+        if (index >= (LONG)g_metadataPrefetchQueue.size())
+        {
+            break;
+        }
+        g_metadataPrefetchQueue[index]->Prefetch();
+    }
+    return nullptr;
+}
+
+// Stops handing out regions and waits for the workers to finish the ones they are mapping.
+// The workers never call the symbol service, so this doesn't wait on a download.
+static void StopMetadataPrefetch()
+{
+    InterlockedExchange(&g_metadataPrefetchNext, (LONG)g_metadataPrefetchQueue.size());
+    for (int i = 0; i < g_metadataPrefetchThreadCount; i++)
+    {
+        pthread_join(g_metadataPrefetchThreads[i], nullptr);
+    }
+    g_metadataPrefetchThreadCount = 0;
+    g_metadataPrefetchQueue.clear();
+}
+
+/**********************************************************************\
+ * Maps the metadata of the regions with a local assembly file
+ * concurrently. The image and file paths are resolved here (the DAC and
+ * the symbol service are single threaded); the workers only map the
+ * files. Enabled by setting DOTNET_SOS_METADATA_PREFETCH=1.
+\**********************************************************************/
+static void StartMetadataPrefetch()
+{
+    char setting[16];
+    DWORD length = GetEnvironmentVariableA("DOTNET_SOS_METADATA_PREFETCH", setting, ARRAY_SIZE(setting));
+    if (length == 0 || length >= ARRAY_SIZE(setting) || strcmp(setting, "1") != 0)
+    {
+        return;
+    }
+
+    if (g_metadataRegions.size() < 2)
+    {
+        return;
+    }
+
+    for (const MemoryRegion& region : g_metadataRegions)
+    {
+        if (const_cast<MemoryRegion&>(region).QueuePrefetch())
+        {
+            g_metadataPrefetchQueue.push_back(&const_cast<MemoryRegion&>(region));
+        }
+    }
+    g_metadataPrefetchNext = 0;
+
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int threadCount = (int)_min(_min(processors > 0 ? processors : 1, (long)MAX_METADATA_PREFETCH_THREADS), (long)g_metadataPrefetchQueue.size());
+    for (int i = 0; i < threadCount; i++)
+    {
+        if (pthread_create(&g_metadataPrefetchThreads[g_metadataPrefetchThreadCount], nullptr, MetadataPrefetchWorker, nullptr) != 0)
+        {
+            break;
+        }
+        g_metadataPrefetchThreadCount++;
+    }
+
+    // Without any worker the pending regions are loaded by the DAC reads as before
+    ExtDbgOut("StartMetadataPrefetch: %d regions on %d threads\n", (int)g_metadataPrefetchQueue.size(), g_metadataPrefetchThreadCount);
+}
+
 void FlushMetadataRegions()
 {
+    StopMetadataPrefetch();
     for (const MemoryRegion& region : g_metadataRegions)
     {
         const_cast<MemoryRegion&>(region).Dispose();
@@ -5595,6 +6647,7 @@ void FlushMetadataRegions()
 
 void PopulateMetadataRegions()
 {
+    StopMetadataPrefetch();
     g_metadataRegions.clear();
 
     // Only populate the metadata regions if core dump
@@ -5625,6 +6678,7 @@ void PopulateMetadataRegions()
                     }
                 }
             }
+            StartMetadataPrefetch();
         }
         else
         {
@@ -148,8 +148,59 @@ extern ISOSDacInterface *g_sos;
 extern ISOSDacInterface15 *g_sos15;
 extern ISOSDacInterface16 *g_sos16;
 
+// These are queried once per command with g_sos and are NULL if the DAC doesn't support them
+extern ISOSDacInterface5 *g_sos5;
+extern ISOSDacInterface7 *g_sos7;
+extern ISOSDacInterface14 *g_sos14;
+
 #include "dacprivate.h"
 
+//
+// The Dacp*Data requests made through CachedRequest are cached by request type and
+// address until the target is flushed (the stop id changes) or the runtime changes.
+//
+enum DacRequestType
+{
+    DacRequestModuleData,
+    DacRequestMethodTableData,
+    DacRequestMethodTableFieldData,
+    DacRequestMethodDescData,
+    DacRequestFieldDescData,
+    DacRequestTypeCount
+};
+
+template <class T> struct DacRequestTypeOf;
+template <> struct DacRequestTypeOf<DacpModuleData> { static const DacRequestType Value = DacRequestModuleData; };
+template <> struct DacRequestTypeOf<DacpMethodTableData> { static const DacRequestType Value = DacRequestMethodTableData; };
+template <> struct DacRequestTypeOf<DacpMethodTableFieldData> { static const DacRequestType Value = DacRequestMethodTableFieldData; };
+template <> struct DacRequestTypeOf<DacpMethodDescData> { static const DacRequestType Value = DacRequestMethodDescData; };
+template <> struct DacRequestTypeOf<DacpFieldDescData> { static const DacRequestType Value = DacRequestFieldDescData; };
+
+bool DacRequestCacheLookup(DacRequestType type, CLRDATA_ADDRESS addr, void* data, size_t size, HRESULT* phr);
+void DacRequestCacheAdd(DacRequestType type, CLRDATA_ADDRESS addr, const void* data, size_t size, HRESULT hr);
+void FlushDacRequestCache();
+
+template <class T>
+HRESULT CachedRequest(T& data, CLRDATA_ADDRESS addr)
+{
+    HRESULT hr;
+    if (!DacRequestCacheLookup(DacRequestTypeOf<T>::Value, addr, &data, sizeof(T), &hr))
+    {
+        hr = data.Request(g_sos, addr);
+        DacRequestCacheAdd(DacRequestTypeOf<T>::Value, addr, &data, sizeof(T), hr);
+    }
+    return hr;
+}
+
+// Counts the DAC requests the cache saved during a command and shows them in
+// the debug output (dbgout) when the command finishes.
+class DacRequestCacheScope
+{
+public:
+    DacRequestCacheScope();
+    ~DacRequestCacheScope();
+};
+
 // This class is templated for easy modification.  We may need to update the CachedString
 // or related classes to use WCHAR instead of char in the future.
 template <class T, int count, int size>
@@ -1365,9 +1416,11 @@ UINT GetGcHeapCount();
 BOOL GetGcStructuresValid();
 
 void DisassembleToken(IMetaDataImport* i, DWORD token);
-ULONG GetILSize(DWORD_PTR ilAddr); // REturns 0 if error occurs
-HRESULT DecodeILFromAddress(IMetaDataImport *pImport, TADDR ilAddr);
-void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize);
+HRESULT ReadILMethod(TADDR ilAddr, ArrayHolder<BYTE>& body, ULONG* pSize);
+HRESULT DecodeILFromAddress(IMetaDataImport *pImport, TADDR ilAddr, CLRDATA_ADDRESS moduleAddr = 0);
+void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize, CLRDATA_ADDRESS moduleAddr = 0);
+HRESULT DumpModuleILToFile(TADDR moduleAddr, LPCSTR filePath, ULONG* pMethodCount);
+void FlushILTokenNameCache();
 void DecodeDynamicIL(BYTE *data, ULONG Size, DacpObjectData& tokenArray);
 ULONG DisplayILOperation(const UINT indentCount, BYTE* pBuffer, ULONG position, std::function<void(DWORD)>& func);
 
@@ -1395,7 +1448,8 @@ BOOL SafeReadMemory (TADDR offset, PVOID lpBuffer, ULONG cb, PULONG lpcbBytesRea
 BOOL NameForMD_s (DWORD_PTR pMD, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName);
 BOOL NameForMT_s (DWORD_PTR MTAddr, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName);
 
-WCHAR *CreateMethodTableName(TADDR mt, TADDR cmt = (TADDR)0);
+const WCHAR *GetCachedMethodTableName(TADDR mt, TADDR cmt = (TADDR)0);
+void FlushMethodTableNameCache();
 
 void isRetAddr(DWORD_PTR retAddr, DWORD_PTR* whereCalled);
 DWORD_PTR GetValueFromExpression (___in __in_z const char *const str);
@@ -1437,6 +1491,8 @@ public:
     // TODO: Change the aSize argument to size_t when we start supporting
     // TODO: object sizes above 4GB
     void Add (DWORD_PTR aData, DWORD aSize);
+    // Adds aCount entries totalling aTotalSize bytes for aData at once
+    void Add (DWORD_PTR aData, size_t aTotalSize, DWORD aCount);
     void Sort ();
     void Print (const char* label = NULL);
     void Delete ();
@@ -1575,6 +1631,7 @@ struct GCHandleStatistics
 };
 
 BOOL IsSameModuleName (const char *str1, const char *str2);
+BOOL ModuleNameMatches(const DacpModuleData& moduleData, LPCSTR fileName, __in_z LPSTR mName);
 BOOL IsModule (DWORD_PTR moduleAddr);
 BOOL IsMethodDesc (DWORD_PTR value);
 BOOL IsMethodTable (DWORD_PTR value);
@@ -1657,10 +1714,25 @@ size_t NextOSPageAddress (size_t addr);
 BOOL GetSizeEfficient(DWORD_PTR dwAddrCurrObj,
     DWORD_PTR dwAddrMethTable, BOOL bLarge, size_t& s, BOOL& bContainsPointers);
 
+// The MethodTable and size of an object, as filled in by GetObjectsMTAndSize.
+// MT is 0 if the object or its MethodTable could not be read.
+struct ObjectMTAndSize
+{
+    TADDR Object;
+    TADDR MT;
+    size_t Size;
+};
+
+// Resolves the MethodTable and size of count objects with reads coalesced by
+// page. The entries are sorted by object address in place.
+void GetObjectsMTAndSize(ObjectMTAndSize *objects, size_t count);
+
 BOOL GetCollectibleDataEfficient(DWORD_PTR dwAddrMethTable, BOOL& bCollectible, TADDR& loaderAllocatorObjectHandle);
 
 void CharArrayContent(TADDR pos, ULONG num, bool widechar);
 void StringObjectContent (size_t obj, BOOL fLiteral=FALSE, const int length=-1);  // length=-1: dump everything in the string object.
+HRESULT ExportObjectContent(TADDR obj, LPCSTR filePath, bool utf8, ULONG64 *pBytesWritten);
+HRESULT ExportILMap(TADDR moduleAddr, LPCSTR filePath, bool csv, ULONG* pMethodCount);
 
 UINT FindAllPinnedAndStrong (DWORD_PTR handlearray[],UINT arraySize);
 
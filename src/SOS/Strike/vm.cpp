@@ -23,18 +23,28 @@ Revision History:
 
 #ifndef FEATURE_PAL
 #include <tchar.h>
+#endif // !FEATURE_PAL
 
 
 #include "strike.h"
 #include "util.h"
 #include "gcinfo.h"
 #include "disasm.h"
+#ifndef FEATURE_PAL
 #include <dbghelp.h>
+#endif // !FEATURE_PAL
 
 #include "corhdr.h"
 #include "cor.h"
 #include "dacprivate.h"
 
+#ifdef FEATURE_PAL
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#endif // FEATURE_PAL
+
 
 
 //
@@ -78,6 +88,8 @@ typedef struct _VM_STATS
 
 } VM_STATS, *PVM_STATS;
 
+#ifndef FEATURE_PAL
+
 typedef struct PROTECT_MASK
 {
     DWORD Bit;
@@ -143,6 +155,8 @@ PROTECT_MASK ProtectMasks[] =
         }
     };
 
+#endif // !FEATURE_PAL
+
 //
 // Private functions.
 //
@@ -389,6 +403,8 @@ PrintVmStats(
 
 }   // PrintVmStats
 
+#ifndef FEATURE_PAL
+
 PSTR
 VmProtectToString(
     IN DWORD Protect,
@@ -708,20 +724,675 @@ Return Value:
 
 }   // DECLARE_API( vmmap )
 
-#else
+#else // FEATURE_PAL
+
+//
+// There is no QueryVirtual on Linux/MacOS targets. The address space is
+// rebuilt from the mappings of the target instead: /proc/<pid>/smaps for a
+// live process (which also gives the resident size of each mapping) or the
+// regions lldb reports for a core dump (the PT_LOAD segments named by the
+// NT_FILE note). The resident bytes are then attributed to the runtime's
+// GC heap, loader heaps and JIT code heaps with one sweep over the sorted
+// mapping and runtime range lists.
+//
+
+#ifndef MEM_IMAGE
+#define MEM_IMAGE           0x1000000
+#endif
+
+#define VM_MAX_SEGMENTS     (1024 * 1024)
+
+enum VmOwner
+{
+    VmOwnerGCHeap,
+    VmOwnerLoaderHeap,
+    VmOwnerJitCode,
+    VmOwnerImage,
+    VmOwnerMapped,
+    VmOwnerNative,
+    VmOwnerCount
+};
+
+static const PCSTR VmOwnerNames[VmOwnerCount] =
+{
+    "GCHeap",
+    "LoaderHeap",
+    "JitCode",
+    "Image",
+    "Mapped",
+    "Native"
+};
+
+struct VmRegion
+{
+    ULONG64 Start;
+    ULONG64 End;
+    ULONG64 Resident;       // resident bytes, the region size for dumps
+    ULONG Protect;          // PAGE_* value
+    DWORD Type;             // MEM_PRIVATE, MEM_MAPPED or MEM_IMAGE
+    std::string Name;
+
+    bool operator<(const VmRegion& other) const { return Start < other.Start; }
+};
+
+struct VmRange
+{
+    ULONG64 Start;
+    ULONG64 End;
+    VmOwner Owner;
+
+    bool operator<(const VmRange& other) const { return Start < other.Start; }
+};
+
+static ULONG
+VmPermsToProtect(
+    IN PCSTR Perms
+    )
+{
+    bool read = Perms[0] == 'r';
+    bool write = Perms[1] == 'w';
+
+    if( Perms[2] == 'x' ) {
+        return write ? PAGE_EXECUTE_READWRITE : (read ? PAGE_EXECUTE_READ : PAGE_EXECUTE);
+    }
+    return write ? PAGE_READWRITE : (read ? PAGE_READONLY : PAGE_NOACCESS);
+
+}   // VmPermsToProtect
+
+static PCSTR
+VmProtectToPerms(
+    IN ULONG Protect
+    )
+{
+    switch( Protect )
+    {
+    case PAGE_READONLY:             return "r--";
+    case PAGE_READWRITE:            return "rw-";
+    case PAGE_EXECUTE:              return "--x";
+    case PAGE_EXECUTE_READ:         return "r-x";
+    case PAGE_EXECUTE_READWRITE:    return "rwx";
+    default:                        return "---";
+    }
+
+}   // VmProtectToPerms
+
+static bool
+ReadProcSmaps(
+    IN ULONG ProcessId,
+    OUT std::vector<VmRegion>& Regions
+    )
+{
+    char path[64];
+    sprintf_s( path, ARRAY_SIZE(path), "/proc/%u/smaps", ProcessId );
+
+    FILE* file = fopen( path, "r" );
+    if( file == nullptr ) {
+        return false;
+    }
+
+    // Processes with 100k mappings produce a smaps file of tens of MBs
+    setvbuf( file, nullptr, _IOFBF, 1024 * 1024 );
+
+    char line[MAX_LONGPATH + 128];
+    size_t current = (size_t)-1;
+
+    while( fgets( line, sizeof(line), file ) != nullptr ) {
+        unsigned long long start, end, kb;
+        char perms[8];
+        int nameOffset = 0;
+
+        if( sscanf( line, "%llx-%llx %7s %*llx %*s %*llu %n", &start, &end, perms, &nameOffset ) == 3 ) {
+            char* name = line + nameOffset;
+            name[strcspn( name, "\n" )] = '\0';
+
+            VmRegion region;
+            region.Start = start;
+            region.End = end;
+            region.Resident = 0;
+            region.Protect = VmPermsToProtect( perms );
+            region.Type = MEM_PRIVATE;
+            region.Name = name;
+            Regions.push_back( std::move(region) );
+            current = Regions.size() - 1;
+        }
+        else if( current != (size_t)-1 && strncmp( line, "Rss:", 4 ) == 0 ) {
+            if( sscanf( line + 4, "%llu", &kb ) == 1 ) {
+                Regions[current].Resident = kb * 1024;
+            }
+        }
+    }
+
+    fclose( file );
+    return !Regions.empty();
+
+}   // ReadProcSmaps
 
-#include <rotor_pal.h>
-#include <assert.h>
+static void
+AddDebuggerRegion(
+    void* param,
+    ULONG64 start,
+    ULONG64 end,
+    ULONG protect,
+    const char* name
+    )
+{
+    VmRegion region;
+    region.Start = start;
+    region.End = end;
+    region.Resident = end - start;
+    region.Protect = protect;
+    region.Type = MEM_PRIVATE;
+    region.Name = name != nullptr ? name : "";
+    ((std::vector<VmRegion>*)param)->push_back( std::move(region) );
+
+}   // AddDebuggerRegion
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Builds the sorted list of target mappings and classifies each as  *
+*    private, mapped file or image (any file with an executable        *
+*    mapping).                                                         *
+*                                                                      *
+\**********************************************************************/
+static HRESULT
+GetVmRegions(
+    OUT std::vector<VmRegion>& Regions
+    )
+{
+    ULONG processId = 0;
+
+    if( !IsDumpFile() &&
+        SUCCEEDED(g_ExtSystem->GetCurrentProcessSystemId( &processId )) &&
+        ReadProcSmaps( processId, Regions ) ) {
+        // Live target on this machine with resident sizes
+    }
+    else {
+        Regions.clear();
+        // Hosts that predate ILLDBServices3 (or can't enumerate regions) don't
+        // expose it; the callers report E_NOINTERFACE as unsupported.
+        ToRelease<ILLDBServices3> services3;
+        HRESULT hr = g_ExtServices->QueryInterface( __uuidof(ILLDBServices3), (void**)&services3 );
+        if( FAILED(hr) ) {
+            return E_NOINTERFACE;
+        }
+        hr = services3->EnumerateMemoryRegions( AddDebuggerRegion, &Regions );
+        if( FAILED(hr) ) {
+            return hr;
+        }
+    }
+
+    std::sort( Regions.begin(), Regions.end() );
+
+    std::unordered_set<std::string> images;
+    for( const VmRegion& region : Regions ) {
+        if( region.Name.size() > 0 && region.Name[0] == '/' &&
+            (region.Protect == PAGE_EXECUTE || region.Protect == PAGE_EXECUTE_READ || region.Protect == PAGE_EXECUTE_READWRITE) ) {
+            images.insert( region.Name );
+        }
+    }
+    for( VmRegion& region : Regions ) {
+        if( region.Name.size() > 0 && region.Name[0] == '/' ) {
+            region.Type = images.find( region.Name ) != images.end() ? MEM_IMAGE : MEM_MAPPED;
+        }
+    }
+
+    return S_OK;
+
+}   // GetVmRegions
+
+// TraverseLoaderHeap has no context parameter
+static std::vector<VmRange>* s_pVisitRanges = nullptr;
+static VmOwner s_visitOwner = VmOwnerLoaderHeap;
+
+static void
+VisitLoaderHeapBlock(
+    CLRDATA_ADDRESS blockData,
+    size_t blockSize,
+    BOOL blockIsCurrentBlock
+    )
+{
+    ULONG64 start = TO_TADDR(blockData);
+    s_pVisitRanges->push_back( VmRange { start, start + blockSize, s_visitOwner } );
+
+}   // VisitLoaderHeapBlock
+
+static void
+AddMemoryEnumRanges(
+    IN ISOSMemoryEnum* MemoryEnum,
+    IN VmOwner Owner,
+    IN OUT std::vector<VmRange>& Ranges
+    )
+{
+    SOSMemoryRegion regions[64];
+    unsigned int fetched = 0;
+
+    while( SUCCEEDED(MemoryEnum->Next( ARRAY_SIZE(regions), regions, &fetched )) && fetched > 0 ) {
+        for( unsigned int i = 0; i < fetched; i++ ) {
+            ULONG64 start = TO_TADDR(regions[i].Start);
+            Ranges.push_back( VmRange { start, start + regions[i].Size, Owner } );
+        }
+    }
+
+}   // AddMemoryEnumRanges
+
+static void
+AddGCHeapRanges(
+    IN const DacpGcHeapDetails& Heap,
+    IN OUT std::vector<VmRange>& Ranges
+    )
+{
+    for( int gen = 0; gen < DAC_NUMBERGENERATIONS; gen++ ) {
+        CLRDATA_ADDRESS segment = Heap.generation_table[gen].start_segment;
+
+        // The count guards against a corrupted (cyclic) segment list
+        for( int count = 0; segment != 0 && count < VM_MAX_SEGMENTS; count++ ) {
+            DacpHeapSegmentData segmentData;
+            if( segmentData.Request( g_sos, segment, Heap ) != S_OK ) {
+                break;
+            }
+            ULONG64 start = TO_TADDR(segmentData.segmentAddr);
+            ULONG64 end = TO_TADDR(segmentData.committed);
+            if( end <= start ) {
+                end = TO_TADDR(segmentData.highAllocMark);
+            }
+            if( end > start ) {
+                Ranges.push_back( VmRange { start, end, VmOwnerGCHeap } );
+            }
+            segment = segmentData.next;
+        }
+    }
+
+}   // AddGCHeapRanges
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Collects the address ranges owned by the runtime (GC segments and *
+*    bookkeeping, JIT code heaps, loader heaps) and returns them       *
+*    sorted and non-overlapping.                                       *
+*                                                                      *
+\**********************************************************************/
+static void
+GetRuntimeRanges(
+    OUT std::vector<VmRange>& Ranges
+    )
+{
+    if( g_sos == nullptr ) {
+        return;
+    }
+
+    //
+    // GC heap segments/regions.
+    //
+
+    DacpGcHeapData gcHeap;
+    if( gcHeap.Request( g_sos ) == S_OK ) {
+        if( gcHeap.bServerMode ) {
+            ArrayHolder<CLRDATA_ADDRESS> heapAddrs = new NOTHROW CLRDATA_ADDRESS[gcHeap.HeapCount];
+            if( heapAddrs != NULL && g_sos->GetGCHeapList( gcHeap.HeapCount, heapAddrs, NULL ) == S_OK ) {
+                for( UINT i = 0; i < gcHeap.HeapCount; i++ ) {
+                    DacpGcHeapDetails heapDetails;
+                    if( heapDetails.Request( g_sos, heapAddrs[i] ) == S_OK ) {
+                        AddGCHeapRanges( heapDetails, Ranges );
+                    }
+                }
+            }
+        }
+        else {
+            DacpGcHeapDetails heapDetails;
+            if( heapDetails.Request( g_sos ) == S_OK ) {
+                AddGCHeapRanges( heapDetails, Ranges );
+            }
+        }
+    }
+
+    ReleaseHolder<ISOSDacInterface13> sos13;
+    if( SUCCEEDED(g_sos->QueryInterface( __uuidof(ISOSDacInterface13), &sos13 )) ) {
+        ReleaseHolder<ISOSMemoryEnum> memoryEnum;
+        if( SUCCEEDED(sos13->GetGCBookkeepingMemoryRegions( &memoryEnum )) ) {
+            AddMemoryEnumRanges( memoryEnum, VmOwnerGCHeap, Ranges );
+        }
+        memoryEnum.Release();
+        if( SUCCEEDED(sos13->GetHandleTableMemoryRegions( &memoryEnum )) ) {
+            AddMemoryEnumRanges( memoryEnum, VmOwnerGCHeap, Ranges );
+        }
+    }
+
+    s_pVisitRanges = &Ranges;
+
+    //
+    // JIT code heaps.
+    //
+
+    unsigned int managerCount = 0;
+    if( g_sos->GetJitManagerList( 0, NULL, &managerCount ) == S_OK && managerCount > 0 ) {
+        ArrayHolder<DacpJitManagerInfo> managers = new NOTHROW DacpJitManagerInfo[managerCount];
+        if( managers != NULL && g_sos->GetJitManagerList( managerCount, managers, NULL ) == S_OK ) {
+            for( unsigned int n = 0; n < managerCount; n++ ) {
+                if( !IsMiIL(managers[n].codeType) ) {
+                    continue;
+                }
+                unsigned int heapCount = 0;
+                if( g_sos->GetCodeHeapList( managers[n].managerAddr, 0, NULL, &heapCount ) != S_OK || heapCount == 0 ) {
+                    continue;
+                }
+                ArrayHolder<DacpJitCodeHeapInfo> codeHeaps = new NOTHROW DacpJitCodeHeapInfo[heapCount];
+                if( codeHeaps == NULL || g_sos->GetCodeHeapList( managers[n].managerAddr, heapCount, codeHeaps, NULL ) != S_OK ) {
+                    continue;
+                }
+                for( unsigned int i = 0; i < heapCount; i++ ) {
+                    if( codeHeaps[i].codeHeapType == CODEHEAP_LOADER ) {
+                        s_visitOwner = VmOwnerJitCode;
+                        g_sos->TraverseLoaderHeap( codeHeaps[i].LoaderHeap, VisitLoaderHeapBlock );
+                    }
+                    else if( codeHeaps[i].codeHeapType == CODEHEAP_HOST ) {
+                        ULONG64 start = TO_TADDR(codeHeaps[i].HostData.baseAddr);
+                        ULONG64 end = TO_TADDR(codeHeaps[i].HostData.currentAddr);
+                        if( end > start ) {
+                            Ranges.push_back( VmRange { start, end, VmOwnerJitCode } );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //
+    // Loader heaps of each domain's loader allocator.
+    //
+
+    if( sos13 != NULL ) {
+        DWORD_PTR* pDomainList = NULL;
+        int numDomain = 0;
+        GetDomainList( pDomainList, numDomain );
+        ArrayHolder<DWORD_PTR> domainList = pDomainList;
+
+        s_visitOwner = VmOwnerLoaderHeap;
+        for( int d = 0; d < numDomain; d++ ) {
+            CLRDATA_ADDRESS loaderAllocator = 0;
+            int needed = 0;
+            if( FAILED(sos13->GetDomainLoaderAllocator( domainList[d], &loaderAllocator )) || loaderAllocator == 0 ||
+                FAILED(sos13->GetLoaderAllocatorHeaps( loaderAllocator, 0, NULL, NULL, &needed )) || needed <= 0 ) {
+                continue;
+            }
+            ArrayHolder<CLRDATA_ADDRESS> heaps = new NOTHROW CLRDATA_ADDRESS[needed];
+            ArrayHolder<LoaderHeapKind> kinds = new NOTHROW LoaderHeapKind[needed];
+            if( heaps == NULL || kinds == NULL ||
+                FAILED(sos13->GetLoaderAllocatorHeaps( loaderAllocator, needed, heaps, kinds, NULL )) ) {
+                continue;
+            }
+            for( int i = 0; i < needed; i++ ) {
+                if( heaps[i] != 0 ) {
+                    sos13->TraverseLoaderHeap( heaps[i], kinds[i], VisitLoaderHeapBlock );
+                }
+            }
+        }
+    }
+
+    s_pVisitRanges = nullptr;
+
+    //
+    // Sort and clip so that the ranges are disjoint; the first (lowest)
+    // range wins where two overlap.
+    //
+
+    std::sort( Ranges.begin(), Ranges.end() );
+
+    size_t count = 0;
+    ULONG64 limit = 0;
+    for( size_t i = 0; i < Ranges.size(); i++ ) {
+        VmRange range = Ranges[i];
+        if( range.Start < limit ) {
+            range.Start = limit;
+        }
+        if( range.End <= range.Start ) {
+            continue;
+        }
+        if( count > 0 && Ranges[count - 1].End == range.Start && Ranges[count - 1].Owner == range.Owner ) {
+            Ranges[count - 1].End = range.End;
+        }
+        else {
+            Ranges[count++] = range;
+        }
+        limit = range.End;
+    }
+    Ranges.resize( count );
+
+}   // GetRuntimeRanges
+
+static VmOwner
+VmDefaultOwner(
+    IN const VmRegion& Region
+    )
+{
+    switch( Region.Type )
+    {
+    case MEM_IMAGE:     return VmOwnerImage;
+    case MEM_MAPPED:    return VmOwnerMapped;
+    default:            return VmOwnerNative;
+    }
+
+}   // VmDefaultOwner
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Splits each mapping into the runtime ranges it overlaps and       *
+*    reports every piece with its share of the mapping's resident      *
+*    bytes. Both lists are sorted so this is a single linear sweep.    *
+*                                                                      *
+\**********************************************************************/
+template <class Callback>
+static void
+AttributeVmRegions(
+    IN const std::vector<VmRegion>& Regions,
+    IN const std::vector<VmRange>& Ranges,
+    IN Callback callback
+    )
+{
+    size_t first = 0;
+
+    for( const VmRegion& region : Regions ) {
+        ULONG64 size = region.End - region.Start;
+        ULONG64 owned = 0;
+
+        while( first < Ranges.size() && Ranges[first].End <= region.Start ) {
+            first++;
+        }
+
+        for( size_t i = first; i < Ranges.size() && Ranges[i].Start < region.End; i++ ) {
+            ULONG64 start = _max( Ranges[i].Start, region.Start );
+            ULONG64 end = _min( Ranges[i].End, region.End );
+            ULONG64 bytes = end - start;
+            owned += bytes;
+            callback( region, Ranges[i].Owner, bytes, (ULONG64)((double)region.Resident * bytes / size) );
+        }
+
+        if( owned < size ) {
+            ULONG64 bytes = size - owned;
+            callback( region, VmDefaultOwner( region ), bytes, (ULONG64)((double)region.Resident * bytes / size) );
+        }
+    }
+
+}   // AttributeVmRegions
+
+/************************************************************
+ * Dump Virtual Memory Info
+ ************************************************************/
 
 void vmstat()
 {
-   assert(false);
-}
+    std::vector<VmRegion> regions;
+    std::vector<VmRange> ranges;
+    VM_STATS freeStats;
+    VM_STATS reserveStats;
+    VM_STATS commitStats;
+    VM_STATS privateStats;
+    VM_STATS mappedStats;
+    VM_STATS imageStats;
+    VM_STATS ownerStats[VmOwnerCount];
+    ULONG64 ownerResident[VmOwnerCount] = {};
+    ULONG64 totalResident = 0;
+    CHAR residentStr[CCH_ULONGLONG_COMMAS];
+
+    HRESULT hr = GetVmRegions( regions );
+    if( hr == E_NOINTERFACE ) {
+        ExtOut( "This debugger host doesn't support enumerating the target's memory regions\n" );
+        return;
+    }
+    if( FAILED(hr) ) {
+        ExtOut( "Unable to enumerate the target's memory regions %08x\n", hr );
+        return;
+    }
+    GetRuntimeRanges( ranges );
+
+    InitVmStats( &freeStats );
+    InitVmStats( &reserveStats );
+    InitVmStats( &commitStats );
+    InitVmStats( &privateStats );
+    InitVmStats( &mappedStats );
+    InitVmStats( &imageStats );
+    for( int i = 0; i < VmOwnerCount; i++ ) {
+        InitVmStats( &ownerStats[i] );
+    }
+
+    ULONG64 previousEnd = 0;
+    for( const VmRegion& region : regions ) {
+        SIZE_T regionSize = (SIZE_T)(region.End - region.Start);
+
+        if( previousEnd != 0 && region.Start > previousEnd ) {
+            UpdateVmStats( &freeStats, (SIZE_T)(region.Start - previousEnd) );
+        }
+        previousEnd = _max( previousEnd, region.End );
+
+        if( region.Protect == PAGE_NOACCESS ) {
+            UpdateVmStats( &reserveStats, regionSize );
+        }
+        else {
+            UpdateVmStats( &commitStats, regionSize );
+        }
+
+        switch( region.Type ) {
+        case MEM_PRIVATE:
+            UpdateVmStats( &privateStats, regionSize );
+            break;
+
+        case MEM_MAPPED:
+            UpdateVmStats( &mappedStats, regionSize );
+            break;
+
+        case MEM_IMAGE:
+            UpdateVmStats( &imageStats, regionSize );
+            break;
+        }
+    }
+
+    AttributeVmRegions( regions, ranges, [&](const VmRegion& region, VmOwner owner, ULONG64 bytes, ULONG64 resident) {
+        UpdateVmStats( &ownerStats[owner], (SIZE_T)bytes );
+        ownerResident[owner] += resident;
+        totalResident += resident;
+    });
+
+    PrintVmStatsHeader();
+    PrintVmStats( "Free", &freeStats );
+    PrintVmStats( "Reserve", &reserveStats );
+    PrintVmStats( "Commit", &commitStats );
+    PrintVmStats( "Private", &privateStats );
+    PrintVmStats( "Mapped", &mappedStats );
+    PrintVmStats( "Image", &imageStats );
+    for( int i = 0; i < VmOwnerCount; i++ ) {
+        PrintVmStats( VmOwnerNames[i], &ownerStats[i] );
+    }
+
+    ExtOut( "%s:\n", IsDumpFile() ? "Dumped" : "Resident" );
+    for( int i = 0; i < VmOwnerCount; i++ ) {
+        ExtOut( "%-10s %*sK\n", VmOwnerNames[i], CCH_ULONGLONG_COMMAS,
+            ULongLongToString( (ULONGLONG)BYTES_TO_K(ownerResident[i]), residentStr ) );
+    }
+    ExtOut( "%-10s %*sK\n", "Total", CCH_ULONGLONG_COMMAS,
+        ULongLongToString( (ULONGLONG)BYTES_TO_K(totalResident), residentStr ) );
+
+}   // DECLARE_API( vmstat )
+
 
 void vmmap()
 {
+    std::vector<VmRegion> regions;
+    std::vector<VmRange> ranges;
+    CHAR residentStr[CCH_ULONGLONG_COMMAS];
+
+    HRESULT hr = GetVmRegions( regions );
+    if( hr == E_NOINTERFACE ) {
+        ExtOut( "This debugger host doesn't support enumerating the target's memory regions\n" );
+        return;
+    }
+    if( FAILED(hr) ) {
+        ExtOut( "Unable to enumerate the target's memory regions %08x\n", hr );
+        return;
+    }
+    GetRuntimeRanges( ranges );
+
+    ExtOut(
+        "%-*s %-*s %-*s  %-7s %-8s %-10s %12s  %s\n",
+        sizeof(PVOID) * 2,
+        "Start",
+        sizeof(PVOID) * 2,
+        "Stop",
+        sizeof(PVOID) * 2,
+        "Length",
+        "Protect",
+        "Type",
+        "Owner",
+        IsDumpFile() ? "Dumped" : "Resident",
+        "Name"
+        );
+
+    //
+    // One line per mapping, labelled with the owner of most of its bytes.
+    //
+
+    const VmRegion* current = nullptr;
+    ULONG64 currentOwnerBytes[VmOwnerCount] = {};
+    ULONG64 currentResident = 0;
+
+    auto printRegion = [&]() {
+        int owner = 0;
+        for( int i = 1; i < VmOwnerCount; i++ ) {
+            if( currentOwnerBytes[i] > currentOwnerBytes[owner] ) {
+                owner = i;
+            }
+        }
+        ExtOut(
+            "%p-%p %p  %-7s %-8s %-10s %11sK  %s\n",
+            SOS_PTR(current->Start),
+            SOS_PTR(current->End - 1),
+            SOS_PTR(current->End - current->Start),
+            VmProtectToPerms( current->Protect ),
+            current->Type == MEM_IMAGE ? "Image" : (current->Type == MEM_MAPPED ? "Mapped" : "Private"),
+            VmOwnerNames[owner],
+            ULongLongToString( (ULONGLONG)BYTES_TO_K(currentResident), residentStr ),
+            current->Name.c_str()
+            );
+    };
+
+    AttributeVmRegions( regions, ranges, [&](const VmRegion& region, VmOwner owner, ULONG64 bytes, ULONG64 resident) {
+        if( &region != current ) {
+            if( current != nullptr && !IsInterrupt() ) {
+                printRegion();
+            }
+            current = &region;
+            memset( currentOwnerBytes, 0, sizeof(currentOwnerBytes) );
+            currentResident = 0;
+        }
+        currentOwnerBytes[owner] += bytes;
+        currentResident += resident;
+    });
 
-   assert(false);
-}
+    if( current != nullptr && !IsInterrupt() ) {
+        printRegion();
+    }
+
+}   // DECLARE_API( vmmap )
 
 #endif  // #ifndef FEATURE_PAL
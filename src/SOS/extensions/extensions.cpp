@@ -207,7 +207,12 @@ ITarget* Extensions::GetTarget()
 {
     if (m_pTarget == nullptr)
     {
-        GetHost()->GetCurrentTarget(&m_pTarget);
+        // The lldb plug-in has no host while its background hosting is loading
+        IHost* host = GetHost();
+        if (host != nullptr)
+        {
+            host->GetCurrentTarget(&m_pTarget);
+        }
     }
     return m_pTarget;
 }
@@ -24,7 +24,9 @@ enum HostRuntimeFlavor
 };
 
 extern BOOL IsHostingInitialized();
+extern BOOL IsHostingInProgress();
 extern HRESULT InitializeHosting();
+extern void InitializeHostingInBackground();
 extern bool SetHostRuntime(HostRuntimeFlavor flavor, int major, int minor, LPCSTR hostRuntimeDirectory);
 extern void GetHostRuntime(HostRuntimeFlavor& flavor, int& major, int& minor, LPCSTR& hostRuntimeDirectory);
 extern bool GetAbsolutePath(const char* path, std::string& absolutePath);
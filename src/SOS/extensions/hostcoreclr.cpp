@@ -12,6 +12,7 @@
 #include <dirent.h>
 #include <dlfcn.h>
 #include <unistd.h>
+#include <pthread.h>
 #endif // FEATURE_PAL
 
 #include <functional>
@@ -65,6 +66,21 @@ static RuntimeVersion g_hostRuntimeVersion = { };
 static LPCSTR g_hostRuntimeDirectory = nullptr;
 static ExtensionsInitializeDelegate g_extensionsInitializeFunc = nullptr;
 
+// The background hosting thread only loads the runtime and creates the extensions
+// delegate. The debugger services can only be called on the command thread so the
+// thread's errors are saved and reported by WaitForBackgroundHosting.
+// g_backgroundHostingComplete is set by the thread when it is done so the command
+// thread can check it without waiting.
+static bool g_backgroundHostingActive = false;
+static LONG g_backgroundHostingComplete = 0;
+static HRESULT g_backgroundHostingResult = S_OK;
+static std::string g_backgroundHostingErrors;
+#ifdef FEATURE_PAL
+static pthread_t g_backgroundHostingThread;
+#else
+static HANDLE g_backgroundHostingThread = nullptr;
+#endif
+
 namespace RuntimeHostingConstants
 {
     // This list is in probing order.
@@ -136,6 +152,26 @@ namespace RuntimeHostingConstants
 #endif
 };
 
+//
+// Reports a hosting error or saves it if on the background hosting thread
+//
+static void HostingError(PCSTR format, ...)
+{
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (g_backgroundHostingActive)
+    {
+        g_backgroundHostingErrors.append(buffer);
+    }
+    else
+    {
+        TraceHostingError("%s", buffer);
+    }
+}
+
 struct FileFind
 {
 #ifdef FEATURE_PAL
@@ -272,9 +308,9 @@ static void AddFileToTpaList(const char* directory, const char* filename, std::s
 }
 
 //
-// Build the TPA list of assemblies for the runtime hosting api.
+// Returns the assemblies in the directory for the TPA list.
 //
-static void AddFilesFromDirectoryToTpaList(const char* directory, std::string& tpaList)
+static void GetAssembliesInDirectory(const char* directory, std::vector<std::string>& fileNames)
 {
     std::set<std::string> addedAssemblies;
 
@@ -304,7 +340,7 @@ static void AddFilesFromDirectoryToTpaList(const char* directory, std::string& t
                         if (addedAssemblies.find(filenameWithoutExt) == addedAssemblies.end())
                         {
                             addedAssemblies.insert(filenameWithoutExt);
-                            AddFileToTpaList(directory, filename.c_str(), tpaList);
+                            fileNames.push_back(filename);
                         }
                     }
                 }
@@ -314,6 +350,180 @@ static void AddFilesFromDirectoryToTpaList(const char* directory, std::string& t
     }
 }
 
+#ifdef FEATURE_PAL
+
+//
+// The assemblies found in a runtime directory are cached in $HOME/.dotnet/sos so
+// later sessions don't have to scan it. A cache file is the directory, its
+// modification time and then the assembly file names, one per line.
+//
+static bool GetTpaCachePath(const char* directory, std::string& cacheDirectory, std::string& cachePath)
+{
+    const char* home = getenv("HOME");
+    if (home == nullptr || *home == '\0')
+    {
+        return false;
+    }
+    // FNV-1a hash of the runtime directory
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char* p = directory; *p != '\0'; p++)
+    {
+        hash = (hash ^ (uint8_t)*p) * 1099511628211ULL;
+    }
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "/tpa-%016llx.txt", (unsigned long long)hash);
+
+    cacheDirectory.assign(home);
+    cacheDirectory.append("/.dotnet/sos");
+    cachePath.assign(cacheDirectory);
+    cachePath.append(fileName);
+    return true;
+}
+
+static bool GetDirectoryModifiedTime(const char* directory, std::string& modifiedTime)
+{
+    struct stat st;
+    if (stat(directory, &st) != 0)
+    {
+        return false;
+    }
+#if defined(__APPLE__)
+    long nanoseconds = st.st_mtimespec.tv_nsec;
+#else
+    long nanoseconds = st.st_mtim.tv_nsec;
+#endif
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%lld.%09ld", (long long)st.st_mtime, nanoseconds);
+    modifiedTime.assign(buffer);
+    return true;
+}
+
+static bool ReadTpaCache(const char* directory, const std::string& modifiedTime, std::vector<std::string>& fileNames)
+{
+    std::string cacheDirectory;
+    std::string cachePath;
+    if (!GetTpaCachePath(directory, cacheDirectory, cachePath))
+    {
+        return false;
+    }
+    // Only trust a cache file written by this user
+    struct stat st;
+    if (stat(cachePath.c_str(), &st) != 0 || st.st_uid != getuid())
+    {
+        return false;
+    }
+    FILE* cacheFile = fopen(cachePath.c_str(), "r");
+    if (cacheFile == nullptr)
+    {
+        return false;
+    }
+    char* line = nullptr;
+    size_t lineLen = 0;
+    ssize_t length;
+    int lineNumber = 0;
+    bool valid = true;
+    while (valid && (length = getline(&line, &lineLen, cacheFile)) != -1)
+    {
+        if (length == 0 || line[length - 1] != '\n')
+        {
+            valid = false;
+            break;
+        }
+        line[length - 1] = '\0';
+        switch (lineNumber++)
+        {
+            case 0:
+                valid = strcmp(line, directory) == 0;
+                break;
+            case 1:
+                valid = modifiedTime == line;
+                break;
+            default:
+                // Only file names in the runtime directory
+                valid = strchr(line, '/') == nullptr;
+                if (valid)
+                {
+                    fileNames.push_back(line);
+                }
+                break;
+        }
+    }
+    free(line);
+    fclose(cacheFile);
+    if (!valid || lineNumber < 2)
+    {
+        fileNames.clear();
+        return false;
+    }
+    return true;
+}
+
+static void WriteTpaCache(const char* directory, const std::string& modifiedTime, const std::vector<std::string>& fileNames)
+{
+    std::string cacheDirectory;
+    std::string cachePath;
+    if (!GetTpaCachePath(directory, cacheDirectory, cachePath) || strchr(directory, '\n') != nullptr)
+    {
+        return;
+    }
+    std::string dotnetDirectory(cacheDirectory.substr(0, cacheDirectory.rfind('/')));
+    mkdir(dotnetDirectory.c_str(), 0700);
+    mkdir(cacheDirectory.c_str(), 0700);
+
+    std::string contents(directory);
+    contents.append("\n");
+    contents.append(modifiedTime);
+    contents.append("\n");
+    for (const std::string& fileName : fileNames)
+    {
+        contents.append(fileName);
+        contents.append("\n");
+    }
+
+    // Write a temporary file and rename it so readers never see a partial cache
+    std::string tempPath(cachePath);
+    tempPath.append(".XXXXXX");
+    int fd = mkstemp(&tempPath[0]);
+    if (fd == -1)
+    {
+        return;
+    }
+    bool written = write(fd, contents.c_str(), contents.size()) == (ssize_t)contents.size();
+    close(fd);
+    if (!written || rename(tempPath.c_str(), cachePath.c_str()) != 0)
+    {
+        unlink(tempPath.c_str());
+    }
+}
+
+#endif // FEATURE_PAL
+
+//
+// Build the TPA list of assemblies for the runtime hosting api.
+//
+static void AddFilesFromDirectoryToTpaList(const char* directory, std::string& tpaList)
+{
+    std::vector<std::string> fileNames;
+#ifdef FEATURE_PAL
+    std::string modifiedTime;
+    bool cacheable = GetDirectoryModifiedTime(directory, modifiedTime);
+    if (!cacheable || !ReadTpaCache(directory, modifiedTime, fileNames))
+    {
+        GetAssembliesInDirectory(directory, fileNames);
+        if (cacheable && !fileNames.empty())
+        {
+            WriteTpaCache(directory, modifiedTime, fileNames);
+        }
+    }
+#else
+    GetAssembliesInDirectory(directory, fileNames);
+#endif
+    for (const std::string& fileName : fileNames)
+    {
+        AddFileToTpaList(directory, fileName.c_str(), tpaList);
+    }
+}
+
 static std::string GetTpaListForRuntimeVersion(
     const std::string& sosModuleDirectory,
     const std::string& hostRuntimeDirectory,
@@ -399,7 +609,7 @@ static HRESULT ProbeInstallationMarkerFile(const char* const markerName, std::st
 
     if (getline(&line, &lineLen, locationFile) == -1)
     {
-        TraceHostingError("Unable to read .NET installation marker at %s\n", markerName);
+        HostingError("Unable to read .NET installation marker at %s\n", markerName);
         free(line);
         return E_FAIL;
     }
@@ -487,7 +697,7 @@ static HRESULT GetHostRuntime(std::string& coreClrPath, std::string& hostRuntime
         ArrayHolder<CHAR> programFiles = new CHAR[MAX_LONGPATH];
         if (GetEnvironmentVariableA("PROGRAMFILES", programFiles, MAX_LONGPATH) == 0)
         {
-            TraceHostingError("PROGRAMFILES environment variable not found\n");
+            HostingError("PROGRAMFILES environment variable not found\n");
             return E_FAIL;
         }
         std::string windowsInstallPath(programFiles);
@@ -501,7 +711,7 @@ static HRESULT GetHostRuntime(std::string& coreClrPath, std::string& hostRuntime
 
         if (Status != S_OK)
         {
-            TraceHostingError("Failed to find runtime directory\n");
+            HostingError("Failed to find runtime directory\n");
             return E_FAIL;
         }
 
@@ -518,7 +728,7 @@ static HRESULT GetHostRuntime(std::string& coreClrPath, std::string& hostRuntime
 
         if (hostRuntimeVersion.Major == 0)
         {
-            TraceHostingError("Failed to find a supported runtime within %s\n", hostRuntimeDirectory.c_str());
+            HostingError("Failed to find a supported runtime within %s\n", hostRuntimeDirectory.c_str());
             return E_FAIL;
         }
 
@@ -536,18 +746,15 @@ static HRESULT GetHostRuntime(std::string& coreClrPath, std::string& hostRuntime
 }
 
 /**********************************************************************\
- * Initializes the host coreclr runtime
+ * Returns the path of the SOS module
 \**********************************************************************/
-static HRESULT InitializeNetCoreHost()
+static HRESULT GetSOSModulePath(std::string& sosModulePath)
 {
-    std::string sosModulePath;
-    HRESULT hr = S_OK;
-
 #ifdef FEATURE_PAL
     Dl_info info;
-    if (dladdr((PVOID)&InitializeNetCoreHost, &info) == 0)
+    if (dladdr((PVOID)&GetSOSModulePath, &info) == 0)
     {
-        TraceHostingError("Failed to get SOS module directory with dladdr()\n");
+        HostingError("Failed to get SOS module directory with dladdr()\n");
         return E_FAIL;
     }
     sosModulePath = info.dli_fname;
@@ -555,110 +762,144 @@ static HRESULT InitializeNetCoreHost()
     ArrayHolder<char> szSOSModulePath = new char[MAX_LONGPATH + 1];
     if (GetModuleFileNameA(g_hInstance, szSOSModulePath, MAX_LONGPATH) == 0)
     {
-        TraceHostingError("Failed to get SOS module directory\n");
+        HostingError("Failed to get SOS module directory\n");
         return HRESULT_FROM_WIN32(GetLastError());
     }
     sosModulePath = szSOSModulePath;
 #endif // FEATURE_PAL
+    return S_OK;
+}
 
-    if (g_extensionsInitializeFunc == nullptr)
+/**********************************************************************\
+ * Loads and initializes the host coreclr runtime and creates the
+ * extensions initialize delegate. Doesn't call the debugger so it can
+ * run on the background hosting thread.
+\**********************************************************************/
+static HRESULT LoadNetCoreHost(const std::string& sosModulePath)
+{
+    HRESULT hr = S_OK;
+    coreclr_initialize_ptr initializeCoreCLR = nullptr;
+    coreclr_create_delegate_ptr createDelegate = nullptr;
+    std::string sosModuleDirectory;
+    std::string hostRuntimeDirectory;
+    std::string coreClrPath;
+    RuntimeVersion hostRuntimeVersion = {};
+
+    hr = GetHostRuntime(coreClrPath, hostRuntimeDirectory, hostRuntimeVersion);
+    if (FAILED(hr))
     {
-        coreclr_initialize_ptr initializeCoreCLR = nullptr;
-        coreclr_create_delegate_ptr createDelegate = nullptr;
-        std::string sosModuleDirectory;
-        std::string hostRuntimeDirectory;
-        std::string coreClrPath;
-        RuntimeVersion hostRuntimeVersion = {};
-
-        hr = GetHostRuntime(coreClrPath, hostRuntimeDirectory, hostRuntimeVersion);
-        if (FAILED(hr))
-        {
-            return hr;
-        }
+        return hr;
+    }
 #ifdef FEATURE_PAL
-        void* coreclrLib = dlopen(coreClrPath.c_str(), RTLD_NOW | RTLD_LOCAL);
-        if (coreclrLib == nullptr)
-        {
-            TraceHostingError("Failed to load runtime module %s\n", coreClrPath.c_str());
-            return E_FAIL;
-        }
-        initializeCoreCLR = (coreclr_initialize_ptr)dlsym(coreclrLib, "coreclr_initialize");
-        createDelegate = (coreclr_create_delegate_ptr)dlsym(coreclrLib, "coreclr_create_delegate");
+    void* coreclrLib = dlopen(coreClrPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (coreclrLib == nullptr)
+    {
+        HostingError("Failed to load runtime module %s\n", coreClrPath.c_str());
+        return E_FAIL;
+    }
+    initializeCoreCLR = (coreclr_initialize_ptr)dlsym(coreclrLib, "coreclr_initialize");
+    createDelegate = (coreclr_create_delegate_ptr)dlsym(coreclrLib, "coreclr_create_delegate");
 #else
-        HMODULE coreclrLib = LoadLibraryA(coreClrPath.c_str());
-        if (coreclrLib == nullptr)
-        {
-            TraceHostingError("Failed to load runtime module %s\n", coreClrPath.c_str());
-            return E_FAIL;
-        }
-        initializeCoreCLR = (coreclr_initialize_ptr)GetProcAddress(coreclrLib, "coreclr_initialize");
-        createDelegate = (coreclr_create_delegate_ptr)GetProcAddress(coreclrLib, "coreclr_create_delegate");
+    HMODULE coreclrLib = LoadLibraryA(coreClrPath.c_str());
+    if (coreclrLib == nullptr)
+    {
+        HostingError("Failed to load runtime module %s\n", coreClrPath.c_str());
+        return E_FAIL;
+    }
+    initializeCoreCLR = (coreclr_initialize_ptr)GetProcAddress(coreclrLib, "coreclr_initialize");
+    createDelegate = (coreclr_create_delegate_ptr)GetProcAddress(coreclrLib, "coreclr_create_delegate");
 #endif // FEATURE_PAL
 
-        if (initializeCoreCLR == nullptr || createDelegate == nullptr)
-        {
-            TraceHostingError("coreclr_initialize or coreclr_create_delegate not found in %s\n", coreClrPath.c_str());
-            return E_FAIL;
-        }
+    if (initializeCoreCLR == nullptr || createDelegate == nullptr)
+    {
+        HostingError("coreclr_initialize or coreclr_create_delegate not found in %s\n", coreClrPath.c_str());
+        return E_FAIL;
+    }
 
-        // Get just the sos module directory
-        sosModuleDirectory = sosModulePath;
-        size_t lastSlash = sosModuleDirectory.rfind(DIRECTORY_SEPARATOR_CHAR_A);
-        if (lastSlash == std::string::npos)
-        {
-            TraceHostingError("Failed to parse SOS module name\n");
-            return E_FAIL;
-        }
-        sosModuleDirectory.erase(lastSlash);
+    // Get just the sos module directory
+    sosModuleDirectory = sosModulePath;
+    size_t lastSlash = sosModuleDirectory.rfind(DIRECTORY_SEPARATOR_CHAR_A);
+    if (lastSlash == std::string::npos)
+    {
+        HostingError("Failed to parse SOS module name\n");
+        return E_FAIL;
+    }
+    sosModuleDirectory.erase(lastSlash);
 
-        // Trust The SOS managed and dependent assemblies from the sos directory
-        std::string tpaList = GetTpaListForRuntimeVersion(sosModuleDirectory, hostRuntimeDirectory, hostRuntimeVersion);
+    // Trust The SOS managed and dependent assemblies from the sos directory
+    std::string tpaList = GetTpaListForRuntimeVersion(sosModuleDirectory, hostRuntimeDirectory, hostRuntimeVersion);
 
-        std::string appPaths;
-        appPaths.append(sosModuleDirectory);
+    std::string appPaths;
+    appPaths.append(sosModuleDirectory);
 
-        const char* propertyKeys[] = {
-            "TRUSTED_PLATFORM_ASSEMBLIES",
-            "APP_PATHS",
-            "APP_NI_PATHS",
-            "NATIVE_DLL_SEARCH_DIRECTORIES",
-            "AppDomainCompatSwitch"
-        };
+    const char* propertyKeys[] = {
+        "TRUSTED_PLATFORM_ASSEMBLIES",
+        "APP_PATHS",
+        "APP_NI_PATHS",
+        "NATIVE_DLL_SEARCH_DIRECTORIES",
+        "AppDomainCompatSwitch"
+    };
 
-        const char* propertyValues[] = {
-            // TRUSTED_PLATFORM_ASSEMBLIES
-            tpaList.c_str(),
-            // APP_PATHS
-            appPaths.c_str(),
-            // APP_NI_PATHS
-            hostRuntimeDirectory.c_str(),
-            // NATIVE_DLL_SEARCH_DIRECTORIES
-            appPaths.c_str(),
-            // AppDomainCompatSwitch
-            "UseLatestBehaviorWhenTFMNotSpecified"
-        };
+    const char* propertyValues[] = {
+        // TRUSTED_PLATFORM_ASSEMBLIES
+        tpaList.c_str(),
+        // APP_PATHS
+        appPaths.c_str(),
+        // APP_NI_PATHS
+        hostRuntimeDirectory.c_str(),
+        // NATIVE_DLL_SEARCH_DIRECTORIES
+        appPaths.c_str(),
+        // AppDomainCompatSwitch
+        "UseLatestBehaviorWhenTFMNotSpecified"
+    };
 
-        char* exePath = minipal_getexepath();
-        if (!exePath)
-        {
-            TraceHostingError("Could not get full path to current executable\n");
-            return E_FAIL;
-        }
+    char* exePath = minipal_getexepath();
+    if (!exePath)
+    {
+        HostingError("Could not get full path to current executable\n");
+        return E_FAIL;
+    }
 
-        void* hostHandle;
-        unsigned int domainId;
-        hr = initializeCoreCLR(exePath, "sos", ARRAY_SIZE(propertyKeys), propertyKeys, propertyValues, &hostHandle, &domainId);
-        free(exePath);
-        if (FAILED(hr))
+    void* hostHandle;
+    unsigned int domainId;
+    hr = initializeCoreCLR(exePath, "sos", ARRAY_SIZE(propertyKeys), propertyKeys, propertyValues, &hostHandle, &domainId);
+    free(exePath);
+    if (FAILED(hr))
+    {
+        HostingError("Fail to initialize hosting runtime '%s' %08x\n", coreClrPath.c_str(), hr);
+        return hr;
+    }
+
+    hr = createDelegate(hostHandle, domainId, ExtensionsDllName, ExtensionsClassName, ExtensionsInitializeFunctionName, (void**)&g_extensionsInitializeFunc);
+    if (FAILED(hr))
+    {
+        HostingError("Fail to create hosting delegate %08x\n", hr);
+        return hr;
+    }
+    return S_OK;
+}
+
+/**********************************************************************\
+ * Initializes the host coreclr runtime
+\**********************************************************************/
+static HRESULT InitializeNetCoreHost()
+{
+    std::string sosModulePath;
+    HRESULT hr = GetSOSModulePath(sosModulePath);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+    if (g_extensionsInitializeFunc == nullptr)
+    {
+        // Don't try again if the background hosting thread already failed
+        if (FAILED(g_backgroundHostingResult))
         {
-            TraceHostingError("Fail to initialize hosting runtime '%s' %08x\n", coreClrPath.c_str(), hr);
-            return hr;
+            return g_backgroundHostingResult;
         }
-
-        hr = createDelegate(hostHandle, domainId, ExtensionsDllName, ExtensionsClassName, ExtensionsInitializeFunctionName, (void**)&g_extensionsInitializeFunc);
+        hr = LoadNetCoreHost(sosModulePath);
         if (FAILED(hr))
         {
-            TraceHostingError("Fail to create hosting delegate %08x\n", hr);
             return hr;
         }
     }
@@ -672,17 +913,93 @@ static HRESULT InitializeNetCoreHost()
     }
     if (FAILED(hr))
     {
-        TraceHostingError("Extension host initialization FAILED %08x\n", hr);
+        HostingError("Extension host initialization FAILED %08x\n", hr);
         return hr;
     }
     return hr;
 }
 
+#ifdef FEATURE_PAL
+static void* BackgroundHostingThread(void*)
+#else
+static DWORD WINAPI BackgroundHostingThread(LPVOID)
+#endif
+{
+    std::string sosModulePath;
+    HRESULT hr = GetSOSModulePath(sosModulePath);
+    if (SUCCEEDED(hr))
+    {
+        hr = LoadNetCoreHost(sosModulePath);
+    }
+    g_backgroundHostingResult = hr;
+    InterlockedExchange(&g_backgroundHostingComplete, 1);
+    return 0;
+}
+
+/**********************************************************************\
+ * Waits for the background hosting thread and reports its errors.
+ * Called on the command thread before any of the hosting state is used.
+\**********************************************************************/
+static void WaitForBackgroundHosting()
+{
+    if (!g_backgroundHostingActive)
+    {
+        return;
+    }
+#ifdef FEATURE_PAL
+    pthread_join(g_backgroundHostingThread, nullptr);
+#else
+    WaitForSingleObject(g_backgroundHostingThread, INFINITE);
+    CloseHandle(g_backgroundHostingThread);
+    g_backgroundHostingThread = nullptr;
+#endif
+    g_backgroundHostingActive = false;
+    if (!g_backgroundHostingErrors.empty())
+    {
+        TraceHostingError("%s", g_backgroundHostingErrors.c_str());
+        g_backgroundHostingErrors.clear();
+    }
+}
+
+/**********************************************************************\
+ * Starts loading the .NET Core host runtime on a background thread if
+ * DOTNET_SOS_BACKGROUND_HOSTING is set to 1 so the first managed
+ * command doesn't have to wait for it. Commands that don't need the
+ * hosting check IsHostingInProgress and never wait for it.
+\**********************************************************************/
+void InitializeHostingInBackground()
+{
+    const char* enable = getenv("DOTNET_SOS_BACKGROUND_HOSTING");
+    if (enable == nullptr || strcmp(enable, "1") != 0)
+    {
+        return;
+    }
+    if (g_backgroundHostingActive || g_hostingInitialized || g_extensionsInitializeFunc != nullptr || g_hostRuntimeFlavor != HostRuntimeFlavor::NetCore)
+    {
+        return;
+    }
+    g_backgroundHostingActive = true;
+    g_backgroundHostingComplete = 0;
+#ifdef FEATURE_PAL
+    if (pthread_create(&g_backgroundHostingThread, nullptr, BackgroundHostingThread, nullptr) != 0)
+    {
+        g_backgroundHostingActive = false;
+    }
+#else
+    g_backgroundHostingThread = CreateThread(nullptr, 0, BackgroundHostingThread, nullptr, 0, nullptr);
+    if (g_backgroundHostingThread == nullptr)
+    {
+        g_backgroundHostingActive = false;
+    }
+#endif
+}
+
 /**********************************************************************\
  * Sets the host runtime info
 \**********************************************************************/
 bool SetHostRuntime(HostRuntimeFlavor flavor, int major, int minor, LPCSTR hostRuntimeDirectory)
 {
+    WaitForBackgroundHosting();
     if (hostRuntimeDirectory != nullptr)
     {
         std::string fullPath;
@@ -710,6 +1027,7 @@ bool SetHostRuntime(HostRuntimeFlavor flavor, int major, int minor, LPCSTR hostR
         free((void*)g_hostRuntimeDirectory);
     }
     g_hostRuntimeFlavor = flavor;
+    g_backgroundHostingResult = S_OK;
     g_hostRuntimeVersion.Major = major;
     g_hostRuntimeVersion.Minor = minor;
     g_hostRuntimeDirectory = hostRuntimeDirectory;
@@ -721,6 +1039,7 @@ bool SetHostRuntime(HostRuntimeFlavor flavor, int major, int minor, LPCSTR hostR
 \**********************************************************************/
 void GetHostRuntime(HostRuntimeFlavor& flavor, int& major, int& minor, LPCSTR& hostRuntimeDirectory)
 {
+    WaitForBackgroundHosting();
     flavor = g_hostRuntimeFlavor;
     major = g_hostRuntimeVersion.Major;
     minor = g_hostRuntimeVersion.Minor;
@@ -728,11 +1047,26 @@ void GetHostRuntime(HostRuntimeFlavor& flavor, int& major, int& minor, LPCSTR& h
 }
 
 /**********************************************************************\
- * Returns true if the host runtime has already been initialized.
+ * Returns true while the background hosting thread is still loading
+ * the host runtime. Doesn't wait for it.
+\**********************************************************************/
+BOOL IsHostingInProgress()
+{
+    return g_backgroundHostingActive && InterlockedCompareExchange(&g_backgroundHostingComplete, 0, 0) == 0;
+}
+
+/**********************************************************************\
+ * Returns true if the host runtime has already been initialized or
+ * loaded by the background hosting thread. Doesn't wait for the
+ * background hosting thread; false while it is still loading.
 \**********************************************************************/
 BOOL IsHostingInitialized()
 {
-    return g_hostingInitialized;
+    if (IsHostingInProgress())
+    {
+        return FALSE;
+    }
+    return g_hostingInitialized || g_extensionsInitializeFunc != nullptr;
 }
 
 /**********************************************************************\
@@ -740,6 +1074,7 @@ BOOL IsHostingInitialized()
 \**********************************************************************/
 HRESULT InitializeHosting()
 {
+    WaitForBackgroundHosting();
     if (g_hostRuntimeFlavor == HostRuntimeFlavor::None)
     {
         return E_FAIL;
@@ -258,6 +258,7 @@ interface ILLDBServices;
 typedef HRESULT (*PFN_EXCEPTION_CALLBACK)(ILLDBServices *services);
 typedef HRESULT (*PFN_RUNTIME_LOADED_CALLBACK)(ILLDBServices *services);
 typedef void (*PFN_MODULE_LOAD_CALLBACK)(void* param, const char* moduleFilePath, ULONG64 moduleAddress, int moduleSize);
+typedef void (*PFN_MEMORY_REGION_CALLBACK)(void* param, ULONG64 start, ULONG64 end, ULONG protect, const char* name);
 
 //----------------------------------------------------------------------------
 // ILLDBServices
@@ -609,6 +610,23 @@ public:
         PFN_RUNTIME_LOADED_CALLBACK callback) = 0;
 };
 
+MIDL_INTERFACE("5A3B6E1C-8F2D-4C47-9B1E-6D0C2A7F4E93")
+ILLDBServices3: public IUnknown
+{
+public:
+    //----------------------------------------------------------------------------
+    // ILLDBServices3
+    //----------------------------------------------------------------------------
+
+    // Enumerates the mapped memory regions of the target in address order. For
+    // core dumps these come from the PT_LOAD segments and the NT_FILE note, for
+    // live processes from the /proc/<pid>/maps equivalent. The protect value is
+    // the PAGE_* constant matching the region's permissions.
+    virtual HRESULT STDMETHODCALLTYPE EnumerateMemoryRegions(
+        PFN_MEMORY_REGION_CALLBACK callback,
+        void* param) = 0;
+};
+
 #ifdef __cplusplus
 };
 #endif
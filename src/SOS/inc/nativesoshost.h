@@ -0,0 +1,435 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+// The common part of the standalone native SOS hosts (soscore and sosreplay)
+// that run libsos's commands without lldb. Include after lldbservices.h and
+// debuggerservices.h.
+//
+// NativeSOSHost implements the ILLDBServices, ILLDBServices2 and
+// IDebuggerServices plumbing and the methods these hosts don't support. A
+// host derives from it and implements the target access: memory, modules,
+// threads, output and symbols. NativeSOSLibrary loads libsos, initializes
+// it with the host and looks up the commands.
+
+typedef HRESULT (*CommandFunc)(ILLDBServices* services, const char* args);
+typedef HRESULT (*InitializeFunc)(IUnknown* punk, IDebuggerServices* debuggerServices);
+typedef void (*UninitializeFunc)();
+
+class NativeSOSHost : public ILLDBServices, public ILLDBServices2, public IDebuggerServices
+{
+private:
+    LONG m_ref;
+
+protected:
+    NativeSOSHost() :
+        m_ref(1)
+    {
+    }
+
+    static void CopyString(const std::string& str, PSTR buffer, ULONG bufferSize, PULONG size)
+    {
+        if (buffer != nullptr && bufferSize > 0)
+        {
+            size_t length = std::min((size_t)bufferSize - 1, str.size());
+            memcpy(buffer, str.data(), length);
+            buffer[length] = '\0';
+        }
+        if (size != nullptr)
+        {
+            *size = (ULONG)str.size() + 1;
+        }
+    }
+
+public:
+    //----------------------------------------------------------------------------
+    // IUnknown
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(
+        REFIID InterfaceId,
+        PVOID* Interface)
+    {
+        if (InterfaceId == __uuidof(IUnknown) ||
+            InterfaceId == __uuidof(ILLDBServices))
+        {
+            *Interface = static_cast<ILLDBServices*>(this);
+        }
+        else if (InterfaceId == __uuidof(ILLDBServices2))
+        {
+            *Interface = static_cast<ILLDBServices2*>(this);
+        }
+        else if (InterfaceId == __uuidof(IDebuggerServices))
+        {
+            *Interface = static_cast<IDebuggerServices*>(this);
+        }
+        else
+        {
+            *Interface = NULL;
+            return E_NOINTERFACE;
+        }
+        AddRef();
+        return S_OK;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef()
+    {
+        return ++m_ref;
+    }
+
+    ULONG STDMETHODCALLTYPE Release()
+    {
+        // The instance lives for the whole run
+        return --m_ref;
+    }
+
+    //----------------------------------------------------------------------------
+    // ILLDBServices
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE VirtualUnwind(
+        DWORD threadId,
+        ULONG32 contextSize,
+        PBYTE context)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetExceptionCallback(
+        PFN_EXCEPTION_CALLBACK callback)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE ClearExceptionCallback()
+    {
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetInterrupt()
+    {
+        return E_FAIL;
+    }
+
+    HRESULT STDMETHODCALLTYPE Execute(
+        ULONG outputControl,
+        PCSTR command,
+        ULONG flags)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetLastEventInformation(
+        PULONG type,
+        PULONG processId,
+        PULONG threadId,
+        PVOID extraInformation,
+        ULONG extraInformationSize,
+        PULONG extraInformationUsed,
+        PSTR description,
+        ULONG descriptionSize,
+        PULONG descriptionUsed)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE Disassemble(
+        ULONG64 offset,
+        ULONG flags,
+        PSTR buffer,
+        ULONG bufferSize,
+        PULONG disassemblySize,
+        PULONG64 endOffset)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetContextStackTrace(
+        PVOID startContext,
+        ULONG startContextSize,
+        PDEBUG_STACK_FRAME frames,
+        ULONG framesSize,
+        PVOID frameContexts,
+        ULONG frameContextsSize,
+        ULONG frameContextsEntrySize,
+        PULONG framesFilled)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE WriteVirtual(
+        ULONG64 offset,
+        PVOID buffer,
+        ULONG bufferSize,
+        PULONG bytesWritten)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetSymbolOptions(
+        PULONG options)
+    {
+        *options = SYMOPT_LOAD_LINES;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetNameByOffset(
+        ULONG64 offset,
+        PSTR nameBuffer,
+        ULONG nameBufferSize,
+        PULONG nameSize,
+        PULONG64 displacement)
+    {
+        return GetSymbolByOffset(DEBUG_ANY_ID, offset, nameBuffer, nameBufferSize, nameSize, displacement);
+    }
+
+    HRESULT STDMETHODCALLTYPE GetLineByOffset(
+        ULONG64 offset,
+        PULONG line,
+        PSTR fileBuffer,
+        ULONG fileBufferSize,
+        PULONG fileSize,
+        PULONG64 displacement)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetSourceFileLineOffsets(
+        PCSTR file,
+        PULONG64 buffer,
+        ULONG bufferLines,
+        PULONG fileLines)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE FindSourceFile(
+        ULONG startElement,
+        PCSTR file,
+        ULONG flags,
+        PULONG foundElement,
+        PSTR buffer,
+        ULONG bufferSize,
+        PULONG foundSize)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetValueByName(
+        PCSTR name,
+        PDWORD_PTR value)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetInstructionOffset(
+        PULONG64 offset)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetStackOffset(
+        PULONG64 offset)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetFrameOffset(
+        PULONG64 offset)
+    {
+        return E_NOTIMPL;
+    }
+
+    //----------------------------------------------------------------------------
+    // ILLDBServices2
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE LoadNativeSymbols(
+        bool runtimeOnly,
+        PFN_MODULE_LOAD_CALLBACK callback)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE AddModuleSymbol(
+        void* param,
+        const char* symbolFilePath)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetRuntimeLoadedCallback(
+        PFN_RUNTIME_LOADED_CALLBACK callback)
+    {
+        return E_NOTIMPL;
+    }
+
+    //----------------------------------------------------------------------------
+    // IDebuggerServices
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE AddCommand(
+        PCSTR command,
+        PCSTR help,
+        PCSTR aliases[],
+        int numberOfAliases)
+    {
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetThreadTeb(
+        ULONG sysId,
+        PULONG64 pteb)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetSymbolPath(
+        PSTR buffer,
+        ULONG bufferSize,
+        PULONG pathSize)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetTypeId(
+        ULONG moduleIndex,
+        PCSTR typeName,
+        PULONG64 typeId)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetFieldOffset(
+        ULONG moduleIndex,
+        PCSTR typeName,
+        ULONG64 typeId,
+        PCSTR fieldName,
+        PULONG offset)
+    {
+        return E_NOTIMPL;
+    }
+
+    ULONG STDMETHODCALLTYPE GetOutputWidth()
+    {
+        return 120;
+    }
+
+    HRESULT STDMETHODCALLTYPE SupportsDml(
+        PULONG supported)
+    {
+        *supported = 0;
+        return S_OK;
+    }
+
+    void STDMETHODCALLTYPE OutputDmlString(
+        ULONG mask,
+        PCSTR message)
+    {
+        OutputString(mask, message);
+    }
+
+    void STDMETHODCALLTYPE FlushCheck()
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE ExecuteHostCommand(
+        PCSTR commandLine,
+        PEXECUTE_COMMAND_OUTPUT_CALLBACK callback)
+    {
+        return E_NOTIMPL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetDacSignatureVerificationSettings(
+        BOOL* dacSignatureVerificationEnabled)
+    {
+        *dacSignatureVerificationEnabled = FALSE;
+        return S_OK;
+    }
+};
+
+//
+// Loads libsos and initializes it with a native host
+//
+class NativeSOSLibrary
+{
+private:
+    void* m_handle;
+
+public:
+    NativeSOSLibrary() :
+        m_handle(nullptr)
+    {
+    }
+
+    ~NativeSOSLibrary()
+    {
+        if (m_handle != nullptr)
+        {
+            UninitializeFunc uninitializeFunc = (UninitializeFunc)dlsym(m_handle, "SOSUninitializeByHost");
+            if (uninitializeFunc != nullptr)
+            {
+                uninitializeFunc();
+            }
+        }
+    }
+
+    // Loads libsos and calls SOSInitializeByHost. Prints the error and returns
+    // false on failure.
+    bool Initialize(const char* sosPath, IDebuggerServices* services)
+    {
+        void* handle = dlopen(sosPath, RTLD_NOW);
+        if (handle == nullptr)
+        {
+            fprintf(stderr, "Could not load '%s' - %s\n", sosPath, dlerror());
+            return false;
+        }
+        InitializeFunc initializeFunc = (InitializeFunc)dlsym(handle, "SOSInitializeByHost");
+        if (initializeFunc == nullptr)
+        {
+            fprintf(stderr, "'%s' is not libsos\n", sosPath);
+            return false;
+        }
+        HRESULT hr = initializeFunc(nullptr, services);
+        if (hr != S_OK)
+        {
+            fprintf(stderr, "SOSInitializeByHost failed %08x\n", hr);
+            return false;
+        }
+        m_handle = handle;
+        return true;
+    }
+
+    // Returns the exported function or nullptr
+    CommandFunc GetExport(const char* name)
+    {
+        return (CommandFunc)dlsym(m_handle, name);
+    }
+
+    // Splits a "<command> [args]" command line and looks up the command.
+    // Prints the error and returns nullptr if libsos doesn't export it.
+    CommandFunc GetCommand(const char* commandLine, std::string& args)
+    {
+        std::string command(commandLine);
+        args.clear();
+        size_t space = command.find(' ');
+        if (space != std::string::npos)
+        {
+            args = command.substr(space + 1);
+            command.resize(space);
+        }
+        CommandFunc commandFunc = GetExport(command.c_str());
+        if (commandFunc == nullptr)
+        {
+            fprintf(stderr, "SOS command '%s' not found\n", command.c_str());
+        }
+        return commandFunc;
+    }
+};
@@ -0,0 +1,162 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+// Format of the debugger services recordings written by the lldb plugin's
+// "sosrecord" command and served back by the sosreplay benchmark host.
+//
+// A recording is a RecordingFileHeader followed by a flat stream of entries.
+// Each entry is a RecordingEntryHeader, the key (the call's inputs) and the
+// value (the call's outputs). The replay host keeps the last value for each
+// op/key pair except for ReadVirtual, whose results are merged into a sparse
+// image of the target's memory so any read within recorded ranges is served.
+//
+//  Op                              Key                             Value
+//  ReadVirtual                     u64 address, u32 size           bytes read
+//  GetThreadContextBySystemId      u32 sysId, u32 flags, u32 size  context
+//  VirtualUnwind                   u32 threadId, context           unwound context
+//  GetNumberModules                                                u32 loaded, u32 unloaded
+//  GetModuleByIndex                u32 index                       u64 base
+//  GetModuleByModuleName           string name, u32 startIndex     u32 index, u64 base
+//  GetModuleByOffset               u64 offset, u32 startIndex      u32 index, u64 base
+//  GetModuleNames                  u32 index, u64 base             string image, string module
+//  GetModuleInfo                   u32 index                       u64 base, u64 size, u32 timestamp, u32 checksum
+//  GetModuleVersionInformation     u32 index, u64 base, string item    version info bytes
+//  GetNameByOffset                 u32 moduleIndex, u64 offset     u64 displacement, string name
+//  GetOffsetBySymbol               u32 moduleIndex, string name    u64 offset
+//  GetNumberThreads                                                u32 number
+//  GetThreadIdsByIndex             u32 index                       u32 id, u32 sysId
+//  GetCurrentProcessSystemId                                       u32 sysId
+//  GetCurrentThreadSystemId                                        u32 sysId
+//  GetThreadIdBySystemId           u32 sysId                       u32 id
+//  GetCoreClrDirectory                                             string directory
+//  GetExpression                   string expression               u64 value
+//
+// Strings are a u32 length followed by the characters without a terminator.
+
+#define SERVICES_RECORDING_SIGNATURE 0x43455253     // "SREC"
+#define SERVICES_RECORDING_VERSION 1
+
+enum class RecordingOp : uint32_t
+{
+    ReadVirtual = 1,
+    GetThreadContextBySystemId,
+    VirtualUnwind,
+    GetNumberModules,
+    GetModuleByIndex,
+    GetModuleByModuleName,
+    GetModuleByOffset,
+    GetModuleNames,
+    GetModuleInfo,
+    GetModuleVersionInformation,
+    GetNameByOffset,
+    GetOffsetBySymbol,
+    GetNumberThreads,
+    GetThreadIdsByIndex,
+    GetCurrentProcessSystemId,
+    GetCurrentThreadSystemId,
+    GetThreadIdBySystemId,
+    GetCoreClrDirectory,
+    GetExpression,
+};
+
+struct RecordingFileHeader
+{
+    uint32_t signature;
+    uint32_t version;
+    uint32_t processorType;         // IMAGE_FILE_MACHINE_*
+    uint32_t pageSize;
+    uint32_t operatingSystem;       // IDebuggerServices::OperatingSystem
+    uint32_t debugClass;
+    uint32_t debugQualifier;
+    uint32_t reserved;
+};
+
+struct RecordingEntryHeader
+{
+    uint32_t op;                    // RecordingOp
+    int32_t result;                 // HRESULT of the call
+    uint32_t keySize;
+    uint32_t valueSize;
+};
+
+// Builds the key or value of a recording entry
+class RecordingBuffer
+{
+    std::string m_data;
+
+public:
+    template <typename T>
+    RecordingBuffer& Add(T value)
+    {
+        m_data.append((const char*)&value, sizeof(T));
+        return *this;
+    }
+
+    RecordingBuffer& AddString(const char* str)
+    {
+        uint32_t length = str != nullptr ? (uint32_t)strlen(str) : 0;
+        Add(length);
+        m_data.append(str != nullptr ? str : "", length);
+        return *this;
+    }
+
+    RecordingBuffer& AddBytes(const void* data, uint32_t size)
+    {
+        m_data.append((const char*)data, size);
+        return *this;
+    }
+
+    const char* Data() const { return m_data.data(); }
+    uint32_t Size() const { return (uint32_t)m_data.size(); }
+    const std::string& String() const { return m_data; }
+};
+
+// Parses the key or value of a recording entry. Reads past the end fail and
+// leave the output untouched.
+class RecordingReader
+{
+    const char* m_data;
+    uint32_t m_size;
+    uint32_t m_position;
+
+public:
+    RecordingReader(const std::string& data) :
+        m_data(data.data()),
+        m_size((uint32_t)data.size()),
+        m_position(0)
+    {
+    }
+
+    template <typename T>
+    bool Read(T* value)
+    {
+        if (m_size - m_position < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(value, m_data + m_position, sizeof(T));
+        m_position += sizeof(T);
+        return true;
+    }
+
+    bool ReadString(std::string& str)
+    {
+        uint32_t length;
+        if (!Read(&length) || m_size - m_position < length)
+        {
+            return false;
+        }
+        str.assign(m_data + m_position, length);
+        m_position += length;
+        return true;
+    }
+
+    const char* Remaining() const { return m_data + m_position; }
+    uint32_t RemainingSize() const { return m_size - m_position; }
+};
@@ -13,6 +13,13 @@
 #define LONG_MAX      2147483647L
 #endif
 
+#define PAGE_NOACCESS                   0x01
+#define PAGE_READONLY                   0x02
+#define PAGE_READWRITE                  0x04
+#define PAGE_EXECUTE                    0x10
+#define PAGE_EXECUTE_READ               0x20
+#define PAGE_EXECUTE_READWRITE          0x40
+
 // Platform-specific library naming
 // 
 #ifdef __APPLE__
@@ -4,6 +4,7 @@
 #include <cstdarg>
 #include <cstdlib>
 #include <algorithm>
+#include <limits.h>
 #include <string.h>
 #include <string>
 #include <dlfcn.h>
@@ -26,6 +27,9 @@
 #undef PAGE_MASK
 #define PAGE_MASK (~(PAGE_SIZE-1))
 
+// Number of instructions decoded at once by Disassemble
+#define DISASM_BLOCK_INSTRUCTIONS 256
+
 char *g_coreclrDirectory = nullptr;
 char *g_pluginModuleDirectory = nullptr;
 
@@ -39,10 +43,12 @@ LLDBServices::LLDBServices(lldb::SBDebugger debugger) :
     m_processId(0),
     m_threadInfoInitialized(false),
     m_currentResult(nullptr),
-    m_sectionCacheStopId(UINT32_MAX)
+    m_outputBufferMask(DEBUG_OUTPUT_NORMAL),
+    m_bufferOutput(false),
+    m_sectionCacheStopId(UINT32_MAX),
+    m_disasmStopId(UINT32_MAX),
+    m_recorder(nullptr)
 {
-    ClearCache();
-
     lldb::SBProcess process = GetCurrentProcess();
     if (process.IsValid())
     {
@@ -52,6 +58,7 @@ LLDBServices::LLDBServices(lldb::SBDebugger debugger) :
 
 LLDBServices::~LLDBServices()
 {
+    StopRecording();
 }
 
 //----------------------------------------------------------------------------
@@ -77,6 +84,12 @@ LLDBServices::QueryInterface(
         AddRef();
         return S_OK;
     }
+    else if (InterfaceId == __uuidof(ILLDBServices3))
+    {
+        *Interface = static_cast<ILLDBServices3*>(this);
+        AddRef();
+        return S_OK;
+    }
     else if (InterfaceId == __uuidof(IDebuggerServices))
     {
         *Interface = static_cast<IDebuggerServices*>(this);
@@ -135,12 +148,30 @@ LLDBServices::GetCoreClrDirectory()
             }
         }
     }
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetCoreClrDirectory, g_coreclrDirectory != nullptr ? S_OK : E_FAIL,
+            RecordingBuffer(), RecordingBuffer().AddString(g_coreclrDirectory));
+    }
     return g_coreclrDirectory;
 }
 
 ULONG64
 LLDBServices::GetExpression(
     PCSTR exp)
+{
+    ULONG64 result = InternalGetExpression(exp);
+    if (m_recorder != nullptr && exp != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetExpression, S_OK, RecordingBuffer().AddString(exp), RecordingBuffer().Add((uint64_t)result));
+    }
+    return result;
+}
+
+// Internal function
+ULONG64
+LLDBServices::InternalGetExpression(
+    PCSTR exp)
 {
     if (exp == nullptr)
     {
@@ -201,6 +232,25 @@ LLDBServices::VirtualUnwind(
     DWORD threadID,
     ULONG32 contextSize,
     PBYTE context)
+{
+    if (m_recorder == nullptr || context == nullptr)
+    {
+        return InternalVirtualUnwind(threadID, contextSize, context);
+    }
+    // The context is unwound in place so the key is captured first
+    RecordingBuffer key;
+    key.Add((uint32_t)threadID).AddBytes(context, contextSize);
+    HRESULT hr = InternalVirtualUnwind(threadID, contextSize, context);
+    m_recorder->Record(RecordingOp::VirtualUnwind, hr, key, context, hr == S_OK ? contextSize : 0);
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalVirtualUnwind(
+    DWORD threadID,
+    ULONG32 contextSize,
+    PBYTE context)
 {
     lldb::SBProcess process;
     lldb::SBThread thread;
@@ -477,6 +527,8 @@ LLDBServices::Execute(
     PCSTR command,
     ULONG flags)
 {
+    // Keep the command's output in order with anything it buffered
+    FlushOutput();
     lldb::SBCommandReturnObject result;
     lldb::ReturnStatus status = m_interpreter.HandleCommand(command, result);
     return status <= lldb::eReturnStatusSuccessContinuingResult ? S_OK : E_FAIL;
@@ -572,6 +624,97 @@ LLDBServices::GetLastEventInformation(
     return S_OK;
 }
 
+//
+// Makes sure the instruction at offset is in the disassembly cache and returns
+// its index. On a miss a whole block of instructions starting at offset is
+// decoded with one ReadInstructions call and the raw bytes of the block are
+// read with one memory read. The cache is discarded when the target moves.
+//
+bool
+LLDBServices::EnsureDisassembly(
+    lldb::SBTarget& target,
+    ULONG64 offset,
+    size_t* pindex)
+{
+    if (m_disasmStopId != m_currentStopId)
+    {
+        m_disasmInstructions.Clear();
+        m_disasmAddresses.clear();
+        m_disasmBytes.clear();
+        m_disasmStopId = m_currentStopId;
+    }
+
+    if (!m_disasmAddresses.empty() && offset >= m_disasmAddresses.front() && offset <= m_disasmAddresses.back())
+    {
+        auto found = std::lower_bound(m_disasmAddresses.begin(), m_disasmAddresses.end(), offset);
+        if (found != m_disasmAddresses.end() && *found == offset)
+        {
+            *pindex = found - m_disasmAddresses.begin();
+            return true;
+        }
+        // The offset is in the middle of a cached instruction; decode from there
+    }
+
+    m_disasmInstructions.Clear();
+    m_disasmAddresses.clear();
+    m_disasmBytes.clear();
+
+    lldb::SBAddress address = target.ResolveLoadAddress(offset);
+    if (!address.IsValid())
+    {
+        return false;
+    }
+    // A block that runs into unreadable memory can fail to decode as a whole,
+    // so fall back to decoding just the instruction at the offset.
+    static const uint32_t blockSizes[] = { DISASM_BLOCK_INSTRUCTIONS, 1 };
+    lldb::SBInstructionList list;
+    ULONG64 end = offset;
+    for (uint32_t blockSize : blockSizes)
+    {
+        list = target.ReadInstructions(address, blockSize, "intel");
+        if (!list.IsValid() || list.GetSize() == 0)
+        {
+            continue;
+        }
+        size_t count = list.GetSize();
+        m_disasmAddresses.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            lldb::SBInstruction instruction = list.GetInstructionAtIndex(i);
+            ULONG64 instructionAddress = instruction.GetAddress().GetLoadAddress(target);
+            size_t size = instruction.GetByteSize();
+            // Stop at anything that doesn't follow the previous instruction
+            if (instructionAddress != end || size == 0)
+            {
+                break;
+            }
+            m_disasmAddresses.push_back(instructionAddress);
+            end += size;
+        }
+        if (!m_disasmAddresses.empty())
+        {
+            break;
+        }
+    }
+    if (m_disasmAddresses.empty())
+    {
+        return false;
+    }
+    m_disasmInstructions = list;
+
+    // Fetch the bytes of all the decoded instructions at once. If this fails
+    // Disassemble falls back to the bytes lldb captured with each instruction.
+    ULONG bytesRead = 0;
+    m_disasmBytes.resize(end - offset);
+    if (FAILED(ReadVirtual(offset, m_disasmBytes.data(), (ULONG)m_disasmBytes.size(), &bytesRead)) || bytesRead != m_disasmBytes.size())
+    {
+        m_disasmBytes.clear();
+    }
+
+    *pindex = 0;
+    return true;
+}
+
 HRESULT
 LLDBServices::Disassemble(
     ULONG64 offset,
@@ -581,16 +724,16 @@ LLDBServices::Disassemble(
     PULONG disassemblySize,
     PULONG64 endOffset)
 {
+    static const char hexDigits[] = "0123456789abcdef";
     lldb::SBInstruction instruction;
-    lldb::SBInstructionList list;
     lldb::SBTarget target;
-    lldb::SBAddress address;
     lldb::SBError error;
     lldb::SBData data;
-    std::string str;
+    BYTE instructionBytes[64];
+    const BYTE* bytes;
     HRESULT hr = S_OK;
     ULONG size = 0;
-    uint8_t byte;
+    size_t index = 0;
     int cch;
 
     // lldb doesn't expect sign-extended address
@@ -609,41 +752,43 @@ LLDBServices::Disassemble(
         hr = E_INVALIDARG;
         goto exit;
     }
-    address = target.ResolveLoadAddress(offset);
-    if (!address.IsValid())
-    {
-        hr = E_INVALIDARG;
-        goto exit;
-    }
-    list = target.ReadInstructions(address, 1, "intel");
-    if (!list.IsValid())
+    if (!EnsureDisassembly(target, offset, &index))
     {
         hr = E_FAIL;
         goto exit;
     }
-    instruction = list.GetInstructionAtIndex(0);
+    instruction = m_disasmInstructions.GetInstructionAtIndex(index);
     if (!instruction.IsValid())
     {
         hr = E_FAIL;
         goto exit;
     }
-    cch = snprintf(buffer, bufferSize, "%016llx ", (unsigned long long)offset);
-    buffer += cch;
-    bufferSize -= cch;
-
     size = instruction.GetByteSize();
-    data = instruction.GetData(target);
-    for (ULONG i = 0; i < size && bufferSize > 0; i++)
+
+    if (!m_disasmBytes.empty())
+    {
+        bytes = m_disasmBytes.data() + (m_disasmAddresses[index] - m_disasmAddresses[0]);
+    }
+    else
     {
-        byte = data.GetUnsignedInt8(error, i);
-        if (error.Fail())
+        data = instruction.GetData(target);
+        if (size > sizeof(instructionBytes) || data.ReadRawData(error, 0, instructionBytes, size) != size || error.Fail())
         {
             hr = E_FAIL;
             goto exit;
         }
-        cch = snprintf(buffer, bufferSize, "%02x", byte);
-        buffer += cch;
-        bufferSize -= cch;
+        bytes = instructionBytes;
+    }
+
+    cch = snprintf(buffer, bufferSize, "%016llx ", (unsigned long long)offset);
+    buffer += cch;
+    bufferSize -= cch;
+
+    for (ULONG i = 0; i < size && bufferSize > 2; i++)
+    {
+        *buffer++ = hexDigits[bytes[i] >> 4];
+        *buffer++ = hexDigits[bytes[i] & 0xf];
+        bufferSize -= 2;
     }
     // Pad the data bytes to 16 chars
     cch = size * 2;
@@ -784,6 +929,9 @@ LLDBServices::ReadVirtual(
     lldb::SBError error;
     size_t bytesRead = 0;
     ULONG64 nextPageStart;
+    ULONG64 startOffset = offset;
+    PVOID startBuffer = buffer;
+    ULONG startSize = bufferSize;
 
     // Reading 0 bytes must succeed
     if (bufferSize == 0)
@@ -856,6 +1004,11 @@ LLDBServices::ReadVirtual(
     }
 
 exit:
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Record(RecordingOp::ReadVirtual, bytesRead > 0 ? S_OK : E_FAIL,
+            RecordingBuffer().Add((uint64_t)startOffset).Add((uint32_t)startSize), startBuffer, (uint32_t)bytesRead);
+    }
     if (pbytesRead)
     {
         *pbytesRead = bytesRead;
@@ -1109,6 +1262,11 @@ LLDBServices::GetNameByOffset(
     str.append(1, '\0');
 
 exit:
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetNameByOffset, hr, RecordingBuffer().Add((uint32_t)moduleIndex).Add((uint64_t)offset),
+            RecordingBuffer().Add((uint64_t)disp).AddString(str.c_str()));
+    }
     if (nameSize)
     {
         *nameSize = str.length();
@@ -1142,6 +1300,10 @@ LLDBServices::GetNumberModules(
     numModules = target.GetNumModules();
 
 exit:
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetNumberModules, hr, RecordingBuffer(), RecordingBuffer().Add((uint32_t)numModules).Add((uint32_t)0));
+    }
     if (loaded)
     {
         *loaded = numModules;
@@ -1156,6 +1318,25 @@ exit:
 HRESULT LLDBServices::GetModuleByIndex(
     ULONG index,
     PULONG64 base)
+{
+    if (m_recorder == nullptr)
+    {
+        return InternalGetModuleByIndex(index, base);
+    }
+    ULONG64 moduleBase = 0;
+    HRESULT hr = InternalGetModuleByIndex(index, &moduleBase);
+    m_recorder->Record(RecordingOp::GetModuleByIndex, hr, RecordingBuffer().Add((uint32_t)index), RecordingBuffer().Add((uint64_t)moduleBase));
+    if (base)
+    {
+        *base = moduleBase;
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT LLDBServices::InternalGetModuleByIndex(
+    ULONG index,
+    PULONG64 base)
 {
     lldb::SBTarget target;
     lldb::SBModule module;
@@ -1190,6 +1371,34 @@ LLDBServices::GetModuleByModuleName(
     ULONG startIndex,
     PULONG index,
     PULONG64 base)
+{
+    if (m_recorder == nullptr)
+    {
+        return InternalGetModuleByModuleName(name, startIndex, index, base);
+    }
+    ULONG moduleIndex = 0;
+    ULONG64 moduleBase = 0;
+    HRESULT hr = InternalGetModuleByModuleName(name, startIndex, &moduleIndex, &moduleBase);
+    m_recorder->Record(RecordingOp::GetModuleByModuleName, hr, RecordingBuffer().AddString(name).Add((uint32_t)startIndex),
+        RecordingBuffer().Add((uint32_t)moduleIndex).Add((uint64_t)moduleBase));
+    if (index)
+    {
+        *index = moduleIndex;
+    }
+    if (base)
+    {
+        *base = moduleBase;
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetModuleByModuleName(
+    PCSTR name,
+    ULONG startIndex,
+    PULONG index,
+    PULONG64 base)
 {
     lldb::SBTarget target;
     lldb::SBModule module;
@@ -1247,6 +1456,34 @@ LLDBServices::GetModuleByOffset(
     ULONG startIndex,
     PULONG index,
     PULONG64 base)
+{
+    if (m_recorder == nullptr)
+    {
+        return InternalGetModuleByOffset(offset, startIndex, index, base);
+    }
+    ULONG moduleIndex = 0;
+    ULONG64 moduleBase = 0;
+    HRESULT hr = InternalGetModuleByOffset(offset, startIndex, &moduleIndex, &moduleBase);
+    m_recorder->Record(RecordingOp::GetModuleByOffset, hr, RecordingBuffer().Add((uint64_t)offset).Add((uint32_t)startIndex),
+        RecordingBuffer().Add((uint32_t)moduleIndex).Add((uint64_t)moduleBase));
+    if (index)
+    {
+        *index = moduleIndex;
+    }
+    if (base)
+    {
+        *base = moduleBase;
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetModuleByOffset(
+    ULONG64 offset,
+    ULONG startIndex,
+    PULONG index,
+    PULONG64 base)
 {
     lldb::SBTarget target;
     int numModules;
@@ -1313,6 +1550,37 @@ LLDBServices::GetModuleNames(
     PSTR loadedImageNameBuffer,
     ULONG loadedImageNameBufferSize,
     PULONG loadedImageNameSize)
+{
+    HRESULT hr = InternalGetModuleNames(index, base, imageNameBuffer, imageNameBufferSize, imageNameSize,
+        moduleNameBuffer, moduleNameBufferSize, moduleNameSize, loadedImageNameBuffer, loadedImageNameBufferSize, loadedImageNameSize);
+    if (m_recorder != nullptr)
+    {
+        // The caller's buffers may be missing or truncated so the names are recorded from a separate lookup
+        char imageName[PATH_MAX];
+        char moduleName[PATH_MAX];
+        imageName[0] = '\0';
+        moduleName[0] = '\0';
+        HRESULT hrRecord = InternalGetModuleNames(index, base, imageName, sizeof(imageName), nullptr, moduleName, sizeof(moduleName), nullptr, nullptr, 0, nullptr);
+        m_recorder->Record(RecordingOp::GetModuleNames, hrRecord, RecordingBuffer().Add((uint32_t)index).Add((uint64_t)base),
+            RecordingBuffer().AddString(imageName).AddString(moduleName));
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetModuleNames(
+    ULONG index,
+    ULONG64 base,
+    PSTR imageNameBuffer,
+    ULONG imageNameBufferSize,
+    PULONG imageNameSize,
+    PSTR moduleNameBuffer,
+    ULONG moduleNameBufferSize,
+    PULONG moduleNameSize,
+    PSTR loadedImageNameBuffer,
+    ULONG loadedImageNameBufferSize,
+    PULONG loadedImageNameSize)
 {
     lldb::SBTarget target;
     lldb::SBFileSpec fileSpec;
@@ -1583,6 +1851,19 @@ LLDBServices::GetModuleSize(
 HRESULT
 LLDBServices::GetCurrentProcessSystemId(
     PULONG sysId)
+{
+    HRESULT hr = InternalGetCurrentProcessSystemId(sysId);
+    if (m_recorder != nullptr && sysId != NULL)
+    {
+        m_recorder->Record(RecordingOp::GetCurrentProcessSystemId, hr, RecordingBuffer(), RecordingBuffer().Add((uint32_t)*sysId));
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetCurrentProcessSystemId(
+    PULONG sysId)
 {
     if (sysId == NULL)
     {
@@ -1643,6 +1924,19 @@ LLDBServices::SetCurrentThreadId(
 HRESULT
 LLDBServices::GetCurrentThreadSystemId(
     PULONG sysId)
+{
+    HRESULT hr = InternalGetCurrentThreadSystemId(sysId);
+    if (m_recorder != nullptr && sysId != NULL)
+    {
+        m_recorder->Record(RecordingOp::GetCurrentThreadSystemId, hr, RecordingBuffer(), RecordingBuffer().Add((uint32_t)*sysId));
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetCurrentThreadSystemId(
+    PULONG sysId)
 {
     if (sysId == NULL)
     {
@@ -1665,6 +1959,20 @@ LLDBServices::GetThreadIdBySystemId(
     ULONG sysId,
     PULONG threadId)
 {
+    HRESULT hr = InternalGetThreadIdBySystemId(sysId, threadId);
+    if (m_recorder != nullptr && threadId != NULL)
+    {
+        m_recorder->Record(RecordingOp::GetThreadIdBySystemId, hr, RecordingBuffer().Add((uint32_t)sysId), RecordingBuffer().Add((uint32_t)*threadId));
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetThreadIdBySystemId(
+    ULONG sysId,
+    PULONG threadId)
+{
 
     if (threadId == NULL)
     {
@@ -1720,6 +2028,11 @@ LLDBServices::GetThreadContextBySystemId(
     hr = S_OK;
 
 exit:
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetThreadContextBySystemId, hr,
+            RecordingBuffer().Add((uint32_t)sysId).Add((uint32_t)contextFlags).Add((uint32_t)contextSize), context, hr == S_OK ? contextSize : 0);
+    }
     return hr;
 }
 
@@ -2057,6 +2370,44 @@ HRESULT LLDBServices::GetModuleInfo(
     PULONG64 pSize,
     PULONG pTimestamp,
     PULONG pChecksum)
+{
+    if (m_recorder == nullptr)
+    {
+        return InternalGetModuleInfo(index, pBase, pSize, pTimestamp, pChecksum);
+    }
+    ULONG64 moduleBase = 0;
+    ULONG64 moduleSize = 0;
+    ULONG timestamp = 0;
+    ULONG checksum = 0;
+    HRESULT hr = InternalGetModuleInfo(index, &moduleBase, &moduleSize, &timestamp, &checksum);
+    m_recorder->Record(RecordingOp::GetModuleInfo, hr, RecordingBuffer().Add((uint32_t)index),
+        RecordingBuffer().Add((uint64_t)moduleBase).Add((uint64_t)moduleSize).Add((uint32_t)timestamp).Add((uint32_t)checksum));
+    if (pBase)
+    {
+        *pBase = moduleBase;
+    }
+    if (pSize)
+    {
+        *pSize = moduleSize;
+    }
+    if (pTimestamp)
+    {
+        *pTimestamp = timestamp;
+    }
+    if (pChecksum)
+    {
+        *pChecksum = checksum;
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT LLDBServices::InternalGetModuleInfo(
+    ULONG index,
+    PULONG64 pBase,
+    PULONG64 pSize,
+    PULONG pTimestamp,
+    PULONG pChecksum)
 {
     lldb::SBTarget target;
     lldb::SBModule module;
@@ -2105,6 +2456,25 @@ LLDBServices::GetModuleVersionInformation(
     PVOID buffer,
     ULONG bufferSize,
     PULONG versionInfoSize)
+{
+    HRESULT hr = InternalGetModuleVersionInformation(index, base, item, buffer, bufferSize, versionInfoSize);
+    if (m_recorder != nullptr && item != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetModuleVersionInformation, hr, RecordingBuffer().Add((uint32_t)index).Add((uint64_t)base).AddString(item),
+            buffer, hr == S_OK ? bufferSize : 0);
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetModuleVersionInformation(
+    ULONG index,
+    ULONG64 base,
+    PCSTR item,
+    PVOID buffer,
+    ULONG bufferSize,
+    PULONG versionInfoSize)
 {
     // Only support a narrow set of argument values
     if (index == DEBUG_ANY_ID || buffer == nullptr || versionInfoSize != nullptr)
@@ -2125,7 +2495,23 @@ LLDBServices::GetModuleVersionInformation(
     lldb::SBValue value;
     lldb::SBData data;
 
-    value = module.FindFirstGlobalVariable(target, "sccsid");
+    // The version string of a build never changes so it is only searched for once
+    std::string buildId;
+    const char* uuid = module.GetUUIDString();
+    if (uuid != nullptr)
+    {
+        buildId = uuid;
+        auto found = m_versionStrings.find(buildId);
+        if (found != m_versionStrings.end())
+        {
+            versionString = found->second.c_str();
+        }
+    }
+
+    if (versionString == nullptr)
+    {
+        value = module.FindFirstGlobalVariable(target, "sccsid");
+    }
     if (value.IsValid())
     {
         data = value.GetData();
@@ -2161,6 +2547,10 @@ LLDBServices::GetModuleVersionInformation(
     {
         return E_FAIL;
     }
+    if (!buildId.empty())
+    {
+        versionString = m_versionStrings.emplace(buildId, versionString).first->second.c_str();
+    }
 
     if (strcmp(item, "\\") == 0)
     {
@@ -2252,6 +2642,47 @@ LLDBServices::SetRuntimeLoadedCallback(
     return S_OK;
 }
 
+HRESULT
+LLDBServices::EnumerateMemoryRegions(
+    PFN_MEMORY_REGION_CALLBACK callback,
+    void* param)
+{
+    if (callback == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+    lldb::SBProcess process = GetCurrentProcess();
+    if (!process.IsValid())
+    {
+        return E_FAIL;
+    }
+    // Fetching the whole list at once is a single request to the process plugin
+    // instead of one GetMemoryRegionInfo round trip per region.
+    lldb::SBMemoryRegionInfoList regions = process.GetMemoryRegions();
+    uint32_t numRegions = regions.GetSize();
+    for (uint32_t ri = 0; ri < numRegions; ri++)
+    {
+        lldb::SBMemoryRegionInfo region;
+        if (!regions.GetMemoryRegionAtIndex(ri, region) || !region.IsMapped())
+        {
+            continue;
+        }
+        ULONG protect;
+        bool read = region.IsReadable();
+        bool write = region.IsWritable();
+        if (region.IsExecutable())
+        {
+            protect = write ? PAGE_EXECUTE_READWRITE : (read ? PAGE_EXECUTE_READ : PAGE_EXECUTE);
+        }
+        else
+        {
+            protect = write ? PAGE_READWRITE : (read ? PAGE_READONLY : PAGE_NOACCESS);
+        }
+        callback(param, region.GetRegionBase(), region.GetRegionEnd(), protect, region.GetName());
+    }
+    return S_OK;
+}
+
 //----------------------------------------------------------------------------
 // IDebuggerServices
 //----------------------------------------------------------------------------
@@ -2293,7 +2724,7 @@ public:
                char** arguments,
                lldb::SBCommandReturnObject &result)
     {
-        IHostServices* hostservices = GetHostServices();
+        IHostServices* hostservices = PluginExtensions::WaitForHostServices();
         if (hostservices == nullptr)
         {
             g_services->Output(DEBUG_OUTPUT_ERROR, "Unrecognized command '%s' because managed hosting failed or was disabled. See sethostruntime command for details.\n", m_commandName);
@@ -2365,10 +2796,39 @@ LLDBServices::AddCommand(
     return S_OK;
 }
 
+// The buffered output is written when it reaches this size or when it has
+// been held this long so long running commands still show their progress.
+#define OUTPUT_BUFFER_FLUSH_SIZE        (64 * 1024)
+#define OUTPUT_BUFFER_FLUSH_INTERVAL    std::chrono::milliseconds(250)
+
 void
 LLDBServices::OutputString(
     ULONG mask,
     PCSTR str)
+{
+    if (!m_bufferOutput)
+    {
+        WriteOutput(mask, str);
+        return;
+    }
+    if (mask != m_outputBufferMask)
+    {
+        FlushOutput();
+        m_outputBufferMask = mask;
+    }
+    m_outputBuffer.append(str);
+
+    if (m_outputBuffer.size() >= OUTPUT_BUFFER_FLUSH_SIZE ||
+        std::chrono::steady_clock::now() - m_outputFlushTime >= OUTPUT_BUFFER_FLUSH_INTERVAL)
+    {
+        FlushOutput();
+    }
+}
+
+void
+LLDBServices::WriteOutput(
+    ULONG mask,
+    PCSTR str)
 {
     if (m_currentResult != nullptr)
     {
@@ -2394,6 +2854,32 @@ LLDBServices::OutputString(
     }
 }
 
+void
+LLDBServices::BeginBufferedOutput()
+{
+    m_bufferOutput = true;
+    m_outputBufferMask = DEBUG_OUTPUT_NORMAL;
+    m_outputFlushTime = std::chrono::steady_clock::now();
+}
+
+void
+LLDBServices::EndBufferedOutput()
+{
+    FlushOutput();
+    m_bufferOutput = false;
+}
+
+void
+LLDBServices::FlushOutput()
+{
+    if (!m_outputBuffer.empty())
+    {
+        WriteOutput(m_outputBufferMask, m_outputBuffer.c_str());
+        m_outputBuffer.clear();
+    }
+    m_outputFlushTime = std::chrono::steady_clock::now();
+}
+
 HRESULT
 LLDBServices::GetNumberThreads(
     PULONG number)
@@ -2402,14 +2888,22 @@ LLDBServices::GetNumberThreads(
     {
         return E_INVALIDARG;
     }
+    HRESULT hr = S_OK;
     lldb::SBProcess process = GetCurrentProcess();
     if (!process.IsValid())
     {
         *number = 0;
-        return E_UNEXPECTED;
+        hr = E_UNEXPECTED;
     }
-    *number = process.GetNumThreads();
-    return S_OK;
+    else
+    {
+        *number = process.GetNumThreads();
+    }
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetNumberThreads, hr, RecordingBuffer(), RecordingBuffer().Add((uint32_t)*number));
+    }
+    return hr;
 }
 
 HRESULT
@@ -2418,6 +2912,41 @@ LLDBServices::GetThreadIdsByIndex(
     ULONG count,
     PULONG ids,
     PULONG sysIds)
+{
+    if (m_recorder == nullptr)
+    {
+        return InternalGetThreadIdsByIndex(start, count, ids, sysIds);
+    }
+    // The ids are stored at their thread index, not relative to start
+    std::vector<ULONG> threadIds(start + count);
+    std::vector<ULONG> threadSysIds(start + count);
+    HRESULT hr = InternalGetThreadIdsByIndex(start, count, threadIds.data(), threadSysIds.data());
+    if (SUCCEEDED(hr))
+    {
+        for (ULONG index = start; index < start + count; index++)
+        {
+            m_recorder->Record(RecordingOp::GetThreadIdsByIndex, hr, RecordingBuffer().Add((uint32_t)index),
+                RecordingBuffer().Add((uint32_t)threadIds[index]).Add((uint32_t)threadSysIds[index]));
+            if (ids != nullptr)
+            {
+                ids[index] = threadIds[index];
+            }
+            if (sysIds != nullptr)
+            {
+                sysIds[index] = threadSysIds[index];
+            }
+        }
+    }
+    return hr;
+}
+
+// Internal function
+HRESULT
+LLDBServices::InternalGetThreadIdsByIndex(
+    ULONG start,
+    ULONG count,
+    PULONG ids,
+    PULONG sysIds)
 {
     lldb::SBProcess process = GetCurrentProcess();
     if (!process.IsValid())
@@ -2537,6 +3066,11 @@ LLDBServices::GetOffsetBySymbol(
     }
     *offset = startAddress.GetLoadAddress(target);
 exit:
+    if (m_recorder != nullptr && offset != nullptr)
+    {
+        m_recorder->Record(RecordingOp::GetOffsetBySymbol, hr, RecordingBuffer().Add((uint32_t)moduleIndex).AddString(name),
+            RecordingBuffer().Add((uint64_t)(hr == S_OK ? *offset : 0)));
+    }
     return hr;
 }
 
@@ -3003,113 +3537,89 @@ LLDBServices::GetVersionStringFromSection(lldb::SBTarget& target, lldb::SBSectio
 }
 
 #define VersionLength 12
+#define VersionSearchChunkSize 0x10000
 static const char* g_versionString = "@(#)Version ";
 
-bool
-LLDBServices::SearchVersionString(
-    uint64_t address,
-    int32_t size,
-    char* versionBuffer,
-    int versionBufferSize)
+// Returns the first version marker in the buffer. memchr for the first character is
+// vectorized by the C library and the marker start is rare in data sections.
+static const BYTE*
+FindVersionMarker(const BYTE* start, size_t length)
 {
-    BYTE buffer[VersionLength];
-    ULONG cbBytesRead;
-    bool result;
-
-    ClearCache();
-
-    while (size > 0)
+    const BYTE* end = start + length;
+    const BYTE* current = start;
+    while ((size_t)(end - current) >= VersionLength)
     {
-        result = ReadVirtualCache(address, buffer, VersionLength, &cbBytesRead);
-        if (result && cbBytesRead >= VersionLength)
+        current = (const BYTE*)memchr(current, g_versionString[0], (end - current) - (VersionLength - 1));
+        if (current == nullptr)
         {
-            if (memcmp(buffer, g_versionString, VersionLength) == 0)
-            {
-                for (int i = 0; i < versionBufferSize; i++)
-                {
-                    // Now read the version string a char/byte at a time
-                    result = ReadVirtualCache(address, &versionBuffer[i], 1, &cbBytesRead);
-
-                    // Return not found if there are any failures or problems while reading the version string.
-                    if (!result || cbBytesRead < 1 || size <= 0) {
-                        break;
-                    }
-                    // Found the end of the string
-                    if (versionBuffer[i] == '\0') {
-                        return true;
-                    }
-                    address++;
-                    size--;
-                }
-                // Return not found if overflowed the versionBuffer (not finding a null).
-                break;
-            }
-            address++;
-            size--;
+            break;
         }
-        else
+        if (memcmp(current, g_versionString, VersionLength) == 0)
         {
-            address += VersionLength;
-            size -= VersionLength;
+            return current;
         }
+        current++;
     }
-
-    return false;
+    return nullptr;
 }
 
 bool
-LLDBServices::ReadVirtualCache(ULONG64 address, PVOID buffer, ULONG bufferSize, PULONG pcbBytesRead)
+LLDBServices::SearchVersionString(
+    uint64_t address,
+    int32_t size,
+    char* versionBuffer,
+    int versionBufferSize)
 {
-    if (bufferSize == 0)
+    if (size <= 0)
     {
-        return true;
-    }
-
-    if (bufferSize > CACHE_SIZE)
-    {
-        // Don't even try with the cache
-        return ReadVirtual(address, buffer, bufferSize, pcbBytesRead) == S_OK;
+        return false;
     }
+    ArrayHolder<BYTE> buffer = new BYTE[VersionSearchChunkSize + VersionLength];
+    uint64_t end = address + size;
+    size_t carry = 0;
 
-    if (!m_cacheValid || (address < m_startCache) || (address > (m_startCache + m_cacheSize - bufferSize)))
+    // Scan the section a chunk at a time. The last VersionLength - 1 bytes of each chunk are
+    // carried into the next one so a marker that straddles a chunk boundary is still found.
+    while (address < end)
     {
+        ULONG toRead = (ULONG)std::min<uint64_t>(VersionSearchChunkSize, end - address);
         ULONG cbBytesRead = 0;
+        if (ReadVirtual(address, buffer.GetPtr() + carry, toRead, &cbBytesRead) != S_OK)
+        {
+            cbBytesRead = 0;
+        }
+        size_t length = carry + cbBytesRead;
 
-        m_cacheValid = false;
-        m_startCache = address;
-
-        // Avoid an int overflow
-        if (m_startCache + CACHE_SIZE < m_startCache)
-            m_startCache = (ULONG64)(-CACHE_SIZE);
-
-        HRESULT hr = ReadVirtual(m_startCache, m_cache, CACHE_SIZE, &cbBytesRead);
-        if (hr != S_OK)
+        const BYTE* marker = FindVersionMarker(buffer, length);
+        if (marker != nullptr)
         {
+            // Read the whole version string at once; it has to be null terminated within
+            // the section and the version buffer.
+            uint64_t versionAddress = address - carry + (marker - buffer.GetPtr());
+            ULONG versionSize = (ULONG)std::min<uint64_t>(versionBufferSize, end - versionAddress);
+            ULONG cbVersionRead = 0;
+            if (ReadVirtual(versionAddress, versionBuffer, versionSize, &cbVersionRead) == S_OK &&
+                memchr(versionBuffer, '\0', cbVersionRead) != nullptr)
+            {
+                return true;
+            }
+            // Return not found if overflowed the versionBuffer (not finding a null).
             return false;
         }
 
-        m_cacheSize = cbBytesRead;
-        m_cacheValid = true;
-    }
-
-    // If the address is within the cache, copy the cached memory to the input buffer
-    LONG_PTR cacheOffset = address - m_startCache;
-    if (cacheOffset >= 0 && cacheOffset < CACHE_SIZE)
-    {
-        int size = std::min(bufferSize, m_cacheSize);
-        memcpy(buffer, (LPVOID)(m_cache + cacheOffset), size);
-
-        if (pcbBytesRead != NULL)
+        if (cbBytesRead < toRead)
         {
-            *pcbBytesRead = size;
+            // Skip the rest of the unreadable page and don't carry bytes across the gap
+            address = (address + cbBytesRead + PAGE_SIZE) & PAGE_MASK;
+            carry = 0;
+            continue;
         }
-    }
-    else
-    {
-        return false;
+        address += cbBytesRead;
+        carry = std::min(length, (size_t)(VersionLength - 1));
+        memmove(buffer.GetPtr(), buffer.GetPtr() + length - carry, carry);
     }
 
-    return true;
+    return false;
 }
 
 lldb::SBCommand
@@ -3152,7 +3662,13 @@ LLDBServices::ExecuteCommand(
         commandArguments.append(" ");
     }
     // Load and initialize the managed extensions and commands before we check the m_commands list.
+    // Native SOS and managed commands are already in the list so only wait for the background
+    // hosting for a command that isn't; it may be a managed command that couldn't be added.
     IHostServices* hostservices = GetHostServices();
+    if (hostservices == nullptr && m_commands.find(commandName) == m_commands.end())
+    {
+        hostservices = PluginExtensions::WaitForHostServices();
+    }
 
     // If the command is a native SOS or managed extension command execute it through the lldb command added.
     if (m_commands.find(commandName) != m_commands.end())
@@ -3219,3 +3735,44 @@ LLDBServices::InternalOutputVaList(
     }
     return result;
 }
+
+HRESULT
+LLDBServices::StartRecording(
+    const char* filePath)
+{
+    StopRecording();
+
+    RecordingFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.signature = SERVICES_RECORDING_SIGNATURE;
+    header.version = SERVICES_RECORDING_VERSION;
+
+    ULONG processorType = 0;
+    ULONG pageSize = 0;
+    ULONG debugClass = 0;
+    ULONG debugQualifier = 0;
+    IDebuggerServices::OperatingSystem operatingSystem = IDebuggerServices::OperatingSystem::Unknown;
+    GetProcessorType(&processorType);
+    GetPageSize(&pageSize);
+    GetDebuggeeType(&debugClass, &debugQualifier);
+    GetOperatingSystem(&operatingSystem);
+
+    header.processorType = processorType;
+    header.pageSize = pageSize;
+    header.operatingSystem = (uint32_t)operatingSystem;
+    header.debugClass = debugClass;
+    header.debugQualifier = debugQualifier;
+
+    m_recorder = ServicesRecorder::Create(filePath, header);
+    return m_recorder != nullptr ? S_OK : E_FAIL;
+}
+
+void
+LLDBServices::StopRecording()
+{
+    if (m_recorder != nullptr)
+    {
+        delete m_recorder;
+        m_recorder = nullptr;
+    }
+}
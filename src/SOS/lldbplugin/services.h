@@ -2,12 +2,12 @@
 // The .NET Foundation licenses this file to you under the MIT license.
 
 #include <cstdarg>
+#include <chrono>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
-#define CACHE_SIZE  4096
-
 // Cached module section range used by ReadVirtual to satisfy reads not
 // backed by the lldb process (e.g., code/text segments missing from a
 // MachO core). Lookup is via std::upper_bound on loadAddr.
@@ -18,7 +18,7 @@ struct SectionRange
     lldb::SBSection section;
 };
 
-class LLDBServices : public ILLDBServices, public ILLDBServices2, public IDebuggerServices
+class LLDBServices : public ILLDBServices, public ILLDBServices2, public ILLDBServices3, public IDebuggerServices
 {
 private:
     LONG m_ref;
@@ -34,14 +34,27 @@ private:
 
     lldb::SBCommandReturnObject *m_currentResult;
 
-    BYTE m_cache[CACHE_SIZE];
-    ULONG64 m_startCache;
-    bool m_cacheValid;
-    ULONG m_cacheSize;
+    // Output of the current native SOS command, written out in large chunks
+    std::string m_outputBuffer;
+    ULONG m_outputBufferMask;
+    bool m_bufferOutput;
+    std::chrono::steady_clock::time_point m_outputFlushTime;
+
+    // Runtime module version strings by build id (see GetModuleVersionInformation)
+    std::unordered_map<std::string, std::string> m_versionStrings;
 
     std::vector<SectionRange> m_sectionRanges;
     uint32_t m_sectionCacheStopId;
 
+    // Block of instructions decoded by the last Disassemble cache miss
+    lldb::SBInstructionList m_disasmInstructions;
+    std::vector<ULONG64> m_disasmAddresses;
+    std::vector<BYTE> m_disasmBytes;
+    uint32_t m_disasmStopId;
+
+    // Non-null while the sosrecord command is recording the services calls
+    ServicesRecorder* m_recorder;
+
     ULONG64 GetModuleBase(lldb::SBTarget& target, lldb::SBModule& module);
     ULONG64 GetModuleSize(lldb::SBTarget& target, ULONG64 baseAddress, lldb::SBModule& module);
     ULONG64 GetExpression(lldb::SBFrame& frame, lldb::SBError& error, PCSTR exp);
@@ -50,19 +63,30 @@ private:
 
     bool GetVersionStringFromSection(lldb::SBTarget& target, lldb::SBSection& section, char* versionBuffer);
     bool SearchVersionString(uint64_t address, int32_t size, char* versionBuffer, int versionBufferSize);
-    bool ReadVirtualCache(ULONG64 address, PVOID buffer, ULONG bufferSize, PULONG pcbBytesRead);
+
+    bool EnsureDisassembly(lldb::SBTarget& target, ULONG64 offset, size_t* pindex);
 
     void EnsureSectionRanges(lldb::SBTarget& target);
     bool ReadFromSectionCache(lldb::SBTarget& target, uint64_t offset, uint32_t size, void* buffer, lldb::SBError& error, size_t& bytesRead);
 
-    void ClearCache()
-    {
-        m_cacheValid = false;
-        m_cacheSize = CACHE_SIZE;
-    }
+    void WriteOutput(ULONG mask, PCSTR str);
 
     void LoadNativeSymbols(lldb::SBTarget target, lldb::SBModule module, PFN_MODULE_LOAD_CALLBACK callback);
 
+    ULONG64 InternalGetExpression(PCSTR exp);
+    HRESULT InternalVirtualUnwind(DWORD threadId, ULONG32 contextSize, PBYTE context);
+    HRESULT InternalGetModuleByIndex(ULONG index, PULONG64 base);
+    HRESULT InternalGetModuleByModuleName(PCSTR name, ULONG startIndex, PULONG index, PULONG64 base);
+    HRESULT InternalGetModuleByOffset(ULONG64 offset, ULONG startIndex, PULONG index, PULONG64 base);
+    HRESULT InternalGetModuleNames(ULONG index, ULONG64 base, PSTR imageNameBuffer, ULONG imageNameBufferSize, PULONG imageNameSize,
+        PSTR moduleNameBuffer, ULONG moduleNameBufferSize, PULONG moduleNameSize, PSTR loadedImageNameBuffer, ULONG loadedImageNameBufferSize, PULONG loadedImageNameSize);
+    HRESULT InternalGetModuleInfo(ULONG index, PULONG64 base, PULONG64 size, PULONG timestamp, PULONG checksum);
+    HRESULT InternalGetModuleVersionInformation(ULONG index, ULONG64 base, PCSTR item, PVOID buffer, ULONG bufferSize, PULONG versionInfoSize);
+    HRESULT InternalGetThreadIdsByIndex(ULONG start, ULONG count, PULONG ids, PULONG sysIds);
+    HRESULT InternalGetCurrentProcessSystemId(PULONG sysId);
+    HRESULT InternalGetCurrentThreadSystemId(PULONG sysId);
+    HRESULT InternalGetThreadIdBySystemId(ULONG sysId, PULONG threadId);
+
     void InitializeThreadInfo(lldb::SBProcess process);
     uint32_t GetProcessId(lldb::SBProcess process);
     uint32_t GetThreadId(lldb::SBThread thread);
@@ -363,6 +387,14 @@ public:
     HRESULT STDMETHODCALLTYPE SetRuntimeLoadedCallback(
         PFN_RUNTIME_LOADED_CALLBACK callback);
 
+    //----------------------------------------------------------------------------
+    // ILLDBServices3
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE EnumerateMemoryRegions(
+        PFN_MEMORY_REGION_CALLBACK callback,
+        void* param);
+
     //----------------------------------------------------------------------------
     // IDebuggerServices
     //----------------------------------------------------------------------------
@@ -458,5 +490,17 @@ public:
     void SetCurrentResult(lldb::SBCommandReturnObject *result) { m_currentResult = result; }
     void ClearCurrentResult() { m_currentResult = nullptr; }
 
+    // Buffers the output of a command until EndBufferedOutput, the buffer
+    // size threshold or the flush interval is reached.
+    void BeginBufferedOutput();
+    void EndBufferedOutput();
+    void FlushOutput();
+
     HRESULT InternalOutputVaList(ULONG mask, PCSTR format, va_list args);
+
+    // Starts writing the services calls and their results to a recording
+    // file for the sosreplay host; see servicesrecording.h.
+    HRESULT StartRecording(const char* filePath);
+    void StopRecording();
+    ServicesRecorder* Recorder() { return m_recorder; }
 };
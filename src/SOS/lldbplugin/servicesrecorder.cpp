@@ -0,0 +1,63 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "sosplugin.h"
+#include "servicesrecorder.h"
+
+// Recordings of a clrstack -all or gchandles run are tens of megabytes of
+// small reads; a large stdio buffer keeps the recording overhead down.
+#define RECORDING_BUFFER_SIZE (1024 * 1024)
+
+ServicesRecorder::ServicesRecorder(FILE* file) :
+    m_file(file),
+    m_entries(0),
+    m_bytes(0)
+{
+}
+
+ServicesRecorder::~ServicesRecorder()
+{
+    if (m_file != nullptr)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+ServicesRecorder*
+ServicesRecorder::Create(const char* filePath, const RecordingFileHeader& header)
+{
+    FILE* file = fopen(filePath, "wb");
+    if (file == nullptr)
+    {
+        return nullptr;
+    }
+    setvbuf(file, nullptr, _IOFBF, RECORDING_BUFFER_SIZE);
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        fclose(file);
+        return nullptr;
+    }
+    ServicesRecorder* recorder = new ServicesRecorder(file);
+    recorder->m_bytes = sizeof(header);
+    return recorder;
+}
+
+void
+ServicesRecorder::Record(RecordingOp op, HRESULT hr, const RecordingBuffer& key, const void* value, uint32_t valueSize)
+{
+    RecordingEntryHeader entry;
+    entry.op = (uint32_t)op;
+    entry.result = hr;
+    entry.keySize = key.Size();
+    entry.valueSize = value != nullptr ? valueSize : 0;
+
+    fwrite(&entry, sizeof(entry), 1, m_file);
+    fwrite(key.Data(), 1, entry.keySize, m_file);
+    if (entry.valueSize > 0)
+    {
+        fwrite(value, 1, entry.valueSize, m_file);
+    }
+    m_entries++;
+    m_bytes += sizeof(entry) + entry.keySize + entry.valueSize;
+}
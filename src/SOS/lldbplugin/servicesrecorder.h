@@ -0,0 +1,36 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <stdio.h>
+#include "servicesrecording.h"
+
+//-----------------------------------------------------------------------------------------
+// Writes the inputs and results of the debugger services calls SOS makes to a
+// recording file (see servicesrecording.h) that the sosreplay host serves back.
+//-----------------------------------------------------------------------------------------
+class ServicesRecorder
+{
+    FILE* m_file;
+    uint64_t m_entries;
+    uint64_t m_bytes;
+
+    ServicesRecorder(FILE* file);
+
+public:
+    ~ServicesRecorder();
+
+    // Creates the recording file and writes the header. Returns null on failure.
+    static ServicesRecorder* Create(const char* filePath, const RecordingFileHeader& header);
+
+    void Record(RecordingOp op, HRESULT hr, const RecordingBuffer& key, const void* value, uint32_t valueSize);
+
+    void Record(RecordingOp op, HRESULT hr, const RecordingBuffer& key, const RecordingBuffer& value)
+    {
+        Record(op, hr, key, value.Data(), value.Size());
+    }
+
+    uint64_t Entries() const { return m_entries; }
+    uint64_t Bytes() const { return m_bytes; }
+};
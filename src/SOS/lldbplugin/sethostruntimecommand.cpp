@@ -26,6 +26,17 @@ public:
 
         result.SetStatus(lldb::eReturnStatusSuccessFinishResult);
 
+        // Don't wait for the background hosting thread; the host runtime it is loading can't be changed
+        if (IsHostingInProgress())
+        {
+            result.Printf("The host runtime is still being loaded in the background (DOTNET_SOS_BACKGROUND_HOSTING)\n");
+            if (arguments != nullptr && arguments[0] != nullptr)
+            {
+                result.SetStatus(lldb::eReturnStatusFailed);
+            }
+            return result.Succeeded();
+        }
+
         if (arguments != nullptr && arguments[0] != nullptr)
         {
             if (IsHostingInitialized())
@@ -13,6 +13,10 @@ void *g_sosHandle = nullptr;
 // directory (legacy behavior).
 bool g_usePluginDirectory = true;
 
+// True if libsos was initialized without a host because the background hosting
+// was still loading. SetSosHost passes it the host once it is ready.
+static bool g_sosHostPending = false;
+
 class sosCommand : public lldb::SBCommandPluginInterface
 {
     const char *m_command;
@@ -56,6 +60,14 @@ public:
 
         LoadSos();
 
+        // Give SOS the host if the background hosting finished since it was loaded.
+        // GetHost calls SetSosHost if the hosting succeeded.
+        if (g_sosHostPending && !IsHostingInProgress())
+        {
+            GetHost();
+            g_sosHostPending = false;
+        }
+
         if (g_sosHandle != nullptr)
         {
             CommandFunc commandFunc = (CommandFunc)dlsym(g_sosHandle, sosCommand);
@@ -77,8 +89,10 @@ public:
                 }
                 g_services->FlushCheck();
                 g_services->SetCurrentResult(&result);
+                g_services->BeginBufferedOutput();
                 const char* sosArgs = str.c_str();
                 HRESULT hr = commandFunc(g_services, sosArgs);
+                g_services->EndBufferedOutput();
                 g_services->ClearCurrentResult();
                 if (hr != S_OK)
                 {
@@ -112,7 +126,11 @@ public:
                         InitializeFunc initializeFunc = (InitializeFunc)dlsym(g_sosHandle, SOSInitialize);
                         if (initializeFunc)
                         {
-                            HRESULT hr = initializeFunc(GetHost(), GetDebuggerServices());
+                            // Native SOS commands don't wait for the background hosting; SOS
+                            // uses its local host until SetSosHost passes it the host.
+                            IHost* host = GetHost();
+                            g_sosHostPending = host == nullptr && IsHostingInProgress();
+                            HRESULT hr = initializeFunc(host, GetDebuggerServices());
                             if (hr != S_OK)
                             {
                                 g_services->Output(DEBUG_OUTPUT_ERROR, SOSInitialize " failed %08x\n", hr);
@@ -152,6 +170,27 @@ public:
     }
 };
 
+// Passes the host to libsos if it was initialized without it while the
+// background hosting was still loading.
+void
+SetSosHost(IHost* host)
+{
+    if (!g_sosHostPending || g_sosHandle == nullptr)
+    {
+        return;
+    }
+    g_sosHostPending = false;
+    InitializeFunc initializeFunc = (InitializeFunc)dlsym(g_sosHandle, SOSInitialize);
+    if (initializeFunc)
+    {
+        HRESULT hr = initializeFunc(host, GetDebuggerServices());
+        if (hr != S_OK)
+        {
+            g_services->Output(DEBUG_OUTPUT_ERROR, SOSInitialize " failed %08x\n", hr);
+        }
+    }
+}
+
 bool
 sosCommandInitialize(lldb::SBDebugger debugger)
 {
@@ -194,6 +233,7 @@ sosCommandInitialize(lldb::SBDebugger debugger)
     g_services->AddCommand("eestack", new sosCommand("EEStack"), "Runs dumpstack on all threads in the process.");
     g_services->AddCommand("eeversion", new sosCommand("EEVersion"), "Displays information about the runtime and SOS versions.");
     g_services->AddCommand("ehinfo", new sosCommand("EHInfo"), "Displays the exception handling blocks in a JIT-ed method.");
+    g_services->AddCommand("exportilmap", new sosCommand("ExportILMap"), "Writes the IL to native maps, with source lines, of the jitted methods in a module to a file.");
     g_services->AddManagedCommand("finalizequeue", "Displays all objects registered for finalization.");
     g_services->AddCommand("findappdomain", new sosCommand("FindAppDomain"), "Attempts to resolve the AppDomain of a GC object.");
     g_services->AddCommand("findroots", new sosCommand("FindRoots"), "Finds and displays object roots across GC collections.");
@@ -218,6 +258,8 @@ sosCommandInitialize(lldb::SBDebugger debugger)
     g_services->AddCommand("pe", new sosCommand("PrintException"), "Displays and formats fields of any object derived from the Exception class at the specified address.");
     g_services->AddCommand("printexception", new sosCommand("PrintException"), "Displays and formats fields of any object derived from the Exception class at the specified address.");
     g_services->AddCommand("runtimes", new sosCommand("runtimes"), "Lists the runtimes in the target or change the default runtime.");
+    g_services->AddCommand("saveallmodules", new sosCommand("SaveAllModules"), "Saves every managed assembly in the target to a folder.");
+    g_services->AddCommand("savemodule", new sosCommand("SaveModule"), "Saves a managed assembly loaded in the target to a file.");
     g_services->AddCommand("stoponcatch", new sosCommand("StopOnCatch"), "Target process will break the next time a managed exception is caught during execution.");
     g_services->AddCommand("setclrpath", new sosCommand("SetClrPath"), "Sets the path to load the runtime DAC/DBI files.");
     g_services->AddManagedCommand("setsymbolserver", "Enables the symbol server support ");
@@ -231,5 +273,7 @@ sosCommandInitialize(lldb::SBDebugger debugger)
     g_services->AddManagedCommand("verifyheap", "Checks the GC heap for signs of corruption.");
     g_services->AddManagedCommand("verifyobj", "Checks the object that is passed as an argument for signs of corruption.");
     g_services->AddManagedCommand("traverseheap", "Writes out heap information to a file in a format understood by the CLR Profiler.");
+    g_services->AddCommand("vmmap", new sosCommand("VMMap"), "Lists the memory mappings of the target with their owner and resident size.");
+    g_services->AddCommand("vmstat", new sosCommand("VMStat"), "Summarizes the address space of the target by state, type and runtime owner.");
     return true;
 }
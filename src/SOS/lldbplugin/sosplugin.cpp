@@ -22,5 +22,7 @@ bool lldb::PluginInitialize(lldb::SBDebugger debugger)
     sosCommandInitialize(debugger);
     setsostidCommandInitialize(debugger);
     sethostruntimeCommandInitialize(debugger);
+    sosrecordCommandInitialize(debugger);
+    InitializeHostingInBackground();
     return true;
 }
@@ -11,6 +11,7 @@
 #include "dbgtargetcontext.h"
 #include "specialdiaginfo.h"
 #include "specialthreadinfo.h"
+#include "servicesrecorder.h"
 #include "services.h"
 
 #define SOSInitialize "SOSInitializeByHost"
@@ -30,6 +31,12 @@ setsostidCommandInitialize(lldb::SBDebugger debugger);
 bool
 sethostruntimeCommandInitialize(lldb::SBDebugger debugger);
 
+bool
+sosrecordCommandInitialize(lldb::SBDebugger debugger);
+
+void
+SetSosHost(IHost* host);
+
 //-----------------------------------------------------------------------------------------
 // Extension helper class
 //-----------------------------------------------------------------------------------------
@@ -61,16 +68,41 @@ public:
     /// <summary>
     /// Returns the host instance or null
     /// 
-    /// SOS.Extensions provides the instance via the InitializeHostServices callback
+    /// SOS.Extensions provides the instance via the InitializeHostServices callback. Returns null
+    /// without waiting while the background hosting thread is still loading the host runtime.
     /// </summary>
     IHost* GetHost()
     {
-        if (m_pHost == nullptr)
+        if (m_pHost == nullptr && !IsHostingInProgress())
         {
-            // If we can get the host instance from the client, initialize the hosting runtime which will
-            // call InitializeHostServices and give us a host instance.
-            InitializeHosting();
+            LoadHost();
         }
         return m_pHost;
     }
+
+    /// <summary>
+    /// Returns the host services or null, waiting for the background hosting thread if it
+    /// is still loading. Only the managed commands need to wait for it.
+    /// </summary>
+    static IHostServices* WaitForHostServices()
+    {
+        PluginExtensions* extensions = (PluginExtensions*)s_extensions;
+        if (extensions->m_pHost == nullptr)
+        {
+            extensions->LoadHost();
+        }
+        return extensions->GetHostServices();
+    }
+
+private:
+    void LoadHost()
+    {
+        // If we can get the host instance from the client, initialize the hosting runtime which will
+        // call InitializeHostServices and give us a host instance.
+        InitializeHosting();
+        if (m_pHost != nullptr)
+        {
+            SetSosHost(m_pHost);
+        }
+    }
 };
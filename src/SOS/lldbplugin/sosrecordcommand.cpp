@@ -0,0 +1,77 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include "sosplugin.h"
+#include <dlfcn.h>
+#include <string.h>
+#include <string>
+
+extern void *g_sosHandle;
+
+class sosrecordCommand : public lldb::SBCommandPluginInterface
+{
+public:
+    sosrecordCommand()
+    {
+    }
+
+    virtual bool
+    DoExecute(lldb::SBDebugger debugger,
+              char** arguments,
+              lldb::SBCommandReturnObject &result)
+    {
+        result.SetStatus(lldb::eReturnStatusSuccessFinishResult);
+
+        if (arguments == nullptr || arguments[0] == nullptr)
+        {
+            ServicesRecorder* recorder = g_services->Recorder();
+            if (recorder != nullptr)
+            {
+                result.Printf("Recording: %llu calls, %llu bytes\n", (unsigned long long)recorder->Entries(), (unsigned long long)recorder->Bytes());
+            }
+            else
+            {
+                result.Printf("Not recording\n");
+            }
+        }
+        else if (strcmp(arguments[0], "-stop") == 0)
+        {
+            ServicesRecorder* recorder = g_services->Recorder();
+            if (recorder != nullptr)
+            {
+                result.Printf("Recorded %llu calls, %llu bytes\n", (unsigned long long)recorder->Entries(), (unsigned long long)recorder->Bytes());
+            }
+            g_services->StopRecording();
+        }
+        else
+        {
+            if (FAILED(g_services->StartRecording(arguments[0])))
+            {
+                result.Printf("Could not create recording file %s\n", arguments[0]);
+                result.SetStatus(lldb::eReturnStatusFailed);
+                return result.Succeeded();
+            }
+
+            // Throw away what SOS has already read so the next commands read
+            // (and record) everything they need from the target.
+            if (g_sosHandle != nullptr)
+            {
+                CommandFunc flushFunc = (CommandFunc)dlsym(g_sosHandle, "SOSFlush");
+                if (flushFunc != nullptr)
+                {
+                    g_services->FlushCheck();
+                    flushFunc(g_services, "");
+                }
+            }
+            result.Printf("Recording the SOS services calls to %s\n", arguments[0]);
+        }
+        return result.Succeeded();
+    }
+};
+
+bool
+sosrecordCommandInitialize(lldb::SBDebugger debugger)
+{
+    g_services->AddCommand("sosrecord", new sosrecordCommand(), "Records the target data SOS commands read for the sosreplay benchmark host. sosrecord <file> | -stop");
+    return true;
+}
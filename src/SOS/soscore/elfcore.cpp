@@ -0,0 +1,424 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/procfs.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <unordered_map>
+#include "elfcore.h"
+
+#ifndef NT_FILE
+#define NT_FILE 0x46494c45
+#endif
+
+#define NOTE_ALIGN(size) (((size) + 3) & ~(uint64_t)3)
+
+// Maps the whole file read only. Returns nullptr on failure.
+static const char*
+MapFile(const char* path, uint64_t* size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    *size = st.st_size;
+    return (const char*)data;
+}
+
+ElfCoreFile::ElfCoreFile() :
+    m_data(nullptr),
+    m_size(0),
+    m_processId(0),
+    m_validateFile(nullptr),
+    m_validateFileContext(nullptr)
+{
+}
+
+ElfCoreFile::~ElfCoreFile()
+{
+    for (const CoreMappedFile& file : m_files)
+    {
+        if (file.data != nullptr)
+        {
+            munmap((void*)file.data, file.size);
+        }
+    }
+    if (m_data != nullptr)
+    {
+        munmap((void*)m_data, m_size);
+    }
+}
+
+bool
+ElfCoreFile::Open(const char* path)
+{
+    m_data = MapFile(path, &m_size);
+    if (m_data == nullptr)
+    {
+        fprintf(stderr, "Could not map %s\n", path);
+        return false;
+    }
+    if (m_size < sizeof(ElfW(Ehdr)))
+    {
+        fprintf(stderr, "%s is not an ELF core\n", path);
+        return false;
+    }
+    const ElfW(Ehdr)* ehdr = (const ElfW(Ehdr)*)m_data;
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_type != ET_CORE)
+    {
+        fprintf(stderr, "%s is not an ELF core\n", path);
+        return false;
+    }
+#if defined(__x86_64__)
+    const int machine = EM_X86_64;
+#elif defined(__aarch64__)
+    const int machine = EM_AARCH64;
+#else
+    const int machine = EM_NONE;
+#endif
+    if (ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_machine != machine)
+    {
+        fprintf(stderr, "%s is for a different architecture (e_machine %d)\n", path, ehdr->e_machine);
+        return false;
+    }
+    if (ehdr->e_phoff > m_size || (uint64_t)ehdr->e_phnum * sizeof(ElfW(Phdr)) > m_size - ehdr->e_phoff)
+    {
+        fprintf(stderr, "%s is truncated\n", path);
+        return false;
+    }
+
+    const ElfW(Phdr)* phdrs = (const ElfW(Phdr)*)(m_data + ehdr->e_phoff);
+    for (int i = 0; i < ehdr->e_phnum; i++)
+    {
+        const ElfW(Phdr)& phdr = phdrs[i];
+        if (phdr.p_type == PT_LOAD && phdr.p_memsz > 0)
+        {
+            CoreSegment segment;
+            segment.start = phdr.p_vaddr;
+            segment.end = phdr.p_vaddr + phdr.p_memsz;
+
+            // A core truncated by a ulimit still has the headers for the
+            // segments it didn't write.
+            uint64_t fileSize = 0;
+            if (phdr.p_offset < m_size)
+            {
+                fileSize = std::min((uint64_t)phdr.p_filesz, m_size - phdr.p_offset);
+            }
+            segment.fileSize = std::min(fileSize, (uint64_t)phdr.p_memsz);
+            segment.data = m_data + phdr.p_offset;
+            m_segments.push_back(segment);
+        }
+        else if (phdr.p_type == PT_NOTE)
+        {
+            if (!ParseNotes(phdr))
+            {
+                fprintf(stderr, "%s has invalid notes\n", path);
+                return false;
+            }
+        }
+    }
+    std::sort(m_segments.begin(), m_segments.end(), [](const CoreSegment& a, const CoreSegment& b) { return a.start < b.start; });
+    std::sort(m_fileMappings.begin(), m_fileMappings.end(), [](const CoreFileMapping& a, const CoreFileMapping& b) { return a.start < b.start; });
+    AddModules();
+    return true;
+}
+
+bool
+ElfCoreFile::ParseNotes(const ElfW(Phdr)& phdr)
+{
+    if (phdr.p_offset > m_size || phdr.p_filesz > m_size - phdr.p_offset)
+    {
+        return false;
+    }
+    const char* note = m_data + phdr.p_offset;
+    const char* end = note + phdr.p_filesz;
+    while (end - note >= (ptrdiff_t)sizeof(ElfW(Nhdr)))
+    {
+        const ElfW(Nhdr)* nhdr = (const ElfW(Nhdr)*)note;
+        const char* name = note + sizeof(ElfW(Nhdr));
+        const char* desc = name + NOTE_ALIGN(nhdr->n_namesz);
+        if (desc > end || nhdr->n_descsz > (uint64_t)(end - desc))
+        {
+            return false;
+        }
+        if (nhdr->n_namesz == sizeof("CORE") && strcmp(name, "CORE") == 0)
+        {
+            switch (nhdr->n_type)
+            {
+                case NT_PRSTATUS:
+                    if (nhdr->n_descsz >= sizeof(struct elf_prstatus))
+                    {
+                        struct elf_prstatus prstatus;
+                        memcpy(&prstatus, desc, sizeof(prstatus));
+                        m_threads.push_back({ (uint32_t)prstatus.pr_pid, desc, nhdr->n_descsz });
+                    }
+                    break;
+
+                case NT_PRPSINFO:
+                    if (nhdr->n_descsz >= sizeof(struct elf_prpsinfo))
+                    {
+                        struct elf_prpsinfo prpsinfo;
+                        memcpy(&prpsinfo, desc, sizeof(prpsinfo));
+                        m_processId = prpsinfo.pr_pid;
+                    }
+                    break;
+
+                case NT_FILE:
+                    ParseFileNote(desc, nhdr->n_descsz);
+                    break;
+            }
+        }
+        note = desc + NOTE_ALIGN(nhdr->n_descsz);
+    }
+    return true;
+}
+
+// The NT_FILE note is the mapping count and page size followed by a start,
+// end and page offset for each mapping, followed by the mappings' file names.
+void
+ElfCoreFile::ParseFileNote(const char* desc, uint64_t descSize)
+{
+    const uint64_t* header = (const uint64_t*)desc;
+    if (descSize < 2 * sizeof(uint64_t))
+    {
+        return;
+    }
+    uint64_t count = header[0];
+    uint64_t pageSize = header[1];
+    if (count > (descSize - 2 * sizeof(uint64_t)) / (3 * sizeof(uint64_t)))
+    {
+        return;
+    }
+    const uint64_t* entries = header + 2;
+    const char* name = (const char*)(entries + count * 3);
+    const char* end = desc + descSize;
+
+    std::unordered_map<std::string, uint32_t> fileIndexes;
+    for (uint64_t i = 0; i < count && name < end; i++)
+    {
+        size_t length = strnlen(name, end - name);
+        std::string path(name, length);
+        name += length + 1;
+
+        auto found = fileIndexes.find(path);
+        uint32_t fileIndex;
+        if (found != fileIndexes.end())
+        {
+            fileIndex = found->second;
+        }
+        else
+        {
+            fileIndex = (uint32_t)m_files.size();
+            fileIndexes.emplace(path, fileIndex);
+            m_files.push_back({ path, nullptr, 0, false });
+        }
+        CoreFileMapping mapping;
+        mapping.start = entries[i * 3];
+        mapping.end = entries[i * 3 + 1];
+        mapping.fileOffset = entries[i * 3 + 2] * pageSize;
+        mapping.fileIndex = fileIndex;
+        m_fileMappings.push_back(mapping);
+    }
+}
+
+// A module is each mapped file whose mapping of file offset 0 starts with an
+// ELF header. Its size covers all the file's mappings above that base.
+void
+ElfCoreFile::AddModules()
+{
+    std::vector<int64_t> moduleIndexes(m_files.size(), -1);
+    for (const CoreFileMapping& mapping : m_fileMappings)
+    {
+        if (mapping.fileOffset != 0 || moduleIndexes[mapping.fileIndex] != -1)
+        {
+            continue;
+        }
+        char ident[SELFMAG];
+        if (ReadMemory(mapping.start, ident, sizeof(ident)) != sizeof(ident) || memcmp(ident, ELFMAG, SELFMAG) != 0)
+        {
+            continue;
+        }
+        const std::string& path = m_files[mapping.fileIndex].path;
+        size_t slash = path.rfind('/');
+
+        CoreModule module;
+        module.path = path;
+        module.name = slash != std::string::npos ? path.substr(slash + 1) : path;
+        module.base = mapping.start;
+        module.size = 0;
+        module.fileIndex = mapping.fileIndex;
+        moduleIndexes[mapping.fileIndex] = m_modules.size();
+        m_modules.push_back(module);
+    }
+    for (const CoreFileMapping& mapping : m_fileMappings)
+    {
+        int64_t index = moduleIndexes[mapping.fileIndex];
+        if (index != -1 && mapping.start >= m_modules[index].base)
+        {
+            m_modules[index].size = std::max(m_modules[index].size, mapping.end - m_modules[index].base);
+        }
+    }
+    std::sort(m_modules.begin(), m_modules.end(), [](const CoreModule& a, const CoreModule& b) { return a.base < b.base; });
+}
+
+const char*
+ElfCoreFile::GetFileData(uint32_t fileIndex, uint64_t* size)
+{
+    CoreMappedFile& file = m_files[fileIndex];
+    if (!file.mapped)
+    {
+        // Only try once; the file may not exist on this machine
+        file.mapped = true;
+        file.data = MapFile(file.path.c_str(), &file.size);
+        if (file.data != nullptr && m_validateFile != nullptr)
+        {
+            uint64_t baseAddress = 0;
+            for (const CoreFileMapping& mapping : m_fileMappings)
+            {
+                if (mapping.fileIndex == fileIndex && mapping.fileOffset == 0)
+                {
+                    baseAddress = mapping.start;
+                    break;
+                }
+            }
+            if (!m_validateFile(m_validateFileContext, baseAddress, file.data, file.size))
+            {
+                fprintf(stderr, "Ignoring %s: it isn't the file mapped into the target\n", file.path.c_str());
+                munmap((void*)file.data, file.size);
+                file.data = nullptr;
+                file.size = 0;
+            }
+        }
+    }
+    *size = file.size;
+    return file.data;
+}
+
+void
+ElfCoreFile::SetFileValidator(ValidateFileCallback callback, void* context)
+{
+    m_validateFile = callback;
+    m_validateFileContext = context;
+}
+
+const char*
+ElfCoreFile::GetCorePointer(uint64_t address, uint64_t* available)
+{
+    // The last segment starting at or below the address
+    auto segment = std::upper_bound(m_segments.begin(), m_segments.end(), address,
+        [](uint64_t value, const CoreSegment& s) { return value < s.start; });
+    if (segment != m_segments.begin())
+    {
+        --segment;
+        if (address < segment->end)
+        {
+            uint64_t offset = address - segment->start;
+            if (offset < segment->fileSize)
+            {
+                *available = segment->fileSize - offset;
+                return segment->data + offset;
+            }
+        }
+    }
+    *available = 0;
+    return nullptr;
+}
+
+const char*
+ElfCoreFile::GetPointer(uint64_t address, uint64_t* available)
+{
+    const char* data = GetCorePointer(address, available);
+    if (data != nullptr)
+    {
+        return data;
+    }
+
+    // Not in the core; fall back to the file mapped at the address
+    auto mapping = std::upper_bound(m_fileMappings.begin(), m_fileMappings.end(), address,
+        [](uint64_t value, const CoreFileMapping& m) { return value < m.start; });
+    if (mapping != m_fileMappings.begin())
+    {
+        --mapping;
+        if (address < mapping->end)
+        {
+            uint64_t fileSize;
+            const char* fileData = GetFileData(mapping->fileIndex, &fileSize);
+            uint64_t fileOffset = mapping->fileOffset + (address - mapping->start);
+            if (fileData != nullptr && fileOffset < fileSize)
+            {
+                *available = std::min(fileSize - fileOffset, mapping->end - address);
+                return fileData + fileOffset;
+            }
+        }
+    }
+    *available = 0;
+    return nullptr;
+}
+
+uint32_t
+ElfCoreFile::ReadMemory(uint64_t address, void* buffer, uint32_t size)
+{
+    uint32_t read = 0;
+    while (read < size)
+    {
+        uint64_t available;
+        const char* data = GetPointer(address + read, &available);
+        if (data == nullptr)
+        {
+            break;
+        }
+        uint32_t length = (uint32_t)std::min((uint64_t)(size - read), available);
+        memcpy((char*)buffer + read, data, length);
+        read += length;
+    }
+    return read;
+}
+
+uint32_t
+ElfCoreFile::ReadCoreMemory(uint64_t address, void* buffer, uint32_t size)
+{
+    uint32_t read = 0;
+    while (read < size)
+    {
+        uint64_t available;
+        const char* data = GetCorePointer(address + read, &available);
+        if (data == nullptr)
+        {
+            break;
+        }
+        uint32_t length = (uint32_t)std::min((uint64_t)(size - read), available);
+        memcpy((char*)buffer + read, data, length);
+        read += length;
+    }
+    return read;
+}
+
+bool
+ElfCoreFile::GetThreadRegisters(const CoreThread& thread, void* regs, size_t size) const
+{
+    size_t offset = offsetof(struct elf_prstatus, pr_reg);
+    if (thread.prstatusSize < offset + size)
+    {
+        return false;
+    }
+    memcpy(regs, thread.prstatus + offset, size);
+    return true;
+}
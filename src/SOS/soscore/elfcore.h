@@ -0,0 +1,115 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <elf.h>
+#include <link.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A PT_LOAD segment of the core. The bytes past fileSize up to the end of the
+// segment weren't written to the core (filtered out by coredump_filter).
+struct CoreSegment
+{
+    uint64_t start;
+    uint64_t end;
+    uint64_t fileSize;
+    const char* data;
+};
+
+// A file mapping from the NT_FILE note
+struct CoreFileMapping
+{
+    uint64_t start;
+    uint64_t end;
+    uint64_t fileOffset;
+    uint32_t fileIndex;
+};
+
+// A file mapped into the target. The file is mapped into this process on the
+// first read the core itself can't satisfy.
+struct CoreMappedFile
+{
+    std::string path;
+    const char* data;
+    uint64_t size;
+    bool mapped;
+};
+
+struct CoreModule
+{
+    std::string path;
+    std::string name;
+    uint64_t base;
+    uint64_t size;
+    uint32_t fileIndex;
+};
+
+struct CoreThread
+{
+    uint32_t tid;
+    const char* prstatus;           // the NT_PRSTATUS note's elf_prstatus in the mapped core
+    uint64_t prstatusSize;
+};
+
+// Called the first time a mapped file is needed with the address the target
+// mapped its start at (0 if the core doesn't say) and the local file's
+// contents. Returning false leaves the file unused.
+typedef bool (*ValidateFileCallback)(void* context, uint64_t baseAddress, const char* data, uint64_t size);
+
+//
+// Memory maps an ELF core dump and indexes its PT_LOAD segments, NT_FILE
+// mappings and NT_PRSTATUS threads so target reads are a binary search and a
+// copy out of the mapping.
+//
+class ElfCoreFile
+{
+private:
+    const char* m_data;
+    uint64_t m_size;
+    uint32_t m_processId;
+    std::vector<CoreSegment> m_segments;            // sorted by start
+    std::vector<CoreFileMapping> m_fileMappings;    // sorted by start
+    std::vector<CoreMappedFile> m_files;
+    std::vector<CoreModule> m_modules;              // sorted by base
+    std::vector<CoreThread> m_threads;              // in note order, the faulting thread first
+    ValidateFileCallback m_validateFile;
+    void* m_validateFileContext;
+
+    bool ParseNotes(const ElfW(Phdr)& phdr);
+    void ParseFileNote(const char* desc, uint64_t descSize);
+    void AddModules();
+    const char* GetCorePointer(uint64_t address, uint64_t* available);
+
+public:
+    ElfCoreFile();
+    ~ElfCoreFile();
+
+    bool Open(const char* path);
+
+    // Returns a pointer to the bytes at the target address and the number of
+    // contiguous bytes available there, or nullptr if neither the core nor a
+    // mapped file has them.
+    const char* GetPointer(uint64_t address, uint64_t* available);
+
+    uint32_t ReadMemory(uint64_t address, void* buffer, uint32_t size);
+
+    // Like ReadMemory but only from the core, never from a mapped file
+    uint32_t ReadCoreMemory(uint64_t address, void* buffer, uint32_t size);
+
+    // Sets the check a local file has to pass before it backs any reads
+    void SetFileValidator(ValidateFileCallback callback, void* context);
+
+    // Returns the contents of a mapped file, or nullptr if it isn't on this machine
+    const char* GetFileData(uint32_t fileIndex, uint64_t* size);
+
+    uint32_t ProcessId() const { return m_processId; }
+    const std::vector<CoreModule>& Modules() const { return m_modules; }
+    const std::vector<CoreThread>& Threads() const { return m_threads; }
+
+    // Copies the thread's general purpose registers (the prstatus pr_reg)
+    // into regs, returning false if the note is too small
+    bool GetThreadRegisters(const CoreThread& thread, void* regs, size_t size) const;
+};
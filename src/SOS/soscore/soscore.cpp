@@ -0,0 +1,763 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Runs native SOS commands against a Linux ELF core dump without lldb:
+//
+//   soscore [-sos <libsos path>] <core> "<command> [args]" ...
+//
+// The core is memory mapped and served to libsos through a minimal
+// IDebuggerServices/ILLDBServices implementation. Memory the core doesn't
+// have (usually the modules' code and read only data) is read from the
+// files named in the core's NT_FILE note, so they need to be present at the
+// same paths on this machine, as does the runtime's DAC. A file whose build
+// id doesn't match the image in the core is ignored. The core has to be for
+// this machine's architecture.
+//
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/user.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mstypes.h"
+#define DEFINE_EXCEPTION_RECORD
+#include "lldbservices.h"
+#include "debuggerservices.h"
+#include "nativesoshost.h"
+#include "dbgtargetcontext.h"
+#include "elfreader.h"
+#include "elfcore.h"
+
+#define VERSION_STRING_PREFIX "@(#)Version "
+
+// Return what dbgeng returns for Linux modules that don't have a timestamp/checksum
+#define InvalidTimeStamp    0xFFFFFFFE
+#define InvalidChecksum     0xFFFFFFFF
+
+#define MAX_BUILDID_SIZE    64
+
+// Looks up the exported symbols or build id of a module through the core's
+// memory. With coreOnly it doesn't fall back to the local files.
+class CoreElfReader : public ElfReader
+{
+private:
+    ElfCoreFile& m_core;
+    bool m_coreOnly;
+
+public:
+    CoreElfReader(ElfCoreFile& core, bool coreOnly = false) :
+        ElfReader(false),
+        m_core(core),
+        m_coreOnly(coreOnly)
+    {
+    }
+
+private:
+    virtual bool ReadMemory(const void* address, void* buffer, size_t size)
+    {
+        uint32_t read = m_coreOnly ? m_core.ReadCoreMemory((uint64_t)address, buffer, (uint32_t)size) : m_core.ReadMemory((uint64_t)address, buffer, (uint32_t)size);
+        return read == size;
+    }
+};
+
+// Reads the build id of a memory mapped local file
+class MappedFileElfReader : public ElfReader
+{
+private:
+    const char* m_data;
+    uint64_t m_size;
+
+public:
+    MappedFileElfReader(const char* data, uint64_t size) :
+        ElfReader(true),
+        m_data(data),
+        m_size(size)
+    {
+    }
+
+private:
+    virtual bool ReadMemory(const void* address, void* buffer, size_t size)
+    {
+        uint64_t offset = (uint64_t)address;
+        if (offset > m_size || size > m_size - offset)
+        {
+            return false;
+        }
+        memcpy(buffer, m_data + offset, size);
+        return true;
+    }
+};
+
+// The local file named by the NT_FILE note is only used if its GNU build id
+// matches the one of the image in the core. Files without an ELF image in the
+// core (data files, managed assemblies) or whose notes weren't dumped have
+// nothing to compare against and are used as is.
+static bool
+ValidateMappedFile(void* context, uint64_t baseAddress, const char* data, uint64_t size)
+{
+    if (baseAddress == 0)
+    {
+        return true;
+    }
+    BYTE coreBuildId[MAX_BUILDID_SIZE];
+    ULONG coreBuildIdSize = 0;
+    CoreElfReader coreReader(*(ElfCoreFile*)context, true);
+    if (!coreReader.EnumerateProgramHeaders(baseAddress, nullptr, nullptr) ||
+        !coreReader.GetBuildId(coreBuildId, sizeof(coreBuildId), &coreBuildIdSize))
+    {
+        return true;
+    }
+    BYTE fileBuildId[MAX_BUILDID_SIZE];
+    ULONG fileBuildIdSize = 0;
+    MappedFileElfReader fileReader(data, size);
+    bool found = fileReader.EnumerateProgramHeaders(0, nullptr, nullptr) && fileReader.GetBuildId(fileBuildId, sizeof(fileBuildId), &fileBuildIdSize);
+    if (!found)
+    {
+        found = fileReader.GetBuildIdFromSectionHeader(0, fileBuildId, sizeof(fileBuildId), &fileBuildIdSize);
+    }
+    return found && fileBuildIdSize == coreBuildIdSize && memcmp(fileBuildId, coreBuildId, coreBuildIdSize) == 0;
+}
+
+class CoreServices : public NativeSOSHost
+{
+private:
+    ElfCoreFile& m_core;
+    ULONG m_currentThreadSystemId;
+    std::string m_coreclrDirectory;
+
+    // The symbol readers and version strings by module index, created on first use
+    std::vector<std::unique_ptr<CoreElfReader>> m_symbolReaders;
+    std::unordered_map<ULONG, std::string> m_versionStrings;
+
+    const CoreModule* GetModule(ULONG index)
+    {
+        const std::vector<CoreModule>& modules = m_core.Modules();
+        return index < modules.size() ? &modules[index] : nullptr;
+    }
+
+    // Searches the module's file for the runtime's "@(#)Version " string
+    const char* GetVersionString(ULONG index)
+    {
+        auto found = m_versionStrings.find(index);
+        if (found != m_versionStrings.end())
+        {
+            return found->second.empty() ? nullptr : found->second.c_str();
+        }
+        std::string& versionString = m_versionStrings[index];
+        const CoreModule* module = GetModule(index);
+        uint64_t size;
+        const char* data = module != nullptr ? m_core.GetFileData(module->fileIndex, &size) : nullptr;
+        if (data != nullptr)
+        {
+            const char* version = (const char*)memmem(data, size, VERSION_STRING_PREFIX, sizeof(VERSION_STRING_PREFIX) - 1);
+            if (version != nullptr)
+            {
+                versionString.assign(version, strnlen(version, data + size - version));
+            }
+        }
+        return versionString.empty() ? nullptr : versionString.c_str();
+    }
+
+public:
+    CoreServices(ElfCoreFile& core) :
+        m_core(core),
+        m_currentThreadSystemId(0)
+    {
+        if (!m_core.Threads().empty())
+        {
+            m_currentThreadSystemId = m_core.Threads()[0].tid;
+        }
+        m_symbolReaders.resize(m_core.Modules().size());
+    }
+
+    //----------------------------------------------------------------------------
+    // ILLDBServices
+    //----------------------------------------------------------------------------
+
+    PCSTR STDMETHODCALLTYPE GetCoreClrDirectory()
+    {
+        if (m_coreclrDirectory.empty())
+        {
+            for (const CoreModule& module : m_core.Modules())
+            {
+                if (module.name == MAKEDLLNAME_A("coreclr"))
+                {
+                    m_coreclrDirectory = module.path.substr(0, module.path.size() - module.name.size());
+                    break;
+                }
+            }
+        }
+        return m_coreclrDirectory.empty() ? nullptr : m_coreclrDirectory.c_str();
+    }
+
+    ULONG64 STDMETHODCALLTYPE GetExpression(
+        PCSTR exp)
+    {
+        // Only numbers; there are no symbols or registers to evaluate
+        return exp != nullptr ? strtoull(exp, nullptr, 0) : 0;
+    }
+
+    HRESULT STDMETHODCALLTYPE OutputVaList(
+        ULONG mask,
+        PCSTR format,
+        va_list args)
+    {
+        vprintf(format, args);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetDebuggeeType(
+        PULONG debugClass,
+        PULONG qualifier)
+    {
+        *debugClass = DEBUG_CLASS_USER_WINDOWS;
+        *qualifier = DEBUG_DUMP_FULL;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetPageSize(
+        PULONG size)
+    {
+        *size = getpagesize();
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetProcessorType(
+        PULONG type)
+    {
+#ifdef TARGET_AMD64
+        *type = IMAGE_FILE_MACHINE_AMD64;
+#elif TARGET_ARM64
+        *type = IMAGE_FILE_MACHINE_ARM64;
+#else
+#error "Unsupported target"
+#endif
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE ReadVirtual(
+        ULONG64 offset,
+        PVOID buffer,
+        ULONG bufferSize,
+        PULONG pbytesRead)
+    {
+        ULONG bytesRead = m_core.ReadMemory(offset, buffer, bufferSize);
+        if (pbytesRead)
+        {
+            *pbytesRead = bytesRead;
+        }
+        return bytesRead > 0 || bufferSize == 0 ? S_OK : E_FAIL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetNumberModules(
+        PULONG loaded,
+        PULONG unloaded)
+    {
+        if (loaded)
+        {
+            *loaded = (ULONG)m_core.Modules().size();
+        }
+        if (unloaded)
+        {
+            *unloaded = 0;
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleByIndex(
+        ULONG index,
+        PULONG64 base)
+    {
+        const CoreModule* module = GetModule(index);
+        if (module == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        if (base)
+        {
+            *base = module->base;
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleByModuleName(
+        PCSTR name,
+        ULONG startIndex,
+        PULONG index,
+        PULONG64 base)
+    {
+        const std::vector<CoreModule>& modules = m_core.Modules();
+        for (ULONG i = startIndex; name != nullptr && i < modules.size(); i++)
+        {
+            if (modules[i].name == name)
+            {
+                if (index)
+                {
+                    *index = i;
+                }
+                if (base)
+                {
+                    *base = modules[i].base;
+                }
+                return S_OK;
+            }
+        }
+        return E_INVALIDARG;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleByOffset(
+        ULONG64 offset,
+        ULONG startIndex,
+        PULONG index,
+        PULONG64 base)
+    {
+        const std::vector<CoreModule>& modules = m_core.Modules();
+        for (ULONG i = startIndex; i < modules.size(); i++)
+        {
+            if (offset >= modules[i].base && offset - modules[i].base < modules[i].size)
+            {
+                if (index)
+                {
+                    *index = i;
+                }
+                if (base)
+                {
+                    *base = modules[i].base;
+                }
+                return S_OK;
+            }
+        }
+        return E_FAIL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleNames(
+        ULONG index,
+        ULONG64 base,
+        PSTR imageNameBuffer,
+        ULONG imageNameBufferSize,
+        PULONG imageNameSize,
+        PSTR moduleNameBuffer,
+        ULONG moduleNameBufferSize,
+        PULONG moduleNameSize,
+        PSTR loadedImageNameBuffer,
+        ULONG loadedImageNameBufferSize,
+        PULONG loadedImageNameSize)
+    {
+        const CoreModule* module = nullptr;
+        if (index != DEBUG_ANY_ID)
+        {
+            module = GetModule(index);
+        }
+        else
+        {
+            ULONG moduleIndex;
+            if (SUCCEEDED(GetModuleByOffset(base, 0, &moduleIndex, nullptr)))
+            {
+                module = GetModule(moduleIndex);
+            }
+        }
+        if (module == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        CopyString(module->path, imageNameBuffer, imageNameBufferSize, imageNameSize);
+        CopyString(module->name, moduleNameBuffer, moduleNameBufferSize, moduleNameSize);
+        CopyString(module->path, loadedImageNameBuffer, loadedImageNameBufferSize, loadedImageNameSize);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetCurrentProcessSystemId(
+        PULONG id)
+    {
+        *id = m_core.ProcessId();
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetCurrentThreadId(
+        PULONG id)
+    {
+        return GetThreadIdBySystemId(m_currentThreadSystemId, id);
+    }
+
+    HRESULT STDMETHODCALLTYPE SetCurrentThreadId(
+        ULONG id)
+    {
+        const std::vector<CoreThread>& threads = m_core.Threads();
+        if (id == 0 || id > threads.size())
+        {
+            return E_FAIL;
+        }
+        m_currentThreadSystemId = threads[id - 1].tid;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetCurrentThreadSystemId(
+        PULONG sysId)
+    {
+        *sysId = m_currentThreadSystemId;
+        return m_currentThreadSystemId != 0 ? S_OK : E_FAIL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetThreadIdBySystemId(
+        ULONG sysId,
+        PULONG threadId)
+    {
+        // Thread ids are 1-based note order like lldb's thread index ids
+        const std::vector<CoreThread>& threads = m_core.Threads();
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            if (threads[i].tid == sysId)
+            {
+                *threadId = (ULONG)i + 1;
+                return S_OK;
+            }
+        }
+        *threadId = 0;
+        return E_FAIL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetThreadContextBySystemId(
+        ULONG32 sysId,
+        ULONG32 contextFlags,
+        ULONG32 contextSize,
+        PBYTE context)
+    {
+        if (context == NULL || contextSize < sizeof(DT_CONTEXT))
+        {
+            return E_FAIL;
+        }
+        const CoreThread* thread = nullptr;
+        for (const CoreThread& t : m_core.Threads())
+        {
+            if (t.tid == sysId)
+            {
+                thread = &t;
+                break;
+            }
+        }
+        struct user_regs_struct regs;
+        if (thread == nullptr || !m_core.GetThreadRegisters(*thread, &regs, sizeof(regs)))
+        {
+            return E_FAIL;
+        }
+        memset(context, 0, contextSize);
+        DT_CONTEXT* dtcontext = (DT_CONTEXT*)context;
+        dtcontext->ContextFlags = contextFlags;
+#ifdef TARGET_AMD64
+        dtcontext->Rip = regs.rip;
+        dtcontext->Rsp = regs.rsp;
+        dtcontext->Rbp = regs.rbp;
+        dtcontext->EFlags = regs.eflags;
+
+        dtcontext->Rax = regs.rax;
+        dtcontext->Rbx = regs.rbx;
+        dtcontext->Rcx = regs.rcx;
+        dtcontext->Rdx = regs.rdx;
+        dtcontext->Rsi = regs.rsi;
+        dtcontext->Rdi = regs.rdi;
+        dtcontext->R8 = regs.r8;
+        dtcontext->R9 = regs.r9;
+        dtcontext->R10 = regs.r10;
+        dtcontext->R11 = regs.r11;
+        dtcontext->R12 = regs.r12;
+        dtcontext->R13 = regs.r13;
+        dtcontext->R14 = regs.r14;
+        dtcontext->R15 = regs.r15;
+
+        dtcontext->SegCs = regs.cs;
+        dtcontext->SegSs = regs.ss;
+        dtcontext->SegDs = regs.ds;
+        dtcontext->SegEs = regs.es;
+        dtcontext->SegFs = regs.fs;
+        dtcontext->SegGs = regs.gs;
+#elif TARGET_ARM64
+        dtcontext->Pc = regs.pc;
+        dtcontext->Sp = regs.sp;
+        dtcontext->Lr = regs.regs[30];
+        dtcontext->Fp = regs.regs[29];
+        dtcontext->Cpsr = regs.pstate;
+        for (int i = 0; i < 29; i++)
+        {
+            dtcontext->X[i] = regs.regs[i];
+        }
+#endif
+        return S_OK;
+    }
+
+    //----------------------------------------------------------------------------
+    // ILLDBServices2
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE GetModuleInfo(
+        ULONG index,
+        PULONG64 moduleBase,
+        PULONG64 moduleSize,
+        PULONG timestamp,
+        PULONG checksum)
+    {
+        const CoreModule* module = GetModule(index);
+        if (module == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        if (moduleBase)
+        {
+            *moduleBase = module->base;
+        }
+        if (moduleSize)
+        {
+            *moduleSize = module->size;
+        }
+        if (timestamp)
+        {
+            *timestamp = InvalidTimeStamp;
+        }
+        if (checksum)
+        {
+            *checksum = InvalidChecksum;
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleVersionInformation(
+        ULONG index,
+        ULONG64 base,
+        PCSTR item,
+        PVOID buffer,
+        ULONG bufferSize,
+        PULONG versionInfoSize)
+    {
+        if (index == DEBUG_ANY_ID || item == nullptr || buffer == nullptr || versionInfoSize != nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        const char* versionString = GetVersionString(index);
+        if (versionString == nullptr)
+        {
+            return E_FAIL;
+        }
+        if (strcmp(item, "\\") == 0)
+        {
+            if (bufferSize < sizeof(VS_FIXEDFILEINFO))
+            {
+                return E_INVALIDARG;
+            }
+            DWORD major, minor, build, revision;
+            if (sscanf(versionString, VERSION_STRING_PREFIX "%u.%u.%u.%u", &major, &minor, &build, &revision) != 4)
+            {
+                return E_FAIL;
+            }
+            memset(buffer, 0, sizeof(VS_FIXEDFILEINFO));
+            ((VS_FIXEDFILEINFO*)buffer)->dwFileVersionMS = MAKELONG(minor, major);
+            ((VS_FIXEDFILEINFO*)buffer)->dwFileVersionLS = MAKELONG(revision, build);
+        }
+        else if (strcmp(item, "\\StringFileInfo\\040904B0\\FileVersion") == 0)
+        {
+            if (bufferSize < (strlen(versionString) - sizeof("@(#)Version")))
+            {
+                return E_INVALIDARG;
+            }
+            stpncpy((char*)buffer, versionString + sizeof("@(#)Version"), bufferSize);
+        }
+        else
+        {
+            return E_INVALIDARG;
+        }
+        return S_OK;
+    }
+
+    //----------------------------------------------------------------------------
+    // IDebuggerServices
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE GetOperatingSystem(
+        IDebuggerServices::OperatingSystem* operatingSystem)
+    {
+        *operatingSystem = IDebuggerServices::OperatingSystem::Linux;
+        return S_OK;
+    }
+
+    void STDMETHODCALLTYPE OutputString(
+        ULONG mask,
+        PCSTR message)
+    {
+        fputs(message, stdout);
+    }
+
+    HRESULT STDMETHODCALLTYPE GetNumberThreads(
+        PULONG number)
+    {
+        *number = (ULONG)m_core.Threads().size();
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetThreadIdsByIndex(
+        ULONG start,
+        ULONG count,
+        PULONG ids,
+        PULONG sysIds)
+    {
+        // Same indexing as the lldb plugin: the ids are stored at their thread index
+        const std::vector<CoreThread>& threads = m_core.Threads();
+        if (start >= threads.size() || start + count > threads.size())
+        {
+            return E_INVALIDARG;
+        }
+        for (ULONG index = start; index < start + count; index++)
+        {
+            if (ids != nullptr)
+            {
+                ids[index] = index + 1;
+            }
+            if (sysIds != nullptr)
+            {
+                sysIds[index] = threads[index].tid;
+            }
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetCurrentThreadSystemId(
+        ULONG sysId)
+    {
+        m_currentThreadSystemId = sysId;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetSymbolByOffset(
+        ULONG moduleIndex,
+        ULONG64 offset,
+        PSTR nameBuffer,
+        ULONG nameBufferSize,
+        PULONG nameSize,
+        PULONG64 displacement)
+    {
+        // Without the symbol files the best name is the module's
+        ULONG index;
+        if (FAILED(GetModuleByOffset(offset, 0, &index, nullptr)) || (moduleIndex != DEBUG_ANY_ID && moduleIndex != index))
+        {
+            return E_FAIL;
+        }
+        const CoreModule* module = GetModule(index);
+        CopyString(module->name, nameBuffer, nameBufferSize, nameSize);
+        if (displacement)
+        {
+            *displacement = offset - module->base;
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetOffsetBySymbol(
+        ULONG moduleIndex,
+        PCSTR name,
+        PULONG64 offset)
+    {
+        const CoreModule* module = GetModule(moduleIndex);
+        if (module == nullptr || name == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        std::unique_ptr<CoreElfReader>& reader = m_symbolReaders[moduleIndex];
+        if (reader == nullptr)
+        {
+            reader.reset(new CoreElfReader(m_core));
+            if (!reader->PopulateForSymbolLookup(module->base))
+            {
+                return E_FAIL;
+            }
+        }
+        uint64_t symbolOffset;
+        if (!reader->TryLookupSymbol(name, &symbolOffset))
+        {
+            return E_FAIL;
+        }
+        *offset = module->base + symbolOffset;
+        return S_OK;
+    }
+};
+
+static void
+Usage()
+{
+    fprintf(stderr, "Usage: soscore [-sos <libsos path>] <core> \"<command> [args]\" ...\n");
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string sosPath;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-sos") == 0 && arg + 1 < argc)
+        {
+            sosPath = argv[++arg];
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+    if (argc - arg < 2)
+    {
+        Usage();
+        return 1;
+    }
+    const char* corePath = argv[arg++];
+
+    // Default to the libsos installed next to this program
+    if (sosPath.empty())
+    {
+        char exePath[PATH_MAX];
+        ssize_t length = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+        if (length > 0)
+        {
+            exePath[length] = '\0';
+            sosPath = exePath;
+            sosPath.resize(sosPath.rfind('/') + 1);
+        }
+        sosPath.append(MAKEDLLNAME_A("sos"));
+    }
+
+    ElfCoreFile core;
+    if (!core.Open(corePath))
+    {
+        return 1;
+    }
+    core.SetFileValidator(ValidateMappedFile, &core);
+    CoreServices* services = new CoreServices(core);
+
+    NativeSOSLibrary sos;
+    if (!sos.Initialize(sosPath.c_str(), services))
+    {
+        return 1;
+    }
+
+    int result = 0;
+    for (; arg < argc; arg++)
+    {
+        std::string args;
+        CommandFunc commandFunc = sos.GetCommand(argv[arg], args);
+        if (commandFunc == nullptr)
+        {
+            result = 1;
+            continue;
+        }
+        HRESULT hr = commandFunc(services, args.c_str());
+        fflush(stdout);
+        if (hr != S_OK)
+        {
+            fprintf(stderr, "%s failed %08x\n", argv[arg], hr);
+            result = 1;
+        }
+    }
+    return result;
+}
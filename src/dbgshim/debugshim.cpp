@@ -18,6 +18,7 @@
 #include "winwrap.h"
 #ifndef HOST_WINDOWS
 #include <dlfcn.h>
+#include "libraryindex.h"
 #endif
 
 //*****************************************************************************
@@ -64,6 +65,8 @@ static HRESULT OpenCorDebugProcessWithProvider(
     IUnknown** ppProcess,
     CLR_DEBUGGING_PROCESS_FLAGS* pFlags);
 static VOID RetargetDacIfNeeded(DWORD* pdwTimeStamp, DWORD* pdwSizeOfImage);
+static bool LookupIndexedLibrary(const char* name, const void* id, ULONG idSize, LPWSTR* ppModulePath);
+static void AddIndexedLibrary(const char* name, const void* id, ULONG idSize, LPCWSTR modulePath);
 static HRESULT TryGetContractDescriptorAddress(
     ULONG64 moduleBaseAddress,
     IUnknown* pDataTarget,
@@ -511,29 +514,38 @@ static HRESULT ResolveLibraries(
         const WCHAR* wszRuntimeModulePath = !clrInfo.RuntimeModulePath.IsEmpty() ? clrInfo.RuntimeModulePath.GetUnicode() : NULL;
         if (clrInfo.WindowsTarget)
         {
-            if (resolveDbi &&
-                (FAILED(pLibraryProvider3->ProvideWindowsLibrary(
+            DWORD dbiIndexId[] = { clrInfo.DbiTimeStamp, clrInfo.DbiSizeOfImage };
+            DWORD dacIndexId[] = { clrInfo.DacTimeStamp, clrInfo.DacSizeOfImage };
+            if (resolveDbi && !LookupIndexedLibrary("dbi", dbiIndexId, sizeof(dbiIndexId), &pDbiModulePath))
+            {
+                if (FAILED(pLibraryProvider3->ProvideWindowsLibrary(
                     clrInfo.DbiName,
                     wszRuntimeModulePath,
                     clrInfo.IndexType,
                     clrInfo.DbiTimeStamp,
                     clrInfo.DbiSizeOfImage,
-                    &pDbiModulePath)) || pDbiModulePath == NULL))
-            {
-                hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
-                goto exit;
+                    &pDbiModulePath)) || pDbiModulePath == NULL)
+                {
+                    hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                    goto exit;
+                }
+                AddIndexedLibrary("dbi", dbiIndexId, sizeof(dbiIndexId), pDbiModulePath);
             }
             // Ask library provider for DAC
-            if (FAILED(pLibraryProvider3->ProvideWindowsLibrary(
-                clrInfo.DacName,
-                wszRuntimeModulePath,
-                clrInfo.IndexType,
-                clrInfo.DacTimeStamp,
-                clrInfo.DacSizeOfImage,
-                &pDacModulePath)) || pDacModulePath == NULL)
+            if (!LookupIndexedLibrary("dac", dacIndexId, sizeof(dacIndexId), &pDacModulePath))
             {
-                hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
-                goto exit;
+                if (FAILED(pLibraryProvider3->ProvideWindowsLibrary(
+                    clrInfo.DacName,
+                    wszRuntimeModulePath,
+                    clrInfo.IndexType,
+                    clrInfo.DacTimeStamp,
+                    clrInfo.DacSizeOfImage,
+                    &pDacModulePath)) || pDacModulePath == NULL)
+                {
+                    hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                    goto exit;
+                }
+                AddIndexedLibrary("dac", dacIndexId, sizeof(dacIndexId), pDacModulePath);
             }
         }
         else
@@ -574,29 +586,36 @@ static HRESULT ResolveLibraries(
                     hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
                     goto exit;
             }
-            if (resolveDbi &&
-                (FAILED(pLibraryProvider3->ProvideUnixLibrary(
+            if (resolveDbi && !LookupIndexedLibrary("dbi", dbiBuildId, dbiBuildIdSize, &pDbiModulePath))
+            {
+                if (FAILED(pLibraryProvider3->ProvideUnixLibrary(
                     clrInfo.DbiName,
                     wszRuntimeModulePath,
                     clrInfo.IndexType,
                     dbiBuildId,
                     dbiBuildIdSize,
-                    &pDbiModulePath)) || pDbiModulePath == NULL))
-            {
-                hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
-                goto exit;
+                    &pDbiModulePath)) || pDbiModulePath == NULL)
+                {
+                    hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                    goto exit;
+                }
+                AddIndexedLibrary("dbi", dbiBuildId, dbiBuildIdSize, pDbiModulePath);
             }
             // Ask library provider for DAC
-            if (FAILED(pLibraryProvider3->ProvideUnixLibrary(
-                clrInfo.DacName,
-                wszRuntimeModulePath,
-                clrInfo.IndexType,
-                dacBuildId,
-                dacBuildIdSize,
-                &pDacModulePath)) || pDacModulePath == NULL)
+            if (!LookupIndexedLibrary("dac", dacBuildId, dacBuildIdSize, &pDacModulePath))
             {
-                hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
-                goto exit;
+                if (FAILED(pLibraryProvider3->ProvideUnixLibrary(
+                    clrInfo.DacName,
+                    wszRuntimeModulePath,
+                    clrInfo.IndexType,
+                    dacBuildId,
+                    dacBuildIdSize,
+                    &pDacModulePath)) || pDacModulePath == NULL)
+                {
+                    hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                    goto exit;
+                }
+                AddIndexedLibrary("dac", dacBuildId, dacBuildIdSize, pDacModulePath);
             }
         }
     }
@@ -673,6 +692,51 @@ exit:
     return hr;
 }
 
+// Returns the module path the library provider resolved the library to in an
+// earlier session, from the index named by DOTNET_DEBUGGER_LIBRARY_INDEX.
+// The path is allocated like the library provider's.
+static bool LookupIndexedLibrary(const char* name, const void* id, ULONG idSize, LPWSTR* ppModulePath)
+{
+#ifdef HOST_UNIX
+    std::string path;
+    if (id == NULL || !LibraryIndexLookup(name, (const uint8_t*)id, idSize, path))
+    {
+        return false;
+    }
+    int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+    LPWSTR modulePath = length > 0 ? (LPWSTR)malloc(length * sizeof(WCHAR)) : NULL;
+    if (modulePath == NULL || MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, modulePath, length) == 0)
+    {
+        free(modulePath);
+        return false;
+    }
+    *ppModulePath = modulePath;
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Adds the module path the library provider resolved the library to
+static void AddIndexedLibrary(const char* name, const void* id, ULONG idSize, LPCWSTR modulePath)
+{
+#ifdef HOST_UNIX
+    if (id == NULL)
+    {
+        return;
+    }
+    int length = WideCharToMultiByte(CP_UTF8, 0, modulePath, -1, NULL, 0, NULL, NULL);
+    if (length > 0)
+    {
+        std::string path(length, '\0');
+        if (WideCharToMultiByte(CP_UTF8, 0, modulePath, -1, &path[0], length, NULL, NULL) != 0)
+        {
+            LibraryIndexAdd(name, (const uint8_t*)id, idSize, path.c_str());
+        }
+    }
+#endif
+}
+
 static HRESULT LoadResolvedLibraries(
     SString& dbiModulePath,
     SString& dacModulePath,
@@ -207,6 +207,20 @@ TryGetSymbolWithCallback(ReadMemoryCallback readMemory, uint64_t baseAddress, co
     return false;
 }
 
+//
+// Get the build id of the module with a read memory callback
+//
+extern "C" bool
+TryGetBuildIdWithCallback(ReadMemoryCallback readMemory, uint64_t baseAddress, BYTE* buffer, ULONG bufferSize, PULONG pBuildSize)
+{
+    ElfReaderWithCallback reader(readMemory);
+    if (reader.EnumerateProgramHeaders(baseAddress, nullptr, nullptr))
+    {
+        return reader.GetBuildId(buffer, bufferSize, pBuildSize);
+    }
+    return false;
+}
+
 class ElfReaderExport : public ElfReader
 {
 private:
@@ -0,0 +1,201 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unordered_map>
+#include "libraryindex.h"
+
+// Each line of the index file is "<key>\t<file size>\t<modified time>\t<path>\n"
+struct LibraryIndexEntry
+{
+    std::string path;
+    uint64_t size;
+    int64_t modifiedTime;
+};
+
+static pthread_mutex_t g_libraryIndexLock = PTHREAD_MUTEX_INITIALIZER;
+static std::unordered_map<std::string, LibraryIndexEntry> g_libraryIndex;
+
+// The index file's size and modification time when it was last read
+static bool g_libraryIndexRead = false;
+static uint64_t g_libraryIndexSize = 0;
+static int64_t g_libraryIndexModifiedTime = 0;
+
+static const char*
+GetLibraryIndexPath()
+{
+    const char* path = getenv("DOTNET_DEBUGGER_LIBRARY_INDEX");
+    return (path != nullptr && *path != '\0') ? path : nullptr;
+}
+
+static std::string
+GetLibraryIndexKey(const char* name, const uint8_t* id, size_t idSize)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string key(name);
+    key.push_back(':');
+    for (size_t i = 0; i < idSize; i++)
+    {
+        key.push_back(hex[id[i] >> 4]);
+        key.push_back(hex[id[i] & 0xf]);
+    }
+    return key;
+}
+
+static int64_t
+GetModifiedTime(const struct stat& st)
+{
+#if defined(__APPLE__)
+    return (int64_t)st.st_mtime * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st.st_mtime * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+static void
+ParseLibraryIndex(const std::string& contents)
+{
+    size_t start = 0;
+    while (start < contents.size())
+    {
+        size_t end = contents.find('\n', start);
+        if (end == std::string::npos)
+        {
+            // An entry still being appended by another process
+            break;
+        }
+        size_t tab1 = contents.find('\t', start);
+        size_t tab2 = tab1 < end ? contents.find('\t', tab1 + 1) : std::string::npos;
+        size_t tab3 = tab2 < end ? contents.find('\t', tab2 + 1) : std::string::npos;
+        if (tab3 < end)
+        {
+            LibraryIndexEntry entry;
+            entry.size = strtoull(contents.c_str() + tab1 + 1, nullptr, 10);
+            entry.modifiedTime = strtoll(contents.c_str() + tab2 + 1, nullptr, 10);
+            entry.path = contents.substr(tab3 + 1, end - tab3 - 1);
+            g_libraryIndex[contents.substr(start, tab1 - start)] = entry;
+        }
+        start = end + 1;
+    }
+}
+
+// Rereads the index file if another process added to it. Called with the lock held.
+static void
+RefreshLibraryIndex(const char* indexPath)
+{
+    struct stat st;
+    if (stat(indexPath, &st) != 0)
+    {
+        return;
+    }
+    if (g_libraryIndexRead && (uint64_t)st.st_size == g_libraryIndexSize && GetModifiedTime(st) == g_libraryIndexModifiedTime)
+    {
+        return;
+    }
+    int fd = open(indexPath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return;
+    }
+    std::string contents;
+    if (flock(fd, LOCK_SH) == 0)
+    {
+        if (fstat(fd, &st) == 0)
+        {
+            contents.resize(st.st_size);
+            ssize_t read = pread(fd, &contents[0], contents.size(), 0);
+            contents.resize(read > 0 ? read : 0);
+            g_libraryIndexRead = true;
+            g_libraryIndexSize = st.st_size;
+            g_libraryIndexModifiedTime = GetModifiedTime(st);
+        }
+        flock(fd, LOCK_UN);
+    }
+    close(fd);
+    ParseLibraryIndex(contents);
+}
+
+bool
+LibraryIndexLookup(const char* name, const uint8_t* id, size_t idSize, std::string& path)
+{
+    const char* indexPath = GetLibraryIndexPath();
+    if (indexPath == nullptr || idSize == 0)
+    {
+        return false;
+    }
+    std::string key = GetLibraryIndexKey(name, id, idSize);
+    LibraryIndexEntry entry;
+    bool found = false;
+
+    pthread_mutex_lock(&g_libraryIndexLock);
+    RefreshLibraryIndex(indexPath);
+    auto it = g_libraryIndex.find(key);
+    if (it != g_libraryIndex.end())
+    {
+        entry = it->second;
+        found = true;
+    }
+    pthread_mutex_unlock(&g_libraryIndexLock);
+
+    // The file was verified when it was added; make sure it wasn't replaced since
+    struct stat st;
+    if (!found || stat(entry.path.c_str(), &st) != 0 || (uint64_t)st.st_size != entry.size || GetModifiedTime(st) != entry.modifiedTime)
+    {
+        return false;
+    }
+    path = entry.path;
+    return true;
+}
+
+void
+LibraryIndexAdd(const char* name, const uint8_t* id, size_t idSize, const char* path)
+{
+    const char* indexPath = GetLibraryIndexPath();
+    if (indexPath == nullptr || idSize == 0 || strpbrk(path, "\t\n") != nullptr)
+    {
+        return;
+    }
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        return;
+    }
+    std::string key = GetLibraryIndexKey(name, id, idSize);
+    LibraryIndexEntry entry;
+    entry.path = path;
+    entry.size = st.st_size;
+    entry.modifiedTime = GetModifiedTime(st);
+
+    char numbers[64];
+    snprintf(numbers, sizeof(numbers), "\t%" PRIu64 "\t%" PRId64 "\t", entry.size, entry.modifiedTime);
+    std::string line = key + numbers + entry.path + "\n";
+
+    pthread_mutex_lock(&g_libraryIndexLock);
+    RefreshLibraryIndex(indexPath);
+    auto it = g_libraryIndex.find(key);
+    if (it == g_libraryIndex.end() || it->second.path != entry.path || it->second.size != entry.size || it->second.modifiedTime != entry.modifiedTime)
+    {
+        int fd = open(indexPath, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+        if (fd != -1)
+        {
+            if (flock(fd, LOCK_EX) == 0)
+            {
+                if (write(fd, line.c_str(), line.size()) == (ssize_t)line.size())
+                {
+                    g_libraryIndex[key] = entry;
+                }
+                flock(fd, LOCK_UN);
+            }
+            close(fd);
+        }
+    }
+    pthread_mutex_unlock(&g_libraryIndexLock);
+}
@@ -0,0 +1,27 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//
+// A persistent index of the debugger libraries (DAC, DBI and assemblies)
+// resolved on this machine. An entry maps a library name and the build id
+// (or PE timestamp and size) it was resolved for to the local file. It is
+// checked before any probing or symbol server download, so opening another
+// dump of the same runtime build goes straight to loading the library.
+//
+// The index is the file named by DOTNET_DEBUGGER_LIBRARY_INDEX and is only
+// used when that is set. Any number of processes can share it: entries are
+// appended under an exclusive lock and the last entry for a key wins.
+//
+
+// Returns the indexed path of the library if the file still has the size and
+// modification time it had when it was added.
+bool LibraryIndexLookup(const char* name, const uint8_t* id, size_t idSize, std::string& path);
+
+// Adds the path the library was resolved to
+void LibraryIndexAdd(const char* name, const uint8_t* id, size_t idSize, const char* path);
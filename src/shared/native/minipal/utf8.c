@@ -8,6 +8,25 @@
 #include <string.h>
 #include <assert.h>
 
+// MINIPAL_UTF8_NO_ASCII_FAST_PATH leaves out the vectorized ASCII fast path below so
+// the utf8bench micro-benchmark can time the general converters on their own.
+#if !BIGENDIAN && !defined(MINIPAL_UTF8_NO_ASCII_FAST_PATH)
+#define ASCII_FAST_PATH 1
+#else
+#define ASCII_FAST_PATH 0
+#endif
+
+#if ASCII_FAST_PATH
+#if defined(HOST_AMD64)
+#include <immintrin.h>
+#ifdef MINIPAL_UTF8_USE_CPUFEATURES
+#include "cpufeatures.h"
+#endif
+#elif defined(HOST_ARM64)
+#include <arm_neon.h>
+#endif
+#endif // ASCII_FAST_PATH
+
 #define HIGH_SURROGATE_START 0xd800
 #define HIGH_SURROGATE_END 0xdbff
 #define LOW_SURROGATE_START 0xdc00
@@ -2055,6 +2074,228 @@ static size_t GetByteCount(UTF8Encoding* self, CHAR16_T *chars, size_t count)
     return byteCount;
 }
 
+#if ASCII_FAST_PATH
+
+// ASCII fast path. Text handled by the debugger (type names, paths, metadata strings) is
+// overwhelmingly ASCII, and the decoder/encoder state machines above process it one code
+// unit at a time. The helpers below copy the leading run of ASCII code units with vector
+// instructions and stop at the first non-ASCII one, leaving the remainder (if any) to the
+// general converters. Splitting the input at an ASCII boundary never cuts a multi-byte
+// sequence or a surrogate pair, so the result is identical to converting the whole input.
+//
+// SSE2 is part of the AMD64 baseline and AdvSimd of the ARM64 baseline. On AMD64 the wider
+// AVX2 variants are selected at runtime through minipal_getcpufeatures when cpufeatures.c
+// is linked into the same binary (MINIPAL_UTF8_USE_CPUFEATURES).
+
+#if defined(HOST_AMD64) && defined(MINIPAL_UTF8_USE_CPUFEATURES)
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ASCII_TARGET_AVX2
+#else
+#define ASCII_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// -1: not yet determined, 0: SSE2, 1: AVX2. Racing initializations store the same value.
+static int s_asciiUseAvx2 = -1;
+
+static bool AsciiUseAvx2(void)
+{
+    int useAvx2 = s_asciiUseAvx2;
+    if (useAvx2 < 0)
+    {
+        useAvx2 = (minipal_getcpufeatures() & XArchIntrinsicConstants_Avx2) != 0 ? 1 : 0;
+        s_asciiUseAvx2 = useAvx2;
+    }
+    return useAvx2 != 0;
+}
+
+ASCII_TARGET_AVX2
+static size_t WidenAscii_Avx2(const unsigned char* src, CHAR16_T* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(v) != 0)
+            break;
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256((__m256i*)(dst + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+    }
+    return i;
+}
+
+ASCII_TARGET_AVX2
+static size_t NarrowAscii_Avx2(const CHAR16_T* src, unsigned char* dst, size_t count)
+{
+    const __m256i nonAsciiMask = _mm256_set1_epi16((short)0xFF80);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 16));
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), nonAsciiMask))
+            break;
+        // packus works within 128-bit lanes; restore the element order afterwards
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + i), packed);
+    }
+    return i;
+}
+
+ASCII_TARGET_AVX2
+static size_t CountAsciiBytes_Avx2(const unsigned char* src, size_t count)
+{
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        if (_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(src + i))) != 0)
+            break;
+    }
+    return i;
+}
+
+ASCII_TARGET_AVX2
+static size_t CountAsciiChars_Avx2(const CHAR16_T* src, size_t count)
+{
+    const __m256i nonAsciiMask = _mm256_set1_epi16((short)0xFF80);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        if (!_mm256_testz_si256(_mm256_loadu_si256((const __m256i*)(src + i)), nonAsciiMask))
+            break;
+    }
+    return i;
+}
+#endif // HOST_AMD64 && MINIPAL_UTF8_USE_CPUFEATURES
+
+// Copies the leading ASCII bytes of src to dst as UTF-16 and returns how many were copied.
+static size_t WidenAscii(const unsigned char* src, CHAR16_T* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(HOST_AMD64)
+#if defined(MINIPAL_UTF8_USE_CPUFEATURES)
+    if (AsciiUseAvx2())
+        i = WidenAscii_Avx2(src, dst, count);
+#endif
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(v) != 0)
+            break;
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+#elif defined(HOST_ARM64)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(src + i);
+        if (vmaxvq_u8(v) >= 0x80)
+            break;
+        vst1q_u16((uint16_t*)(dst + i), vmovl_u8(vget_low_u8(v)));
+        vst1q_u16((uint16_t*)(dst + i + 8), vmovl_high_u8(v));
+    }
+#endif
+    for (; i < count && src[i] < 0x80; i++)
+    {
+        dst[i] = (CHAR16_T)src[i];
+    }
+    return i;
+}
+
+// Copies the leading ASCII chars of src to dst as UTF-8 and returns how many were copied.
+static size_t NarrowAscii(const CHAR16_T* src, unsigned char* dst, size_t count)
+{
+    size_t i = 0;
+#if defined(HOST_AMD64)
+#if defined(MINIPAL_UTF8_USE_CPUFEATURES)
+    if (AsciiUseAvx2())
+        i = NarrowAscii_Avx2(src, dst, count);
+#endif
+    const __m128i nonAsciiMask = _mm_set1_epi16((short)0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 8));
+        __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAsciiMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+            break;
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(a, b));
+    }
+#elif defined(HOST_ARM64)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint16x8_t a = vld1q_u16((const uint16_t*)(src + i));
+        uint16x8_t b = vld1q_u16((const uint16_t*)(src + i + 8));
+        if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80)
+            break;
+        vst1q_u8(dst + i, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    }
+#endif
+    for (; i < count && src[i] < 0x80; i++)
+    {
+        dst[i] = (unsigned char)src[i];
+    }
+    return i;
+}
+
+// Returns the number of leading ASCII bytes in src.
+static size_t CountAsciiBytes(const unsigned char* src, size_t count)
+{
+    size_t i = 0;
+#if defined(HOST_AMD64)
+#if defined(MINIPAL_UTF8_USE_CPUFEATURES)
+    if (AsciiUseAvx2())
+        i = CountAsciiBytes_Avx2(src, count);
+#endif
+    for (; i + 16 <= count; i += 16)
+    {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(src + i))) != 0)
+            break;
+    }
+#elif defined(HOST_ARM64)
+    for (; i + 16 <= count; i += 16)
+    {
+        if (vmaxvq_u8(vld1q_u8(src + i)) >= 0x80)
+            break;
+    }
+#endif
+    while (i < count && src[i] < 0x80)
+        i++;
+    return i;
+}
+
+// Returns the number of leading ASCII chars in src.
+static size_t CountAsciiChars(const CHAR16_T* src, size_t count)
+{
+    size_t i = 0;
+#if defined(HOST_AMD64)
+#if defined(MINIPAL_UTF8_USE_CPUFEATURES)
+    if (AsciiUseAvx2())
+        i = CountAsciiChars_Avx2(src, count);
+#endif
+    const __m128i nonAsciiMask = _mm_set1_epi16((short)0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i high = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + i)), nonAsciiMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+            break;
+    }
+#elif defined(HOST_ARM64)
+    for (; i + 8 <= count; i += 8)
+    {
+        if (vmaxvq_u16(vld1q_u16((const uint16_t*)(src + i))) >= 0x80)
+            break;
+    }
+#endif
+    while (i < count && src[i] < 0x80)
+        i++;
+    return i;
+}
+
+#endif // ASCII_FAST_PATH
+
 size_t minipal_get_length_utf8_to_utf16(const char* source, size_t sourceLength, unsigned int flags)
 {
     errno = 0;
@@ -2071,7 +2312,18 @@ size_t minipal_get_length_utf8_to_utf16(const char* source, size_t sourceLength,
 #endif
     };
 
+#if ASCII_FAST_PATH
+    size_t asciiCount = CountAsciiBytes((const unsigned char*)source, sourceLength);
+    if (asciiCount == sourceLength)
+        return asciiCount;
+
+    size_t ret = asciiCount + GetCharCount(&enc, (unsigned char*)source + asciiCount, sourceLength - asciiCount);
+    if (errno) ret = 0;
+
+    return ret;
+#else
     return GetCharCount(&enc, (unsigned char*)source, sourceLength);
+#endif
 }
 
 size_t minipal_get_length_utf16_to_utf8(const CHAR16_T* source, size_t sourceLength, unsigned int flags)
@@ -2091,11 +2343,20 @@ size_t minipal_get_length_utf16_to_utf8(const CHAR16_T* source, size_t sourceLen
 #endif
     };
 
-#if !BIGENDIAN
+#if ASCII_FAST_PATH
     (void)flags; // unused
-#endif
 
+    size_t asciiCount = CountAsciiChars(source, sourceLength);
+    if (asciiCount == sourceLength)
+        return asciiCount;
+
+    size_t ret = asciiCount + GetByteCount(&enc, (CHAR16_T*)source + asciiCount, sourceLength - asciiCount);
+    if (errno) ret = 0;
+
+    return ret;
+#else
     return GetByteCount(&enc, (CHAR16_T*)source, sourceLength);
+#endif
 }
 
 size_t minipal_convert_utf8_to_utf16(const char* source, size_t sourceLength, CHAR16_T* destination, size_t destinationLength, unsigned int flags)
@@ -2115,7 +2376,22 @@ size_t minipal_convert_utf8_to_utf16(const char* source, size_t sourceLength, CH
 #endif
     };
 
+#if ASCII_FAST_PATH
+    size_t asciiCount = WidenAscii((const unsigned char*)source, destination,
+        sourceLength < destinationLength ? sourceLength : destinationLength);
+    if (asciiCount == sourceLength)
+        return asciiCount;
+
+    // Hand the last ASCII unit to the general converter as well; it reports a truncated
+    // trailing sequence differently depending on whether it has produced any output.
+    if (asciiCount > 0)
+        asciiCount--;
+
+    ret = asciiCount + GetChars(&enc, (unsigned char*)source + asciiCount, sourceLength - asciiCount,
+        destination + asciiCount, destinationLength - asciiCount);
+#else
     ret = GetChars(&enc, (unsigned char*)source, sourceLength, destination, destinationLength);
+#endif
     if (errno) ret = 0;
 
     return ret;
@@ -2139,11 +2415,24 @@ size_t minipal_convert_utf16_to_utf8(const CHAR16_T* source, size_t sourceLength
 #endif
     };
 
-#if !BIGENDIAN
+#if ASCII_FAST_PATH
     (void)flags; // unused
-#endif
 
+    size_t asciiCount = NarrowAscii(source, (unsigned char*)destination,
+        sourceLength < destinationLength ? sourceLength : destinationLength);
+    if (asciiCount == sourceLength)
+        return asciiCount;
+
+    // Hand the last ASCII unit to the general converter as well; it reports a truncated
+    // trailing sequence differently depending on whether it has produced any output.
+    if (asciiCount > 0)
+        asciiCount--;
+
+    ret = asciiCount + GetBytes(&enc, (CHAR16_T*)source + asciiCount, sourceLength - asciiCount,
+        (unsigned char*)destination + asciiCount, destinationLength - asciiCount);
+#else
     ret = GetBytes(&enc, (CHAR16_T*)source, sourceLength, (unsigned char*)destination, destinationLength);
+#endif
     if (errno) ret = 0;
 
     return ret;
@@ -0,0 +1,263 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+// Tests the parsing, appending and refreshing of the debugger library index
+// (libraryindex.cpp) through its public functions. Each test writes the index
+// file directly the way another process appending to it would, using its own
+// build id so the entries cached from earlier tests don't interfere.
+//
+// usage: libraryindextest
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include "libraryindex.h"
+
+static int s_failures = 0;
+static std::string s_directory;
+static std::string s_indexPath;
+
+#define CHECK(condition) \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: FAILED %s\n", __FUNCTION__, __LINE__, #condition); \
+        s_failures++; \
+    }
+
+// Creates a library file of the given size in the test directory
+static std::string
+CreateLibrary(const char* name, size_t size)
+{
+    std::string path = s_directory + "/" + name;
+    FILE* file = fopen(path.c_str(), "wb");
+    for (size_t i = 0; i < size; i++)
+    {
+        fputc('x', file);
+    }
+    fclose(file);
+    return path;
+}
+
+static void
+GetFileInfo(const std::string& path, uint64_t* size, int64_t* modifiedTime)
+{
+    struct stat st;
+    stat(path.c_str(), &st);
+    *size = st.st_size;
+#if defined(__APPLE__)
+    *modifiedTime = (int64_t)st.st_mtime * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    *modifiedTime = (int64_t)st.st_mtime * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+// Appends raw text to the index file
+static void
+AppendIndex(const std::string& text)
+{
+    FILE* file = fopen(s_indexPath.c_str(), "ab");
+    fwrite(text.c_str(), 1, text.size(), file);
+    fclose(file);
+}
+
+// Returns an index line for the library as LibraryIndexAdd writes it, without the newline
+static std::string
+IndexEntry(const char* key, const std::string& path)
+{
+    uint64_t size;
+    int64_t modifiedTime;
+    GetFileInfo(path, &size, &modifiedTime);
+    char numbers[64];
+    snprintf(numbers, sizeof(numbers), "\t%" PRIu64 "\t%" PRId64 "\t", size, modifiedTime);
+    return std::string(key) + numbers + path;
+}
+
+static std::string
+ReadIndex()
+{
+    std::string contents;
+    FILE* file = fopen(s_indexPath.c_str(), "rb");
+    if (file != nullptr)
+    {
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            contents.append(buffer, read);
+        }
+        fclose(file);
+    }
+    return contents;
+}
+
+static size_t
+CountOccurrences(const std::string& contents, const std::string& text)
+{
+    size_t count = 0;
+    for (size_t pos = contents.find(text); pos != std::string::npos; pos = contents.find(text, pos + 1))
+    {
+        count++;
+    }
+    return count;
+}
+
+static void
+TestPartialTrailingLine()
+{
+    const uint8_t id1[] = { 0x01, 0xab };
+    const uint8_t id2[] = { 0x02, 0xab };
+    std::string library1 = CreateLibrary("partial1.so", 10);
+    std::string library2 = CreateLibrary("partial2.so", 20);
+    std::string path;
+
+    // The second entry is still being appended by another process
+    AppendIndex(IndexEntry("dac:01ab", library1) + "\n" + IndexEntry("dac:02ab", library2));
+    CHECK(LibraryIndexLookup("dac", id1, sizeof(id1), path) && path == library1);
+    CHECK(!LibraryIndexLookup("dac", id2, sizeof(id2), path));
+
+    // Found once the line is complete
+    AppendIndex("\n");
+    CHECK(LibraryIndexLookup("dac", id2, sizeof(id2), path) && path == library2);
+}
+
+static void
+TestLastEntryWins()
+{
+    const uint8_t id[] = { 0x03, 0xcd };
+    std::string library1 = CreateLibrary("last1.so", 10);
+    std::string library2 = CreateLibrary("last2.so", 20);
+    std::string library3 = CreateLibrary("last3.so", 30);
+    std::string path;
+
+    AppendIndex(IndexEntry("dbi:03cd", library1) + "\n" + IndexEntry("dbi:03cd", library2) + "\n");
+    CHECK(LibraryIndexLookup("dbi", id, sizeof(id), path) && path == library2);
+
+    // An entry appended later by another process replaces the one already read
+    AppendIndex(IndexEntry("dbi:03cd", library3) + "\n");
+    CHECK(LibraryIndexLookup("dbi", id, sizeof(id), path) && path == library3);
+
+    // The name is part of the key
+    CHECK(!LibraryIndexLookup("dac", id, sizeof(id), path));
+}
+
+static void
+TestStaleEntries()
+{
+    const uint8_t idSize[] = { 0x04, 0xef };
+    const uint8_t idTime[] = { 0x05, 0xef };
+    const uint8_t idMissing[] = { 0x06, 0xef };
+    std::string library1 = CreateLibrary("stale1.so", 10);
+    std::string library2 = CreateLibrary("stale2.so", 10);
+    std::string library3 = CreateLibrary("stale3.so", 10);
+    std::string path;
+
+    AppendIndex(IndexEntry("dac:04ef", library1) + "\n" + IndexEntry("dac:05ef", library2) + "\n" + IndexEntry("dac:06ef", library3) + "\n");
+    CHECK(LibraryIndexLookup("dac", idSize, sizeof(idSize), path) && path == library1);
+    CHECK(LibraryIndexLookup("dac", idTime, sizeof(idTime), path) && path == library2);
+    CHECK(LibraryIndexLookup("dac", idMissing, sizeof(idMissing), path) && path == library3);
+
+    // Replaced with a file of another size
+    CreateLibrary("stale1.so", 11);
+    CHECK(!LibraryIndexLookup("dac", idSize, sizeof(idSize), path));
+
+    // Same size but modified since it was indexed
+    struct timespec times[2] = { { 0, UTIME_OMIT }, { 1000000000, 0 } };
+    CHECK(utimensat(AT_FDCWD, library2.c_str(), times, 0) == 0);
+    CHECK(!LibraryIndexLookup("dac", idTime, sizeof(idTime), path));
+
+    // Deleted
+    unlink(library3.c_str());
+    CHECK(!LibraryIndexLookup("dac", idMissing, sizeof(idMissing), path));
+}
+
+static void
+TestAdd()
+{
+    const uint8_t id[] = { 0x07, 0x12, 0x34 };
+    std::string library1 = CreateLibrary("add1.so", 10);
+    std::string library2 = CreateLibrary("add2.so", 20);
+    std::string path;
+
+    CHECK(!LibraryIndexLookup("assembly", id, sizeof(id), path));
+    LibraryIndexAdd("assembly", id, sizeof(id), library1.c_str());
+    CHECK(LibraryIndexLookup("assembly", id, sizeof(id), path) && path == library1);
+    CHECK(CountOccurrences(ReadIndex(), IndexEntry("assembly:071234", library1) + "\n") == 1);
+
+    // Adding the same entry again doesn't append it
+    LibraryIndexAdd("assembly", id, sizeof(id), library1.c_str());
+    CHECK(CountOccurrences(ReadIndex(), "assembly:071234\t") == 1);
+
+    // A new path for the key is appended and wins
+    LibraryIndexAdd("assembly", id, sizeof(id), library2.c_str());
+    CHECK(CountOccurrences(ReadIndex(), "assembly:071234\t") == 2);
+    CHECK(LibraryIndexLookup("assembly", id, sizeof(id), path) && path == library2);
+
+    // The library changed since it was indexed; adding it again refreshes the entry
+    CreateLibrary("add2.so", 21);
+    CHECK(!LibraryIndexLookup("assembly", id, sizeof(id), path));
+    LibraryIndexAdd("assembly", id, sizeof(id), library2.c_str());
+    CHECK(CountOccurrences(ReadIndex(), "assembly:071234\t") == 3);
+    CHECK(LibraryIndexLookup("assembly", id, sizeof(id), path) && path == library2);
+
+    // Paths that can't be stored in the index file are ignored, as are missing files
+    const uint8_t idInvalid[] = { 0x08, 0x12, 0x34 };
+    std::string tabPath = CreateLibrary("add\t3.so", 10);
+    LibraryIndexAdd("assembly", idInvalid, sizeof(idInvalid), tabPath.c_str());
+    LibraryIndexAdd("assembly", idInvalid, sizeof(idInvalid), (s_directory + "/missing.so").c_str());
+    CHECK(!LibraryIndexLookup("assembly", idInvalid, sizeof(idInvalid), path));
+    CHECK(CountOccurrences(ReadIndex(), "assembly:081234\t") == 0);
+}
+
+static void
+TestDisabled()
+{
+    const uint8_t id[] = { 0x09, 0x56 };
+    std::string library = CreateLibrary("disabled.so", 10);
+    std::string path;
+
+    unsetenv("DOTNET_DEBUGGER_LIBRARY_INDEX");
+    LibraryIndexAdd("dac", id, sizeof(id), library.c_str());
+    CHECK(!LibraryIndexLookup("dac", id, sizeof(id), path));
+    setenv("DOTNET_DEBUGGER_LIBRARY_INDEX", s_indexPath.c_str(), 1);
+    CHECK(CountOccurrences(ReadIndex(), "dac:0956\t") == 0);
+
+    // Entries need an id
+    LibraryIndexAdd("dac", id, 0, library.c_str());
+    CHECK(!LibraryIndexLookup("dac", id, 0, path));
+}
+
+int
+main(int argc, char* argv[])
+{
+    char directory[] = "/tmp/libraryindextest.XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+    {
+        fprintf(stderr, "mkdtemp FAILED\n");
+        return 1;
+    }
+    s_directory = directory;
+    s_indexPath = s_directory + "/index";
+    setenv("DOTNET_DEBUGGER_LIBRARY_INDEX", s_indexPath.c_str(), 1);
+
+    TestPartialTrailingLine();
+    TestLastEntryWins();
+    TestStaleEntries();
+    TestAdd();
+    TestDisabled();
+
+    std::string command = "rm -rf " + s_directory;
+    system(command.c_str());
+
+    if (s_failures > 0)
+    {
+        printf("%d check(s) FAILED\n", s_failures);
+        return 1;
+    }
+    printf("All tests passed\n");
+    return 0;
+}
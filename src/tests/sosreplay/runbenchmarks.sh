@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+# Licensed to the .NET Foundation under one or more agreements.
+# The .NET Foundation licenses this file to you under the MIT license.
+
+# Runs the native SOS command benchmarks against a sosrecord recording and
+# optionally compares the median times to a previous run's output.
+#
+#   runbenchmarks.sh <sosreplay> <libsos path> <recording> [<baseline output> [<threshold percent>]]
+#
+# To make a recording, load the dump in lldb and run:
+#
+#   (lldb) sosrecord /tmp/app.rec
+#   (lldb) clrstack -all
+#   (lldb) gchandles
+#   (lldb) clrthreads
+#   (lldb) dumpdomain
+#   (lldb) sosrecord -stop
+#
+# The run fails if a command reads memory or makes a debugger call the
+# recording doesn't have (the recording doesn't cover the command) or a median
+# is more than the threshold (default 10%) slower than the baseline.
+
+if [[ $# -lt 3 ]]; then
+    echo "Usage: $0 <sosreplay> <libsos path> <recording> [<baseline output> [<threshold percent>]]"
+    exit 1
+fi
+
+sosreplay="$1"
+libsos="$2"
+recording="$3"
+baseline="$4"
+threshold="${5:-10}"
+iterations="${SOS_BENCHMARK_ITERATIONS:-10}"
+
+commands=(
+    "ClrStack -all"
+    "GCHandles"
+    "Threads"
+    "DumpDomain"
+)
+
+output="$("$sosreplay" -q -n "$iterations" "$libsos" "$recording" "${commands[@]}")"
+result=$?
+echo "$output"
+if [[ $result -ne 0 ]]; then
+    exit $result
+fi
+
+# "<command>: <n> iterations min <ms> ms median <ms> ms max <ms> ms reads <n> missed reads <n> missed calls <n>"
+echo "$output" | awk -F': ' '
+    {
+        split($2, f, " ")
+        if (f[16] != 0) { print "error: " $1 " missed " f[16] " reads"; bad = 1 }
+        if (f[19] != 0) { print "error: " $1 " missed " f[19] " calls"; bad = 1 }
+    }
+    END { exit bad }' || exit 1
+
+if [[ -n "$baseline" ]]; then
+    echo "$output" | awk -F': ' -v threshold="$threshold" '
+        NR == FNR { split($2, f, " "); base[$1] = f[7]; next }
+        {
+            split($2, f, " ")
+            if (!($1 in base)) { next }
+            change = (f[7] - base[$1]) * 100 / base[$1]
+            printf "%s: median %.3f ms baseline %.3f ms (%+.1f%%)\n", $1, f[7], base[$1], change
+            if (change > threshold) { regressed = 1 }
+        }
+        END { if (regressed) { print "error: regressed more than " threshold "%"; exit 1 } }' "$baseline" -
+    exit $?
+fi
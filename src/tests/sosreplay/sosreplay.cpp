@@ -0,0 +1,949 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Replays a recording made with the lldb plugin's "sosrecord" command against
+// libsos so that native SOS commands can be timed deterministically without
+// lldb or the original target:
+//
+//   sosreplay [-q] [-warm] [-n <iterations>] <libsos path> <recording> "<command> [args]" ...
+//
+// Every command is run for the number of iterations, with the SOS caches
+// flushed (SOSFlush) before each run unless -warm is given. The runtime's DAC
+// is loaded from the path in the recording so the replay needs to run on a
+// machine that has the same runtime installed.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mstypes.h"
+#define DEFINE_EXCEPTION_RECORD
+#include "lldbservices.h"
+#include "debuggerservices.h"
+#include "nativesoshost.h"
+#include "servicesrecording.h"
+
+// Granularity of the replayed memory image
+#define REPLAY_PAGE_SIZE 0x1000
+#define REPLAY_PAGE_MASK (~((uint64_t)REPLAY_PAGE_SIZE - 1))
+
+struct ReplayPage
+{
+    // A bit per byte of the page that was recorded
+    uint64_t valid[REPLAY_PAGE_SIZE / 64];
+    char data[REPLAY_PAGE_SIZE];
+
+    void SetValid(uint32_t offset, uint32_t length)
+    {
+        for (uint32_t end = offset + length; offset < end; offset++)
+        {
+            valid[offset / 64] |= (uint64_t)1 << (offset % 64);
+        }
+    }
+
+    // Returns the number of recorded bytes starting at offset, up to the end of the page
+    uint32_t ValidLength(uint32_t offset) const
+    {
+        uint32_t end = offset;
+        while (end < REPLAY_PAGE_SIZE)
+        {
+            if ((end % 64) == 0 && valid[end / 64] == ~(uint64_t)0)
+            {
+                end += 64;
+            }
+            else if ((valid[end / 64] & ((uint64_t)1 << (end % 64))) != 0)
+            {
+                end++;
+            }
+            else
+            {
+                break;
+            }
+        }
+        return end - offset;
+    }
+};
+
+struct ReplayFailedRead
+{
+    uint64_t end;
+    HRESULT hr;
+};
+
+struct ReplayEntry
+{
+    HRESULT hr;
+    std::string value;
+};
+
+class ReplayServices : public NativeSOSHost
+{
+private:
+    RecordingFileHeader m_header;
+    bool m_quiet;
+
+    // The recorded reads merged into pages of the target's address space
+    std::unordered_map<uint64_t, ReplayPage*> m_pages;
+
+    // The recorded reads that failed by start address
+    std::map<uint64_t, ReplayFailedRead> m_failedReads;
+
+    // The last recorded result of everything else by op and key
+    std::unordered_map<std::string, ReplayEntry> m_entries;
+
+    // Thread index -> (id, system id) from the recorded GetThreadIdsByIndex calls
+    std::vector<std::pair<ULONG, ULONG>> m_threads;
+    ULONG m_currentThreadSystemId;
+    bool m_currentThreadSet;
+
+    std::string m_coreclrDirectory;
+
+    uint64_t m_reads;
+    uint64_t m_missedReads;
+    uint64_t m_missedCalls;
+
+    static std::string MakeKey(RecordingOp op, const RecordingBuffer& key)
+    {
+        std::string result((const char*)&op, sizeof(op));
+        result.append(key.String());
+        return result;
+    }
+
+    const ReplayEntry* Find(RecordingOp op, const RecordingBuffer& key)
+    {
+        auto found = m_entries.find(MakeKey(op, key));
+        if (found == m_entries.end())
+        {
+            m_missedCalls++;
+            return nullptr;
+        }
+        return &found->second;
+    }
+
+    void AddMemory(uint64_t address, const char* data, uint32_t size)
+    {
+        while (size > 0)
+        {
+            uint64_t pageAddress = address & REPLAY_PAGE_MASK;
+            uint32_t offset = (uint32_t)(address - pageAddress);
+            uint32_t length = std::min(size, REPLAY_PAGE_SIZE - offset);
+
+            ReplayPage*& page = m_pages[pageAddress];
+            if (page == nullptr)
+            {
+                page = new ReplayPage();
+                memset(page->valid, 0, sizeof(page->valid));
+            }
+            memcpy(page->data + offset, data, length);
+            page->SetValid(offset, length);
+
+            address += length;
+            data += length;
+            size -= length;
+        }
+    }
+
+    void AddFailedRead(uint64_t address, uint32_t size, HRESULT hr)
+    {
+        ReplayFailedRead& failedRead = m_failedReads[address];
+        failedRead.end = std::max(failedRead.end, address + std::max(size, (uint32_t)1));
+        failedRead.hr = hr;
+    }
+
+    // Returns the recorded failure of a read starting at the address or nullptr
+    const ReplayFailedRead* FindFailedRead(uint64_t address) const
+    {
+        auto found = m_failedReads.upper_bound(address);
+        if (found == m_failedReads.begin())
+        {
+            return nullptr;
+        }
+        --found;
+        return address < found->second.end ? &found->second : nullptr;
+    }
+
+    void AddEntry(const RecordingEntryHeader& entry, const std::string& key, std::string& value)
+    {
+        RecordingOp op = (RecordingOp)entry.op;
+        if (op == RecordingOp::ReadVirtual)
+        {
+            RecordingReader reader(key);
+            uint64_t address;
+            uint32_t size;
+            if (reader.Read(&address) && reader.Read(&size))
+            {
+                if (value.size() > 0)
+                {
+                    AddMemory(address, value.data(), (uint32_t)value.size());
+                }
+                else if (size > 0)
+                {
+                    AddFailedRead(address, size, FAILED(entry.result) ? entry.result : E_FAIL);
+                }
+            }
+            return;
+        }
+        if (op == RecordingOp::GetThreadIdsByIndex && SUCCEEDED(entry.result))
+        {
+            RecordingReader keyReader(key);
+            RecordingReader valueReader(value);
+            uint32_t index, id, sysId;
+            if (keyReader.Read(&index) && valueReader.Read(&id) && valueReader.Read(&sysId))
+            {
+                if (index >= m_threads.size())
+                {
+                    m_threads.resize(index + 1);
+                }
+                m_threads[index] = std::make_pair(id, sysId);
+            }
+        }
+        std::string entryKey((const char*)&op, sizeof(op));
+        entryKey.append(key);
+        ReplayEntry& replayEntry = m_entries[entryKey];
+        replayEntry.hr = entry.result;
+        replayEntry.value.swap(value);
+    }
+
+public:
+    ReplayServices(bool quiet) :
+        m_quiet(quiet),
+        m_currentThreadSystemId(0),
+        m_currentThreadSet(false),
+        m_reads(0),
+        m_missedReads(0),
+        m_missedCalls(0)
+    {
+        memset(&m_header, 0, sizeof(m_header));
+    }
+
+    ~ReplayServices()
+    {
+        for (auto& page : m_pages)
+        {
+            delete page.second;
+        }
+    }
+
+    bool Load(const char* filePath)
+    {
+        FILE* file = fopen(filePath, "rb");
+        if (file == nullptr)
+        {
+            fprintf(stderr, "Could not open recording %s\n", filePath);
+            return false;
+        }
+        bool result = false;
+        if (fread(&m_header, sizeof(m_header), 1, file) != 1 || m_header.signature != SERVICES_RECORDING_SIGNATURE)
+        {
+            fprintf(stderr, "%s is not a services recording\n", filePath);
+        }
+        else if (m_header.version != SERVICES_RECORDING_VERSION)
+        {
+            fprintf(stderr, "%s is version %u, expected %u\n", filePath, m_header.version, SERVICES_RECORDING_VERSION);
+        }
+        else
+        {
+            RecordingEntryHeader entry;
+            std::string key;
+            std::string value;
+            result = true;
+            while (fread(&entry, sizeof(entry), 1, file) == 1)
+            {
+                key.resize(entry.keySize);
+                value.resize(entry.valueSize);
+                if ((entry.keySize > 0 && fread(&key[0], entry.keySize, 1, file) != 1) ||
+                    (entry.valueSize > 0 && fread(&value[0], entry.valueSize, 1, file) != 1))
+                {
+                    fprintf(stderr, "%s is truncated\n", filePath);
+                    result = false;
+                    break;
+                }
+                AddEntry(entry, key, value);
+            }
+        }
+        fclose(file);
+        return result;
+    }
+
+    void SetQuiet(bool quiet) { m_quiet = quiet; }
+
+    void ResetCounters()
+    {
+        m_reads = 0;
+        m_missedReads = 0;
+        m_missedCalls = 0;
+    }
+
+    uint64_t Reads() const { return m_reads; }
+    uint64_t MissedReads() const { return m_missedReads; }
+    uint64_t MissedCalls() const { return m_missedCalls; }
+
+    //----------------------------------------------------------------------------
+    // ILLDBServices
+    //----------------------------------------------------------------------------
+
+    PCSTR STDMETHODCALLTYPE GetCoreClrDirectory()
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetCoreClrDirectory, RecordingBuffer());
+        if (entry == nullptr || FAILED(entry->hr))
+        {
+            return nullptr;
+        }
+        RecordingReader reader(entry->value);
+        if (!reader.ReadString(m_coreclrDirectory))
+        {
+            return nullptr;
+        }
+        return m_coreclrDirectory.c_str();
+    }
+
+    ULONG64 STDMETHODCALLTYPE GetExpression(
+        PCSTR exp)
+    {
+        if (exp == nullptr)
+        {
+            return 0;
+        }
+        const ReplayEntry* entry = Find(RecordingOp::GetExpression, RecordingBuffer().AddString(exp));
+        uint64_t value = 0;
+        if (entry != nullptr)
+        {
+            RecordingReader(entry->value).Read(&value);
+        }
+        return value;
+    }
+
+    HRESULT STDMETHODCALLTYPE VirtualUnwind(
+        DWORD threadId,
+        ULONG32 contextSize,
+        PBYTE context)
+    {
+        if (context == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        const ReplayEntry* entry = Find(RecordingOp::VirtualUnwind, RecordingBuffer().Add((uint32_t)threadId).AddBytes(context, contextSize));
+        if (entry == nullptr)
+        {
+            return E_FAIL;
+        }
+        if (entry->hr == S_OK)
+        {
+            memcpy(context, entry->value.data(), std::min((size_t)contextSize, entry->value.size()));
+        }
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE OutputVaList(
+        ULONG mask,
+        PCSTR format,
+        va_list args)
+    {
+        // Always format so the replayed command does the same work it does under lldb
+        char str[1024];
+        int length = vsnprintf(str, sizeof(str), format, args);
+        if (!m_quiet && length >= 0)
+        {
+            fputs(str, stdout);
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetDebuggeeType(
+        PULONG debugClass,
+        PULONG qualifier)
+    {
+        *debugClass = m_header.debugClass;
+        *qualifier = m_header.debugQualifier;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetPageSize(
+        PULONG size)
+    {
+        *size = m_header.pageSize;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetProcessorType(
+        PULONG type)
+    {
+        *type = m_header.processorType;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE ReadVirtual(
+        ULONG64 offset,
+        PVOID buffer,
+        ULONG bufferSize,
+        PULONG pbytesRead)
+    {
+        ULONG bytesRead = 0;
+        m_reads++;
+
+        while (bytesRead < bufferSize)
+        {
+            uint64_t pageAddress = offset & REPLAY_PAGE_MASK;
+            auto found = m_pages.find(pageAddress);
+            if (found == m_pages.end())
+            {
+                break;
+            }
+            const ReplayPage* page = found->second;
+            uint32_t pageOffset = (uint32_t)(offset - pageAddress);
+            uint32_t validLength = page->ValidLength(pageOffset);
+            uint32_t length = std::min(bufferSize - bytesRead, validLength);
+            memcpy((BYTE*)buffer + bytesRead, page->data + pageOffset, length);
+            bytesRead += length;
+            offset += length;
+
+            // The recording doesn't have the rest of this page
+            if (pageOffset + validLength < REPLAY_PAGE_SIZE)
+            {
+                break;
+            }
+        }
+
+        HRESULT hr = S_OK;
+        if (bufferSize > 0 && bytesRead == 0)
+        {
+            // Replay the failure of a read the recording saw fail
+            const ReplayFailedRead* failedRead = FindFailedRead(offset);
+            if (failedRead != nullptr)
+            {
+                hr = failedRead->hr;
+            }
+            else
+            {
+                m_missedReads++;
+                hr = E_FAIL;
+            }
+        }
+        if (pbytesRead)
+        {
+            *pbytesRead = bytesRead;
+        }
+        return hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetNumberModules(
+        PULONG loaded,
+        PULONG unloaded)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetNumberModules, RecordingBuffer());
+        if (entry == nullptr)
+        {
+            return E_FAIL;
+        }
+        RecordingReader reader(entry->value);
+        uint32_t numLoaded = 0, numUnloaded = 0;
+        reader.Read(&numLoaded);
+        reader.Read(&numUnloaded);
+        if (loaded)
+        {
+            *loaded = numLoaded;
+        }
+        if (unloaded)
+        {
+            *unloaded = numUnloaded;
+        }
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleByIndex(
+        ULONG index,
+        PULONG64 base)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetModuleByIndex, RecordingBuffer().Add((uint32_t)index));
+        if (entry == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        if (base)
+        {
+            RecordingReader(entry->value).Read(base);
+        }
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleByModuleName(
+        PCSTR name,
+        ULONG startIndex,
+        PULONG index,
+        PULONG64 base)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetModuleByModuleName, RecordingBuffer().AddString(name).Add((uint32_t)startIndex));
+        if (entry == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        RecordingReader reader(entry->value);
+        uint32_t moduleIndex = 0;
+        uint64_t moduleBase = 0;
+        reader.Read(&moduleIndex);
+        reader.Read(&moduleBase);
+        if (index)
+        {
+            *index = moduleIndex;
+        }
+        if (base)
+        {
+            *base = moduleBase;
+        }
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleByOffset(
+        ULONG64 offset,
+        ULONG startIndex,
+        PULONG index,
+        PULONG64 base)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetModuleByOffset, RecordingBuffer().Add((uint64_t)offset).Add((uint32_t)startIndex));
+        if (entry == nullptr)
+        {
+            return E_FAIL;
+        }
+        RecordingReader reader(entry->value);
+        uint32_t moduleIndex = 0;
+        uint64_t moduleBase = 0;
+        reader.Read(&moduleIndex);
+        reader.Read(&moduleBase);
+        if (index)
+        {
+            *index = moduleIndex;
+        }
+        if (base)
+        {
+            *base = moduleBase;
+        }
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleNames(
+        ULONG index,
+        ULONG64 base,
+        PSTR imageNameBuffer,
+        ULONG imageNameBufferSize,
+        PULONG imageNameSize,
+        PSTR moduleNameBuffer,
+        ULONG moduleNameBufferSize,
+        PULONG moduleNameSize,
+        PSTR loadedImageNameBuffer,
+        ULONG loadedImageNameBufferSize,
+        PULONG loadedImageNameSize)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetModuleNames, RecordingBuffer().Add((uint32_t)index).Add((uint64_t)base));
+        if (entry == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        if (FAILED(entry->hr))
+        {
+            return entry->hr;
+        }
+        RecordingReader reader(entry->value);
+        std::string imageName;
+        std::string moduleName;
+        reader.ReadString(imageName);
+        reader.ReadString(moduleName);
+        CopyString(imageName, imageNameBuffer, imageNameBufferSize, imageNameSize);
+        CopyString(moduleName, moduleNameBuffer, moduleNameBufferSize, moduleNameSize);
+        CopyString(imageName, loadedImageNameBuffer, loadedImageNameBufferSize, loadedImageNameSize);
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetCurrentProcessSystemId(
+        PULONG id)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetCurrentProcessSystemId, RecordingBuffer());
+        if (entry == nullptr)
+        {
+            *id = 0;
+            return E_FAIL;
+        }
+        RecordingReader(entry->value).Read(id);
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetCurrentThreadId(
+        PULONG id)
+    {
+        ULONG sysId;
+        HRESULT hr = GetCurrentThreadSystemId(&sysId);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        return GetThreadIdBySystemId(sysId, id);
+    }
+
+    HRESULT STDMETHODCALLTYPE SetCurrentThreadId(
+        ULONG id)
+    {
+        for (const auto& thread : m_threads)
+        {
+            if (thread.first == id && thread.second != 0)
+            {
+                return SetCurrentThreadSystemId(thread.second);
+            }
+        }
+        return E_FAIL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetCurrentThreadSystemId(
+        PULONG sysId)
+    {
+        if (m_currentThreadSet)
+        {
+            *sysId = m_currentThreadSystemId;
+            return S_OK;
+        }
+        const ReplayEntry* entry = Find(RecordingOp::GetCurrentThreadSystemId, RecordingBuffer());
+        if (entry == nullptr)
+        {
+            *sysId = 0;
+            return E_FAIL;
+        }
+        RecordingReader(entry->value).Read(sysId);
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetThreadIdBySystemId(
+        ULONG sysId,
+        PULONG threadId)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetThreadIdBySystemId, RecordingBuffer().Add((uint32_t)sysId));
+        if (entry != nullptr)
+        {
+            RecordingReader(entry->value).Read(threadId);
+            return entry->hr;
+        }
+        for (const auto& thread : m_threads)
+        {
+            if (thread.second == sysId)
+            {
+                *threadId = thread.first;
+                return S_OK;
+            }
+        }
+        *threadId = 0;
+        return E_FAIL;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetThreadContextBySystemId(
+        ULONG32 sysId,
+        ULONG32 contextFlags,
+        ULONG32 contextSize,
+        PBYTE context)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetThreadContextBySystemId,
+            RecordingBuffer().Add((uint32_t)sysId).Add((uint32_t)contextFlags).Add((uint32_t)contextSize));
+        if (entry == nullptr)
+        {
+            return E_FAIL;
+        }
+        if (entry->hr == S_OK)
+        {
+            memcpy(context, entry->value.data(), std::min((size_t)contextSize, entry->value.size()));
+        }
+        return entry->hr;
+    }
+
+    //----------------------------------------------------------------------------
+    // ILLDBServices2
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE GetModuleInfo(
+        ULONG index,
+        PULONG64 moduleBase,
+        PULONG64 moduleSize,
+        PULONG timestamp,
+        PULONG checksum)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetModuleInfo, RecordingBuffer().Add((uint32_t)index));
+        if (entry == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        RecordingReader reader(entry->value);
+        uint64_t base = 0, size = 0;
+        uint32_t moduleTimestamp = 0, moduleChecksum = 0;
+        reader.Read(&base);
+        reader.Read(&size);
+        reader.Read(&moduleTimestamp);
+        reader.Read(&moduleChecksum);
+        if (moduleBase)
+        {
+            *moduleBase = base;
+        }
+        if (moduleSize)
+        {
+            *moduleSize = size;
+        }
+        if (timestamp)
+        {
+            *timestamp = moduleTimestamp;
+        }
+        if (checksum)
+        {
+            *checksum = moduleChecksum;
+        }
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetModuleVersionInformation(
+        ULONG index,
+        ULONG64 base,
+        PCSTR item,
+        PVOID buffer,
+        ULONG bufferSize,
+        PULONG versionInfoSize)
+    {
+        if (item == nullptr || buffer == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        const ReplayEntry* entry = Find(RecordingOp::GetModuleVersionInformation,
+            RecordingBuffer().Add((uint32_t)index).Add((uint64_t)base).AddString(item));
+        if (entry == nullptr)
+        {
+            return E_FAIL;
+        }
+        if (entry->hr == S_OK)
+        {
+            size_t size = std::min((size_t)bufferSize, entry->value.size());
+            memcpy(buffer, entry->value.data(), size);
+        }
+        return entry->hr;
+    }
+
+    //----------------------------------------------------------------------------
+    // IDebuggerServices
+    //----------------------------------------------------------------------------
+
+    HRESULT STDMETHODCALLTYPE GetOperatingSystem(
+        IDebuggerServices::OperatingSystem* operatingSystem)
+    {
+        *operatingSystem = (IDebuggerServices::OperatingSystem)m_header.operatingSystem;
+        return S_OK;
+    }
+
+    void STDMETHODCALLTYPE OutputString(
+        ULONG mask,
+        PCSTR message)
+    {
+        if (!m_quiet)
+        {
+            fputs(message, stdout);
+        }
+    }
+
+    HRESULT STDMETHODCALLTYPE GetNumberThreads(
+        PULONG number)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetNumberThreads, RecordingBuffer());
+        if (entry == nullptr)
+        {
+            *number = (ULONG)m_threads.size();
+            return S_OK;
+        }
+        RecordingReader(entry->value).Read(number);
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetThreadIdsByIndex(
+        ULONG start,
+        ULONG count,
+        PULONG ids,
+        PULONG sysIds)
+    {
+        // Same indexing as the lldb plugin: the ids are stored at their thread index
+        for (ULONG index = start; index < start + count; index++)
+        {
+            if (index >= m_threads.size())
+            {
+                return E_INVALIDARG;
+            }
+            if (ids != nullptr)
+            {
+                ids[index] = m_threads[index].first;
+            }
+            if (sysIds != nullptr)
+            {
+                sysIds[index] = m_threads[index].second;
+            }
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetCurrentThreadSystemId(
+        ULONG sysId)
+    {
+        m_currentThreadSystemId = sysId;
+        m_currentThreadSet = true;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetSymbolByOffset(
+        ULONG moduleIndex,
+        ULONG64 offset,
+        PSTR nameBuffer,
+        ULONG nameBufferSize,
+        PULONG nameSize,
+        PULONG64 displacement)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetNameByOffset, RecordingBuffer().Add((uint32_t)moduleIndex).Add((uint64_t)offset));
+        if (entry == nullptr)
+        {
+            return E_FAIL;
+        }
+        RecordingReader reader(entry->value);
+        uint64_t disp = DEBUG_INVALID_OFFSET;
+        std::string name;
+        reader.Read(&disp);
+        reader.ReadString(name);
+        CopyString(name, nameBuffer, nameBufferSize, nameSize);
+        if (displacement)
+        {
+            *displacement = disp;
+        }
+        return entry->hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetOffsetBySymbol(
+        ULONG moduleIndex,
+        PCSTR name,
+        PULONG64 offset)
+    {
+        const ReplayEntry* entry = Find(RecordingOp::GetOffsetBySymbol, RecordingBuffer().Add((uint32_t)moduleIndex).AddString(name));
+        if (entry == nullptr)
+        {
+            return E_INVALIDARG;
+        }
+        if (entry->hr == S_OK)
+        {
+            RecordingReader(entry->value).Read(offset);
+        }
+        return entry->hr;
+    }
+};
+
+static void
+Usage()
+{
+    fprintf(stderr, "Usage: sosreplay [-q] [-warm] [-n <iterations>] <libsos path> <recording> \"<command> [args]\" ...\n");
+}
+
+int
+main(int argc, char* argv[])
+{
+    bool quiet = false;
+    bool warm = false;
+    int iterations = 5;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-q") == 0)
+        {
+            quiet = true;
+        }
+        else if (strcmp(argv[arg], "-warm") == 0)
+        {
+            warm = true;
+        }
+        else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+        {
+            iterations = atoi(argv[++arg]);
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+    if (argc - arg < 3 || iterations <= 0)
+    {
+        Usage();
+        return 1;
+    }
+    const char* sosPath = argv[arg++];
+    const char* recordingPath = argv[arg++];
+
+    ReplayServices* services = new ReplayServices(quiet);
+    if (!services->Load(recordingPath))
+    {
+        return 1;
+    }
+
+    NativeSOSLibrary sos;
+    if (!sos.Initialize(sosPath, services))
+    {
+        return 1;
+    }
+    CommandFunc flushFunc = sos.GetExport("SOSFlush");
+    if (flushFunc == nullptr)
+    {
+        fprintf(stderr, "'%s' doesn't export SOSFlush\n", sosPath);
+        return 1;
+    }
+
+    int result = 0;
+    for (; arg < argc; arg++)
+    {
+        std::string args;
+        CommandFunc commandFunc = sos.GetCommand(argv[arg], args);
+        if (commandFunc == nullptr)
+        {
+            result = 1;
+            continue;
+        }
+
+        std::vector<double> times;
+        for (int i = 0; i < iterations; i++)
+        {
+            if (!warm)
+            {
+                services->SetQuiet(true);
+                flushFunc(services, "");
+                services->SetQuiet(quiet);
+            }
+            services->ResetCounters();
+
+            auto start = std::chrono::steady_clock::now();
+            HRESULT hr = commandFunc(services, args.c_str());
+            auto end = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+            if (hr != S_OK)
+            {
+                fprintf(stderr, "%s failed %08x\n", argv[arg], hr);
+                result = 1;
+                break;
+            }
+        }
+        if (times.empty())
+        {
+            continue;
+        }
+        std::sort(times.begin(), times.end());
+        printf("%s: %zu iterations min %.3f ms median %.3f ms max %.3f ms reads %llu missed reads %llu missed calls %llu\n",
+            argv[arg],
+            times.size(),
+            times.front(),
+            times[times.size() / 2],
+            times.back(),
+            (unsigned long long)services->Reads(),
+            (unsigned long long)services->MissedReads(),
+            (unsigned long long)services->MissedCalls());
+    }
+    return result;
+}
@@ -0,0 +1,167 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+// Measures the throughput of the minipal UTF-8 <-> UTF-16 converters on inputs that
+// resemble what SOS converts: short and long ASCII identifiers, and mostly-ASCII text
+// with occasional multi-byte characters. Each operation is timed through both the
+// scalar converters (utf8scalar.c) and the vectorized ones and the speedup reported.
+//
+// usage: utf8bench [units per workload]
+
+#include <minipal/utf8.h>
+#include <minipal/time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The converters without the ASCII fast path, from utf8scalar.c
+size_t scalar_get_length_utf8_to_utf16(const char* source, size_t sourceLength, unsigned int flags);
+size_t scalar_get_length_utf16_to_utf8(const CHAR16_T* source, size_t sourceLength, unsigned int flags);
+size_t scalar_convert_utf8_to_utf16(const char* source, size_t sourceLength, CHAR16_T* destination, size_t destinationLength, unsigned int flags);
+size_t scalar_convert_utf16_to_utf8(const CHAR16_T* source, size_t sourceLength, char* destination, size_t destinationLength, unsigned int flags);
+
+typedef struct
+{
+    const char* name;
+    size_t length;          // in UTF-16 code units
+    int nonAsciiInterval;   // 0 for pure ASCII
+} Workload;
+
+static const Workload s_workloads[] =
+{
+    { "ascii-32",       32,         0 },
+    { "ascii-256",      256,        0 },
+    { "ascii-64k",      64 * 1024,  0 },
+    { "mixed-256",      256,        64 },
+    { "mixed-64k",      64 * 1024,  64 },
+    { "dense-64k",      64 * 1024,  4 },
+};
+
+static void FillSource(CHAR16_T* text, size_t length, int nonAsciiInterval)
+{
+    static const char identifier[] = "System.Collections.Generic.Dictionary`2+Entry[[System.String, System.Private.CoreLib]]";
+    for (size_t i = 0; i < length; i++)
+    {
+        if (nonAsciiInterval != 0 && (i % nonAsciiInterval) == (size_t)(nonAsciiInterval - 1))
+        {
+            // Alternate between two and three byte UTF-8 sequences
+            text[i] = (i / nonAsciiInterval) & 1 ? (CHAR16_T)0x00E9 : (CHAR16_T)0x4E2D;
+        }
+        else
+        {
+            text[i] = (CHAR16_T)identifier[i % (sizeof(identifier) - 1)];
+        }
+    }
+}
+
+static double ElapsedNanoseconds(int64_t start, int64_t end)
+{
+    return (double)(end - start) * 1e9 / (double)minipal_hires_tick_frequency();
+}
+
+static void Report(const char* workload, const char* operation, double scalarNanoseconds, double vectorNanoseconds, size_t units, int iterations)
+{
+    printf("%-12s %-22s scalar %12.1f ns/call %8.3f units/ns  vector %12.1f ns/call %8.3f units/ns  speedup %6.2fx\n",
+        workload,
+        operation,
+        scalarNanoseconds / iterations,
+        (double)units * iterations / scalarNanoseconds,
+        vectorNanoseconds / iterations,
+        (double)units * iterations / vectorNanoseconds,
+        scalarNanoseconds / vectorNanoseconds);
+}
+
+// Times the iterations of one call, accumulating the results into sink so the calls
+// can't be optimized away
+#define TIME_CALL(nanoseconds, call) \
+    do \
+    { \
+        int64_t start = minipal_hires_ticks(); \
+        for (int i = 0; i < iterations; i++) \
+            sink += (call); \
+        nanoseconds = ElapsedNanoseconds(start, minipal_hires_ticks()); \
+    } while (0)
+
+static int RunWorkload(const Workload* workload, int iterations)
+{
+    size_t length = workload->length;
+    CHAR16_T* utf16 = (CHAR16_T*)malloc(length * sizeof(CHAR16_T));
+    CHAR16_T* roundTrip = (CHAR16_T*)malloc(length * sizeof(CHAR16_T));
+    char* utf8 = (char*)malloc(length * 3);
+    char* scalarUtf8 = (char*)malloc(length * 3);
+    if (utf16 == NULL || roundTrip == NULL || utf8 == NULL || scalarUtf8 == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    FillSource(utf16, length, workload->nonAsciiInterval);
+    size_t utf8Length = minipal_convert_utf16_to_utf8(utf16, length, utf8, length * 3, 0);
+    if (utf8Length == 0 ||
+        minipal_convert_utf8_to_utf16(utf8, utf8Length, roundTrip, length, 0) != length ||
+        memcmp(utf16, roundTrip, length * sizeof(CHAR16_T)) != 0)
+    {
+        fprintf(stderr, "%s: round trip failed\n", workload->name);
+        return 1;
+    }
+    if (scalar_convert_utf16_to_utf8(utf16, length, scalarUtf8, length * 3, 0) != utf8Length ||
+        memcmp(utf8, scalarUtf8, utf8Length) != 0)
+    {
+        fprintf(stderr, "%s: scalar and vector results differ\n", workload->name);
+        return 1;
+    }
+
+    size_t sink = 0;
+    double scalar, vector;
+
+    TIME_CALL(scalar, scalar_get_length_utf16_to_utf8(utf16, length, 0));
+    TIME_CALL(vector, minipal_get_length_utf16_to_utf8(utf16, length, 0));
+    Report(workload->name, "length utf16->utf8", scalar, vector, length, iterations);
+
+    TIME_CALL(scalar, scalar_convert_utf16_to_utf8(utf16, length, utf8, length * 3, 0));
+    TIME_CALL(vector, minipal_convert_utf16_to_utf8(utf16, length, utf8, length * 3, 0));
+    Report(workload->name, "convert utf16->utf8", scalar, vector, length, iterations);
+
+    TIME_CALL(scalar, scalar_get_length_utf8_to_utf16(utf8, utf8Length, 0));
+    TIME_CALL(vector, minipal_get_length_utf8_to_utf16(utf8, utf8Length, 0));
+    Report(workload->name, "length utf8->utf16", scalar, vector, utf8Length, iterations);
+
+    TIME_CALL(scalar, scalar_convert_utf8_to_utf16(utf8, utf8Length, roundTrip, length, 0));
+    TIME_CALL(vector, minipal_convert_utf8_to_utf16(utf8, utf8Length, roundTrip, length, 0));
+    Report(workload->name, "convert utf8->utf16", scalar, vector, utf8Length, iterations);
+
+    if (sink == 0)
+    {
+        fprintf(stderr, "%s: unexpected empty result\n", workload->name);
+    }
+
+    free(scalarUtf8);
+    free(utf8);
+    free(roundTrip);
+    free(utf16);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // Scale the iteration count so each workload converts roughly the same amount of text
+    int totalUnits = argc > 1 ? atoi(argv[1]) : 64 * 1024 * 1024;
+    if (totalUnits <= 0)
+    {
+        fprintf(stderr, "usage: utf8bench [units per workload]\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(s_workloads) / sizeof(s_workloads[0]); i++)
+    {
+        const Workload* workload = &s_workloads[i];
+        int iterations = (int)(totalUnits / workload->length);
+        if (iterations == 0)
+            iterations = 1;
+
+        if (RunWorkload(workload, iterations) != 0)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+// A second copy of the minipal converters built without the vectorized ASCII fast
+// path and renamed with a scalar_ prefix, so utf8bench can time both implementations
+// in the same process.
+
+#define MINIPAL_UTF8_NO_ASCII_FAST_PATH
+#define minipal_get_length_utf8_to_utf16 scalar_get_length_utf8_to_utf16
+#define minipal_get_length_utf16_to_utf8 scalar_get_length_utf16_to_utf8
+#define minipal_convert_utf8_to_utf16 scalar_convert_utf8_to_utf16
+#define minipal_convert_utf16_to_utf8 scalar_convert_utf16_to_utf8
+
+#include <minipal/utf8.c>